@@ -42,6 +42,14 @@ int main(int argc, char* argv[])
 	HCSearch::Global::settings->paths->OUTPUT_TEMP_FOLDER_NAME = po.tempFolderName;
 
 	HCSearch::Global::settings->USE_EDGE_WEIGHTS = po.useEdgeWeights;
+	HCSearch::Global::settings->NUM_THREADS = po.numThreads;
+	HCSearch::Global::settings->RAND_SEED = po.randSeed;
+	HCSearch::Global::settings->USE_FLOAT_FEATURES = po.useFloatFeatures;
+	HCSearch::Global::settings->MAX_COST_SET_SIZE = po.maxCostSetSize;
+	HCSearch::Global::settings->SEARCH_NODE_SNAPSHOT_INTERVAL = po.snapshotInterval;
+	HCSearch::Global::settings->TRANSPOSITION_TABLE_SIZE = po.transpositionTableSize;
+	HCSearch::Global::settings->TRANSPOSITION_TABLE_EVICTION = po.transpositionTableEviction;
+	HCSearch::Global::settings->TRANSPOSITION_TABLE_FEATURES = po.transpositionTableFeatures;
 
 	HCSearch::Global::settings->paths->OUTPUT_HEURISTIC_MODEL_FILE_NAME = po.heuristicModelFileName;
 	HCSearch::Global::settings->paths->OUTPUT_COST_H_MODEL_FILE_NAME = po.costModelFileName;
@@ -135,6 +143,10 @@ HCSearch::SearchSpace* setupSearchSpace(MyProgramOptions::ProgramOptions po)
 		LOG() << "dense CRF features" << endl;
 		heuristicFeatFunc = new HCSearch::DenseCRFFeatures();
 		break;
+	case MyProgramOptions::ProgramOptions::DENSE_CRF_FILTERED:
+		LOG() << "dense CRF features (filtered pairwise term)" << endl;
+		heuristicFeatFunc = new HCSearch::DenseCRFFeatures(HCSearch::DenseCRFFeatures::FILTERED);
+		break;
 	case MyProgramOptions::ProgramOptions::STANDARD_SIMPLE:
 		LOG() << "standard simple CRF features" << endl;
 		LOG() << "\tlambda1=" << po.lambda1 << endl;
@@ -204,6 +216,10 @@ HCSearch::SearchSpace* setupSearchSpace(MyProgramOptions::ProgramOptions po)
 		LOG() << "dense CRF features" << endl;
 		costFeatFunc = new HCSearch::DenseCRFFeatures();
 		break;
+	case MyProgramOptions::ProgramOptions::DENSE_CRF_FILTERED:
+		LOG() << "dense CRF features (filtered pairwise term)" << endl;
+		costFeatFunc = new HCSearch::DenseCRFFeatures(HCSearch::DenseCRFFeatures::FILTERED);
+		break;
 	case MyProgramOptions::ProgramOptions::STANDARD_SIMPLE:
 		LOG() << "standard simple CRF features" << endl;
 		LOG() << "\tlambda1=" << po.lambda1 << endl;
@@ -273,6 +289,10 @@ HCSearch::SearchSpace* setupSearchSpace(MyProgramOptions::ProgramOptions po)
 		LOG() << "dense CRF features" << endl;
 		pruneFeatFunc = new HCSearch::DenseCRFFeatures();
 		break;
+	case MyProgramOptions::ProgramOptions::DENSE_CRF_FILTERED:
+		LOG() << "dense CRF features (filtered pairwise term)" << endl;
+		pruneFeatFunc = new HCSearch::DenseCRFFeatures(HCSearch::DenseCRFFeatures::FILTERED);
+		break;
 	case MyProgramOptions::ProgramOptions::STANDARD_PRUNE:
 		LOG() << "standard prune features" << endl;
 		pruneFeatFunc = new HCSearch::StandardPruneFeatures();
@@ -947,6 +967,7 @@ void runSlave(vector<string> commands, vector<string> messages,
 			meta.setType = HCSearch::TEST;
 			meta.exampleName = testFiles[i];
 			meta.iter = iter;
+			meta.timeBudget = po.timeBudget;
 
 			HCSearch::ImgFeatures* XTestObj = NULL;
 			HCSearch::ImgLabeling* YTestObj = NULL;
@@ -1006,6 +1027,7 @@ void runSlave(vector<string> commands, vector<string> messages,
 			meta.setType = HCSearch::TEST;
 			meta.exampleName = testFiles[i];
 			meta.iter = iter;
+			meta.timeBudget = po.timeBudget;
 
 			HCSearch::ImgFeatures* XTestObj = NULL;
 			HCSearch::ImgLabeling* YTestObj = NULL;
@@ -1067,6 +1089,7 @@ void runSlave(vector<string> commands, vector<string> messages,
 			meta.setType = HCSearch::TEST;
 			meta.exampleName = testFiles[i];
 			meta.iter = iter;
+			meta.timeBudget = po.timeBudget;
 
 			HCSearch::ImgFeatures* XTestObj = NULL;
 			HCSearch::ImgLabeling* YTestObj = NULL;
@@ -1129,6 +1152,7 @@ void runSlave(vector<string> commands, vector<string> messages,
 			meta.setType = HCSearch::TEST;
 			meta.exampleName = testFiles[i];
 			meta.iter = iter;
+			meta.timeBudget = po.timeBudget;
 
 			HCSearch::ImgFeatures* XTestObj = NULL;
 			HCSearch::ImgLabeling* YTestObj = NULL;
@@ -1224,6 +1248,10 @@ void printInfo(MyProgramOptions::ProgramOptions po)
 		LOG() << "Save anytime predictions: " << po.saveAnytimePredictions << endl;
 		LOG() << "Save features files: " << po.saveFeaturesFiles << endl;
 		LOG() << "Save output label masks: " << po.saveOutputMask << endl;
+		LOG() << "Float features: " << po.useFloatFeatures;
+		if (po.useFloatFeatures)
+			LOG() << " (" << MySIMD::instructionSetName(MySIMD::getInstructionSet()) << ")";
+		LOG() << endl;
 	}
 	else
 	{
@@ -28,6 +28,7 @@ namespace MyProgramOptions
 		// time bound
 
 		timeBound = 0;
+		timeBudget = 0;
 
 		// schedule or demo
 
@@ -64,6 +65,14 @@ namespace MyProgramOptions
 		pruneRatio = 0.5;
 		badPruneRatio = 1.0;
 		useEdgeWeights = false;
+		numThreads = 1;
+		randSeed = 1;
+		useFloatFeatures = false;
+		maxCostSetSize = 0;
+		snapshotInterval = 0;
+		transpositionTableSize = 0;
+		transpositionTableEviction = HCSearch::EVICT_LRU;
+		transpositionTableFeatures = false;
 
 		nodeClamp = false;
 		edgeClamp = false;
@@ -483,6 +492,8 @@ namespace MyProgramOptions
 						po.heuristicFeaturesMode = STANDARD_CONF;
 					else if (strcmp(argv[i+1], "dense-crf") == 0)
 						po.heuristicFeaturesMode = DENSE_CRF;
+					else if (strcmp(argv[i+1], "dense-crf-filtered") == 0)
+						po.heuristicFeaturesMode = DENSE_CRF_FILTERED;
 					else if (strcmp(argv[i+1], "unary") == 0)
 						po.heuristicFeaturesMode = UNARY;
 					else if (strcmp(argv[i+1], "unary-conf") == 0)
@@ -513,6 +524,8 @@ namespace MyProgramOptions
 						po.costFeaturesMode = STANDARD_CONF;
 					else if (strcmp(argv[i+1], "dense-crf") == 0)
 						po.costFeaturesMode = DENSE_CRF;
+					else if (strcmp(argv[i+1], "dense-crf-filtered") == 0)
+						po.costFeaturesMode = DENSE_CRF_FILTERED;
 					else if (strcmp(argv[i+1], "unary") == 0)
 						po.costFeaturesMode = UNARY;
 					else if (strcmp(argv[i+1], "unary-conf") == 0)
@@ -543,6 +556,8 @@ namespace MyProgramOptions
 						po.pruneFeaturesMode = STANDARD_CONF;
 					else if (strcmp(argv[i+1], "dense-crf") == 0)
 						po.pruneFeaturesMode = DENSE_CRF;
+					else if (strcmp(argv[i+1], "dense-crf-filtered") == 0)
+						po.pruneFeaturesMode = DENSE_CRF_FILTERED;
 					else if (strcmp(argv[i+1], "unary") == 0)
 						po.pruneFeaturesMode = UNARY;
 					else if (strcmp(argv[i+1], "unary-conf") == 0)
@@ -717,6 +732,101 @@ namespace MyProgramOptions
 						po.useEdgeWeights = false;
 				}
 			}
+			else if (strcmp(argv[i], "--float-features") == 0)
+			{
+				po.useFloatFeatures = true;
+				if (i + 1 != argc)
+				{
+					if (strcmp(argv[i+1], "false") == 0)
+						po.useFloatFeatures = false;
+				}
+			}
+			else if (strcmp(argv[i], "--cost-set-size") == 0)
+			{
+				if (i + 1 != argc)
+				{
+					po.maxCostSetSize = atoi(argv[i+1]);
+					if (po.maxCostSetSize < 0)
+					{
+						LOG(ERROR) << "Invalid cost set size!";
+						HCSearch::abort();
+					}
+				}
+			}
+			else if (strcmp(argv[i], "--snapshot-interval") == 0)
+			{
+				if (i + 1 != argc)
+				{
+					po.snapshotInterval = atoi(argv[i+1]);
+					if (po.snapshotInterval < 0)
+					{
+						LOG(ERROR) << "Invalid snapshot interval!";
+						HCSearch::abort();
+					}
+				}
+			}
+			else if (strcmp(argv[i], "--transposition-size") == 0)
+			{
+				if (i + 1 != argc)
+				{
+					po.transpositionTableSize = atoi(argv[i+1]);
+					if (po.transpositionTableSize < 0)
+					{
+						LOG(ERROR) << "Invalid transposition table size!";
+						HCSearch::abort();
+					}
+				}
+			}
+			else if (strcmp(argv[i], "--transposition-eviction") == 0)
+			{
+				if (i + 1 != argc)
+				{
+					if (strcmp(argv[i+1], "fifo") == 0)
+						po.transpositionTableEviction = HCSearch::EVICT_FIFO;
+					else if (strcmp(argv[i+1], "lru") == 0)
+						po.transpositionTableEviction = HCSearch::EVICT_LRU;
+				}
+			}
+			else if (strcmp(argv[i], "--transposition-features") == 0)
+			{
+				po.transpositionTableFeatures = true;
+				if (i + 1 != argc)
+				{
+					if (strcmp(argv[i+1], "false") == 0)
+						po.transpositionTableFeatures = false;
+				}
+			}
+			else if (strcmp(argv[i], "--time-budget") == 0)
+			{
+				if (i + 1 != argc)
+				{
+					po.timeBudget = atoi(argv[i+1]);
+					if (po.timeBudget < 0)
+					{
+						LOG(ERROR) << "Invalid time budget!";
+						HCSearch::abort();
+					}
+				}
+			}
+			else if (strcmp(argv[i], "--threads") == 0)
+			{
+				if (i + 1 != argc)
+				{
+					po.numThreads = atoi(argv[i+1]);
+					if (po.numThreads <= 0)
+					{
+						LOG(ERROR) << "Invalid number of threads!";
+						HCSearch::abort();
+					}
+				}
+			}
+			else if (strcmp(argv[i], "--seed") == 0)
+			{
+				if (i + 1 != argc)
+				{
+					po.randSeed = strtoul(argv[i+1], NULL, 10);
+				}
+			}
 			else
 			{
 				string argvi = argv[i];
@@ -768,6 +878,7 @@ namespace MyProgramOptions
 		cerr << "\t--anytime arg\t\t\t" << ": turn on saving anytime predictions if true" << endl;
 		cerr << "\t--base-path arg\t\t\t" << ": path to this program (default is pwd)" << endl;
 		cerr << "\t--beam-size arg\t\t\t" << ": beam size for beam search" << endl;
+		cerr << "\t--cost-set-size arg\t\t" << ": max nodes kept in the beam/greedy search cost set (default 0 for unbounded)" << endl;
 		cerr << "\t--cut-mode arg\t\t\t" << ": edges|state (cut edges by edges independently or by state)" << endl;
 		cerr << "\t--cut-param arg\t\t\t" << ": temperature parameter for stochastic cuts" << endl;
 		cerr << "\t--edge-clamp arg\t" << ": clamp edges if true" << endl;
@@ -775,16 +886,17 @@ namespace MyProgramOptions
 		cerr << "\t--edge-clamp-negative-threshold arg\t" << ": edge clamp negative threshold" << endl;
 		cerr << "\t--edges-path arg\t" << ": edges folder name" << endl;
 		cerr << "\t--edge-features-path arg\t" << ": edge features folder name" << endl;
+		cerr << "\t--float-features arg\t\t" << ": use single-precision SIMD feature kernels if true" << endl;
 		cerr << "\t--hmodel-filename arg\t\t\t" << ": heuristic model file name" << endl;
 		cerr << "\t--cmodel-filename arg\t\t\t" << ": cost model file name" << endl;
 		cerr << "\t--cohmodel-filename arg\t\t\t" << ": cost oracle H model file name" << endl;
 		cerr << "\t--pmodel-filename arg\t\t\t" << ": prune model file name" << endl;
 		cerr << "\t--hfeatures arg\t\t\t" << ": standard|standard-context|standard-conf|unary|unary-conf|"
-			"standard-pair-counts|standard-conf-pair-counts|dense-crf|standard-simple|standard-simple-context|standard-simple-action-context" << endl;
+			"standard-pair-counts|standard-conf-pair-counts|dense-crf|dense-crf-filtered|standard-simple|standard-simple-context|standard-simple-action-context" << endl;
 		cerr << "\t--cfeatures arg\t\t\t" << ": standard|standard-context|standard-conf|unary|unary-conf|"
-			"standard-pair-counts|standard-conf-pair-counts|dense-crf|standard-simple|standard-simple-context|standard-simple-action-context" << endl;
+			"standard-pair-counts|standard-conf-pair-counts|dense-crf|dense-crf-filtered|standard-simple|standard-simple-context|standard-simple-action-context" << endl;
 		cerr << "\t--pfeatures arg\t\t" << ": standard|standard-context|standard-conf|unary|unary-conf|"
-			"standard-pair-counts|standard-conf-pair-counts|dense-crf|standard-prune|standard-simple|standard-simple-context|standard-simple-action-context" << endl;
+			"standard-pair-counts|standard-conf-pair-counts|dense-crf|dense-crf-filtered|standard-prune|standard-simple|standard-simple-context|standard-simple-action-context" << endl;
 		cerr << "\t--logs-path arg\t" << ": logs folder name" << endl;
 		cerr << "\t--max-cutting-threshold arg\t" << ": maximum threshold for deciding to cut edges" << endl;
 		cerr << "\t--min-cutting-threshold arg\t" << ": minimum threshold for deciding to cut edges" << endl;
@@ -803,6 +915,8 @@ namespace MyProgramOptions
 		cerr << "\t--save-features arg\t\t" << ": save rank features during learning if true" << endl;
 		cerr << "\t--save-mask arg\t\t\t" << ": save final prediction label masks if true" << endl;
 		cerr << "\t--search arg\t\t\t" << ": greedy|breadthbeam|bestbeam" << endl;
+		cerr << "\t--seed arg\t\t\t" << ": run seed of the random streams (default 1)" << endl;
+		cerr << "\t--snapshot-interval arg\t" << ": keep full search node labelings only every k levels (default 0 for all)" << endl;
 		cerr << "\t--splits-path arg\t\t" << ": specify alternate path to splits folder" << endl;
 		cerr << "\t--splits-train-file arg\t" << ": specify alternate file name to train file" << endl;
 		cerr << "\t--splits-valid-file arg\t" << ": specify alternate file name to validation file" << endl;
@@ -812,6 +926,11 @@ namespace MyProgramOptions
 			<< "cut-schedule|cut-schedule-neighbors|cut-schedule-confidences-neighbors"
 			<< "stochastic-schedule|stochastic-schedule-neighbors|stochastic-schedule-confidences-neighbors|stochastic-constrained" << endl;
 		cerr << "\t--temp-path arg\t" << ": temp folder name" << endl;
+		cerr << "\t--threads arg\t\t\t" << ": number of threads for constructing successors (default 1)" << endl;
+		cerr << "\t--time-budget arg\t\t" << ": wall-clock time budget per inference search in ms (default 0 for none)" << endl;
+		cerr << "\t--transposition-size arg\t" << ": capacity of the per-search transposition table (default 0 for disabled)" << endl;
+		cerr << "\t--transposition-eviction arg\t" << ": fifo|lru (eviction policy of the transposition table)" << endl;
+		cerr << "\t--transposition-features arg\t" << ": also cache features in the transposition table if true (needed when learning)" << endl;
 		cerr << "\t--use-edge-weights arg\t\t" << ": use edge weights if true (must provide --edges-path)" << endl;
 		cerr << "\t--unique-iter arg\t\t" << ": unique iteration ID (num-test-iters needs to be 1)" << endl;
 		cerr << "\t--verbose arg\t\t\t" << ": turn on verbose output if true" << endl;
@@ -16,7 +16,7 @@ namespace MyProgramOptions
 		// constants
 
 		enum SearchProcedureMode { GREEDY, BREADTH_BEAM, BEST_BEAM };
-		enum FeaturesMode { STANDARD, STANDARD_CONTEXT, STANDARD_ALT, STANDARD_CONF, DENSE_CRF, UNARY, UNARY_CONF, STANDARD_PAIR_COUNTS, STANDARD_CONF_PAIR_COUNTS, STANDARD_PRUNE, STANDARD_SIMPLE,
+		enum FeaturesMode { STANDARD, STANDARD_CONTEXT, STANDARD_ALT, STANDARD_CONF, DENSE_CRF, DENSE_CRF_FILTERED, UNARY, UNARY_CONF, STANDARD_PAIR_COUNTS, STANDARD_CONF_PAIR_COUNTS, STANDARD_PRUNE, STANDARD_SIMPLE,
 			STANDARD_SIMPLE_CONTEXT, STANDARD_SIMPLE_ACTION_CONTEXT };
 		enum InitialFunctionMode { LOG_REG };
 		enum SuccessorsMode { FLIPBIT, FLIPBIT_NEIGHBORS, FLIPBIT_CONFIDENCES_NEIGHBORS, 
@@ -50,6 +50,7 @@ namespace MyProgramOptions
 		// time bound
 
 		int timeBound;
+		int timeBudget;
 
 		// schedule or demo
 
@@ -87,6 +88,14 @@ namespace MyProgramOptions
 		double pruneRatio;
 		double badPruneRatio;
 		bool useEdgeWeights;
+		int numThreads;
+		unsigned long randSeed;
+		bool useFloatFeatures;
+		int maxCostSetSize;
+		int snapshotInterval;
+		int transpositionTableSize;
+		HCSearch::EvictionPolicy transpositionTableEviction;
+		bool transpositionTableFeatures;
 
 		bool nodeClamp;
 		bool edgeClamp;
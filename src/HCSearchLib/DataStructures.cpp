@@ -1,4 +1,5 @@
 #include <vector>
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #ifndef USE_WINDOWS
@@ -27,261 +28,1113 @@ namespace HCSearch
 
 	/**************** Graphs ****************/
 
+	NeighborRange::NeighborRange()
+	{
+		this->first = NULL;
+		this->last = NULL;
+	}
+
+	NeighborRange::NeighborRange(const int* first, const int* last)
+	{
+		this->first = first;
+		this->last = last;
+	}
+
+	NeighborRange::const_iterator NeighborRange::begin() const
+	{
+		return this->first;
+	}
+
+	NeighborRange::const_iterator NeighborRange::end() const
+	{
+		return this->last;
+	}
+
+	int NeighborRange::size() const
+	{
+		return this->last - this->first;
+	}
+
+	bool NeighborRange::empty() const
+	{
+		return this->first == this->last;
+	}
+
+	CompressedAdjList::CompressedAdjList()
+	{
+		this->offsets.push_back(0);
+	}
+
+	CompressedAdjList::CompressedAdjList(const AdjList_t& adjList)
+	{
+		const int numNodes = adjList.empty() ? 0 : adjList.rbegin()->first + 1;
+
+		int numEdges = 0;
+		for (AdjList_t::const_iterator it = adjList.begin(); it != adjList.end(); ++it)
+			numEdges += it->second.size();
+
+		this->offsets.assign(numNodes+1, 0);
+		this->neighbors.reserve(numEdges);
+		AdjList_t::const_iterator it = adjList.begin();
+		for (int node = 0; node < numNodes; node++)
+		{
+			this->offsets[node] = this->neighbors.size();
+			if (it != adjList.end() && it->first == node)
+			{
+				this->neighbors.insert(this->neighbors.end(), it->second.begin(), it->second.end());
+				++it;
+			}
+		}
+		this->offsets[numNodes] = this->neighbors.size();
+	}
+
+	CompressedAdjList::~CompressedAdjList()
+	{
+	}
+
+	int CompressedAdjList::getNumNodes() const
+	{
+		return this->offsets.size() - 1;
+	}
+
+	int CompressedAdjList::getNumEdges() const
+	{
+		return this->neighbors.size();
+	}
+
+	NeighborRange CompressedAdjList::getNeighbors(int node) const
+	{
+		if (node < 0 || node >= getNumNodes())
+			return NeighborRange();
+
+		const int* base = this->neighbors.empty() ? NULL : &this->neighbors[0];
+		return NeighborRange(base + this->offsets[node], base + this->offsets[node+1]);
+	}
+
+	int CompressedAdjList::edgeIndex(int node1, int node2) const
+	{
+		NeighborRange range = getNeighbors(node1);
+		const int* it = lower_bound(range.begin(), range.end(), node2);
+		if (it == range.end() || *it != node2)
+			return -1;
+
+		return it - &this->neighbors[0];
+	}
+
+	SharedAdjList::SharedAdjList()
+	{
+	}
+
+	SharedAdjList::SharedAdjList(const AdjList_t& adjList) : data(adjList)
+	{
+		compress();
+	}
+
+	SharedAdjList::~SharedAdjList()
+	{
+	}
+
+	SharedAdjList& SharedAdjList::operator=(const AdjList_t& adjList)
+	{
+		this->data = MyPrimitives::CopyOnWrite< AdjList_t >(adjList);
+		compress();
+		return *this;
+	}
+
+	SharedAdjList::operator const AdjList_t&() const
+	{
+		return this->data.get();
+	}
+
+	const AdjList_t& SharedAdjList::get() const
+	{
+		return this->data.get();
+	}
+
+	AdjList_t& SharedAdjList::mutate()
+	{
+		this->compressed.reset();
+		return this->data.mutate();
+	}
+
+	const NeighborSet_t& SharedAdjList::getNeighbors(int node) const
+	{
+		static const NeighborSet_t noNeighbors;
+
+		AdjList_t::const_iterator it = this->data.get().find(node);
+		if (it == this->data.get().end())
+			return noNeighbors;
+
+		return it->second;
+	}
+
+	NeighborSet_t& SharedAdjList::operator[](int node)
+	{
+		this->compressed.reset();
+		return this->data.mutate()[node];
+	}
+
+	NeighborRange SharedAdjList::neighbors(int node) const
+	{
+		if (!this->compressed)
+		{
+			checkCompressed();
+			return NeighborRange();
+		}
+
+		return this->compressed->getNeighbors(node);
+	}
+
+	shared_ptr< const CompressedAdjList > SharedAdjList::getCompressed() const
+	{
+		if (!this->compressed)
+		{
+			checkCompressed();
+			return shared_ptr< const CompressedAdjList >(new CompressedAdjList());
+		}
+
+		return this->compressed;
+	}
+
+	void SharedAdjList::compress()
+	{
+		this->compressed = shared_ptr< const CompressedAdjList >(new CompressedAdjList(this->data.get()));
+	}
+
+	void SharedAdjList::checkCompressed() const
+	{
+		// an empty list needs no compressed form
+		if (!this->data.get().empty())
+		{
+			LOG(ERROR) << "adjacency list was modified without calling compress()";
+			abort();
+		}
+	}
+
+	AdjList_t::const_iterator SharedAdjList::begin() const
+	{
+		return this->data.get().begin();
+	}
+
+	AdjList_t::const_iterator SharedAdjList::end() const
+	{
+		return this->data.get().end();
+	}
+
+	AdjList_t::const_iterator SharedAdjList::find(int node) const
+	{
+		return this->data.get().find(node);
+	}
+
+	int SharedAdjList::count(int node) const
+	{
+		return this->data.get().count(node);
+	}
+
+	int SharedAdjList::size() const
+	{
+		return this->data.get().size();
+	}
+
+	bool SharedAdjList::empty() const
+	{
+		return this->data.get().empty();
+	}
+
+	bool SharedAdjList::isShared() const
+	{
+		return this->data.isShared();
+	}
+
 	int IGraph::getNumEdges()
 	{
-		int numEdges = 0;
-		for (AdjList_t::iterator it = this->adjList.begin(); it != this->adjList.end(); ++it)
+		return this->adjList.getCompressed()->getNumEdges();
+	}
+
+	/**************** Features and Labelings ****************/
+
+	SharedConfidences::SharedConfidences()
+	{
+	}
+
+	SharedConfidences::SharedConfidences(const MatrixXd& confidences) : data(confidences)
+	{
+	}
+
+	SharedConfidences::~SharedConfidences()
+	{
+	}
+
+	SharedConfidences& SharedConfidences::operator=(const MatrixXd& confidences)
+	{
+		this->data = MyPrimitives::CopyOnWrite< MatrixXd >(confidences);
+		this->classOrder.reset();
+		return *this;
+	}
+
+	double SharedConfidences::operator()(int node, int classIndex) const
+	{
+		return this->data.get()(node, classIndex);
+	}
+
+	int SharedConfidences::rows() const
+	{
+		return this->data.get().rows();
+	}
+
+	int SharedConfidences::cols() const
+	{
+		return this->data.get().cols();
+	}
+
+	const MatrixXd& SharedConfidences::get() const
+	{
+		return this->data.get();
+	}
+
+	MatrixXd& SharedConfidences::mutate()
+	{
+		this->classOrder.reset();
+		return this->data.mutate();
+	}
+
+	bool SharedConfidences::isShared() const
+	{
+		return this->data.isShared();
+	}
+
+	namespace
+	{
+		struct CompareClassesByConfidence
+		{
+			const double* confidences;
+			int stride;
+
+			bool operator() (int lhs, int rhs) const
+			{
+				return this->confidences[lhs*this->stride] > this->confidences[rhs*this->stride];
+			}
+		};
+	}
+
+	void SharedConfidences::computeClassOrder()
+	{
+		const MatrixXd& confidences = this->data.get();
+		const int numNodes = confidences.rows();
+		const int numClasses = confidences.cols();
+
+		ClassOrder_t* order = new ClassOrder_t(numNodes, numClasses);
+		CompareClassesByConfidence compare;
+		compare.stride = confidences.outerStride();
+		for (int node = 0; node < numNodes; node++)
+		{
+			int* classIndices = order->row(node).data();
+			for (int classIndex = 0; classIndex < numClasses; classIndex++)
+				classIndices[classIndex] = classIndex;
+
+			compare.confidences = confidences.data() + node;
+			stable_sort(classIndices, classIndices + numClasses, compare);
+		}
+
+		this->classOrder = shared_ptr< const ClassOrder_t >(order);
+	}
+
+	bool SharedConfidences::classOrderAvailable() const
+	{
+		return this->classOrder != NULL;
+	}
+
+	const int* SharedConfidences::orderedClassIndices(int node) const
+	{
+		return this->classOrder->row(node).data();
+	}
+
+	ImgFeatures::ImgFeatures()
+	{
+		this->filename = "";
+		this->segmentsAvailable = false;
+		this->nodeLocationsAvailable = false;
+		this->edgeKernelsAvailable = false;
+		this->floatFeaturesAvailable = false;
+	}
+
+	ImgFeatures::~ImgFeatures()
+	{
+	}
+
+	int ImgFeatures::getFeatureDim()
+	{
+		return this->graph.nodesData.cols();
+	}
+
+	int ImgFeatures::getNumNodes()
+	{
+		return this->graph.nodesData.rows();
+	}
+
+	int ImgFeatures::getNumEdges()
+	{
+		return this->graph.getNumEdges();
+	}
+
+	double ImgFeatures::getFeature(int node, int featIndex)
+	{
+		return this->graph.nodesData(node, featIndex);
+	}
+
+	string ImgFeatures::getFileName()
+	{
+		return this->filename;
+	}
+
+	double ImgFeatures::getNodeLocationX(int node)
+	{
+		if (!nodeLocationsAvailable)
+		{
+			LOG(ERROR) << "node location not available for getting x.";
+			abort();
+		}
+
+		return this->nodeLocations(node, 0);
+	}
+
+	double ImgFeatures::getNodeLocationY(int node)
+	{
+		if (!nodeLocationsAvailable)
+		{
+			LOG(ERROR) << "node location not available for getting y.";
+			abort();
+		}
+
+		return this->nodeLocations(node, 1);
+	}
+
+	void ImgFeatures::computeFloatFeatures()
+	{
+		this->floatFeatures = shared_ptr< const MySIMD::AlignedFloatMatrix >(
+			new MySIMD::AlignedFloatMatrix(this->graph.nodesData));
+		this->floatFeaturesAvailable = true;
+	}
+
+	void ImgFeatures::addNodeFeatures(int node, double weight, VectorXd& sums, int offset)
+	{
+		if (this->floatFeaturesAvailable)
+		{
+			MySIMD::addScaled(sums.data() + offset, this->floatFeatures->row(node), weight, getFeatureDim());
+			return;
+		}
+
+		sums.segment(offset, getFeatureDim()) += weight * this->graph.nodesData.row(node).transpose();
+	}
+
+	void ImgFeatures::computeEdgeKernels()
+	{
+		if (this->floatFeaturesAvailable)
+			this->edgeKernels.build(this->graph, *this->floatFeatures);
+		else
+			this->edgeKernels.build(this->graph);
+		this->edgeKernelsAvailable = true;
+	}
+
+	VectorXd ImgFeatures::getEdgeContrast(int node1, int node2)
+	{
+		if (this->edgeKernelsAvailable)
+		{
+			int edgeIndex = this->edgeKernels.edgeIndex(node1, node2);
+			if (edgeIndex >= 0)
+				return this->edgeKernels.contrast.row(edgeIndex);
+		}
+
+		if (this->floatFeaturesAvailable)
+		{
+			const int featureDim = getFeatureDim();
+			vector<float> contrast(featureDim);
+			vector<float> absDiff(featureDim);
+			MySIMD::contrastKernel(this->floatFeatures->row(node1), this->floatFeatures->row(node2), 
+				contrast.data(), absDiff.data(), featureDim);
+			return Map<VectorXf>(contrast.data(), featureDim).cast<double>();
+		}
+
+		VectorXd diff = this->graph.nodesData.row(node1) - this->graph.nodesData.row(node2);
+		return (-diff.cwiseAbs2()).array().exp();
+	}
+
+	VectorXd ImgFeatures::getEdgeAbsDiff(int node1, int node2)
+	{
+		if (this->edgeKernelsAvailable)
+		{
+			int edgeIndex = this->edgeKernels.edgeIndex(node1, node2);
+			if (edgeIndex >= 0)
+				return this->edgeKernels.absDiff.row(edgeIndex);
+		}
+
+		VectorXd diff = this->graph.nodesData.row(node1) - this->graph.nodesData.row(node2);
+		return diff.cwiseAbs();
+	}
+
+	/**************** Edge Kernel Cache ****************/
+
+	EdgeKernelCache::EdgeKernelCache()
+	{
+	}
+
+	EdgeKernelCache::~EdgeKernelCache()
+	{
+	}
+
+	void EdgeKernelCache::build(const FeatureGraph& graph)
+	{
+		const int featureDim = graph.nodesData.cols();
+
+		// rows aligned to the edge index of the compressed adjacency list
+		this->edges = graph.adjList.getCompressed();
+		const int numNodes = this->edges->getNumNodes();
+		const int numEdges = this->edges->getNumEdges();
+
+		this->contrast.resize(numEdges, featureDim);
+		this->absDiff.resize(numEdges, featureDim);
+		for (int node1 = 0; node1 < numNodes; node1++)
+		{
+			for (int edgeIndex = this->edges->offsets[node1]; edgeIndex < this->edges->offsets[node1+1]; edgeIndex++)
+			{
+				int node2 = this->edges->neighbors[edgeIndex];
+				this->absDiff.row(edgeIndex) = (graph.nodesData.row(node1) - graph.nodesData.row(node2)).cwiseAbs();
+				this->contrast.row(edgeIndex) = (-this->absDiff.row(edgeIndex).cwiseAbs2()).array().exp();
+			}
+		}
+	}
+
+	void EdgeKernelCache::build(const FeatureGraph& graph, const MySIMD::AlignedFloatMatrix& floatFeatures)
+	{
+		const int featureDim = graph.nodesData.cols();
+
+		// rows aligned to the edge index of the compressed adjacency list
+		this->edges = graph.adjList.getCompressed();
+		const int numNodes = this->edges->getNumNodes();
+		const int numEdges = this->edges->getNumEdges();
+
+		vector<float> contrastRow(featureDim);
+		vector<float> absDiffRow(featureDim);
+
+		this->contrast.resize(numEdges, featureDim);
+		this->absDiff.resize(numEdges, featureDim);
+		for (int node1 = 0; node1 < numNodes; node1++)
+		{
+			for (int edgeIndex = this->edges->offsets[node1]; edgeIndex < this->edges->offsets[node1+1]; edgeIndex++)
+			{
+				int node2 = this->edges->neighbors[edgeIndex];
+				MySIMD::contrastKernel(floatFeatures.row(node1), floatFeatures.row(node2), 
+					contrastRow.data(), absDiffRow.data(), featureDim);
+				this->absDiff.row(edgeIndex) = Map<RowVectorXf>(absDiffRow.data(), featureDim).cast<double>();
+				this->contrast.row(edgeIndex) = Map<RowVectorXf>(contrastRow.data(), featureDim).cast<double>();
+			}
+		}
+	}
+
+	void EdgeKernelCache::clear()
+	{
+		this->edges.reset();
+		this->contrast.resize(0, 0);
+		this->absDiff.resize(0, 0);
+	}
+
+	bool EdgeKernelCache::empty() const
+	{
+		return !this->edges || this->edges->getNumEdges() == 0;
+	}
+
+	int EdgeKernelCache::edgeIndex(int node1, int node2) const
+	{
+		if (!this->edges)
+			return -1;
+
+		return this->edges->edgeIndex(node1, node2);
+	}
+
+	ImgLabeling::ImgLabeling()
+	{
+		this->confidencesAvailable = false;
+		this->stochasticCutsAvailable = false;
+		this->nodeWeightsAvailable = false;
+	}
+
+	ImgLabeling::~ImgLabeling()
+	{
+	}
+
+	int ImgLabeling::getNumNodes()
+	{
+		return this->graph.nodesData.size();
+	}
+
+	int ImgLabeling::getNumEdges()
+	{
+		return this->graph.getNumEdges();
+	}
+
+	int ImgLabeling::getLabel(int node)
+	{
+		return this->graph.nodesData(node);
+	}
+
+	set<int> ImgLabeling::getNeighborLabels(int node)
+	{
+		set<int> labels;
+		NeighborRange neighbors = this->graph.adjList.neighbors(node);
+		for (NeighborRange::const_iterator it = neighbors.begin(); it != neighbors.end(); ++it)
+		{
+			labels.insert(getLabel(*it));
+		}
+		return labels;
+	}
+
+	set<int> ImgLabeling::getNeighbors(int node)
+	{
+		return this->graph.adjList.getNeighbors(node);
+	}
+
+	bool ImgLabeling::hasNeighbors(int node)
+	{
+		return !this->graph.adjList.neighbors(node).empty();
+	}
+
+	set<int> ImgLabeling::getTopConfidentLabels(int node, int K)
+	{
+		// check if confidences are available
+		if (!this->confidencesAvailable)
+		{
+			LOG(ERROR) << "confidences are not available to get top K confident labels.";
+			abort();
+		}
+
+		// bad cases
+		const int numLabels = this->confidences.cols();
+		if (K > numLabels)
+		{
+			return HCSearch::Global::settings->CLASSES.getLabels();
+		}
+		else if (K == 0)
+		{
+			return set<int>();
+		}
+		else if (K < 0)
+		{
+			LOG(ERROR) << "K cannot be negative!";
+			HCSearch::abort();
+		}
+
+		set<int> labels;
+
+		// get top K confident labels
+		const int* classIndices = getOrderedClassIndices(node);
+		for (int i = 0; i < K; i++)
+			labels.insert(HCSearch::Global::settings->CLASSES.getClassLabel(classIndices[i]));
+
+		return labels;
+	}
+
+	vector<int> ImgLabeling::getLabelsByConfidence(int node)
+	{
+		// check if confidences are available
+		if (!this->confidencesAvailable)
+		{
+			LOG(ERROR) << "confidences are not available to get sorted confident labels.";
+			abort();
+		}
+
+		const int numLabels = this->confidences.cols();
+		vector<int> labels(numLabels);
+
+		const int* classIndices = getOrderedClassIndices(node);
+		for (int i = 0; i < numLabels; i++)
+			labels[i] = HCSearch::Global::settings->CLASSES.getClassLabel(classIndices[i]);
+
+		return labels;
+	}
+
+	int ImgLabeling::getMostConfidentLabel(int node)
+	{
+		// check if confidences are available
+		if (!this->confidencesAvailable)
+		{
+			LOG(ERROR) << "confidences are not available to get sorted confident labels.";
+			abort();
+		}
+
+		return HCSearch::Global::settings->CLASSES.getClassLabel(getOrderedClassIndices(node)[0]);
+	}
+
+	const int* ImgLabeling::getOrderedClassIndices(int node)
+	{
+		// normally computed once when the initial prediction is loaded
+		if (!this->confidences.classOrderAvailable())
+			this->confidences.computeClassOrder();
+
+		return this->confidences.orderedClassIndices(node);
+	}
+
+	double ImgLabeling::getConfidence(int node, int label)
+	{
+		// check if confidences are available
+		if (!this->confidencesAvailable)
+		{
+			LOG(ERROR) << "confidences are not available to get confidence.";
+			abort();
+		}
+
+		int classIndex = Global::settings->CLASSES.getClassIndex(label);
+		return confidences(node, classIndex);
+	}
+
+	bool ImgLabeling::labelComponentsAvailable()
+	{
+		return this->labelComponents != NULL;
+	}
+
+	shared_ptr< const LabelComponents > ImgLabeling::getLabelComponents()
+	{
+		if (!labelComponentsAvailable())
+		{
+			this->labelComponents = make_shared< const LabelComponents >(*this);
+		}
+#ifndef NDEBUG
+		else if (!this->labelComponents->matches(*this))
+		{
+			LOG(ERROR) << "cached connected components do not match the labels.";
+			abort();
+		}
+#endif
+
+		return this->labelComponents;
+	}
+
+	ImgCandidate::ImgCandidate()
+	{
+		this->parent = NULL;
+		this->stochasticCutsAvailable = false;
+	}
+
+	ImgCandidate::ImgCandidate(ImgLabeling* parent)
+	{
+		this->parent = parent;
+		this->stochasticCutsAvailable = false;
+	}
+
+	ImgCandidate::~ImgCandidate()
+	{
+	}
+
+	bool ImgCandidate::isDelta()
+	{
+		return this->parent != NULL;
+	}
+
+	void ImgCandidate::relabel(int node, int label)
+	{
+		if (this->parent == NULL)
+		{
+			LOG(ERROR) << "cannot relabel a full candidate.";
+			abort();
+		}
+
+		this->action.insert(node);
+		this->newLabels[node] = label;
+		if (this->oldLabels.find(node) == this->oldLabels.end())
+			this->oldLabels[node] = this->parent->getLabel(node);
+	}
+
+	int ImgCandidate::getLabel(int node)
+	{
+		if (this->parent == NULL)
+			return this->labeling.getLabel(node);
+
+		map<int, int>::iterator it = this->newLabels.find(node);
+		if (it != this->newLabels.end())
+			return it->second;
+
+		return this->parent->getLabel(node);
+	}
+
+	ImgLabeling ImgCandidate::getLabeling()
+	{
+		if (this->parent == NULL)
+			return this->labeling;
+
+		ImgLabeling YNew;
+		YNew.confidences = this->parent->confidences;
+		YNew.confidencesAvailable = this->parent->confidencesAvailable;
+		YNew.graph = this->parent->graph;
+		if (this->stochasticCutsAvailable)
+		{
+			YNew.stochasticCuts = this->stochasticCuts;
+			YNew.stochasticCutsAvailable = true;
+		}
+
+		apply(YNew);
+
+		return YNew;
+	}
+
+	void ImgCandidate::materialize()
+	{
+		if (this->parent == NULL)
+			return;
+
+		this->labeling = getLabeling();
+		this->parent = NULL;
+		this->newLabels.clear();
+		this->oldLabels.clear();
+		this->stochasticCuts = SharedAdjList();
+		this->stochasticCutsAvailable = false;
+	}
+
+	void ImgCandidate::apply(ImgLabeling& Y)
+	{
+		for (map<int, int>::iterator it = this->newLabels.begin(); it != this->newLabels.end(); ++it)
 		{
-			NeighborSet_t neighbors = it->second;
-			numEdges += neighbors.size();
+			Y.graph.nodesData(it->first) = it->second;
 		}
-		return numEdges;
 	}
 
-	/**************** Features and Labelings ****************/
+	void ImgCandidate::revert(ImgLabeling& Y)
+	{
+		for (map<int, int>::iterator it = this->oldLabels.begin(); it != this->oldLabels.end(); ++it)
+		{
+			Y.graph.nodesData(it->first) = it->second;
+		}
+	}
 
-	ImgFeatures::ImgFeatures()
+	/**************** Label Components ****************/
+
+	LabelComponents::LabelComponents()
 	{
-		this->filename = "";
-		this->segmentsAvailable = false;
-		this->nodeLocationsAvailable = false;
+		this->numComponents = 0;
+		this->numForeground = 0;
 	}
 
-	ImgFeatures::~ImgFeatures()
+	LabelComponents::LabelComponents(ImgLabeling& Y)
 	{
+		this->numComponents = 0;
+		this->numForeground = 0;
+
+		const int numNodes = Y.getNumNodes();
+		this->nodeComponents.assign(numNodes, -1);
+
+		vector<int> seeds(numNodes);
+		for (int node = 0; node < numNodes; node++)
+			seeds[node] = node;
+		labelComponents(Y, seeds);
 	}
 
-	int ImgFeatures::getFeatureDim()
+	LabelComponents::~LabelComponents()
 	{
-		return this->graph.nodesData.cols();
 	}
 
-	int ImgFeatures::getNumNodes()
+	LabelComponents* LabelComponents::update(ImgLabeling& Y, const set<int>& action) const
 	{
-		return this->graph.nodesData.rows();
+		LabelComponents* components = new LabelComponents(*this);
+
+		// components whose nodes can change component: 
+		// those containing an action node or adjacent to one
+		set<int> affected;
+		vector<int> seeds;
+		for (set<int>::const_iterator it = action.begin(); it != action.end(); ++it)
+		{
+			int node1 = *it;
+			if (affected.insert(this->nodeComponents[node1]).second)
+				seeds.push_back(node1);
+
+			NeighborRange neighbors = Y.graph.adjList.neighbors(node1);
+			for (NeighborRange::const_iterator it2 = neighbors.begin(); it2 != neighbors.end(); ++it2)
+			{
+				if (affected.insert(this->nodeComponents[*it2]).second)
+					seeds.push_back(*it2);
+			}
+		}
+
+		// unassign the nodes of the affected components (found by traversing the old components)
+		vector<int> regionNodes;
+		for (size_t i = 0; i < seeds.size(); i++)
+		{
+			int component = this->nodeComponents[seeds[i]];
+			regionNodes.push_back(seeds[i]);
+			components->nodeComponents[seeds[i]] = -1;
+
+			for (size_t j = regionNodes.size()-1; j < regionNodes.size(); j++)
+			{
+				NeighborRange neighbors = Y.graph.adjList.neighbors(regionNodes[j]);
+				for (NeighborRange::const_iterator it = neighbors.begin(); it != neighbors.end(); ++it)
+				{
+					int node2 = *it;
+					if (components->nodeComponents[node2] == component)
+					{
+						components->nodeComponents[node2] = -1;
+						regionNodes.push_back(node2);
+					}
+				}
+			}
+
+			if (!Global::settings->CLASSES.classLabelIsBackground(this->componentLabels[component]))
+				components->numForeground--;
+			components->componentSizes[component] = 0;
+			components->freeComponents.push_back(component);
+			components->numComponents--;
+		}
+
+		// the affected components are closed under same-label edges of the new labeling, 
+		// so relabeling them is enough
+		components->labelComponents(Y, regionNodes);
+
+		return components;
 	}
 
-	int ImgFeatures::getNumEdges()
+	bool LabelComponents::matches(ImgLabeling& Y) const
 	{
-		return this->graph.getNumEdges();
+		const int numNodes = Y.getNumNodes();
+		if (numNodes != static_cast<int>(this->nodeComponents.size()))
+			return false;
+
+		for (int node = 0; node < numNodes; node++)
+		{
+			if (this->componentLabels[this->nodeComponents[node]] != Y.getLabel(node))
+				return false;
+		}
+
+		return true;
 	}
 
-	double ImgFeatures::getFeature(int node, int featIndex)
+	int LabelComponents::numComponentIds() const
 	{
-		return this->graph.nodesData(node, featIndex);
+		return this->componentLabels.size();
 	}
 
-	string ImgFeatures::getFileName()
+	bool LabelComponents::hasExactlyOnePositiveCC() const
 	{
-		return this->filename;
+		return this->numForeground == 1;
 	}
 
-	double ImgFeatures::getNodeLocationX(int node)
+	void LabelComponents::labelComponents(ImgLabeling& Y, const vector<int>& seeds)
 	{
-		if (!nodeLocationsAvailable)
+		vector<int> queue;
+		for (vector<int>::const_iterator it = seeds.begin(); it != seeds.end(); ++it)
 		{
-			LOG(ERROR) << "node location not available for getting x.";
-			abort();
+			if (this->nodeComponents[*it] != -1)
+				continue;
+
+			// flood fill the nodes of the same label
+			int component = newComponent();
+			int label = Y.getLabel(*it);
+			this->componentLabels[component] = label;
+			this->nodeComponents[*it] = component;
+
+			queue.clear();
+			queue.push_back(*it);
+			for (size_t i = 0; i < queue.size(); i++)
+			{
+				NeighborRange neighbors = Y.graph.adjList.neighbors(queue[i]);
+				for (NeighborRange::const_iterator it2 = neighbors.begin(); it2 != neighbors.end(); ++it2)
+				{
+					int node2 = *it2;
+					if (this->nodeComponents[node2] == -1 && Y.getLabel(node2) == label)
+					{
+						this->nodeComponents[node2] = component;
+						queue.push_back(node2);
+					}
+				}
+			}
+
+			this->componentSizes[component] = queue.size();
+			this->numComponents++;
+			if (!Global::settings->CLASSES.classLabelIsBackground(label))
+				this->numForeground++;
 		}
+	}
 
-		return this->nodeLocations(node, 0);
+	int LabelComponents::newComponent()
+	{
+		if (!this->freeComponents.empty())
+		{
+			int component = this->freeComponents.back();
+			this->freeComponents.pop_back();
+			return component;
+		}
+
+		this->componentLabels.push_back(0);
+		this->componentSizes.push_back(0);
+		return this->componentLabels.size()-1;
 	}
 
-	double ImgFeatures::getNodeLocationY(int node)
+	/**************** Labeling Hash ****************/
+
+	LabelingHash_t LabelingHash::compute(ImgLabeling& Y, LabelingHash_t seed)
 	{
-		if (!nodeLocationsAvailable)
+		LabelingHash_t hash = 0;
+
+		const int numNodes = Y.getNumNodes();
+		for (int node = 0; node < numNodes; node++)
 		{
-			LOG(ERROR) << "node location not available for getting y.";
-			abort();
+			hash ^= key(node, Y.graph.nodesData(node), seed);
 		}
 
-		return this->nodeLocations(node, 1);
+		return hash;
 	}
 
-	ImgLabeling::ImgLabeling()
+	LabelingHash_t LabelingHash::update(LabelingHash_t hash, int node, int oldLabel, int newLabel, LabelingHash_t seed)
 	{
-		this->confidencesAvailable = false;
-		this->stochasticCutsAvailable = false;
-		this->nodeWeightsAvailable = false;
+		if (oldLabel == newLabel)
+			return hash;
+
+		return hash ^ key(node, oldLabel, seed) ^ key(node, newLabel, seed);
 	}
 
-	ImgLabeling::~ImgLabeling()
+	namespace
 	{
+		// splitmix64 finalizer
+		inline LabelingHash_t mixHash(LabelingHash_t z)
+		{
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			return z ^ (z >> 31);
+		}
 	}
 
-	int ImgLabeling::getNumNodes()
+	LabelingHash_t LabelingHash::key(int node, int label, LabelingHash_t seed)
 	{
-		return this->graph.nodesData.size();
+		// splitmix64 finalizer over the packed (node, label) pair
+		LabelingHash_t z = (static_cast<LabelingHash_t>(static_cast<unsigned int>(node)) << 32)
+			| static_cast<LabelingHash_t>(static_cast<unsigned int>(label));
+		z = mixHash(z + 0x9E3779B97F4A7C15ULL);
+
+		// other seeds remix the key so that their hashes are independent
+		if (seed != PRIMARY_SEED)
+			z = mixHash(z ^ seed);
+
+		return z;
 	}
 
-	int ImgLabeling::getNumEdges()
+	/**************** Classify/Rank Features ****************/
+
+	GenericFeatures::GenericFeatures()
 	{
-		return this->graph.getNumEdges();
+		this->sparse = false;
 	}
 
-	int ImgLabeling::getLabel(int node)
+	GenericFeatures::GenericFeatures(VectorXd features)
 	{
-		return this->graph.nodesData(node);
+		this->data = features;
+		this->sparse = false;
 	}
 
-	set<int> ImgLabeling::getNeighborLabels(int node)
+	GenericFeatures::GenericFeatures(SparseVector<double> features)
 	{
-		set<int> labels;
-		if (hasNeighbors(node))
-		{
-			for (set<int>::iterator it = this->graph.adjList[node].begin();
-				it != this->graph.adjList[node].end(); ++it)
-			{
-				labels.insert(getLabel(*it));
-			}
-		}
-		return labels;
+		this->sparseData = features;
+		this->sparse = true;
 	}
 
-	set<int> ImgLabeling::getNeighbors(int node)
+	GenericFeatures::~GenericFeatures()
 	{
-		if (hasNeighbors(node))
-			return this->graph.adjList[node];
-		else
-			return set<int>();
 	}
 
-	bool ImgLabeling::hasNeighbors(int node)
+	int GenericFeatures::size() const
 	{
-		return this->graph.adjList.count(node) != 0;
+		if (this->sparse)
+			return this->sparseData.size();
+		else
+			return this->data.size();
 	}
 
-	set<int> ImgLabeling::getTopConfidentLabels(int node, int K)
+	VectorXd GenericFeatures::getDense() const
 	{
-		// check if confidences are available
-		if (!this->confidencesAvailable)
-		{
-			LOG(ERROR) << "confidences are not available to get top K confident labels.";
-			abort();
-		}
+		if (this->sparse)
+			return VectorXd(this->sparseData);
+		else
+			return this->data;
+	}
 
-		// bad cases
-		const int numLabels = this->confidences.cols();
-		if (K > numLabels)
-		{
-			return HCSearch::Global::settings->CLASSES.getLabels();
-		}
-		else if (K == 0)
-		{
-			return set<int>();
-		}
-		else if (K < 0)
-		{
-			LOG(ERROR) << "K cannot be negative!";
-			HCSearch::abort();
-		}
+	/**************** Rank Model ****************/
 
-		set<int> labels;
+	RankFeaturesMatrix IRankModel::stackFeatures(const vector<RankFeatures>& featuresList)
+	{
+		const int numExamples = featuresList.size();
+		int featureDim = 0;
+		for (int i = 0; i < numExamples; i++)
+			featureDim = max(featureDim, featuresList[i].size());
 
-		// get top K confident labels
-		LabelConfidencePQ sortedByConfidence;
-		for (int i = 0; i < numLabels; i++)
-		{
-			int label = HCSearch::Global::settings->CLASSES.getClassLabel(i);
-			double confidence = this->confidences(node, i);
-			sortedByConfidence.push(MyPrimitives::Pair<int, double>(label, confidence));
-		}
-		for (int i = 0; i < K; i++)
+		RankFeaturesMatrix featuresMatrix = RankFeaturesMatrix::Zero(numExamples, featureDim);
+		for (int i = 0; i < numExamples; i++)
 		{
-			MyPrimitives::Pair<int, double> p = sortedByConfidence.top();
-			sortedByConfidence.pop();
-			labels.insert(p.first);
+			const RankFeatures& features = featuresList[i];
+			if (features.sparse)
+			{
+				for (SparseVector<double>::InnerIterator it(features.sparseData); it; ++it)
+					featuresMatrix(i, it.index()) = it.value();
+			}
+			else
+			{
+				featuresMatrix.row(i).head(features.data.size()) = features.data.transpose();
+			}
 		}
-
-		return labels;
+		return featuresMatrix;
 	}
 
-	vector<int> ImgLabeling::getLabelsByConfidence(int node)
+	VectorXd IRankModel::rankMatrix(const VectorXd& weights, const RankFeaturesMatrix& featuresMatrix)
 	{
-		// check if confidences are available
-		if (!this->confidencesAvailable)
-		{
-			LOG(ERROR) << "confidences are not available to get sorted confident labels.";
-			abort();
-		}
-
-		const int numLabels = this->confidences.cols();
-		vector<int> labels;
+		const int numWeights = weights.size();
+		if (featuresMatrix.rows() == 0)
+			return VectorXd();
 
-		// get top K confident labels
-		LabelConfidencePQ sortedByConfidence;
-		for (int i = 0; i < numLabels; i++)
-		{
-			int label = HCSearch::Global::settings->CLASSES.getClassLabel(i);
-			double confidence = this->confidences(node, i);
-			sortedByConfidence.push(MyPrimitives::Pair<int, double>(label, confidence));
-		}
-		for (int i = 0; i < numLabels; i++)
+		if (featuresMatrix.cols() < numWeights)
 		{
-			MyPrimitives::Pair<int, double> p = sortedByConfidence.top();
-			sortedByConfidence.pop();
-			labels.push_back(p.first);
+			LOG(ERROR) << "rank features dimension (" << featuresMatrix.cols() 
+				<< ") is smaller than the model dimension (" << numWeights << ")!";
+			abort();
 		}
 
-		return labels;
+		return featuresMatrix.leftCols(numWeights) * weights;
 	}
 
-	int ImgLabeling::getMostConfidentLabel(int node)
+	double IRankModel::rankVector(const VectorXd& weights, const VectorXd& features)
 	{
-		// check if confidences are available
-		if (!this->confidencesAvailable)
+		const int numWeights = weights.size();
+		if (features.size() < numWeights)
 		{
-			LOG(ERROR) << "confidences are not available to get sorted confident labels.";
+			LOG(ERROR) << "rank features dimension (" << features.size() 
+				<< ") is smaller than the model dimension (" << numWeights << ")!";
 			abort();
 		}
 
-		const int numLabels = this->confidences.cols();
-		vector<int> labels;
-
-		// get top K confident labels
-		LabelConfidencePQ sortedByConfidence;
-		for (int i = 0; i < numLabels; i++)
-		{
-			int label = HCSearch::Global::settings->CLASSES.getClassLabel(i);
-			double confidence = this->confidences(node, i);
-			sortedByConfidence.push(MyPrimitives::Pair<int, double>(label, confidence));
-		}
-		for (int i = 0; i < numLabels; i++)
-		{
-			MyPrimitives::Pair<int, double> p = sortedByConfidence.top();
-			sortedByConfidence.pop();
-			labels.push_back(p.first);
-		}
-
-		return labels[0];
+		return features.head(numWeights).dot(weights);
 	}
 
-	double ImgLabeling::getConfidence(int node, int label)
+	double IRankModel::rankFeatures(const VectorXd& weights, const RankFeatures& features)
 	{
-		// check if confidences are available
-		if (!this->confidencesAvailable)
+		if (!features.sparse)
+			return rankVector(weights, features.data);
+
+		const int numWeights = weights.size();
+		if (features.size() < numWeights)
 		{
-			LOG(ERROR) << "confidences are not available to get confidence.";
+			LOG(ERROR) << "rank features dimension (" << features.size() 
+				<< ") is smaller than the model dimension (" << numWeights << ")!";
 			abort();
 		}
 
-		int classIndex = Global::settings->CLASSES.getClassIndex(label);
-		return confidences(node, classIndex);
-	}
-
-	/**************** Classify/Rank Features ****************/
-
-	GenericFeatures::GenericFeatures()
-	{
-	}
+		// indices are sorted, so stop at the first feature without a weight
+		double result = 0;
+		for (SparseVector<double>::InnerIterator it(features.sparseData); it && it.index() < numWeights; ++it)
+			result += it.value() * weights(it.index());
 
-	GenericFeatures::GenericFeatures(VectorXd features)
-	{
-		this->data = features;
+		return result;
 	}
 
-	GenericFeatures::~GenericFeatures()
+	bool IRankModel::hasSparseFeatures(const vector<RankFeatures>& featuresList)
 	{
+		for (vector<RankFeatures>::const_iterator it = featuresList.begin(); it != featuresList.end(); ++it)
+		{
+			if (it->sparse)
+				return true;
+		}
+		return false;
 	}
 
 	/**************** SVM-Rank Model ****************/
@@ -297,7 +1150,7 @@ namespace HCSearch
 		load(fileName);
 	}
 	
-	double SVMRankModel::rank(RankFeatures features)
+	double SVMRankModel::rank(const RankFeatures& features)
 	{
 		if (!this->initialized)
 		{
@@ -309,28 +1162,43 @@ namespace HCSearch
 		if (!this->initialized)
 			return 0;
 		else
-			return vectorDot(getWeights(), features.data);
+			return rankFeatures(this->weights, features);
 	}
 
-	vector<double> SVMRankModel::rank(vector<RankFeatures> featuresList)
+	vector<double> SVMRankModel::rank(const vector<RankFeatures>& featuresList)
 	{
+		if (!hasSparseFeatures(featuresList))
+		{
+			VectorXd ranks = rank(stackFeatures(featuresList));
+			return vector<double>(ranks.data(), ranks.data() + ranks.size());
+		}
+
 		if (!this->initialized)
 		{
 			LOG(WARNING) << "svm ranker not initialized for ranking but returning 0 anyway";
-			//LOG(ERROR) << "svm ranker not initialized for ranking";
-			//abort();
+			return vector<double>(featuresList.size(), 0);
 		}
 
-		int numExamples = featuresList.size();
 		vector<double> ranks;
-		for (int i = 0; i < numExamples; i++)
+		for (vector<RankFeatures>::const_iterator it = featuresList.begin(); it != featuresList.end(); ++it)
+			ranks.push_back(rankFeatures(this->weights, *it));
+
+		return ranks;
+	}
+
+	VectorXd SVMRankModel::rank(const RankFeaturesMatrix& featuresMatrix)
+	{
+		if (!this->initialized)
 		{
-			if (!this->initialized)
-				ranks.push_back(0);
-			else
-				ranks.push_back(vectorDot(getWeights(), featuresList[i].data));
+			LOG(WARNING) << "svm ranker not initialized for ranking but returning 0 anyway";
+			//LOG(ERROR) << "svm ranker not initialized for ranking";
+			//abort();
 		}
-		return ranks;
+
+		if (!this->initialized)
+			return VectorXd::Zero(featuresMatrix.rows());
+		else
+			return rankMatrix(this->weights, featuresMatrix);
 	}
 
 	RankerType SVMRankModel::rankerType()
@@ -356,7 +1224,7 @@ namespace HCSearch
 		MyFileSystem::FileSystem::copyFile(this->modelFileName, fileName);
 	}
 	
-	VectorXd SVMRankModel::getWeights()
+	const VectorXd& SVMRankModel::getWeights()
 	{
 		if (!this->initialized)
 		{
@@ -590,15 +1458,28 @@ namespace HCSearch
 		stringstream ss("");
 		stringstream sparse("");
 
-		VectorXd vector = features.data;
-
 		int nonZeroCounts = 0;
-		for (int i = 0; i < vector.size(); i++)
+		if (features.sparse)
+		{
+			for (SparseVector<double>::InnerIterator it(features.sparseData); it; ++it)
+			{
+				if (it.value() != 0)
+				{
+					ss << it.index()+1 << ":" << it.value() << " ";
+					nonZeroCounts++;
+				}
+			}
+		}
+		else
 		{
-			if (vector(i) != 0)
+			const VectorXd& vector = features.data;
+			for (int i = 0; i < vector.size(); i++)
 			{
-				ss << i+1 << ":" << vector(i) << " ";
-				nonZeroCounts++;
+				if (vector(i) != 0)
+				{
+					ss << i+1 << ":" << vector(i) << " ";
+					nonZeroCounts++;
+				}
 			}
 		}
 		sparse << target << " qid:" << qid << " " << ss.str();
@@ -753,7 +1634,7 @@ namespace HCSearch
 		this->numLearn = 0;
 	}
 	
-	double VWRankModel::rank(RankFeatures features)
+	double VWRankModel::rank(const RankFeatures& features)
 	{
 		if (!this->initialized)
 		{
@@ -765,28 +1646,43 @@ namespace HCSearch
 		if (!this->initialized)
 			return 0;
 		else
-			return vectorDot(getWeights(), features.data);
+			return rankFeatures(this->weights, features);
 	}
 
-	vector<double> VWRankModel::rank(vector<RankFeatures> featuresList)
+	vector<double> VWRankModel::rank(const vector<RankFeatures>& featuresList)
 	{
+		if (!hasSparseFeatures(featuresList))
+		{
+			VectorXd ranks = rank(stackFeatures(featuresList));
+			return vector<double>(ranks.data(), ranks.data() + ranks.size());
+		}
+
 		if (!this->initialized)
 		{
 			LOG(WARNING) << "VW ranker not initialized for ranking but returning 0 anyway";
-			//LOG(ERROR) << "VW ranker not initialized for ranking";
-			//abort();
+			return vector<double>(featuresList.size(), 0);
 		}
 
-		int numExamples = featuresList.size();
 		vector<double> ranks;
-		for (int i = 0; i < numExamples; i++)
+		for (vector<RankFeatures>::const_iterator it = featuresList.begin(); it != featuresList.end(); ++it)
+			ranks.push_back(rankFeatures(this->weights, *it));
+
+		return ranks;
+	}
+
+	VectorXd VWRankModel::rank(const RankFeaturesMatrix& featuresMatrix)
+	{
+		if (!this->initialized)
 		{
-			if (!this->initialized)
-				ranks.push_back(0);
-			else
-				ranks.push_back(vectorDot(getWeights(), featuresList[i].data));
+			LOG(WARNING) << "VW ranker not initialized for ranking but returning 0 anyway";
+			//LOG(ERROR) << "VW ranker not initialized for ranking";
+			//abort();
 		}
-		return ranks;
+
+		if (!this->initialized)
+			return VectorXd::Zero(featuresMatrix.rows());
+		else
+			return rankMatrix(this->weights, featuresMatrix);
 	}
 
 	RankerType VWRankModel::rankerType()
@@ -812,7 +1708,7 @@ namespace HCSearch
 		MyFileSystem::FileSystem::copyFile(this->modelFileName, fileName);
 	}
 	
-	VectorXd VWRankModel::getWeights()
+	const VectorXd& VWRankModel::getWeights()
 	{
 		if (!this->initialized)
 		{
@@ -1162,25 +2058,41 @@ namespace HCSearch
 		stringstream sparse("");
 
 		int label;
-		VectorXd vector;
+		double sign;
 		if (Rand::unifDist() < 0.5)
 		{
 			label = -1;
-			vector = bestfeature.data - worstfeature.data;
+			sign = 1;
 		}
 		else
 		{
 			label = 1;
-			vector = worstfeature.data - bestfeature.data;
+			sign = -1;
 		}
 
 		int nonZeroCounts = 0;
-		for (int i = 0; i < vector.size(); i++)
+		if (bestfeature.sparse && worstfeature.sparse && bestfeature.size() == worstfeature.size())
+		{
+			SparseVector<double> vector = sign * (bestfeature.sparseData - worstfeature.sparseData);
+			for (SparseVector<double>::InnerIterator it(vector); it; ++it)
+			{
+				if (it.value() != 0)
+				{
+					ss << it.index()+1 << ":" << it.value() << " ";
+					nonZeroCounts++;
+				}
+			}
+		}
+		else
 		{
-			if (vector(i) != 0)
+			VectorXd vector = sign * (bestfeature.getDense() - worstfeature.getDense());
+			for (int i = 0; i < vector.size(); i++)
 			{
-				ss << i+1 << ":" << vector(i) << " ";
-				nonZeroCounts++;
+				if (vector(i) != 0)
+				{
+					ss << i+1 << ":" << vector(i) << " ";
+					nonZeroCounts++;
+				}
 			}
 		}
 		sparse << label << " " << loss << " | " << ss.str();
@@ -2,11 +2,15 @@
 #define DATASTRUCTURES_HPP
 
 #include <map>
+#include <vector>
 #include <set>
 #include <queue>
+#include <memory>
 #include <fstream>
 #include "../../external/Eigen/Eigen/Dense"
+#include "../../external/Eigen/Eigen/SparseCore"
 #include "MyPrimitives.hpp"
+#include "MySIMD.hpp"
 #include "Settings.hpp"
 
 using namespace Eigen;
@@ -49,16 +53,168 @@ namespace HCSearch
 	 */
 	typedef map< int, NeighborSet_t > AdjList_t;
 
+	/*!
+	 * @brief Contiguous range of neighbors of a node in a compressed adjacency list.
+	 */
+	struct NeighborRange
+	{
+		typedef const int* const_iterator;
+
+		const int* first;
+		const int* last;
+
+		NeighborRange();
+		NeighborRange(const int* first, const int* last);
+
+		const_iterator begin() const;
+		const_iterator end() const;
+		int size() const;
+		bool empty() const;
+	};
+
+	/*!
+	 * @brief Compressed sparse row form of an adjacency list.
+	 * 
+	 * The neighbors of node i are neighbors[offsets[i]] to neighbors[offsets[i+1]-1], 
+	 * sorted like the neighbor sets of the adjacency list. 
+	 * The position of an entry is the index of the directed edge (node i, neighbor). 
+	 * Since edges are ordered by (node1, node2), the edge index is also the position 
+	 * of the edge in ImgFeatures::edgeWeights and ImgFeatures::edgeFeatures 
+	 * when those hold every edge of the graph.
+	 */
+	class CompressedAdjList
+	{
+	public:
+		vector<int> offsets; //!< Row offsets into neighbors (number of nodes + 1)
+		vector<int> neighbors; //!< Ending node of each directed edge
+
+	public:
+		CompressedAdjList();
+		CompressedAdjList(const AdjList_t& adjList);
+		~CompressedAdjList();
+
+		/*!
+		 * Number of rows, i.e. the largest node index with neighbors + 1.
+		 */
+		int getNumNodes() const;
+
+		/*!
+		 * Number of directed edges.
+		 */
+		int getNumEdges() const;
+
+		/*!
+		 * Get the neighbors of a node.
+		 * @param[in] node Node index
+		 * @return Returns the neighbor range, empty if the node has no neighbors
+		 */
+		NeighborRange getNeighbors(int node) const;
+
+		/*!
+		 * Get the index of a directed edge.
+		 * @param[in] node1 Starting node
+		 * @param[in] node2 Ending node
+		 * @return Returns the edge index, or -1 if there is no such edge
+		 */
+		int edgeIndex(int node1, int node2) const;
+	};
+
+	/*!
+	 * @brief Adjacency list shared between copies until one of them is modified.
+	 * 
+	 * The graph structure of an image does not change during search, 
+	 * so copying a graph or labeling only copies a reference to it. 
+	 * Const access reads the shared adjacency list; 
+	 * non-const access (operator[], mutate()) detaches a private copy first.
+	 */
+	class SharedAdjList
+	{
+		MyPrimitives::CopyOnWrite< AdjList_t > data;
+
+		/*!
+		 * Compressed form of data, shared between copies. 
+		 * Built on assignment and dropped on write access until compress() is called, 
+		 * so reads never modify it and copies can be read from several threads.
+		 */
+		shared_ptr< const CompressedAdjList > compressed;
+
+		/*!
+		 * Abort if a non-empty adjacency list has no compressed form.
+		 */
+		void checkCompressed() const;
+
+	public:
+		SharedAdjList();
+		SharedAdjList(const AdjList_t& adjList);
+		~SharedAdjList();
+
+		SharedAdjList& operator=(const AdjList_t& adjList);
+
+		/*!
+		 * Read access to the adjacency list.
+		 */
+		operator const AdjList_t&() const;
+		const AdjList_t& get() const;
+
+		/*!
+		 * Write access to the adjacency list (copy-on-write).
+		 */
+		AdjList_t& mutate();
+
+		/*!
+		 * Get the neighbors of a node without copying.
+		 * @param[in] node Node index
+		 * @return Returns the neighbor set, empty if the node has no neighbors
+		 */
+		const NeighborSet_t& getNeighbors(int node) const;
+
+		/*!
+		 * Write access to the neighbors of a node (copy-on-write).
+		 */
+		NeighborSet_t& operator[](int node);
+
+		/*!
+		 * Get the neighbors of a node from the compressed form. 
+		 * Preferred over getNeighbors() in loops over the graph.
+		 * @param[in] node Node index
+		 * @return Returns the neighbor range, empty if the node has no neighbors
+		 */
+		NeighborRange neighbors(int node) const;
+
+		/*!
+		 * Get the compressed form of the adjacency list. 
+		 * Call compress() after write access before reading it.
+		 */
+		shared_ptr< const CompressedAdjList > getCompressed() const;
+
+		/*!
+		 * Build the compressed form after write access.
+		 */
+		void compress();
+
+		AdjList_t::const_iterator begin() const;
+		AdjList_t::const_iterator end() const;
+		AdjList_t::const_iterator find(int node) const;
+		int count(int node) const;
+		int size() const;
+		bool empty() const;
+
+		/*!
+		 * Check if the adjacency list is shared with other copies.
+		 */
+		bool isShared() const;
+	};
+
 	/*!
 	 * @brief Anstract graph implementation to avoid redundancy.
 	 */
 	struct IGraph
 	{
 		/*!
-		 * Adjacency list of the graph.
+		 * Adjacency list of the graph (shared between copies).
 		 * Node -> set of neighbor nodes
 		 */
-		AdjList_t adjList;
+		SharedAdjList adjList;
 
 		/*!
 		 * Get the number of edges in the graph.
@@ -97,6 +253,139 @@ namespace HCSearch
 
 	/**************** Features and Labelings ****************/
 
+	class ImgLabeling;
+	class LabelComponents;
+	class DenseCRFLattices;
+
+	/*!
+	 * @brief Node class confidences shared between copies until one of them is modified.
+	 * 
+	 * The confidences come from the initial prediction and do not change during search, 
+	 * so copying a labeling only copies a reference to them.
+	 * rows = nodes, cols = label probabilities (sorted by class index)
+	 * 
+	 * The class indices of every node sorted by decreasing confidence can be 
+	 * computed once and are shared between copies as well.
+	 */
+	class SharedConfidences
+	{
+	public:
+		typedef Matrix<int, Dynamic, Dynamic, RowMajor> ClassOrder_t;
+
+	private:
+		MyPrimitives::CopyOnWrite< MatrixXd > data;
+		shared_ptr< const ClassOrder_t > classOrder;
+
+	public:
+		SharedConfidences();
+		SharedConfidences(const MatrixXd& confidences);
+		~SharedConfidences();
+
+		SharedConfidences& operator=(const MatrixXd& confidences);
+
+		/*!
+		 * Get the confidence of a class at a node.
+		 * @param[in] node Node index
+		 * @param[in] classIndex Class index
+		 * @return Returns the confidence
+		 */
+		double operator()(int node, int classIndex) const;
+
+		int rows() const;
+		int cols() const;
+
+		/*!
+		 * Read access to the confidences matrix.
+		 */
+		const MatrixXd& get() const;
+
+		/*!
+		 * Write access to the confidences matrix (copy-on-write).
+		 */
+		MatrixXd& mutate();
+
+		/*!
+		 * Check if the confidences are shared with other copies.
+		 */
+		bool isShared() const;
+
+		/*!
+		 * Sort the class indices of every node by decreasing confidence. 
+		 * Ties keep the class index order. Changing the confidences discards the order.
+		 */
+		void computeClassOrder();
+
+		/*!
+		 * Check if the class order has been computed.
+		 */
+		bool classOrderAvailable() const;
+
+		/*!
+		 * Get the class indices of a node sorted by decreasing confidence.
+		 * @param[in] node Node index
+		 * @return Returns a pointer to cols() class indices
+		 */
+		const int* orderedClassIndices(int node) const;
+	};
+
+	/*!
+	 * @brief Label-independent pairwise terms of an image, computed once per edge.
+	 * 
+	 * Pairwise features only depend on the labels through the slot they are 
+	 * summed into, so the kernels themselves can be computed when the image is loaded. 
+	 * Rows are indexed by the edge index of the compressed adjacency list.
+	 */
+	class EdgeKernelCache
+	{
+	public:
+		shared_ptr< const CompressedAdjList > edges; //!< Edges the rows are aligned to
+		MatrixXd contrast; //!< exp(-(f1-f2)^2) per directed edge
+		MatrixXd absDiff; //!< |f1-f2| per directed edge
+
+	public:
+		EdgeKernelCache();
+		~EdgeKernelCache();
+
+		/*!
+		 * Compute the kernels of all edges of the graph.
+		 */
+		void build(const FeatureGraph& graph);
+
+		/*!
+		 * Compute the kernels of all edges of the graph 
+		 * from single-precision node features with the SIMD kernels.
+		 */
+		void build(const FeatureGraph& graph, const MySIMD::AlignedFloatMatrix& floatFeatures);
+
+		void clear();
+		bool empty() const;
+
+		/*!
+		 * Get the cache row of a directed edge.
+		 * @param[in] node1 Starting node
+		 * @param[in] node2 Ending node
+		 * @return Returns the row index, or -1 if the edge is not cached
+		 */
+		int edgeIndex(int node1, int node2) const;
+	};
+
+	/*!
+	 * @brief Edges of an image weighted for stochastic cuts, computed once per image.
+	 * 
+	 * The weight of a directed edge is exp(-KL*T/2), where KL is the symmetric 
+	 * KL divergence of the node features and T is the cut parameter. The weights 
+	 * only depend on the image and T, so they are shared across search steps.
+	 */
+	class CutEdgeWeights
+	{
+	public:
+		shared_ptr< const CompressedAdjList > edges; //!< Edges the weights were computed for
+		vector< MyPrimitives::Pair<int, int> > edgeNodes; //!< (node1, node2) per directed edge
+		vector<double> weights; //!< Weight per directed edge
+		vector<int> order; //!< Directed edge indices by decreasing weight
+		double T; //!< Cut parameter
+	};
+
 	/*!
 	 * @brief Structured input: graph with feature nodes.
 	 * 
@@ -144,10 +433,37 @@ namespace HCSearch
 		 */
 		map< MyPrimitives::Pair<int, int>, VectorXd > edgeFeatures;
 
+		/*!
+		 * Pairwise kernels of the edges, computed once per image.
+		 * Make sure to check if they are available using ImgFeatures::edgeKernelsAvailable.
+		 */
+		EdgeKernelCache edgeKernels;
+
+		/*!
+		 * Single-precision copy of the node features with 32-byte aligned rows (shared between copies).
+		 * If available, unary sums, edge kernels and KL edge weights use the SIMD kernels.
+		 * Make sure to check if they are available using ImgFeatures::floatFeaturesAvailable.
+		 */
+		shared_ptr< const MySIMD::AlignedFloatMatrix > floatFeatures;
+
+		/*!
+		 * KL weights of the edges for stochastic cuts (shared between copies). 
+		 * Computed by the stochastic successor functions on first use, NULL before.
+		 */
+		shared_ptr< const CutEdgeWeights > cutEdgeWeights;
+
+		/*!
+		 * Lattices of the filtered dense CRF kernels (shared between copies). 
+		 * Computed by DenseCRFFeatures on first use, NULL before.
+		 */
+		shared_ptr< const DenseCRFLattices > denseCRFLattices;
+
 		bool segmentsAvailable;
 		bool nodeLocationsAvailable;
 		bool edgeWeightsAvailable;
 		bool edgeFeaturesAvailable;
+		bool edgeKernelsAvailable;
+		bool floatFeaturesAvailable;
 
 	public:
 		ImgFeatures();
@@ -198,6 +514,45 @@ namespace HCSearch
 		 * @return Returns the Y position of node
 		 */
 		double getNodeLocationY(int node);
+
+		/*!
+		 * Compute the single-precision copy of the node features. 
+		 * Call before computeEdgeKernels, and again if the node features change.
+		 */
+		void computeFloatFeatures();
+
+		/*!
+		 * Add weight times the features of a node to a segment of a vector.
+		 * @param[in] node Node index
+		 * @param[in] weight Scale of the node features
+		 * @param[in,out] sums Vector to add to
+		 * @param[in] offset Start of the segment (feature dimension long)
+		 */
+		void addNodeFeatures(int node, double weight, VectorXd& sums, int offset);
+
+		/*!
+		 * Compute the edge kernel cache from the graph. 
+		 * Call again if the node features or the adjacency list change.
+		 */
+		void computeEdgeKernels();
+
+		/*!
+		 * Get the contrast kernel exp(-(f1-f2)^2) of an edge, 
+		 * from the cache if available.
+		 * @param[in] node1 Starting node
+		 * @param[in] node2 Ending node
+		 * @return Returns the kernel vector (feature dimension)
+		 */
+		VectorXd getEdgeContrast(int node1, int node2);
+
+		/*!
+		 * Get the absolute feature difference |f1-f2| of an edge, 
+		 * from the cache if available.
+		 * @param[in] node1 Starting node
+		 * @param[in] node2 Ending node
+		 * @return Returns the difference vector (feature dimension)
+		 */
+		VectorXd getEdgeAbsDiff(int node1, int node2);
 	};
 
 	/*!
@@ -212,23 +567,32 @@ namespace HCSearch
 	{
 	public:
 		/*!
-		 * Graph with label nodes. Public access allows "low level" manipulations.
+		 * Graph with label nodes. Public access allows "low level" manipulations. 
+		 * Only the labels are owned by the labeling, the adjacency list is shared.
 		 */
 		LabelGraph graph;
 
 		/*!
-		 * Class confidences of nodes from initial prediction. 
+		 * Class confidences of nodes from initial prediction (shared between copies). 
 		 * rows = nodes, cols = label probabilities (sorted by class index)
 		 * Make sure to check if they are available using ImgLabeling::confidencesAvailable.
 		 */
-		MatrixXd confidences;
+		SharedConfidences confidences;
 
 		/*!
-		 * Adjacency list of edges that survived stochastic cuts.  
+		 * Adjacency list of edges that survived stochastic cuts (shared between copies).  
 		 * node -> set of neighbor nodes
 		 * Make sure to check if they are available using ImgLabeling::stochasticCutsAvailable.
 		 */
-		map< int, set<int> > stochasticCuts;
+		SharedAdjList stochasticCuts;
+
+		/*!
+		 * Same-label connected components of the labels (shared between copies). 
+		 * They are trusted without rescanning the labels: code that changes the labels 
+		 * of a labeling with components must update or reset them 
+		 * (transient ImgCandidate::apply/revert excepted).
+		 */
+		shared_ptr< const LabelComponents > labelComponents;
 
 		/*!
 		 * Node weights.
@@ -291,23 +655,120 @@ namespace HCSearch
 		 */
 		set<int> getTopConfidentLabels(int node, int K);
 
+		/*!
+		 * @brief Get all labels sorted by decreasing confidence.
+		 * @param[in] node Node index
+		 * @return Returns the labels of the node from most to least confident
+		 */
 		vector<int> getLabelsByConfidence(int node);
 
+		/*!
+		 * @brief Get the most confident label.
+		 * @param[in] node Node index
+		 * @return Returns the label with the highest confidence
+		 */
 		int getMostConfidentLabel(int node);
 
 		double getConfidence(int node, int label);
+
+		/*!
+		 * @brief Check if connected components are cached.
+		 */
+		bool labelComponentsAvailable();
+
+		/*!
+		 * @brief Get the same-label connected components, computing them if not cached.
+		 * 
+		 * Debug builds check that cached components match the labels.
+		 */
+		shared_ptr< const LabelComponents > getLabelComponents();
+
+	protected:
+		/*!
+		 * @brief Get the class indices of a node sorted by decreasing confidence.
+		 */
+		const int* getOrderedClassIndices(int node);
+	};
+
+	/*!
+	 * @brief Same-label connected components of a labeling, updated locally when labels change.
+	 * 
+	 * Successive states of a search differ only on the nodes of an action, so the 
+	 * components of a child are derived from the parent by recomputing only the 
+	 * components that contain or touch the action nodes. The arrays are still copied 
+	 * from the parent (a linear memory copy), but no traversal leaves the affected components. 
+	 * Component ids of removed components are reused.
+	 */
+	class LabelComponents
+	{
+	public:
+		vector<int> nodeComponents; //!< Node -> component id
+		vector<int> componentLabels; //!< Component id -> label
+		vector<int> componentSizes; //!< Component id -> number of nodes (0 if the id is unused)
+		vector<int> freeComponents; //!< Unused component ids
+		int numComponents; //!< Number of components
+		int numForeground; //!< Number of foreground components
+
+	public:
+		LabelComponents();
+
+		/*!
+		 * @brief Compute the components of a labeling.
+		 */
+		LabelComponents(ImgLabeling& Y);
+
+		~LabelComponents();
+
+		/*!
+		 * @brief Compute the components of a labeling that differs from this one only on the action nodes.
+		 * @param[in] Y New labeling
+		 * @param[in] action Nodes whose labels may have changed
+		 * @return Returns the components of the new labeling
+		 */
+		LabelComponents* update(ImgLabeling& Y, const set<int>& action) const;
+
+		/*!
+		 * @brief Check if the components were computed for the labels of a labeling.
+		 */
+		bool matches(ImgLabeling& Y) const;
+
+		/*!
+		 * @brief Get the size of the component id range (used and unused ids).
+		 */
+		int numComponentIds() const;
+
+		/*!
+		 * @brief Returns true if there is exactly one foreground connected component.
+		 */
+		bool hasExactlyOnePositiveCC() const;
+
+	protected:
+		/*!
+		 * @brief Label the connected components of the unassigned nodes reachable from the seeds.
+		 */
+		void labelComponents(ImgLabeling& Y, const vector<int>& seeds);
+
+		/*!
+		 * @brief Get an unused component id.
+		 */
+		int newComponent();
 	};
 
 	/*!
 	 * @brief Structured output labeling candidate: labeling and action.
 	 * 
 	 * This stores an ImgLabeling with a corresponding action, i.e. the set of nodes that changed.
+	 * 
+	 * A candidate is either full (the new labeling is stored) or a delta 
+	 * (only the new labels of the action nodes are stored against a shared parent labeling). 
+	 * Use getLabeling() to materialize the new labeling in both cases.
 	 */
 	class ImgCandidate
 	{
 	public:
 		/*!
-		 * New labeling.
+		 * New labeling. 
+		 * Only stored for full candidates.
 		 */
 		ImgLabeling labeling;
 
@@ -315,6 +776,137 @@ namespace HCSearch
 		 * Set of nodes that changed.
 		 */
 		set<int> action;
+
+		/*!
+		 * Labeling the action is applied to for delta candidates, NULL for full candidates. 
+		 * Must outlive the candidate.
+		 */
+		ImgLabeling* parent;
+
+		/*!
+		 * New labels of the nodes in the action for delta candidates.
+		 * node -> new label
+		 */
+		map< int, int > newLabels;
+
+		/*!
+		 * Parent labels of the nodes in the action for delta candidates, used by revert().
+		 * node -> parent label
+		 */
+		map< int, int > oldLabels;
+
+		/*!
+		 * Stochastic cuts of the new labeling for delta candidates. 
+		 * Shared by all candidates generated from the same cut.
+		 * Make sure to check if they are available using ImgCandidate::stochasticCutsAvailable.
+		 */
+		SharedAdjList stochasticCuts;
+
+		bool stochasticCutsAvailable;
+
+	public:
+		/*!
+		 * Construct a full candidate.
+		 */
+		ImgCandidate();
+
+		/*!
+		 * Construct a delta candidate with an empty action.
+		 * @param[in] parent Parent labeling
+		 */
+		ImgCandidate(ImgLabeling* parent);
+
+		~ImgCandidate();
+
+		/*!
+		 * Check if the candidate is a delta against a parent labeling.
+		 */
+		bool isDelta();
+
+		/*!
+		 * Add a node to the action of a delta candidate.
+		 * @param[in] node Node index
+		 * @param[in] label New label of the node
+		 */
+		void relabel(int node, int label);
+
+		/*!
+		 * Get the new label of a node.
+		 * @param[in] node Node index
+		 * @return Returns the label of the node in the new labeling
+		 */
+		int getLabel(int node);
+
+		/*!
+		 * Materialize the new labeling.
+		 * @return Returns a copy of the new labeling
+		 */
+		ImgLabeling getLabeling();
+
+		/*!
+		 * Convert a delta candidate into a full candidate, 
+		 * e.g. when the parent labeling does not outlive the candidate.
+		 */
+		void materialize();
+
+		/*!
+		 * Write the new labels of a delta candidate into a labeling equal to the parent.
+		 * @param[in,out] Y Parent labeling (or a copy of it)
+		 */
+		void apply(ImgLabeling& Y);
+
+		/*!
+		 * Undo apply() by restoring the parent labels of the action nodes.
+		 * @param[in,out] Y Labeling previously passed to apply()
+		 */
+		void revert(ImgLabeling& Y);
+	};
+
+	/**************** Labeling Hash ****************/
+
+	/*!
+	 * 64-bit hash value of a labeling.
+	 */
+	typedef unsigned long long LabelingHash_t;
+
+	/*!
+	 * @brief Zobrist-style hash of labelings.
+	 *
+	 * The hash of a labeling is the XOR of a 64-bit key for every
+	 * (node, label) assignment, so relabeling a node is two XORs.
+	 * Keys are derived from (node, label) by a fixed mixing function
+	 * and are therefore the same in every process.
+	 * Equal hashes do not guarantee equal labelings: verify on collision.
+	 */
+	class LabelingHash
+	{
+	public:
+		static const LabelingHash_t PRIMARY_SEED = 0ULL; //!< Seed of the hash used for lookups
+		static const LabelingHash_t CHECK_SEED = 0xD1B54A32D192ED03ULL; //!< Seed of an independent hash used to verify matches
+
+		/*!
+		 * Compute the hash of a labeling from scratch.
+		 * @param[in] Y Labeling
+		 * @param[in] seed Hash seed
+		 * @return Returns the hash of the labeling
+		 */
+		static LabelingHash_t compute(ImgLabeling& Y, LabelingHash_t seed = PRIMARY_SEED);
+
+		/*!
+		 * Update a hash after relabeling a node.
+		 * @param[in] hash Hash before relabeling
+		 * @param[in] node Node index
+		 * @param[in] oldLabel Label of the node before relabeling
+		 * @param[in] newLabel Label of the node after relabeling
+		 * @param[in] seed Hash seed
+		 * @return Returns the hash after relabeling
+		 */
+		static LabelingHash_t update(LabelingHash_t hash, int node, int oldLabel, int newLabel, LabelingHash_t seed = PRIMARY_SEED);
+
+		/*!
+		 * Get the key of a (node, label) assignment.
+		 */
+		static LabelingHash_t key(int node, int label, LabelingHash_t seed = PRIMARY_SEED);
 	};
 
 	/**************** Classify/Rank Features ****************/
@@ -322,31 +914,65 @@ namespace HCSearch
 	/*!
 	 * @brief Stores features for ranking or classification.
 	 * 
-	 * This is nothing more than a wrapper around a VectorXd object.
+	 * This is a wrapper around either a dense VectorXd object or a 
+	 * sparse vector for features that are mostly zero (label pair blocks 
+	 * of classes that do not appear). Rankers score sparse features and 
+	 * training file writers serialize them in O(nnz).
 	 */
 	class GenericFeatures
 	{
 	public:
 		/*!
-		 * Features data
+		 * Dense features data (empty if sparse)
 		 */
 		VectorXd data;
 
+		/*!
+		 * Sparse features data (empty if dense)
+		 */
+		SparseVector<double> sparseData;
+
+		/*!
+		 * True if the features are stored in sparseData
+		 */
+		bool sparse;
+
 		/*!
 		 * Default constructor does nothing.
 		 */
 		GenericFeatures();
 
 		/*!
-		 * Constructor to initialize features data.
+		 * Constructor to initialize dense features data.
 		 */
 		GenericFeatures(VectorXd features);
+
+		/*!
+		 * Constructor to initialize sparse features data.
+		 */
+		GenericFeatures(SparseVector<double> features);
 		
 		~GenericFeatures();
+
+		/*!
+		 * Get the feature dimension.
+		 */
+		int size() const;
+
+		/*!
+		 * Get the features as a dense vector.
+		 */
+		VectorXd getDense() const;
 	};
 
 	typedef GenericFeatures RankFeatures;
 
+	/*!
+	 * Row-major matrix of rank features, one candidate per row. 
+	 * Used to rank a batch of candidates in one matrix-vector product.
+	 */
+	typedef Matrix<double, Dynamic, Dynamic, RowMajor> RankFeaturesMatrix;
+
 	/**************** Rank Model ****************/
 
 	/*!
@@ -368,14 +994,21 @@ namespace HCSearch
 		 * @param[in] features Features for ranking
 		 * @return Returns the ranking of the feature
 		 */
-		virtual double rank(RankFeatures features)=0;
+		virtual double rank(const RankFeatures& features)=0;
 
 		/*!
 		 * Use the model to rank a list of features.
 		 * @param[in] featuresList List of features for ranking
 		 * @return Returns the list of ranking values of the features
 		 */
-		virtual vector<double> rank(vector<RankFeatures> featuresList)=0;
+		virtual vector<double> rank(const vector<RankFeatures>& featuresList)=0;
+
+		/*!
+		 * Use the model to rank a batch of features.
+		 * @param[in] featuresMatrix Features for ranking, one candidate per row
+		 * @return Returns the ranking values of the rows
+		 */
+		virtual VectorXd rank(const RankFeaturesMatrix& featuresMatrix)=0;
 
 		/*!
 		 * Get the ranker type.
@@ -392,24 +1025,38 @@ namespace HCSearch
 		 */
 		virtual void save(string fileName)=0;
 
+		/*!
+		 * Stack a list of features into a matrix, one feature vector per row. 
+		 * Shorter feature vectors are padded with zeros.
+		 */
+		static RankFeaturesMatrix stackFeatures(const vector<RankFeatures>& featuresList);
+
 	protected:
 		/*!
-		 * Manual implementation of the vector dot product. 
-		 * Used to correct a mysterious problem with Eigen's implementation.
-		 */
-		template <class TVector>
-		static double vectorDot(TVector v1, TVector v2)
-		{
-			double result = 0;
-			for (int i = 0; i < v1.size(); i++)
-			{
-				if (i >= v2.size())
-					break;
-
-				result += v1(i)*v2(i);
-			}
-			return result;
-		}
+		 * Rank a batch of features with one matrix-vector product.
+		 * 
+		 * Weights may be shorter than the features (trailing zero weights are 
+		 * not written to model files); features shorter than the weights 
+		 * are a dimension mismatch and abort.
+		 */
+		static VectorXd rankMatrix(const VectorXd& weights, const RankFeaturesMatrix& featuresMatrix);
+
+		/*!
+		 * Rank a single feature vector. Same dimension rules as rankMatrix.
+		 */
+		static double rankVector(const VectorXd& weights, const VectorXd& features);
+
+		/*!
+		 * Rank dense or sparse features. Sparse features are ranked in O(nnz).
+		 * Same dimension rules as rankMatrix.
+		 */
+		static double rankFeatures(const VectorXd& weights, const RankFeatures& features);
+
+		/*!
+		 * Check if any features of a list are sparse.
+		 * Lists with sparse features are ranked one by one instead of stacked.
+		 */
+		static bool hasSparseFeatures(const vector<RankFeatures>& featuresList);
 	};
 
 	/**************** SVM-Rank Model ****************/
@@ -460,16 +1107,17 @@ namespace HCSearch
 		 */
 		SVMRankModel(string fileName);
 		
-		virtual double rank(RankFeatures features);
+		virtual double rank(const RankFeatures& features);
 		virtual RankerType rankerType();
-		virtual vector<double> rank(vector<RankFeatures> featuresList);
+		virtual vector<double> rank(const vector<RankFeatures>& featuresList);
+		virtual VectorXd rank(const RankFeaturesMatrix& featuresMatrix);
 		virtual void load(string fileName);
 		virtual void save(string fileName);
 
 		/*!
 		 * Get weights.
 		 */
-		VectorXd getWeights();
+		const VectorXd& getWeights();
 
 		/*!
 		 * Initialize learning.
@@ -571,16 +1219,17 @@ namespace HCSearch
 		 */
 		VWRankModel(string fileName);
 		
-		virtual double rank(RankFeatures features);
+		virtual double rank(const RankFeatures& features);
 		virtual RankerType rankerType();
-		virtual vector<double> rank(vector<RankFeatures> featuresList);
+		virtual vector<double> rank(const vector<RankFeatures>& featuresList);
+		virtual VectorXd rank(const RankFeaturesMatrix& featuresMatrix);
 		virtual void load(string fileName);
 		virtual void save(string fileName);
 
 		/*!
 		 * Get weights.
 		 */
-		VectorXd getWeights();
+		const VectorXd& getWeights();
 
 		/*!
 		 * Initialize learning.
@@ -1,3 +1,5 @@
+#include <unordered_map>
+#include <limits>
 #include "FeatureFunction.hpp"
 #include "Globals.hpp"
 
@@ -5,11 +7,175 @@ namespace HCSearch
 {
 	/**************** Search Space Functions Abstract Definitions ****************/
 
+	FeatureAccumulators::FeatureAccumulators()
+	{
+		this->numNodes = 0;
+		this->numEdges = 0;
+		this->available = false;
+	}
+
+	RankFeatures IFeatureFunction::computeFeatures(ImgFeatures& X, ImgCandidate& YCandidate)
+	{
+		if (!YCandidate.isDelta())
+			return computeFeatures(X, YCandidate.labeling, YCandidate.action);
+
+		ImgLabeling& Y = *YCandidate.parent;
+		YCandidate.apply(Y);
+		RankFeatures features = computeFeatures(X, Y, YCandidate.action);
+		YCandidate.revert(Y);
+
+		return features;
+	}
+
 	int IFeatureFunction::featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
 		// This is inefficient but does the job
 		// Better to define more efficient functions for extended classes
-		return computeFeatures(X, Y, action).data.size();
+		return computeFeatures(X, Y, action).size();
+	}
+
+	bool IFeatureFunction::computeAccumulators(ImgFeatures& /*X*/, ImgLabeling& /*Y*/, FeatureAccumulators& acc)
+	{
+		acc.available = false;
+		return false;
+	}
+
+	bool IFeatureFunction::updateAccumulators(ImgFeatures& /*X*/, ImgCandidate& /*YCandidate*/, 
+		const FeatureAccumulators& /*parentAcc*/, FeatureAccumulators& acc)
+	{
+		acc.available = false;
+		return false;
+	}
+
+	RankFeatures IFeatureFunction::computeFeatures(ImgFeatures& /*X*/, const FeatureAccumulators& /*acc*/)
+	{
+		LOG(ERROR) << "feature function does not support computing features from accumulators.";
+		abort();
+		return RankFeatures();
+	}
+
+	RankFeatures IFeatureFunction::computeFeatures(ImgFeatures& X, ImgCandidate& YCandidate, const FeatureAccumulators& parentAcc)
+	{
+		FeatureAccumulators acc;
+		if (updateAccumulators(X, YCandidate, parentAcc, acc))
+			return computeFeatures(X, acc);
+
+		return computeFeatures(X, YCandidate);
+	}
+
+	bool IFeatureFunction::accumulateFeatures(ImgFeatures& X, ImgLabeling& Y, FeatureAccumulators& acc)
+	{
+		const int numNodes = X.getNumNodes();
+
+		acc.numNodes = numNodes;
+		acc.numEdges = 0;
+		acc.available = false;
+
+		// unary terms
+		for (int node = 0; node < numNodes; node++)
+		{
+			addUnaryContribution(X, Y, node, Y.getLabel(node), 1, acc.unarySums);
+		}
+
+		// pairwise terms
+		if (acc.pairwiseSums.size() > 0)
+		{
+			shared_ptr< const CompressedAdjList > edges = X.graph.adjList.getCompressed();
+			for (int node1 = 0; node1 < numNodes; node1++)
+			{
+				NeighborRange neighbors = edges->getNeighbors(node1);
+				for (NeighborRange::const_iterator it = neighbors.begin(); it != neighbors.end(); ++it)
+				{
+					int node2 = *it;
+					acc.numEdges++;
+
+					// updates find the incoming edges of a node through its own neighbors
+					if (edges->edgeIndex(node2, node1) < 0)
+						return false;
+
+					addPairwiseContribution(X, node1, Y.getLabel(node1), node2, Y.getLabel(node2), 1, acc.pairwiseSums);
+				}
+			}
+		}
+
+		acc.available = true;
+		return true;
+	}
+
+	bool IFeatureFunction::accumulateDelta(ImgFeatures& X, ImgCandidate& YCandidate, 
+		const FeatureAccumulators& parentAcc, FeatureAccumulators& acc)
+	{
+		if (!parentAcc.available || !YCandidate.isDelta())
+		{
+			acc.available = false;
+			return false;
+		}
+
+		ImgLabeling& YParent = *YCandidate.parent;
+		const bool hasPairwiseTerm = parentAcc.pairwiseSums.size() > 0;
+
+		acc = parentAcc;
+		for (map<int, int>::iterator it = YCandidate.newLabels.begin(); it != YCandidate.newLabels.end(); ++it)
+		{
+			int node1 = it->first;
+			int oldLabel1 = YParent.getLabel(node1);
+			int newLabel1 = it->second;
+
+			// replace unary term
+			addUnaryContribution(X, YParent, node1, oldLabel1, -1, acc.unarySums);
+			addUnaryContribution(X, YParent, node1, newLabel1, 1, acc.unarySums);
+
+			if (!hasPairwiseTerm)
+				continue;
+
+			// replace pairwise terms of outgoing and incoming edges, 
+			// where edges between two changed nodes are replaced from their starting node
+			NeighborRange neighbors = X.graph.adjList.neighbors(node1);
+			for (NeighborRange::const_iterator it2 = neighbors.begin(); it2 != neighbors.end(); ++it2)
+			{
+				int node2 = *it2;
+				int oldLabel2 = YParent.getLabel(node2);
+				int newLabel2 = YCandidate.getLabel(node2);
+
+				addPairwiseContribution(X, node1, oldLabel1, node2, oldLabel2, -1, acc.pairwiseSums);
+				addPairwiseContribution(X, node1, newLabel1, node2, newLabel2, 1, acc.pairwiseSums);
+
+				if (YCandidate.newLabels.count(node2) == 0)
+				{
+					addPairwiseContribution(X, node2, oldLabel2, node1, oldLabel1, -1, acc.pairwiseSums);
+					addPairwiseContribution(X, node2, oldLabel2, node1, newLabel1, 1, acc.pairwiseSums);
+				}
+			}
+		}
+
+		return true;
+	}
+
+	RankFeatures IFeatureFunction::assembleFeatures(const FeatureAccumulators& acc, double unaryWeight, double pairwiseWeight)
+	{
+		const int unarySize = acc.unarySums.size();
+		const int pairwiseSize = acc.pairwiseSums.size();
+
+		VectorXd phi = VectorXd::Zero(unarySize + pairwiseSize);
+		phi.segment(0, unarySize) = unaryWeight * (1.0/acc.numNodes * acc.unarySums);
+		if (pairwiseSize > 0)
+			phi.segment(unarySize, pairwiseSize) = pairwiseWeight * (1.0/acc.numEdges * acc.pairwiseSums);
+
+		return RankFeatures(phi);
+	}
+
+	void IFeatureFunction::addUnaryContribution(ImgFeatures& /*X*/, ImgLabeling& /*Y*/, int /*node*/, int /*nodeLabel*/, 
+		double /*weight*/, VectorXd& /*unarySums*/)
+	{
+		LOG(ERROR) << "feature function does not define unary contributions.";
+		abort();
+	}
+
+	void IFeatureFunction::addPairwiseContribution(ImgFeatures& /*X*/, int /*node1*/, int /*nodeLabel1*/, int /*node2*/, int /*nodeLabel2*/, 
+		double /*weight*/, VectorXd& /*pairwiseSums*/)
+	{
+		LOG(ERROR) << "feature function does not define pairwise contributions.";
+		abort();
 	}
 
 	/**************** Feature Functions ****************/
@@ -67,6 +233,73 @@ namespace HCSearch
 		return numClasses*unaryFeatDim + numPairs*pairwiseFeatDim;
 	}
 
+	bool StandardFeatures::computeAccumulators(ImgFeatures& X, ImgLabeling& Y, FeatureAccumulators& acc)
+	{
+		const int featureDim = X.getFeatureDim();
+		const int numClasses = Global::settings->CLASSES.numClasses();
+		const int unaryFeatDim = 1+featureDim;
+		const int pairwiseFeatDim = featureDim;
+		const int numPairs = (numClasses*(numClasses+1))/2;
+
+		acc.unarySums = VectorXd::Zero(numClasses*unaryFeatDim);
+		acc.pairwiseSums = VectorXd::Zero(numPairs*pairwiseFeatDim);
+
+		return accumulateFeatures(X, Y, acc);
+	}
+
+	bool StandardFeatures::updateAccumulators(ImgFeatures& X, ImgCandidate& YCandidate, 
+		const FeatureAccumulators& parentAcc, FeatureAccumulators& acc)
+	{
+		return accumulateDelta(X, YCandidate, parentAcc, acc);
+	}
+
+	RankFeatures StandardFeatures::computeFeatures(ImgFeatures& /*X*/, const FeatureAccumulators& acc)
+	{
+		return assembleFeatures(acc, lambda1, lambda2);
+	}
+
+	void StandardFeatures::addUnaryContribution(ImgFeatures& X, ImgLabeling& /*Y*/, int node, int nodeLabel, 
+		double weight, VectorXd& unarySums)
+	{
+		const int featureDim = X.getFeatureDim();
+		const int unaryFeatDim = 1+featureDim;
+
+		int classIndex = Global::settings->CLASSES.getClassIndex(nodeLabel);
+
+		// bias and unary feature
+		unarySums(classIndex*unaryFeatDim) += weight;
+		X.addNodeFeatures(node, weight, unarySums, classIndex*unaryFeatDim+1);
+	}
+
+	void StandardFeatures::addPairwiseContribution(ImgFeatures& X, int node1, int nodeLabel1, int node2, int nodeLabel2, 
+		double weight, VectorXd& pairwiseSums)
+	{
+		const int featureDim = X.getFeatureDim();
+		const int classIndex = pairIndex(Global::settings->CLASSES.getClassIndex(nodeLabel1), 
+			Global::settings->CLASSES.getClassIndex(nodeLabel2), Global::settings->CLASSES.numClasses());
+
+		VectorBlock<VectorXd> sums = pairwiseSums.segment(classIndex*featureDim, featureDim);
+
+		// contrast sensitive pairwise potential, added in place from the edge kernel cache if possible
+		int edgeIndex = X.edgeKernelsAvailable ? X.edgeKernels.edgeIndex(node1, node2) : -1;
+		if (edgeIndex >= 0)
+		{
+			const MatrixXd& contrast = X.edgeKernels.contrast;
+			if (nodeLabel1 != nodeLabel2)
+				sums += weight * contrast.block(edgeIndex, 0, 1, featureDim).transpose();
+			else
+				sums.array() += weight * (1 - contrast.block(edgeIndex, 0, 1, featureDim).transpose().array());
+		}
+		else
+		{
+			VectorXd contrast = X.getEdgeContrast(node1, node2);
+			if (nodeLabel1 != nodeLabel2)
+				sums += weight * contrast;
+			else
+				sums.array() += weight * (1 - contrast.array());
+		}
+	}
+
 	VectorXd StandardFeatures::computeUnaryTerm(ImgFeatures& X, ImgLabeling& Y)
 	{
 		const int numNodes = X.getNumNodes();
@@ -79,8 +312,7 @@ namespace HCSearch
 		// unary potential
 		for (int node = 0; node < numNodes; node++)
 		{
-			// get node features and label
-			VectorXd nodeFeatures = X.graph.nodesData.row(node);
+			// get node label
 			int nodeLabel = Y.getLabel(node);
 
 			// map node label to indexing value in phi vector
@@ -88,7 +320,7 @@ namespace HCSearch
 
 			// assignment: bias and unary feature
 			phi(classIndex*unaryFeatDim) += 1;
-			phi.segment(classIndex*unaryFeatDim+1, featureDim) += nodeFeatures;
+			X.addNodeFeatures(node, 1, phi, classIndex*unaryFeatDim+1);
 		}
 
 		phi = 1.0/X.getNumNodes() * phi;
@@ -109,26 +341,23 @@ namespace HCSearch
 		int numEdges = 0;
 		for (int node1 = 0; node1 < numNodes; node1++)
 		{
-			if (X.graph.adjList.count(node1) == 0)
+			// get neighbors (ending nodes) of starting node
+			NeighborRange neighbors = X.graph.adjList.neighbors(node1);
+			if (neighbors.empty())
 				continue;
 
-			// get neighbors (ending nodes) of starting node
-			NeighborSet_t neighbors = X.graph.adjList[node1];
 			const int numNeighbors = neighbors.size();
-			for (NeighborSet_t::iterator it = neighbors.begin(); it != neighbors.end(); ++it)
+			for (NeighborRange::const_iterator it = neighbors.begin(); it != neighbors.end(); ++it)
 			{
 				int node2 = *it;
 				numEdges++;
 
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
+				// get node labels
 				int nodeLabel1 = Y.getLabel(node1);
-
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
 				int nodeLabel2 = Y.getLabel(node2);
 
 				int classIndex = -1;
-				VectorXd edgeFeatureVector = computePairwiseFeatures(nodeFeatures1, nodeFeatures2, nodeLabel1, nodeLabel2, classIndex);
+				VectorXd edgeFeatureVector = computePairwiseFeatures(X, node1, node2, nodeLabel1, nodeLabel2, classIndex);
 				phi.segment(classIndex*pairwiseFeatDim, pairwiseFeatDim) += edgeFeatureVector; // contrast sensitive pairwise potential
 			}
 		}
@@ -138,39 +367,302 @@ namespace HCSearch
 		return phi;
 	}
 
-	VectorXd StandardFeatures::computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
+	VectorXd StandardFeatures::computePairwiseFeatures(ImgFeatures& X, int node1, int node2, 
 		int nodeLabel1, int nodeLabel2, int& classIndex)
 	{
 		int node1ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel1);
 		int node2ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel2);
 		int numClasses = Global::settings->CLASSES.numClasses();
 
-		int i = min(node1ClassIndex, node2ClassIndex);
-		int j = max(node1ClassIndex, node2ClassIndex);
-
-		classIndex = (numClasses*(numClasses+1)-(numClasses-i)*(numClasses-i+1))/2+(numClasses-1-j);
+		classIndex = pairIndex(node1ClassIndex, node2ClassIndex, numClasses);
 
 		// phi features depend on labels
 		if (nodeLabel1 != nodeLabel2)
 		{
-			VectorXd diff = nodeFeatures1 - nodeFeatures2;
-			VectorXd negdiffabs2 = -diff.cwiseAbs2();
-			VectorXd expnegdiffabs2 = negdiffabs2.array().exp();
+			VectorXd expnegdiffabs2 = X.getEdgeContrast(node1, node2);
 
 			// assignment
 			return expnegdiffabs2;
 		}
 		else
 		{
-			VectorXd diff = nodeFeatures1 - nodeFeatures2;
-			VectorXd negdiffabs2 = -diff.cwiseAbs2();
-			VectorXd expnegdiffabs2 = 1 - negdiffabs2.array().exp();
+			VectorXd expnegdiffabs2 = 1 - X.getEdgeContrast(node1, node2).array();
 
 			// assignment
 			return expnegdiffabs2;
 		}
 	}
 
+	int StandardFeatures::pairIndex(int classIndex1, int classIndex2, int numClasses)
+	{
+		int i = min(classIndex1, classIndex2);
+		int j = max(classIndex1, classIndex2);
+
+		return (numClasses*(numClasses+1)-(numClasses-i)*(numClasses-i+1))/2+(numClasses-1-j);
+	}
+
+	/**************** Label Location Extents ****************/
+
+	namespace
+	{
+		/*!
+		 * @brief Bounding box of the node locations of a label.
+		 *
+		 * Some node of label A lies left of some node of label B iff
+		 * the leftmost node of A lies left of the rightmost node of B,
+		 * so the relative location features only need these extremes.
+		 */
+		struct LocationExtents
+		{
+			double minX;
+			double maxX;
+			double minY;
+			double maxY;
+			int numMinX; //!< Number of nodes at minX
+			int numMaxX; //!< Number of nodes at maxX
+			int numMinY; //!< Number of nodes at minY
+			int numMaxY; //!< Number of nodes at maxY
+
+			LocationExtents()
+			{
+				this->minX = numeric_limits<double>::infinity();
+				this->maxX = -numeric_limits<double>::infinity();
+				this->minY = numeric_limits<double>::infinity();
+				this->maxY = -numeric_limits<double>::infinity();
+				this->numMinX = 0;
+				this->numMaxX = 0;
+				this->numMinY = 0;
+				this->numMaxY = 0;
+			}
+
+			void add(double x, double y)
+			{
+				addBound(x < this->minX, x == this->minX, x, this->minX, this->numMinX);
+				addBound(x > this->maxX, x == this->maxX, x, this->maxX, this->numMaxX);
+				addBound(y < this->minY, y == this->minY, y, this->minY, this->numMinY);
+				addBound(y > this->maxY, y == this->maxY, y, this->maxY, this->numMaxY);
+			}
+
+			/*!
+			 * Remove a node location.
+			 * @return Returns true if the last node on a boundary was removed, 
+			 *	in which case the extents must be recomputed
+			 */
+			bool remove(double x, double y)
+			{
+				bool shrunk = false;
+				shrunk = (x == this->minX && --this->numMinX == 0) || shrunk;
+				shrunk = (x == this->maxX && --this->numMaxX == 0) || shrunk;
+				shrunk = (y == this->minY && --this->numMinY == 0) || shrunk;
+				shrunk = (y == this->maxY && --this->numMaxY == 0) || shrunk;
+				return shrunk;
+			}
+
+			bool someLeftOf(const LocationExtents& other) const { return this->minX < other.maxX; }
+			bool someRightOf(const LocationExtents& other) const { return this->maxX > other.minX; }
+			bool someAbove(const LocationExtents& other) const { return this->minY < other.maxY; }
+			bool someBelow(const LocationExtents& other) const { return this->maxY > other.minY; }
+
+		private:
+			static void addBound(bool beyond, bool on, double value, double& bound, int& count)
+			{
+				if (beyond)
+				{
+					bound = value;
+					count = 1;
+				}
+				else if (on)
+				{
+					count++;
+				}
+			}
+		};
+
+		typedef map<int, LocationExtents> LabelExtents_t;
+
+		LabelExtents_t computeLabelExtents(ImgFeatures& X, ImgLabeling& Y)
+		{
+			LabelExtents_t extents;
+			for (int node = 0; node < X.getNumNodes(); node++)
+				extents[Y.getLabel(node)].add(X.getNodeLocationX(node), X.getNodeLocationY(node));
+
+			return extents;
+		}
+
+		template <class TLabeling>
+		LabelExtents_t computeLabelExtents(ImgFeatures& X, TLabeling& Y, set<int>& nodes)
+		{
+			LabelExtents_t extents;
+			for (set<int>::iterator it = nodes.begin(); it != nodes.end(); ++it)
+				extents[Y.getLabel(*it)].add(X.getNodeLocationX(*it), X.getNodeLocationY(*it));
+
+			return extents;
+		}
+
+		int contextPairIndex(int label1, int label2)
+		{
+			int node1ClassIndex = Global::settings->CLASSES.getClassIndex(label1);
+			int node2ClassIndex = Global::settings->CLASSES.getClassIndex(label2);
+			int numClasses = Global::settings->CLASSES.numClasses();
+
+			int i = min(node1ClassIndex, node2ClassIndex);
+			int j = max(node1ClassIndex, node2ClassIndex);
+
+			return (numClasses*(numClasses+1)-(numClasses-i)*(numClasses-i+1))/2+(numClasses-1-j);
+		}
+
+		/*!
+		 * @brief Left/right/above/below indicators over all pairs of differently labeled nodes.
+		 */
+		VectorXd computeRelativeLocationTerm(ImgFeatures& X, ImgLabeling& Y)
+		{
+			const int numClasses = Global::settings->CLASSES.numClasses();
+			const int contextFeatDim = 4;
+			const int numContextPairs = (numClasses*(numClasses+1))/2;
+
+			VectorXd phi = VectorXd::Zero(numContextPairs*contextFeatDim);
+
+			LabelExtents_t extents = computeLabelExtents(X, Y);
+			for (LabelExtents_t::iterator it1 = extents.begin(); it1 != extents.end(); ++it1)
+			{
+				for (LabelExtents_t::iterator it2 = extents.begin(); it2 != extents.end(); ++it2)
+				{
+					if (it1 == it2)
+						continue;
+
+					int classIndex = contextPairIndex(it1->first, it2->first);
+
+					if (it1->second.someLeftOf(it2->second))
+						phi(classIndex*contextFeatDim + 0) = 1;
+					if (it1->second.someRightOf(it2->second))
+						phi(classIndex*contextFeatDim + 1) = 1;
+					if (it1->second.someAbove(it2->second))
+						phi(classIndex*contextFeatDim + 2) = 1;
+					if (it1->second.someBelow(it2->second))
+						phi(classIndex*contextFeatDim + 3) = 1;
+				}
+			}
+
+			return phi;
+		}
+
+		/*!
+		 * @brief Manually defined mutex constraints between action nodes and all nodes.
+		 */
+		VectorXd computeManualMutexTerm(LabelExtents_t& actionExtents, LabelExtents_t& extents)
+		{
+			const int numMutexConstraints = 8;
+
+			VectorXd phi = VectorXd::Zero(numMutexConstraints);
+
+			// MANUALLY DEFINED FOR STANFORD DATASET
+			// (action label 1 below label k, action label k above label 1)
+			const int constrainedLabels[] = {3, 4, 5, 7};
+			for (int k = 0; k < numMutexConstraints/2; k++)
+			{
+				int label = constrainedLabels[k];
+				if (actionExtents[1].someBelow(extents[label]))
+					phi(2*k) = 1;
+				if (actionExtents[label].someAbove(extents[1]))
+					phi(2*k+1) = 1;
+			}
+
+			return phi;
+		}
+
+		VectorXd computeManualMutexTerm(ImgFeatures& X, ImgLabeling& Y, set<int>& action)
+		{
+			LabelExtents_t actionExtents = computeLabelExtents(X, Y, action);
+			LabelExtents_t extents = computeLabelExtents(X, Y);
+
+			return computeManualMutexTerm(actionExtents, extents);
+		}
+
+		/*!
+		 * @brief Hole indicator: all neighbors of the action share one label other than the action label.
+		 * 
+		 * Distinct neighbor classes are counted in a class histogram, stopping at the second one.
+		 */
+		template <class TLabeling>
+		VectorXd computeHoleTerm(TLabeling& Y, const SharedAdjList& adjList, set<int>& action)
+		{
+			if (action.empty())
+				return VectorXd::Zero(1);
+
+			const int numClasses = Global::settings->CLASSES.numClasses();
+
+			vector<bool> neighborClasses(numClasses, false);
+			int numNeighborClasses = 0;
+			int neighborLabel = 0;
+			for (set<int>::iterator it = action.begin(); it != action.end() && numNeighborClasses <= 1; ++it)
+			{
+				NeighborRange neighbors = adjList.neighbors(*it);
+				for (NeighborRange::const_iterator it2 = neighbors.begin(); it2 != neighbors.end(); ++it2)
+				{
+					int label = Y.getLabel(*it2);
+					int classIndex = Global::settings->CLASSES.getClassIndex(label);
+					if (!neighborClasses[classIndex])
+					{
+						neighborClasses[classIndex] = true;
+						neighborLabel = label;
+						if (++numNeighborClasses > 1)
+							break;
+					}
+				}
+			}
+
+			int actionLabel = Y.getLabel(*action.rbegin());
+			int holeFound = (numNeighborClasses == 1 && neighborLabel != actionLabel) ? 1 : 0;
+
+			return holeFound * VectorXd::Ones(1);
+		}
+
+		const int LOCATION_SUMS_DIM = 5; // count, x, y, x^2, y^2
+		const int LOCATION_EXTENTS_DIM = 8; // min x, max x, min y, max y, number of nodes on each
+
+		void addLocation(ImgFeatures& X, int node, int classIndex, double weight, VectorXd& locationSums)
+		{
+			double xPos = X.getNodeLocationX(node);
+			double yPos = X.getNodeLocationY(node);
+
+			double* sums = locationSums.data() + classIndex*LOCATION_SUMS_DIM;
+			sums[0] += weight;
+			sums[1] += weight*xPos;
+			sums[2] += weight*yPos;
+			sums[3] += weight*xPos*xPos;
+			sums[4] += weight*yPos*yPos;
+		}
+
+		void setExtents(int classIndex, const LocationExtents& extents, VectorXd& locationExtents)
+		{
+			double* ext = locationExtents.data() + classIndex*LOCATION_EXTENTS_DIM;
+			ext[0] = extents.minX;
+			ext[1] = extents.maxX;
+			ext[2] = extents.minY;
+			ext[3] = extents.maxY;
+			ext[4] = extents.numMinX;
+			ext[5] = extents.numMaxX;
+			ext[6] = extents.numMinY;
+			ext[7] = extents.numMaxY;
+		}
+
+		LocationExtents getExtents(int classIndex, const VectorXd& locationExtents)
+		{
+			const double* ext = locationExtents.data() + classIndex*LOCATION_EXTENTS_DIM;
+
+			LocationExtents extents;
+			extents.minX = ext[0];
+			extents.maxX = ext[1];
+			extents.minY = ext[2];
+			extents.maxY = ext[3];
+			extents.numMinX = static_cast<int>(ext[4]);
+			extents.numMaxX = static_cast<int>(ext[5]);
+			extents.numMinY = static_cast<int>(ext[6]);
+			extents.numMaxY = static_cast<int>(ext[7]);
+			return extents;
+		}
+	}
+
 	/**************** Standard Context Features ****************/
 
 	StandardContextFeatures::StandardContextFeatures()
@@ -203,7 +695,9 @@ namespace HCSearch
 		phi.segment(numClasses*unaryFeatDim, numPairs*pairwiseFeatDim) = pairwiseTerm;
 		phi.segment(numClasses*unaryFeatDim + numPairs*pairwiseFeatDim, numPairs*numConfigurations) = contextTerm;
 
-		return RankFeatures(phi);
+		// label pair blocks of absent classes are zero
+		SparseVector<double> sparsePhi = phi.sparseView();
+		return RankFeatures(sparsePhi);
 	}
 
 	int StandardContextFeatures::featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action)
@@ -231,8 +725,7 @@ namespace HCSearch
 		// unary potential
 		for (int node = 0; node < numNodes; node++)
 		{
-			// get node features and label
-			VectorXd nodeFeatures = X.graph.nodesData.row(node);
+			// get node label
 			int nodeLabel = Y.getLabel(node);
 
 			// map node label to indexing value in phi vector
@@ -240,7 +733,7 @@ namespace HCSearch
 
 			// assignment: bias and unary feature
 			phi(classIndex*unaryFeatDim) += 1;
-			phi.segment(classIndex*unaryFeatDim+1, featureDim) += nodeFeatures;
+			X.addNodeFeatures(node, 1, phi, classIndex*unaryFeatDim+1);
 		}
 
 		phi = 1.0/X.getNumNodes() * phi;
@@ -261,26 +754,23 @@ namespace HCSearch
 		int numEdges = 0;
 		for (int node1 = 0; node1 < numNodes; node1++)
 		{
-			if (X.graph.adjList.count(node1) == 0)
+			// get neighbors (ending nodes) of starting node
+			NeighborRange neighbors = X.graph.adjList.neighbors(node1);
+			if (neighbors.empty())
 				continue;
 
-			// get neighbors (ending nodes) of starting node
-			NeighborSet_t neighbors = X.graph.adjList[node1];
 			const int numNeighbors = neighbors.size();
-			for (NeighborSet_t::iterator it = neighbors.begin(); it != neighbors.end(); ++it)
+			for (NeighborRange::const_iterator it = neighbors.begin(); it != neighbors.end(); ++it)
 			{
 				int node2 = *it;
 				numEdges++;
 
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
+				// get node labels
 				int nodeLabel1 = Y.getLabel(node1);
-
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
 				int nodeLabel2 = Y.getLabel(node2);
 
 				int classIndex = -1;
-				VectorXd edgeFeatureVector = computePairwiseFeatures(nodeFeatures1, nodeFeatures2, nodeLabel1, nodeLabel2, classIndex);
+				VectorXd edgeFeatureVector = computePairwiseFeatures(X, node1, node2, nodeLabel1, nodeLabel2, classIndex);
 				phi.segment(classIndex*pairwiseFeatDim, pairwiseFeatDim) += edgeFeatureVector; // contrast sensitive pairwise potential
 			}
 		}
@@ -290,7 +780,7 @@ namespace HCSearch
 		return phi;
 	}
 
-	VectorXd StandardContextFeatures::computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
+	VectorXd StandardContextFeatures::computePairwiseFeatures(ImgFeatures& X, int node1, int node2, 
 		int nodeLabel1, int nodeLabel2, int& classIndex)
 	{
 		int node1ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel1);
@@ -305,18 +795,14 @@ namespace HCSearch
 		// phi features depend on labels
 		if (nodeLabel1 != nodeLabel2)
 		{
-			VectorXd diff = nodeFeatures1 - nodeFeatures2;
-			VectorXd negdiffabs2 = -diff.cwiseAbs2();
-			VectorXd expnegdiffabs2 = negdiffabs2.array().exp();
+			VectorXd expnegdiffabs2 = X.getEdgeContrast(node1, node2);
 
 			// assignment
 			return expnegdiffabs2;
 		}
 		else
 		{
-			VectorXd diff = nodeFeatures1 - nodeFeatures2;
-			VectorXd negdiffabs2 = -diff.cwiseAbs2();
-			VectorXd expnegdiffabs2 = 1 - negdiffabs2.array().exp();
+			VectorXd expnegdiffabs2 = 1 - X.getEdgeContrast(node1, node2).array();
 
 			// assignment
 			return expnegdiffabs2;
@@ -325,93 +811,7 @@ namespace HCSearch
 
 	VectorXd StandardContextFeatures::computeContextTerm(ImgFeatures& X, ImgLabeling& Y)
 	{
-		const int numNodes = X.getNumNodes();
-		const int numClasses = Global::settings->CLASSES.numClasses();
-		const int contextFeatDim = 4;
-		const int numContextPairs = (numClasses*(numClasses+1))/2;
-		
-		VectorXd phi = VectorXd::Zero(numContextPairs*contextFeatDim);
-
-		int numEdges = 0;
-		for (int node1 = 0; node1 < numNodes; node1++)
-		{
-			for (int node2 = 0; node2 < numNodes; node2++)
-			{
-				if (node1 == node2)
-					continue;
-
-				numEdges++;
-
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-				double nodeLocationX1 = X.getNodeLocationX(node1);
-				double nodeLocationY1 = X.getNodeLocationY(node1);
-				int nodeLabel1 = Y.getLabel(node1);
-
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
-				double nodeLocationX2 = X.getNodeLocationX(node2);
-				double nodeLocationY2 = X.getNodeLocationY(node2);
-				int nodeLabel2 = Y.getLabel(node2);
-
-				int classIndex = -1;
-				VectorXd edgeFeatureVector = computeContextFeatures(nodeFeatures1, nodeFeatures2, 
-					nodeLocationX1, nodeLocationY1, nodeLocationX2, nodeLocationY2, 
-					nodeLabel1, nodeLabel2, classIndex);
-
-				for (int i = 0; i < contextFeatDim; i++)
-				{
-					if (edgeFeatureVector(i) != 0)
-						phi(classIndex*contextFeatDim + i) = edgeFeatureVector(i);
-				}
-			}
-		}
-		
-		return phi;
-	}
-
-	VectorXd StandardContextFeatures::computeContextFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
-		double nodeLocationX1, double nodeLocationY1, double nodeLocationX2, double nodeLocationY2, 
-		int nodeLabel1, int nodeLabel2, int& classIndex)
-	{
-		int node1ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel1);
-		int node2ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel2);
-		int numClasses = Global::settings->CLASSES.numClasses();
-
-		int i = min(node1ClassIndex, node2ClassIndex);
-		int j = max(node1ClassIndex, node2ClassIndex);
-
-		classIndex = (numClasses*(numClasses+1)-(numClasses-i)*(numClasses-i+1))/2+(numClasses-1-j);
-
-		// phi features depend on labels
-		if (nodeLabel1 != nodeLabel2)
-		{
-			VectorXd potential = VectorXd::Zero(4);
-
-			if (nodeLocationX1 < nodeLocationX2)
-			{
-				potential(0) = 1;
-			}
-			else if (nodeLocationX1 > nodeLocationX2)
-			{
-				potential(1) = 1;
-			}
-			
-			if (nodeLocationY1 < nodeLocationY2)
-			{
-				potential(2) = 1;
-			}
-			else if (nodeLocationY1 > nodeLocationY2)
-			{
-				potential(3) = 1;
-			}
-
-			return potential;
-		}
-		else
-		{
-			VectorXd potential = VectorXd::Zero(4);
-			return potential;
-		}
+		return computeRelativeLocationTerm(X, Y);
 	}
 
 	/**************** Standard Features Alternative Formulation ****************/
@@ -467,8 +867,7 @@ namespace HCSearch
 		// unary potential
 		for (int node = 0; node < numNodes; node++)
 		{
-			// get node features and label
-			VectorXd nodeFeatures = X.graph.nodesData.row(node);
+			// get node label
 			int nodeLabel = Y.getLabel(node);
 
 			// map node label to indexing value in phi vector
@@ -476,7 +875,7 @@ namespace HCSearch
 
 			// assignment: bias and unary feature
 			phi(classIndex*unaryFeatDim) += 1;
-			phi.segment(classIndex*unaryFeatDim+1, featureDim) += nodeFeatures;
+			X.addNodeFeatures(node, 1, phi, classIndex*unaryFeatDim+1);
 		}
 
 		return phi;
@@ -493,25 +892,22 @@ namespace HCSearch
 
 		for (int node1 = 0; node1 < numNodes; node1++)
 		{
-			if (X.graph.adjList.count(node1) == 0)
+			// get neighbors (ending nodes) of starting node
+			NeighborRange neighbors = X.graph.adjList.neighbors(node1);
+			if (neighbors.empty())
 				continue;
 
-			// get neighbors (ending nodes) of starting node
-			NeighborSet_t neighbors = X.graph.adjList[node1];
 			const int numNeighbors = neighbors.size();
-			for (NeighborSet_t::iterator it = neighbors.begin(); it != neighbors.end(); ++it)
+			for (NeighborRange::const_iterator it = neighbors.begin(); it != neighbors.end(); ++it)
 			{
 				int node2 = *it;
 
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
+				// get node labels
 				int nodeLabel1 = Y.getLabel(node1);
-
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
 				int nodeLabel2 = Y.getLabel(node2);
 
 				int classIndex = -1;
-				VectorXd edgeFeatureVector = computePairwiseFeatures(nodeFeatures1, nodeFeatures2, nodeLabel1, nodeLabel2, classIndex);
+				VectorXd edgeFeatureVector = computePairwiseFeatures(X, node1, node2, nodeLabel1, nodeLabel2, classIndex);
 				phi.segment(classIndex*pairwiseFeatDim, pairwiseFeatDim) += edgeFeatureVector; // contrast sensitive pairwise potential
 			}
 		}
@@ -519,15 +915,13 @@ namespace HCSearch
 		return 0.5*phi;
 	}
 
-	VectorXd StandardAltFeatures::computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
+	VectorXd StandardAltFeatures::computePairwiseFeatures(ImgFeatures& X, int node1, int node2, 
 		int nodeLabel1, int nodeLabel2, int& classIndex)
 	{
 		// phi features depend on labels
 		if (nodeLabel1 != nodeLabel2)
 		{
-			VectorXd diff = nodeFeatures1 - nodeFeatures2;
-			VectorXd negdiffabs2 = -diff.cwiseAbs2();
-			VectorXd expnegdiffabs2 = negdiffabs2.array().exp();
+			VectorXd expnegdiffabs2 = X.getEdgeContrast(node1, node2);
 			classIndex = Global::settings->CLASSES.numClasses(); // numClasses
 
 			// assignment
@@ -535,9 +929,7 @@ namespace HCSearch
 		}
 		else
 		{
-			VectorXd diff = nodeFeatures1 - nodeFeatures2;
-			VectorXd negdiffabs2 = -diff.cwiseAbs2();
-			VectorXd expnegdiffabs2 = 1 - negdiffabs2.array().exp();
+			VectorXd expnegdiffabs2 = 1 - X.getEdgeContrast(node1, node2).array();
 
 			// map node label to indexing value in phi vector
 			classIndex = Global::settings->CLASSES.getClassIndex(nodeLabel1);
@@ -590,6 +982,56 @@ namespace HCSearch
 		return numClasses*unaryFeatDim + numPairs*pairwiseFeatDim;
 	}
 
+	bool StandardConfFeatures::computeAccumulators(ImgFeatures& X, ImgLabeling& Y, FeatureAccumulators& acc)
+	{
+		if (!Y.confidencesAvailable)
+		{
+			LOG(ERROR) << "confidences not available for unary potential.";
+			abort();
+		}
+
+		const int featureDim = X.getFeatureDim();
+		const int numClasses = Global::settings->CLASSES.numClasses();
+		const int unaryFeatDim = 1;
+		const int pairwiseFeatDim = featureDim;
+		const int numPairs = (numClasses*(numClasses+1))/2;
+
+		acc.unarySums = VectorXd::Zero(numClasses*unaryFeatDim);
+		acc.pairwiseSums = VectorXd::Zero(numPairs*pairwiseFeatDim);
+
+		return accumulateFeatures(X, Y, acc);
+	}
+
+	bool StandardConfFeatures::updateAccumulators(ImgFeatures& X, ImgCandidate& YCandidate, 
+		const FeatureAccumulators& parentAcc, FeatureAccumulators& acc)
+	{
+		return accumulateDelta(X, YCandidate, parentAcc, acc);
+	}
+
+	RankFeatures StandardConfFeatures::computeFeatures(ImgFeatures& /*X*/, const FeatureAccumulators& acc)
+	{
+		return assembleFeatures(acc, 1, 1);
+	}
+
+	void StandardConfFeatures::addUnaryContribution(ImgFeatures& /*X*/, ImgLabeling& Y, int node, int nodeLabel, 
+		double weight, VectorXd& unarySums)
+	{
+		const int unaryFeatDim = 1;
+
+		int classIndex = Global::settings->CLASSES.getClassIndex(nodeLabel);
+
+		unarySums(classIndex*unaryFeatDim) += weight * (1-Y.confidences(node, classIndex));
+	}
+
+	void StandardConfFeatures::addPairwiseContribution(ImgFeatures& X, int node1, int nodeLabel1, int node2, int nodeLabel2, 
+		double weight, VectorXd& pairwiseSums)
+	{
+		int classIndex = -1;
+		VectorXd edgeFeatureVector = computePairwiseFeatures(X, node1, node2, nodeLabel1, nodeLabel2, classIndex);
+		const int pairwiseFeatDim = edgeFeatureVector.size();
+		pairwiseSums.segment(classIndex*pairwiseFeatDim, pairwiseFeatDim) += weight * edgeFeatureVector;
+	}
+
 	VectorXd StandardConfFeatures::computeUnaryTerm(ImgFeatures& X, ImgLabeling& Y)
 	{
 		if (!Y.confidencesAvailable)
@@ -608,8 +1050,7 @@ namespace HCSearch
 		// unary potential
 		for (int node = 0; node < numNodes; node++)
 		{
-			// get node features and label
-			VectorXd nodeFeatures = X.graph.nodesData.row(node);
+			// get node label
 			int nodeLabel = Y.getLabel(node);
 
 			// map node label to indexing value in phi vector
@@ -637,26 +1078,23 @@ namespace HCSearch
 		int numEdges = 0;
 		for (int node1 = 0; node1 < numNodes; node1++)
 		{
-			if (X.graph.adjList.count(node1) == 0)
+			// get neighbors (ending nodes) of starting node
+			NeighborRange neighbors = X.graph.adjList.neighbors(node1);
+			if (neighbors.empty())
 				continue;
 
-			// get neighbors (ending nodes) of starting node
-			NeighborSet_t neighbors = X.graph.adjList[node1];
 			const int numNeighbors = neighbors.size();
-			for (NeighborSet_t::iterator it = neighbors.begin(); it != neighbors.end(); ++it)
+			for (NeighborRange::const_iterator it = neighbors.begin(); it != neighbors.end(); ++it)
 			{
 				int node2 = *it;
 				numEdges++;
 
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
+				// get node labels
 				int nodeLabel1 = Y.getLabel(node1);
-
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
 				int nodeLabel2 = Y.getLabel(node2);
 
 				int classIndex = -1;
-				VectorXd edgeFeatureVector = computePairwiseFeatures(nodeFeatures1, nodeFeatures2, nodeLabel1, nodeLabel2, classIndex);
+				VectorXd edgeFeatureVector = computePairwiseFeatures(X, node1, node2, nodeLabel1, nodeLabel2, classIndex);
 				phi.segment(classIndex*pairwiseFeatDim, pairwiseFeatDim) += edgeFeatureVector; // contrast sensitive pairwise potential
 			}
 		}
@@ -666,7 +1104,7 @@ namespace HCSearch
 		return phi;
 	}
 
-	VectorXd StandardConfFeatures::computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
+	VectorXd StandardConfFeatures::computePairwiseFeatures(ImgFeatures& X, int node1, int node2, 
 		int nodeLabel1, int nodeLabel2, int& classIndex)
 	{
 		int node1ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel1);
@@ -681,18 +1119,14 @@ namespace HCSearch
 		// phi features depend on labels
 		if (nodeLabel1 != nodeLabel2)
 		{
-			VectorXd diff = nodeFeatures1 - nodeFeatures2;
-			VectorXd negdiffabs2 = -diff.cwiseAbs2();
-			VectorXd expnegdiffabs2 = negdiffabs2.array().exp();
+			VectorXd expnegdiffabs2 = X.getEdgeContrast(node1, node2);
 
 			// assignment
 			return expnegdiffabs2;
 		}
 		else
 		{
-			VectorXd diff = nodeFeatures1 - nodeFeatures2;
-			VectorXd negdiffabs2 = -diff.cwiseAbs2();
-			VectorXd expnegdiffabs2 = 1 - negdiffabs2.array().exp();
+			VectorXd expnegdiffabs2 = 1 - X.getEdgeContrast(node1, node2).array();
 
 			// assignment
 			return expnegdiffabs2;
@@ -735,7 +1169,24 @@ namespace HCSearch
 		int pairwiseFeatDim = featureDim;
 		int numClasses = Global::settings->CLASSES.numClasses();
 
-		return numClasses*unaryFeatDim;
+		return numClasses*unaryFeatDim;
+	}
+
+	bool UnaryFeatures::computeAccumulators(ImgFeatures& X, ImgLabeling& Y, FeatureAccumulators& acc)
+	{
+		const int featureDim = X.getFeatureDim();
+		const int numClasses = Global::settings->CLASSES.numClasses();
+		const int unaryFeatDim = 1+featureDim;
+
+		acc.unarySums = VectorXd::Zero(numClasses*unaryFeatDim);
+		acc.pairwiseSums = VectorXd();
+
+		return accumulateFeatures(X, Y, acc);
+	}
+
+	RankFeatures UnaryFeatures::computeFeatures(ImgFeatures& /*X*/, const FeatureAccumulators& acc)
+	{
+		return assembleFeatures(acc, 1, 0);
 	}
 
 	/**************** Unary Only Confidences Features ****************/
@@ -779,6 +1230,28 @@ namespace HCSearch
 		return numClasses*unaryFeatDim;
 	}
 
+	bool UnaryConfFeatures::computeAccumulators(ImgFeatures& X, ImgLabeling& Y, FeatureAccumulators& acc)
+	{
+		if (!Y.confidencesAvailable)
+		{
+			LOG(ERROR) << "confidences not available for unary potential.";
+			abort();
+		}
+
+		const int numClasses = Global::settings->CLASSES.numClasses();
+		const int unaryFeatDim = 1;
+
+		acc.unarySums = VectorXd::Zero(numClasses*unaryFeatDim);
+		acc.pairwiseSums = VectorXd();
+
+		return accumulateFeatures(X, Y, acc);
+	}
+
+	RankFeatures UnaryConfFeatures::computeFeatures(ImgFeatures& /*X*/, const FeatureAccumulators& acc)
+	{
+		return assembleFeatures(acc, 1, 0);
+	}
+
 	/**************** Standard Raw Unary and Co-occurence Counts Pairwise Features ****************/
 
 	StandardPairwiseCountsFeatures::StandardPairwiseCountsFeatures()
@@ -807,7 +1280,9 @@ namespace HCSearch
 		phi.segment(0, numClasses*unaryFeatDim) = unaryTerm;
 		phi.segment(numClasses*unaryFeatDim, numPairs*pairwiseFeatDim) = pairwiseTerm;
 
-		return RankFeatures(phi);
+		// label pair counts of absent classes are zero
+		SparseVector<double> sparsePhi = phi.sparseView();
+		return RankFeatures(sparsePhi);
 	}
 
 	int StandardPairwiseCountsFeatures::featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action)
@@ -821,6 +1296,35 @@ namespace HCSearch
 
 		return numClasses*unaryFeatDim + numPairs*pairwiseFeatDim;
 	}
+
+	bool StandardPairwiseCountsFeatures::computeAccumulators(ImgFeatures& X, ImgLabeling& Y, FeatureAccumulators& acc)
+	{
+		const int featureDim = X.getFeatureDim();
+		const int numClasses = Global::settings->CLASSES.numClasses();
+		const int unaryFeatDim = 1+featureDim;
+		const int pairwiseFeatDim = 1;
+		const int numPairs = (numClasses*(numClasses+1))/2;
+
+		acc.unarySums = VectorXd::Zero(numClasses*unaryFeatDim);
+		acc.pairwiseSums = VectorXd::Zero(numPairs*pairwiseFeatDim);
+
+		return accumulateFeatures(X, Y, acc);
+	}
+
+	RankFeatures StandardPairwiseCountsFeatures::computeFeatures(ImgFeatures& /*X*/, const FeatureAccumulators& acc)
+	{
+		SparseVector<double> sparsePhi = assembleFeatures(acc, 1, 1).data.sparseView();
+		return RankFeatures(sparsePhi);
+	}
+
+	void StandardPairwiseCountsFeatures::addPairwiseContribution(ImgFeatures& X, int node1, int nodeLabel1, int node2, int nodeLabel2, 
+		double weight, VectorXd& pairwiseSums)
+	{
+		int classIndex = -1;
+		VectorXd edgeFeatureVector = computePairwiseFeatures(X, node1, node2, nodeLabel1, nodeLabel2, classIndex);
+		const int pairwiseFeatDim = edgeFeatureVector.size();
+		pairwiseSums.segment(classIndex*pairwiseFeatDim, pairwiseFeatDim) += weight * edgeFeatureVector;
+	}
 	
 	VectorXd StandardPairwiseCountsFeatures::computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y)
 	{
@@ -835,26 +1339,23 @@ namespace HCSearch
 		int numEdges = 0;
 		for (int node1 = 0; node1 < numNodes; node1++)
 		{
-			if (X.graph.adjList.count(node1) == 0)
+			// get neighbors (ending nodes) of starting node
+			NeighborRange neighbors = X.graph.adjList.neighbors(node1);
+			if (neighbors.empty())
 				continue;
 
-			// get neighbors (ending nodes) of starting node
-			NeighborSet_t neighbors = X.graph.adjList[node1];
 			const int numNeighbors = neighbors.size();
-			for (NeighborSet_t::iterator it = neighbors.begin(); it != neighbors.end(); ++it)
+			for (NeighborRange::const_iterator it = neighbors.begin(); it != neighbors.end(); ++it)
 			{
 				int node2 = *it;
 				numEdges++;
 
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
+				// get node labels
 				int nodeLabel1 = Y.getLabel(node1);
-
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
 				int nodeLabel2 = Y.getLabel(node2);
 
 				int classIndex = -1;
-				VectorXd edgeFeatureVector = computePairwiseFeatures(nodeFeatures1, nodeFeatures2, nodeLabel1, nodeLabel2, classIndex);
+				VectorXd edgeFeatureVector = computePairwiseFeatures(X, node1, node2, nodeLabel1, nodeLabel2, classIndex);
 				phi.segment(classIndex*pairwiseFeatDim, pairwiseFeatDim) += edgeFeatureVector; // contrast sensitive pairwise potential
 			}
 		}
@@ -864,7 +1365,7 @@ namespace HCSearch
 		return phi;
 	}
 
-	VectorXd StandardPairwiseCountsFeatures::computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
+	VectorXd StandardPairwiseCountsFeatures::computePairwiseFeatures(ImgFeatures& X, int node1, int node2, 
 		int nodeLabel1, int nodeLabel2, int& classIndex)
 	{
 		int node1ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel1);
@@ -922,6 +1423,25 @@ namespace HCSearch
 
 		return numClasses*unaryFeatDim + numPairs*pairwiseFeatDim;
 	}
+
+	bool StandardConfPairwiseCountsFeatures::computeAccumulators(ImgFeatures& X, ImgLabeling& Y, FeatureAccumulators& acc)
+	{
+		if (!Y.confidencesAvailable)
+		{
+			LOG(ERROR) << "confidences not available for unary potential.";
+			abort();
+		}
+
+		const int numClasses = Global::settings->CLASSES.numClasses();
+		const int unaryFeatDim = 1;
+		const int pairwiseFeatDim = 1;
+		const int numPairs = (numClasses*(numClasses+1))/2;
+
+		acc.unarySums = VectorXd::Zero(numClasses*unaryFeatDim);
+		acc.pairwiseSums = VectorXd::Zero(numPairs*pairwiseFeatDim);
+
+		return accumulateFeatures(X, Y, acc);
+	}
 	
 	VectorXd StandardConfPairwiseCountsFeatures::computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y)
 	{
@@ -936,26 +1456,23 @@ namespace HCSearch
 		int numEdges = 0;
 		for (int node1 = 0; node1 < numNodes; node1++)
 		{
-			if (X.graph.adjList.count(node1) == 0)
+			// get neighbors (ending nodes) of starting node
+			NeighborRange neighbors = X.graph.adjList.neighbors(node1);
+			if (neighbors.empty())
 				continue;
 
-			// get neighbors (ending nodes) of starting node
-			NeighborSet_t neighbors = X.graph.adjList[node1];
 			const int numNeighbors = neighbors.size();
-			for (NeighborSet_t::iterator it = neighbors.begin(); it != neighbors.end(); ++it)
+			for (NeighborRange::const_iterator it = neighbors.begin(); it != neighbors.end(); ++it)
 			{
 				int node2 = *it;
 				numEdges++;
 
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
+				// get node labels
 				int nodeLabel1 = Y.getLabel(node1);
-
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
 				int nodeLabel2 = Y.getLabel(node2);
 
 				int classIndex = -1;
-				VectorXd edgeFeatureVector = computePairwiseFeatures(nodeFeatures1, nodeFeatures2, nodeLabel1, nodeLabel2, classIndex);
+				VectorXd edgeFeatureVector = computePairwiseFeatures(X, node1, node2, nodeLabel1, nodeLabel2, classIndex);
 				phi.segment(classIndex*pairwiseFeatDim, pairwiseFeatDim) += edgeFeatureVector; // contrast sensitive pairwise potential
 			}
 		}
@@ -965,7 +1482,7 @@ namespace HCSearch
 		return phi;
 	}
 
-	VectorXd StandardConfPairwiseCountsFeatures::computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
+	VectorXd StandardConfPairwiseCountsFeatures::computePairwiseFeatures(ImgFeatures& X, int node1, int node2, 
 		int nodeLabel1, int nodeLabel2, int& classIndex)
 	{
 		int node1ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel1);
@@ -981,10 +1498,269 @@ namespace HCSearch
 		return one;
 	}
 
+	/**************** Global Features ****************/
+
+	bool IGlobalFeatures::computeAccumulators(ImgFeatures& /*X*/, ImgLabeling& /*Y*/, FeatureAccumulators& acc)
+	{
+		acc.available = false;
+		return false;
+	}
+
+	/**************** Permutohedral Lattice ****************/
+
+	namespace
+	{
+		struct LatticeKeyHash
+		{
+			size_t operator()(const vector<int>& key) const
+			{
+				size_t h = 0;
+				for (vector<int>::const_iterator it = key.begin(); it != key.end(); ++it)
+					h = (h + *it) * 2531011;
+				return h;
+			}
+		};
+	}
+
+	PermutohedralLattice::PermutohedralLattice(const MatrixXd& positions)
+	{
+		this->numPoints = positions.rows();
+		this->dim = positions.cols();
+		const int d = this->dim;
+
+		this->offsets.resize(this->numPoints*(d+1));
+		this->barycentrics.resize(this->numPoints*(d+1));
+
+		// scale so that the blur matches a Gaussian with unit standard deviation
+		const double invStdDev = sqrt(2.0/3.0)*(d+1);
+		vector<double> scaleFactor(d);
+		for (int i = 0; i < d; i++)
+			scaleFactor[i] = invStdDev/sqrt((i+1.0)*(i+2.0));
+
+		// canonical simplex
+		vector<int> canonical((d+1)*(d+1));
+		for (int i = 0; i <= d; i++)
+			for (int j = 0; j <= d; j++)
+				canonical[i*(d+1)+j] = (j <= d-i) ? i : i-(d+1);
+
+		unordered_map<vector<int>, int, LatticeKeyHash> vertexIndex;
+		vector< vector<int> > vertexKeys;
+
+		vector<double> elevated(d+1);
+		vector<int> rem0(d+1);
+		vector<int> rank(d+1);
+		vector<double> barycentric(d+2);
+		vector<int> key(d);
+
+		for (int k = 0; k < this->numPoints; k++)
+		{
+			// elevate onto the hyperplane H_d
+			double sm = 0;
+			for (int j = d; j > 0; j--)
+			{
+				double cf = positions(k, j-1)*scaleFactor[j-1];
+				elevated[j] = sm - j*cf;
+				sm += cf;
+			}
+			elevated[0] = sm;
+
+			// closest remainder-0 lattice point
+			int sum = 0;
+			for (int i = 0; i <= d; i++)
+			{
+				double v = elevated[i]/(d+1);
+				int up = static_cast<int>(ceil(v))*(d+1);
+				int down = static_cast<int>(floor(v))*(d+1);
+				rem0[i] = (up - elevated[i] < elevated[i] - down) ? up : down;
+				sum += rem0[i];
+			}
+			sum /= d+1;
+
+			// rank differential to find the permutation
+			fill(rank.begin(), rank.end(), 0);
+			for (int i = 0; i < d; i++)
+			{
+				double di = elevated[i] - rem0[i];
+				for (int j = i+1; j <= d; j++)
+				{
+					if (di < elevated[j] - rem0[j])
+						rank[i]++;
+					else
+						rank[j]++;
+				}
+			}
+
+			// wrap around if the remainder-0 point is off the plane
+			for (int i = 0; i <= d; i++)
+			{
+				rank[i] += sum;
+				if (rank[i] < 0)
+				{
+					rank[i] += d+1;
+					rem0[i] += d+1;
+				}
+				else if (rank[i] > d)
+				{
+					rank[i] -= d+1;
+					rem0[i] -= d+1;
+				}
+			}
+
+			// barycentric coordinates
+			fill(barycentric.begin(), barycentric.end(), 0.0);
+			for (int i = 0; i <= d; i++)
+			{
+				double v = (elevated[i] - rem0[i])/(d+1);
+				barycentric[d-rank[i]] += v;
+				barycentric[d+1-rank[i]] -= v;
+			}
+			barycentric[0] += 1.0 + barycentric[d+1];
+
+			// enclosing simplex vertices
+			for (int remainder = 0; remainder <= d; remainder++)
+			{
+				for (int i = 0; i < d; i++)
+					key[i] = rem0[i] + canonical[remainder*(d+1)+rank[i]];
+
+				unordered_map<vector<int>, int, LatticeKeyHash>::iterator it = vertexIndex.find(key);
+				int index;
+				if (it == vertexIndex.end())
+				{
+					index = vertexKeys.size();
+					vertexIndex[key] = index;
+					vertexKeys.push_back(key);
+				}
+				else
+				{
+					index = it->second;
+				}
+
+				this->offsets[k*(d+1)+remainder] = index;
+				this->barycentrics[k*(d+1)+remainder] = barycentric[remainder];
+			}
+		}
+
+		this->numVertices = vertexKeys.size();
+
+		// neighbors along each axis for the blur
+		this->blurNeighbors.assign(this->numVertices*(d+1)*2, -1);
+		vector<int> neighbor1(d);
+		vector<int> neighbor2(d);
+		for (int j = 0; j <= d; j++)
+		{
+			for (int i = 0; i < this->numVertices; i++)
+			{
+				const vector<int>& vertexKey = vertexKeys[i];
+				for (int k = 0; k < d; k++)
+				{
+					neighbor1[k] = vertexKey[k] - 1;
+					neighbor2[k] = vertexKey[k] + 1;
+				}
+				if (j < d)
+				{
+					neighbor1[j] = vertexKey[j] + d;
+					neighbor2[j] = vertexKey[j] - d;
+				}
+
+				unordered_map<vector<int>, int, LatticeKeyHash>::iterator it1 = vertexIndex.find(neighbor1);
+				unordered_map<vector<int>, int, LatticeKeyHash>::iterator it2 = vertexIndex.find(neighbor2);
+				if (it1 != vertexIndex.end())
+					this->blurNeighbors[(j*this->numVertices+i)*2] = it1->second;
+				if (it2 != vertexIndex.end())
+					this->blurNeighbors[(j*this->numVertices+i)*2+1] = it2->second;
+			}
+		}
+	}
+
+	MatrixXd PermutohedralLattice::filter(const MatrixXd& values) const
+	{
+		const int d = this->dim;
+		const int valueDim = values.cols();
+
+		// splat
+		MatrixXd vertexValues = MatrixXd::Zero(this->numVertices, valueDim);
+		for (int k = 0; k < this->numPoints; k++)
+			for (int remainder = 0; remainder <= d; remainder++)
+				vertexValues.row(this->offsets[k*(d+1)+remainder]) += this->barycentrics[k*(d+1)+remainder]*values.row(k);
+
+		// blur along each axis
+		MatrixXd blurred(this->numVertices, valueDim);
+		for (int j = 0; j <= d; j++)
+		{
+			for (int i = 0; i < this->numVertices; i++)
+			{
+				blurred.row(i) = vertexValues.row(i);
+				int n1 = this->blurNeighbors[(j*this->numVertices+i)*2];
+				int n2 = this->blurNeighbors[(j*this->numVertices+i)*2+1];
+				if (n1 >= 0)
+					blurred.row(i) += 0.5*vertexValues.row(n1);
+				if (n2 >= 0)
+					blurred.row(i) += 0.5*vertexValues.row(n2);
+			}
+			vertexValues.swap(blurred);
+		}
+
+		// slice
+		const double alpha = 1.0/(1.0+pow(2.0, -d));
+		MatrixXd out = MatrixXd::Zero(this->numPoints, valueDim);
+		for (int k = 0; k < this->numPoints; k++)
+			for (int remainder = 0; remainder <= d; remainder++)
+				out.row(k) += this->barycentrics[k*(d+1)+remainder]*vertexValues.row(this->offsets[k*(d+1)+remainder]);
+
+		return alpha*out;
+	}
+
+	int PermutohedralLattice::getNumVertices() const
+	{
+		return this->numVertices;
+	}
+
+	namespace
+	{
+		/*!
+		 * @brief Average response of sample nodes to a unit impulse at themselves.
+		 * 
+		 * The lattice is unnormalized, so filtered sums are divided by this gain.
+		 */
+		double measureLatticeGain(const PermutohedralLattice& lattice, int numPoints, int numSamples)
+		{
+			MatrixXd impulses = MatrixXd::Zero(numPoints, numSamples);
+			for (int sample = 0; sample < numSamples; sample++)
+				impulses(sample*numPoints/numSamples, sample) = 1;
+
+			MatrixXd filtered = lattice.filter(impulses);
+
+			double gain = 0;
+			for (int sample = 0; sample < numSamples; sample++)
+				gain += filtered(sample*numPoints/numSamples, sample);
+
+			return gain/numSamples;
+		}
+	}
+
+	DenseCRFLattices::DenseCRFLattices(const MatrixXd& appearancePositions, const MatrixXd& smoothnessPositions, int numGainSamples)
+		: appearance(appearancePositions), smoothness(smoothnessPositions)
+	{
+		this->appearanceGain = measureLatticeGain(this->appearance, appearancePositions.rows(), numGainSamples);
+		this->smoothnessGain = measureLatticeGain(this->smoothness, smoothnessPositions.rows(), numGainSamples);
+	}
+
 	/**************** Dense CRF Features ****************/
 
+	const double DenseCRFFeatures::THETA_ALPHA = 0.025;
+	const double DenseCRFFeatures::THETA_BETA = 0.025;
+	const double DenseCRFFeatures::THETA_GAMMA = 0.025;
+	const int DenseCRFFeatures::MAX_GAIN_SAMPLES = 32;
+	const int DenseCRFFeatures::MAX_APPEARANCE_DIM = 4;
+
 	DenseCRFFeatures::DenseCRFFeatures()
 	{
+		this->pairwiseMode = EXACT;
+	}
+
+	DenseCRFFeatures::DenseCRFFeatures(PairwiseMode pairwiseMode)
+	{
+		this->pairwiseMode = pairwiseMode;
 	}
 
 	DenseCRFFeatures::~DenseCRFFeatures()
@@ -1042,8 +1818,7 @@ namespace HCSearch
 		// unary potential
 		for (int node = 0; node < numNodes; node++)
 		{
-			// get node features and label
-			VectorXd nodeFeatures = X.graph.nodesData.row(node);
+			// get node label
 			int nodeLabel = Y.getLabel(node);
 
 			// map node label to indexing value in phi vector
@@ -1059,6 +1834,14 @@ namespace HCSearch
 	}
 
 	VectorXd DenseCRFFeatures::computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y)
+	{
+		if (this->pairwiseMode == EXACT)
+			return computePairwiseTermExact(X, Y);
+		else
+			return computePairwiseTermFiltered(X, Y);
+	}
+
+	VectorXd DenseCRFFeatures::computePairwiseTermExact(ImgFeatures& X, ImgLabeling& Y)
 	{
 		const int numNodes = X.getNumNodes();
 		const int numClasses = Global::settings->CLASSES.numClasses();
@@ -1099,14 +1882,125 @@ namespace HCSearch
 		return phi;
 	}
 
+	VectorXd DenseCRFFeatures::computePairwiseTermFiltered(ImgFeatures& X, ImgLabeling& Y)
+	{
+		const int numNodes = X.getNumNodes();
+		const int numClasses = Global::settings->CLASSES.numClasses();
+		const int pairwiseFeatDim = 2;
+		const int numPairs = (numClasses*(numClasses+1))/2;
+
+		VectorXd phi = VectorXd::Zero(numPairs*pairwiseFeatDim);
+		if (numNodes < 2)
+			return phi;
+
+		shared_ptr< const DenseCRFLattices > lattices = getLattices(X);
+
+		// class indicators
+		vector<int> classIndices(numNodes);
+		VectorXd classCounts = VectorXd::Zero(numClasses);
+		MatrixXd values = MatrixXd::Zero(numNodes, numClasses);
+		for (int node = 0; node < numNodes; node++)
+		{
+			classIndices[node] = Global::settings->CLASSES.getClassIndex(Y.getLabel(node));
+			classCounts(classIndices[node]) += 1;
+			values(node, classIndices[node]) = 1;
+		}
+
+		for (int kernel = 0; kernel < pairwiseFeatDim; kernel++)
+		{
+			const PermutohedralLattice& lattice = (kernel == 0) ? lattices->appearance : lattices->smoothness;
+			const double gain = (kernel == 0) ? lattices->appearanceGain : lattices->smoothnessGain;
+			MatrixXd filtered = lattice.filter(values);
+
+			// kernelSums(a, b) = sum of k(i, j) over nodes i of class b and nodes j of class a
+			MatrixXd kernelSums = MatrixXd::Zero(numClasses, numClasses);
+			for (int node = 0; node < numNodes; node++)
+				kernelSums.row(classIndices[node]) += filtered.row(node)/gain;
+
+			for (int i = 0; i < numClasses; i++)
+			{
+				for (int j = i; j < numClasses; j++)
+				{
+					int classIndex = (numClasses*(numClasses+1)-(numClasses-i)*(numClasses-i+1))/2+(numClasses-1-j);
+
+					if (i != j)
+					{
+						// different labels: sum of k over pairs
+						phi(classIndex*pairwiseFeatDim+kernel) = 0.5*(kernelSums(i, j) + kernelSums(j, i));
+					}
+					else
+					{
+						// same labels: sum of 1-k over pairs, excluding each node with itself
+						double count = classCounts(i);
+						phi(classIndex*pairwiseFeatDim+kernel) = count*(count-1)/2 - (kernelSums(i, i) - count)/2;
+					}
+				}
+			}
+		}
+
+		const double numEdges = numNodes*(numNodes-1.0)/2;
+		phi = 1.0/numEdges * phi;
+
+		return phi;
+	}
+
+	shared_ptr< const DenseCRFLattices > DenseCRFFeatures::getLattices(ImgFeatures& X)
+	{
+		shared_ptr< const DenseCRFLattices > lattices;
+
+		// candidates of the same image are scored in parallel
+#ifdef _OPENMP
+		#pragma omp critical(DenseCRFLattices)
+#endif
+		{
+			if (!X.denseCRFLattices)
+			{
+				const int numNodes = X.getNumNodes();
+				const int featureDim = X.getFeatureDim();
+
+				// project the features onto their top principal components
+				MatrixXd appearanceFeatures;
+				if (featureDim <= MAX_APPEARANCE_DIM)
+				{
+					appearanceFeatures = X.graph.nodesData;
+				}
+				else
+				{
+					MatrixXd centered = X.graph.nodesData.rowwise() - X.graph.nodesData.colwise().mean();
+					SelfAdjointEigenSolver<MatrixXd> eigenSolver(centered.transpose()*centered);
+					appearanceFeatures = centered*eigenSolver.eigenvectors().rightCols(MAX_APPEARANCE_DIM);
+				}
+				const int appearanceDim = appearanceFeatures.cols();
+
+				// positions scaled by the kernel bandwidths
+				MatrixXd appearancePositions = MatrixXd(numNodes, 2+appearanceDim);
+				MatrixXd smoothnessPositions = MatrixXd(numNodes, 2);
+				for (int node = 0; node < numNodes; node++)
+				{
+					double nodeLocationX = X.getNodeLocationX(node);
+					double nodeLocationY = X.getNodeLocationY(node);
+
+					appearancePositions(node, 0) = nodeLocationX/THETA_ALPHA;
+					appearancePositions(node, 1) = nodeLocationY/THETA_ALPHA;
+					appearancePositions.block(node, 2, 1, appearanceDim) = appearanceFeatures.row(node)/THETA_BETA;
+
+					smoothnessPositions(node, 0) = nodeLocationX/THETA_GAMMA;
+					smoothnessPositions(node, 1) = nodeLocationY/THETA_GAMMA;
+				}
+
+				X.denseCRFLattices = shared_ptr< const DenseCRFLattices >(
+					new DenseCRFLattices(appearancePositions, smoothnessPositions, min(numNodes, MAX_GAIN_SAMPLES)));
+			}
+			lattices = X.denseCRFLattices;
+		}
+
+		return lattices;
+	}
+
 	VectorXd DenseCRFFeatures::computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
 		double nodeLocationX1, double nodeLocationY1, double nodeLocationX2, double nodeLocationY2, 
 		int nodeLabel1, int nodeLabel2, int& classIndex)
 	{
-		const double THETA_ALPHA = 0.025;
-		const double THETA_BETA = 0.025;
-		const double THETA_GAMMA = 0.025;
-
 		int node1ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel1);
 		int node2ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel2);
 		int numClasses = Global::settings->CLASSES.numClasses();
@@ -1181,304 +2075,266 @@ namespace HCSearch
 		//VectorXd mutexTerm = computeMutexTerm(X, Y, action);
 		//phi.segment(0, numMutexPairs*mutexFeatDim) = mutexTerm;
 
-		int numClasses = Global::settings->CLASSES.numClasses();
-
-		VectorXd phi = VectorXd::Zero(featureSize(X, Y, action));
 		VectorXd holeTerm = computeHoleTerm(X, Y, action);
 		VectorXd mutexTerm = computeMutexTermManually(X, Y, action);
 		VectorXd spatialEntropyTerm = computeSpatialEntropyTerm(X, Y, action);
-		phi.segment(0, 1) = holeTerm;
-		phi.segment(1, 8) = mutexTerm;
-		phi.segment(9, numClasses*2) = spatialEntropyTerm;
 
-		return RankFeatures(phi);
+		return assemblePruneFeatures(holeTerm, mutexTerm, spatialEntropyTerm);
 	}
 
-	int StandardPruneFeatures::featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action)
+	RankFeatures StandardPruneFeatures::assemblePruneFeatures(const VectorXd& holeTerm, const VectorXd& mutexTerm, 
+		const VectorXd& spatialEntropyTerm)
 	{
 		int numClasses = Global::settings->CLASSES.numClasses();
-		//int numMutexPairs = (numClasses*(numClasses+1))/2;
-		//int mutexFeatDim = 4;
-
-		//return numMutexPairs*mutexFeatDim;
-		return 1 + 8 + 2*numClasses;
-	}
-
-	VectorXd StandardPruneFeatures::computeHoleTerm(ImgFeatures& X, ImgLabeling& Y, set<int> action)
-	{
-		if (action.empty())
-			return VectorXd::Zero(1);
-
-		set<int> neighborLabels;
-		int actionLabel;
-		for (set<int>::iterator it = action.begin(); it != action.end(); ++it)
-		{
-			int node = *it;
-			set<int> nodeNeighborLabels = Y.getNeighborLabels(node);
-			neighborLabels.insert(nodeNeighborLabels.begin(), nodeNeighborLabels.end());
-			actionLabel = Y.getLabel(node);
-		}
 
-		int holeFound = 0;
-		if (neighborLabels.size() == 1)
-		{
-			for (set<int>::iterator it = neighborLabels.begin(); it != neighborLabels.end(); ++it)
-			{
-				int label = *it;
-				if (label != actionLabel)
-					holeFound = 1;
-			}
-		}
+		VectorXd phi = VectorXd::Zero(1 + 8 + 2*numClasses);
+		phi.segment(0, 1) = holeTerm;
+		phi.segment(1, 8) = mutexTerm;
+		phi.segment(9, numClasses*2) = spatialEntropyTerm;
 
-		return holeFound * VectorXd::Ones(1);
+		// mutex and spatial entropy terms of absent classes are zero
+		SparseVector<double> sparsePhi = phi.sparseView();
+		return RankFeatures(sparsePhi);
 	}
 
-	VectorXd StandardPruneFeatures::computeSpatialEntropyTerm(ImgFeatures& X, ImgLabeling& Y, set<int> action)
-	{
-		int numClasses = Global::settings->CLASSES.numClasses();
-		
-		// helper to keep track of unusable classes (N <= 1)
-		VectorXi unusable = VectorXi::Zero(numClasses);
-		
-		// first pass: compute mean and totals
-		VectorXd meanX = VectorXd::Zero(numClasses);
-		VectorXd meanY = VectorXd::Zero(numClasses);
-		VectorXd numSum = VectorXd::Zero(numClasses);
-
-		for (int node = 0; node < Y.getNumNodes(); node++)
-		{
-			int classIndex = Global::settings->CLASSES.getClassIndex(Y.getLabel(node));
-			double xPos = X.getNodeLocationX(node);
-			double yPos = X.getNodeLocationY(node);
+	bool StandardPruneFeatures::computeAccumulators(ImgFeatures& X, ImgLabeling& Y, FeatureAccumulators& acc)
+	{
+		const int numNodes = X.getNumNodes();
+		const int numClasses = Global::settings->CLASSES.numClasses();
 
-			meanX(classIndex) += xPos;
-			meanY(classIndex) += yPos;
-			numSum(classIndex) += 1;
-		}
+		acc.unarySums = VectorXd::Zero(numClasses*LOCATION_SUMS_DIM);
+		acc.pairwiseSums = VectorXd();
+		acc.locationExtents = VectorXd(numClasses*LOCATION_EXTENTS_DIM);
+		acc.numNodes = numNodes;
+		acc.numEdges = 0;
 
+		for (int node = 0; node < numNodes; node++)
+			addLocation(X, node, Global::settings->CLASSES.getClassIndex(Y.getLabel(node)), 1, acc.unarySums);
+
+		LabelExtents_t extents = computeLabelExtents(X, Y);
 		for (int c = 0; c < numClasses; c++)
+			setExtents(c, extents[Global::settings->CLASSES.getClassLabel(c)], acc.locationExtents);
+
+		acc.available = true;
+		return true;
+	}
+
+	bool StandardPruneFeatures::updateAccumulators(ImgFeatures& X, ImgCandidate& YCandidate, 
+		const FeatureAccumulators& parentAcc, FeatureAccumulators& acc)
+	{
+		if (!parentAcc.available || !YCandidate.isDelta())
 		{
-			if (numSum(c) <= 1)
-				unusable(c) = 1;
-			else
-			{
-				meanX(c) /= numSum(c);
-				meanY(c) /= numSum(c);
-			}
+			acc.available = false;
+			return false;
 		}
 
-		// second pass: compute standard deviation
-		VectorXd stdX = VectorXd::Zero(numClasses);
-		VectorXd stdY = VectorXd::Zero(numClasses);
+		const int numClasses = Global::settings->CLASSES.numClasses();
+		ImgLabeling& YParent = *YCandidate.parent;
 
-		for (int node = 0; node < Y.getNumNodes(); node++)
+		acc = parentAcc;
+		vector<bool> dirtyExtents(numClasses, false);
+		bool anyDirtyExtents = false;
+		for (map<int, int>::iterator it = YCandidate.newLabels.begin(); it != YCandidate.newLabels.end(); ++it)
 		{
-			int classIndex = Global::settings->CLASSES.getClassIndex(Y.getLabel(node));
-			if (unusable(classIndex) == 1)
+			int node = it->first;
+			int oldClassIndex = Global::settings->CLASSES.getClassIndex(YParent.getLabel(node));
+			int newClassIndex = Global::settings->CLASSES.getClassIndex(it->second);
+			if (oldClassIndex == newClassIndex)
 				continue;
 
+			addLocation(X, node, oldClassIndex, -1, acc.unarySums);
+			addLocation(X, node, newClassIndex, 1, acc.unarySums);
+
 			double xPos = X.getNodeLocationX(node);
 			double yPos = X.getNodeLocationY(node);
 
-			stdX(classIndex) += pow((xPos - meanX(classIndex)), 2);
-			stdY(classIndex) += pow((yPos - meanY(classIndex)), 2);
+			// extents only grow by adding a node, but shrink when the last node on a boundary is removed
+			LocationExtents newExtents = getExtents(newClassIndex, acc.locationExtents);
+			newExtents.add(xPos, yPos);
+			setExtents(newClassIndex, newExtents, acc.locationExtents);
+
+			LocationExtents oldExtents = getExtents(oldClassIndex, acc.locationExtents);
+			if (oldExtents.remove(xPos, yPos))
+			{
+				dirtyExtents[oldClassIndex] = true;
+				anyDirtyExtents = true;
+			}
+			setExtents(oldClassIndex, oldExtents, acc.locationExtents);
 		}
 
-		for (int c = 0; c < numClasses; c++)
+		// recompute extents of classes that shrunk in one pass over the labeling 
+		// (worst case O(number of nodes), but only when a boundary row or column empties)
+		if (anyDirtyExtents)
 		{
-			if (unusable(c) == 1)
+			vector<LocationExtents> extents(numClasses);
+			for (int node = 0; node < X.getNumNodes(); node++)
 			{
-				stdX(c) = 0;
-				stdY(c) = 0;
+				int classIndex = Global::settings->CLASSES.getClassIndex(YCandidate.getLabel(node));
+				if (dirtyExtents[classIndex])
+					extents[classIndex].add(X.getNodeLocationX(node), X.getNodeLocationY(node));
 			}
-			else
+
+			for (int c = 0; c < numClasses; c++)
 			{
-				stdX(c) = sqrt(stdX(c)/(numSum(c)-1));
-				stdY(c) = sqrt(stdY(c)/(numSum(c)-1));
+				if (dirtyExtents[c])
+					setExtents(c, extents[c], acc.locationExtents);
 			}
 		}
 
-		// finish up
-		VectorXd phi = VectorXd::Zero(2*numClasses);
-		phi.segment(0, numClasses) = stdX;
-		phi.segment(numClasses, numClasses) = stdY;
+		acc.available = true;
+		return true;
+	}
 
-		return phi;
+	RankFeatures StandardPruneFeatures::computeFeatures(ImgFeatures& /*X*/, const FeatureAccumulators& acc)
+	{
+		const int numClasses = Global::settings->CLASSES.numClasses();
+
+		LabelExtents_t actionExtents;
+		LabelExtents_t extents;
+		for (int c = 0; c < numClasses; c++)
+			extents[Global::settings->CLASSES.getClassLabel(c)] = getExtents(c, acc.locationExtents);
+
+		return assemblePruneFeatures(VectorXd::Zero(1), computeManualMutexTerm(actionExtents, extents), 
+			computeSpatialEntropyTerm(acc.unarySums));
 	}
 
-	VectorXd StandardPruneFeatures::computeMutexTermManually(ImgFeatures& X, ImgLabeling& Y, set<int> action)
+	RankFeatures StandardPruneFeatures::computeFeatures(ImgFeatures& X, ImgCandidate& YCandidate, const FeatureAccumulators& parentAcc)
 	{
-		const int numNodes = X.getNumNodes();
+		FeatureAccumulators acc;
+		if (!updateAccumulators(X, YCandidate, parentAcc, acc))
+			return computeFeatures(X, YCandidate);
+
 		const int numClasses = Global::settings->CLASSES.numClasses();
-		const int numMutexConstraints = 8;
-		
-		VectorXd phi = VectorXd::Zero(numMutexConstraints);
 
-		int numEdges = 0;
-		//for (int node1 = 0; node1 < numNodes; node1++)
-		for (set<int>::iterator it = action.begin(); it != action.end(); ++it)
-		{
-			int node1 = *it;
+		LabelExtents_t actionExtents = computeLabelExtents(X, YCandidate, YCandidate.action);
+		LabelExtents_t extents;
+		for (int c = 0; c < numClasses; c++)
+			extents[Global::settings->CLASSES.getClassLabel(c)] = getExtents(c, acc.locationExtents);
 
-			for (int node2 = 0; node2 < numNodes; node2++)
-			{
-				if (node1 == node2)
-					continue;
+		VectorXd holeTerm = HCSearch::computeHoleTerm(YCandidate, YCandidate.parent->graph.adjList, YCandidate.action);
+		VectorXd mutexTerm = computeManualMutexTerm(actionExtents, extents);
+		VectorXd spatialEntropyTerm = computeSpatialEntropyTerm(acc.unarySums);
 
-				numEdges++;
+		return assemblePruneFeatures(holeTerm, mutexTerm, spatialEntropyTerm);
+	}
 
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-				double nodeLocationX1 = X.getNodeLocationX(node1);
-				double nodeLocationY1 = X.getNodeLocationY(node1);
-				int nodeLabel1 = Y.getLabel(node1);
+	int StandardPruneFeatures::featureSize(ImgFeatures& /*X*/, ImgLabeling& /*Y*/, set<int> /*action*/)
+	{
+		int numClasses = Global::settings->CLASSES.numClasses();
+		//int numMutexPairs = (numClasses*(numClasses+1))/2;
+		//int mutexFeatDim = 4;
 
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
-				double nodeLocationX2 = X.getNodeLocationX(node2);
-				double nodeLocationY2 = X.getNodeLocationY(node2);
-				int nodeLabel2 = Y.getLabel(node2);
+		//return numMutexPairs*mutexFeatDim;
+		return 1 + 8 + 2*numClasses;
+	}
 
-				// MANUALLY DEFINED FOR STANFORD DATASET
-				if (nodeLabel1 == 1 && nodeLabel2 == 3 && nodeLocationY1 > nodeLocationY2)
-					phi(0) = 1;
-				if (nodeLabel1 == 3 && nodeLabel2 == 1 && nodeLocationY1 < nodeLocationY2)
-					phi(1) = 1;
-				if (nodeLabel1 == 1 && nodeLabel2 == 4 && nodeLocationY1 > nodeLocationY2)
-					phi(2) = 1;
-				if (nodeLabel1 == 4 && nodeLabel2 == 1 && nodeLocationY1 < nodeLocationY2)
-					phi(3) = 1;
-				if (nodeLabel1 == 1 && nodeLabel2 == 5 && nodeLocationY1 > nodeLocationY2)
-					phi(4) = 1;
-				if (nodeLabel1 == 5 && nodeLabel2 == 1 && nodeLocationY1 < nodeLocationY2)
-					phi(5) = 1;
-				if (nodeLabel1 == 1 && nodeLabel2 == 7 && nodeLocationY1 > nodeLocationY2)
-					phi(6) = 1;
-				if (nodeLabel1 == 7 && nodeLabel2 == 1 && nodeLocationY1 < nodeLocationY2)
-					phi(7) = 1;
-			}
+	VectorXd StandardPruneFeatures::computeHoleTerm(ImgFeatures& /*X*/, ImgLabeling& Y, set<int> action)
+	{
+		return HCSearch::computeHoleTerm(Y, Y.graph.adjList, action);
+	}
+
+	VectorXd StandardPruneFeatures::computeSpatialEntropyTerm(ImgFeatures& X, ImgLabeling& Y, set<int> /*action*/)
+	{
+		const int numClasses = Global::settings->CLASSES.numClasses();
+
+		VectorXd locationSums = VectorXd::Zero(numClasses*LOCATION_SUMS_DIM);
+		for (int node = 0; node < Y.getNumNodes(); node++)
+			addLocation(X, node, Global::settings->CLASSES.getClassIndex(Y.getLabel(node)), 1, locationSums);
+
+		return computeSpatialEntropyTerm(locationSums);
+	}
+
+	VectorXd StandardPruneFeatures::computeSpatialEntropyTerm(const VectorXd& locationSums)
+	{
+		const int numClasses = Global::settings->CLASSES.numClasses();
+
+		// one-pass sums of squares lose precision to cancellation and to the rounding
+		// of every incremental update, so sums of squared deviations below 1e-10 of the
+		// mean square location over the image, per node, are treated as zero
+		// (a standard deviation under 1e-5 of the location scale)
+		const double tolerance = 1e-10;
+		double numNodes = 0;
+		double meanSqX = 0;
+		double meanSqY = 0;
+		for (int c = 0; c < numClasses; c++)
+		{
+			const double* sums = locationSums.data() + c*LOCATION_SUMS_DIM;
+			numNodes += sums[0];
+			meanSqX += sums[3];
+			meanSqY += sums[4];
 		}
-		
+		if (numNodes > 0)
+		{
+			meanSqX /= numNodes;
+			meanSqY /= numNodes;
+		}
+
+		// standard deviation of node locations per class (zero for unusable classes with N <= 1)
+		VectorXd phi = VectorXd::Zero(2*numClasses);
+		for (int c = 0; c < numClasses; c++)
+		{
+			const double* sums = locationSums.data() + c*LOCATION_SUMS_DIM;
+			const double numSum = sums[0];
+			if (numSum <= 1)
+				continue;
+
+			double sumSqX = sums[3] - sums[1]*sums[1]/numSum;
+			double sumSqY = sums[4] - sums[2]*sums[2]/numSum;
+			if (sumSqX > tolerance*numSum*meanSqX)
+				phi(c) = sqrt(sumSqX/(numSum-1));
+			if (sumSqY > tolerance*numSum*meanSqY)
+				phi(numClasses + c) = sqrt(sumSqY/(numSum-1));
+		}
+
 		return phi;
 	}
 
+	VectorXd StandardPruneFeatures::computeMutexTermManually(ImgFeatures& X, ImgLabeling& Y, set<int> action)
+	{
+		return computeManualMutexTerm(X, Y, action);
+	}
+
 	VectorXd StandardPruneFeatures::computeMutexTerm(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		const int numNodes = X.getNumNodes();
 		const int numClasses = Global::settings->CLASSES.numClasses();
 		const int mutexFeatDim = 4;
 		const int numMutexPairs = (numClasses*(numClasses+1))/2;
 		
 		VectorXd phi = VectorXd::Zero(numMutexPairs*mutexFeatDim);
 
-		int numEdges = 0;
-		//for (int node1 = 0; node1 < numNodes; node1++)
-		for (set<int>::iterator it = action.begin(); it != action.end(); ++it)
+		// action nodes against all other nodes
+		LabelExtents_t actionExtents = computeLabelExtents(X, Y, action);
+		LabelExtents_t extents = computeLabelExtents(X, Y);
+		for (LabelExtents_t::iterator it1 = actionExtents.begin(); it1 != actionExtents.end(); ++it1)
 		{
-			int node1 = *it;
-
-			for (int node2 = 0; node2 < numNodes; node2++)
+			for (LabelExtents_t::iterator it2 = extents.begin(); it2 != extents.end(); ++it2)
 			{
-				if (node1 == node2)
+				int nodeLabel1 = it1->first;
+				int nodeLabel2 = it2->first;
+				if (nodeLabel1 == nodeLabel2)
 					continue;
 
-				numEdges++;
-
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-				double nodeLocationX1 = X.getNodeLocationX(node1);
-				double nodeLocationY1 = X.getNodeLocationY(node1);
-				int nodeLabel1 = Y.getLabel(node1);
-
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
-				double nodeLocationX2 = X.getNodeLocationX(node2);
-				double nodeLocationY2 = X.getNodeLocationY(node2);
-				int nodeLabel2 = Y.getLabel(node2);
-
-				int classIndex = -1;
-				VectorXd edgeFeatureVector = computeMutexFeatures(nodeFeatures1, nodeFeatures2, 
-					nodeLocationX1, nodeLocationY1, nodeLocationX2, nodeLocationY2, 
-					nodeLabel1, nodeLabel2, classIndex);
+				int classIndex = contextPairIndex(nodeLabel1, nodeLabel2);
 
-				for (int i = 0; i < mutexFeatDim; i++)
-				{
-					if (edgeFeatureVector(i) != 0)
-						phi(classIndex*mutexFeatDim + i) = edgeFeatureVector(i);
-				}
+				if (it1->second.someLeftOf(it2->second) && isMutexAllowed(nodeLabel1, nodeLabel2, "L"))
+					phi(classIndex*mutexFeatDim + 0) = 1;
+				if (it1->second.someRightOf(it2->second) && isMutexAllowed(nodeLabel1, nodeLabel2, "R"))
+					phi(classIndex*mutexFeatDim + 1) = 1;
+				if (it1->second.someAbove(it2->second) && isMutexAllowed(nodeLabel1, nodeLabel2, "U"))
+					phi(classIndex*mutexFeatDim + 2) = 1;
+				if (it1->second.someBelow(it2->second) && isMutexAllowed(nodeLabel1, nodeLabel2, "D"))
+					phi(classIndex*mutexFeatDim + 3) = 1;
 			}
 		}
 		
 		return phi;
 	}
 
-	VectorXd StandardPruneFeatures::computeMutexFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
-		double nodeLocationX1, double nodeLocationY1, double nodeLocationX2, double nodeLocationY2, 
-		int nodeLabel1, int nodeLabel2, int& classIndex)
+	bool StandardPruneFeatures::isMutexAllowed(int class1, int class2, string config)
 	{
-		int node1ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel1);
-		int node2ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel2);
-		int numClasses = Global::settings->CLASSES.numClasses();
-
-		int i = min(node1ClassIndex, node2ClassIndex);
-		int j = max(node1ClassIndex, node2ClassIndex);
-
-		classIndex = (numClasses*(numClasses+1)-(numClasses-i)*(numClasses-i+1))/2+(numClasses-1-j);
-
-		// phi features depend on labels
-		if (nodeLabel1 != nodeLabel2)
-		{
-			VectorXd potential = VectorXd::Zero(4);
-
-			if (nodeLocationX1 < nodeLocationX2)
-			{
-				string mutexKey = mutexStringHelper(nodeLabel1, nodeLabel2, "L");
-				if (this->mutex.count(mutexKey) == 0)
-					potential(0) = 1;
-				else if (this->mutex[mutexKey] <= MUTEX_THRESHOLD)
-					potential(0) = 1;
-				else
-					potential(0) = 0;
-			}
-			else if (nodeLocationX1 > nodeLocationX2)
-			{
-				string mutexKey = mutexStringHelper(nodeLabel1, nodeLabel2, "R");
-				if (this->mutex.count(mutexKey) == 0)
-					potential(1) = 1;
-				else if (this->mutex[mutexKey] <= MUTEX_THRESHOLD)
-					potential(1) = 1;
-				else
-					potential(1) = 0;
-			}
-			
-			if (nodeLocationY1 < nodeLocationY2)
-			{
-				string mutexKey = mutexStringHelper(nodeLabel1, nodeLabel2, "U");
-				if (this->mutex.count(mutexKey) == 0)
-					potential(2) = 1;
-				else if (this->mutex[mutexKey] <= MUTEX_THRESHOLD)
-					potential(2) = 1;
-				else
-					potential(2) = 0;
-			}
-			else if (nodeLocationY1 > nodeLocationY2)
-			{
-				string mutexKey = mutexStringHelper(nodeLabel1, nodeLabel2, "D");
-				if (this->mutex.count(mutexKey) == 0)
-					potential(3) = 1;
-				else if (this->mutex[mutexKey] <= MUTEX_THRESHOLD)
-					potential(3) = 1;
-				else
-					potential(3) = 0;
-			}
-
-			return potential;
-		}
-		else
-		{
-			VectorXd potential = VectorXd::Zero(4);
-			return potential;
-		}
+		string mutexKey = mutexStringHelper(class1, class2, config);
+		return this->mutex.count(mutexKey) == 0 || this->mutex[mutexKey] <= MUTEX_THRESHOLD;
 	}
-
 	void StandardPruneFeatures::setMutex(map<string, int>& mutex)
 	{
 		this->mutex = mutex;
@@ -1560,8 +2416,7 @@ namespace HCSearch
 		// unary potential
 		for (int node = 0; node < numNodes; node++)
 		{
-			// get node features and label
-			VectorXd nodeFeatures = X.graph.nodesData.row(node);
+			// get node label
 			int nodeLabel = Y.getLabel(node);
 
 			// map node label to indexing value in phi vector
@@ -1569,7 +2424,7 @@ namespace HCSearch
 
 			// assignment: bias and unary feature
 			phi(classIndex*unaryFeatDim) += 1;
-			phi.segment(classIndex*unaryFeatDim+1, featureDim) += nodeFeatures;
+			X.addNodeFeatures(node, 1, phi, classIndex*unaryFeatDim+1);
 		}
 
 		return phi;
@@ -1586,27 +2441,24 @@ namespace HCSearch
 
 		for (int node1 = 0; node1 < numNodes; node1++)
 		{
-			if (X.graph.adjList.count(node1) == 0)
+			// get neighbors (ending nodes) of starting node
+			NeighborRange neighbors = X.graph.adjList.neighbors(node1);
+			if (neighbors.empty())
 				continue;
 
-			// get neighbors (ending nodes) of starting node
-			NeighborSet_t neighbors = X.graph.adjList[node1];
 			const int numNeighbors = neighbors.size();
-			for (NeighborSet_t::iterator it = neighbors.begin(); it != neighbors.end(); ++it)
+			for (NeighborRange::const_iterator it = neighbors.begin(); it != neighbors.end(); ++it)
 			{
 				int node2 = *it;
 
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
+				// get node labels
 				int nodeLabel1 = Y.getLabel(node1);
-
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
 				int nodeLabel2 = Y.getLabel(node2);
 
 				if (nodeLabel1 == nodeLabel2)
 					continue;
 
-				VectorXd edgeFeatureVector = computePairwiseFeatures(nodeFeatures1, nodeFeatures2, nodeLabel1, nodeLabel2);
+				VectorXd edgeFeatureVector = computePairwiseFeatures(X, node1, node2, nodeLabel1, nodeLabel2);
 				phi += edgeFeatureVector; // contrast sensitive pairwise potential
 			}
 		}
@@ -1617,11 +2469,10 @@ namespace HCSearch
 		return phi;
 	}
 
-	VectorXd StandardSimpleFeatures::computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
+	VectorXd StandardSimpleFeatures::computePairwiseFeatures(ImgFeatures& X, int node1, int node2, 
 		int nodeLabel1, int nodeLabel2)
 	{
-		VectorXd diff = nodeFeatures1 - nodeFeatures2;
-		VectorXd diffabs = diff.cwiseAbs();
+		VectorXd diffabs = X.getEdgeAbsDiff(node1, node2);
 
 		// assignment
 		return diffabs;
@@ -1700,8 +2551,7 @@ namespace HCSearch
 		// unary potential
 		for (int node = 0; node < numNodes; node++)
 		{
-			// get node features and label
-			VectorXd nodeFeatures = X.graph.nodesData.row(node);
+			// get node label
 			int nodeLabel = Y.getLabel(node);
 
 			// map node label to indexing value in phi vector
@@ -1709,7 +2559,7 @@ namespace HCSearch
 
 			// assignment: bias and unary feature
 			phi(classIndex*unaryFeatDim) += 1;
-			phi.segment(classIndex*unaryFeatDim+1, featureDim) += nodeFeatures;
+			X.addNodeFeatures(node, 1, phi, classIndex*unaryFeatDim+1);
 		}
 
 		return phi;
@@ -1726,27 +2576,24 @@ namespace HCSearch
 
 		for (int node1 = 0; node1 < numNodes; node1++)
 		{
-			if (X.graph.adjList.count(node1) == 0)
+			// get neighbors (ending nodes) of starting node
+			NeighborRange neighbors = X.graph.adjList.neighbors(node1);
+			if (neighbors.empty())
 				continue;
 
-			// get neighbors (ending nodes) of starting node
-			NeighborSet_t neighbors = X.graph.adjList[node1];
 			const int numNeighbors = neighbors.size();
-			for (NeighborSet_t::iterator it = neighbors.begin(); it != neighbors.end(); ++it)
+			for (NeighborRange::const_iterator it = neighbors.begin(); it != neighbors.end(); ++it)
 			{
 				int node2 = *it;
 
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
+				// get node labels
 				int nodeLabel1 = Y.getLabel(node1);
-
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
 				int nodeLabel2 = Y.getLabel(node2);
 
 				if (nodeLabel1 == nodeLabel2)
 					continue;
 
-				VectorXd edgeFeatureVector = computePairwiseFeatures(nodeFeatures1, nodeFeatures2, nodeLabel1, nodeLabel2);
+				VectorXd edgeFeatureVector = computePairwiseFeatures(X, node1, node2, nodeLabel1, nodeLabel2);
 				phi += edgeFeatureVector; // contrast sensitive pairwise potential
 			}
 		}
@@ -1757,11 +2604,10 @@ namespace HCSearch
 		return phi;
 	}
 
-	VectorXd StandardSimpleContextFeatures::computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
+	VectorXd StandardSimpleContextFeatures::computePairwiseFeatures(ImgFeatures& X, int node1, int node2, 
 		int nodeLabel1, int nodeLabel2)
 	{
-		VectorXd diff = nodeFeatures1 - nodeFeatures2;
-		VectorXd diffabs = diff.cwiseAbs();
+		VectorXd diffabs = X.getEdgeAbsDiff(node1, node2);
 
 		// assignment
 		return diffabs;
@@ -1769,147 +2615,12 @@ namespace HCSearch
 	
 	VectorXd StandardSimpleContextFeatures::computeContextTerm(ImgFeatures& X, ImgLabeling& Y)
 	{
-		const int numNodes = X.getNumNodes();
-		const int numClasses = Global::settings->CLASSES.numClasses();
-		const int contextFeatDim = 4;
-		const int numContextPairs = (numClasses*(numClasses+1))/2;
-		
-		VectorXd phi = VectorXd::Zero(numContextPairs*contextFeatDim);
-
-		int numEdges = 0;
-		for (int node1 = 0; node1 < numNodes; node1++)
-		{
-			for (int node2 = 0; node2 < numNodes; node2++)
-			{
-				if (node1 == node2)
-					continue;
-
-				numEdges++;
-
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-				double nodeLocationX1 = X.getNodeLocationX(node1);
-				double nodeLocationY1 = X.getNodeLocationY(node1);
-				int nodeLabel1 = Y.getLabel(node1);
-
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
-				double nodeLocationX2 = X.getNodeLocationX(node2);
-				double nodeLocationY2 = X.getNodeLocationY(node2);
-				int nodeLabel2 = Y.getLabel(node2);
-
-				int classIndex = -1;
-				VectorXd edgeFeatureVector = computeContextFeatures(nodeFeatures1, nodeFeatures2, 
-					nodeLocationX1, nodeLocationY1, nodeLocationX2, nodeLocationY2, 
-					nodeLabel1, nodeLabel2, classIndex);
-
-				for (int i = 0; i < contextFeatDim; i++)
-				{
-					if (edgeFeatureVector(i) != 0)
-						phi(classIndex*contextFeatDim + i) = edgeFeatureVector(i);
-				}
-			}
-		}
-		
-		return phi;
-	}
-
-	VectorXd StandardSimpleContextFeatures::computeContextFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
-		double nodeLocationX1, double nodeLocationY1, double nodeLocationX2, double nodeLocationY2, 
-		int nodeLabel1, int nodeLabel2, int& classIndex)
-	{
-		int node1ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel1);
-		int node2ClassIndex = Global::settings->CLASSES.getClassIndex(nodeLabel2);
-		int numClasses = Global::settings->CLASSES.numClasses();
-
-		int i = min(node1ClassIndex, node2ClassIndex);
-		int j = max(node1ClassIndex, node2ClassIndex);
-
-		classIndex = (numClasses*(numClasses+1)-(numClasses-i)*(numClasses-i+1))/2+(numClasses-1-j);
-
-		// phi features depend on labels
-		if (nodeLabel1 != nodeLabel2)
-		{
-			VectorXd potential = VectorXd::Zero(4);
-
-			if (nodeLocationX1 < nodeLocationX2)
-			{
-				potential(0) = 1;
-			}
-			else if (nodeLocationX1 > nodeLocationX2)
-			{
-				potential(1) = 1;
-			}
-			
-			if (nodeLocationY1 < nodeLocationY2)
-			{
-				potential(2) = 1;
-			}
-			else if (nodeLocationY1 > nodeLocationY2)
-			{
-				potential(3) = 1;
-			}
-
-			return potential;
-		}
-		else
-		{
-			VectorXd potential = VectorXd::Zero(4);
-			return potential;
-		}
+		return computeRelativeLocationTerm(X, Y);
 	}
 
 	VectorXd StandardSimpleContextFeatures::computeMutexTermManually(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
-		const int numNodes = X.getNumNodes();
-		const int numMutexConstraints = 8;
-		
-		VectorXd phi = VectorXd::Zero(numMutexConstraints);
-
-		int numEdges = 0;
-		//for (int node1 = 0; node1 < numNodes; node1++)
-		for (set<int>::iterator it = action.begin(); it != action.end(); ++it)
-		{
-			int node1 = *it;
-
-			for (int node2 = 0; node2 < numNodes; node2++)
-			{
-				if (node1 == node2)
-					continue;
-
-				numEdges++;
-
-				// get node features and label
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-				double nodeLocationX1 = X.getNodeLocationX(node1);
-				double nodeLocationY1 = X.getNodeLocationY(node1);
-				int nodeLabel1 = Y.getLabel(node1);
-
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
-				double nodeLocationX2 = X.getNodeLocationX(node2);
-				double nodeLocationY2 = X.getNodeLocationY(node2);
-				int nodeLabel2 = Y.getLabel(node2);
-
-				// MANUALLY DEFINED FOR STANFORD DATASET
-				if (nodeLabel1 == 1 && nodeLabel2 == 3 && nodeLocationY1 > nodeLocationY2)
-					phi(0) = 1;
-				if (nodeLabel1 == 3 && nodeLabel2 == 1 && nodeLocationY1 < nodeLocationY2)
-					phi(1) = 1;
-				if (nodeLabel1 == 1 && nodeLabel2 == 4 && nodeLocationY1 > nodeLocationY2)
-					phi(2) = 1;
-				if (nodeLabel1 == 4 && nodeLabel2 == 1 && nodeLocationY1 < nodeLocationY2)
-					phi(3) = 1;
-				if (nodeLabel1 == 1 && nodeLabel2 == 5 && nodeLocationY1 > nodeLocationY2)
-					phi(4) = 1;
-				if (nodeLabel1 == 5 && nodeLabel2 == 1 && nodeLocationY1 < nodeLocationY2)
-					phi(5) = 1;
-				if (nodeLabel1 == 1 && nodeLabel2 == 7 && nodeLocationY1 > nodeLocationY2)
-					phi(6) = 1;
-				if (nodeLabel1 == 7 && nodeLabel2 == 1 && nodeLocationY1 < nodeLocationY2)
-					phi(7) = 1;
-			}
-		}
-		
-		return phi;
+		return computeManualMutexTerm(X, Y, action);
 	}
 
 	VectorXd StandardSimpleContextFeatures::computeHoleTerm(ImgFeatures& X, ImgLabeling& Y, set<int> action)
@@ -3,11 +3,31 @@
 
 #include "../../external/Eigen/Eigen/Dense"
 #include "DataStructures.hpp"
+#include "Globals.hpp"
 
 namespace HCSearch
 {
 	/**************** Search Space Function Abstract Definitions ****************/
 
+	/*!
+	 * @brief Unnormalized feature sums of a labeling.
+	 * 
+	 * Feature functions that support incremental computation keep their 
+	 * unnormalized unary and pairwise sums here, so the features of a successor 
+	 * only need the terms of the changed nodes and their incident edges.
+	 */
+	struct FeatureAccumulators
+	{
+		VectorXd unarySums; //!< Unnormalized unary term
+		VectorXd pairwiseSums; //!< Unnormalized pairwise term (empty if no pairwise term)
+		VectorXd locationExtents; //!< Per class min/max node locations and the number of nodes on each (empty if not used)
+		int numNodes; //!< Number of nodes to normalize the unary term
+		int numEdges; //!< Number of (directed) edges to normalize the pairwise term
+		bool available; //!< False if incremental computation is not supported
+
+		FeatureAccumulators();
+	};
+
 	/*!
 	 * @brief Feature function interface.
 	 */
@@ -21,10 +41,78 @@ namespace HCSearch
 		 */
 		virtual RankFeatures computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action)=0;
 
+		/*!
+		 * @brief Compute features of a successor candidate.
+		 * 
+		 * Delta candidates are applied to their parent labeling in place 
+		 * and reverted afterwards, so the labeling is never copied.
+		 */
+		virtual RankFeatures computeFeatures(ImgFeatures& X, ImgCandidate& YCandidate);
+
 		/*!
 		 * @brief Get dimension of computed feature vector given structured features and labeling.
 		 */
 		virtual int featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action);
+
+		/*!
+		 * @brief Compute the unnormalized feature sums of a labeling.
+		 * 
+		 * The default implementation does not support incremental computation.
+		 * @return Returns false if incremental computation is not supported
+		 */
+		virtual bool computeAccumulators(ImgFeatures& X, ImgLabeling& Y, FeatureAccumulators& acc);
+
+		/*!
+		 * @brief Compute the feature sums of a delta candidate from the feature sums of its parent.
+		 * 
+		 * Only the terms of the changed nodes and their incident edges are recomputed.
+		 * @return Returns false if not possible (full candidate or not supported)
+		 */
+		virtual bool updateAccumulators(ImgFeatures& X, ImgCandidate& YCandidate, 
+			const FeatureAccumulators& parentAcc, FeatureAccumulators& acc);
+
+		/*!
+		 * @brief Compute features from feature sums.
+		 */
+		virtual RankFeatures computeFeatures(ImgFeatures& X, const FeatureAccumulators& acc);
+
+		/*!
+		 * @brief Compute features of a successor candidate from the feature sums of its parent.
+		 * 
+		 * Lets many candidates of the same parent share one full pass over the parent. 
+		 * Falls back to computeFeatures(X, YCandidate) if the sums cannot be updated.
+		 */
+		virtual RankFeatures computeFeatures(ImgFeatures& X, ImgCandidate& YCandidate, const FeatureAccumulators& parentAcc);
+
+	protected:
+		/*!
+		 * @brief Fill the (zero initialized) feature sums from all nodes and edges.
+		 * @return Returns false if the graph is not symmetric
+		 */
+		bool accumulateFeatures(ImgFeatures& X, ImgLabeling& Y, FeatureAccumulators& acc);
+
+		/*!
+		 * @brief Update the parent feature sums with the changed nodes of a delta candidate.
+		 */
+		bool accumulateDelta(ImgFeatures& X, ImgCandidate& YCandidate, 
+			const FeatureAccumulators& parentAcc, FeatureAccumulators& acc);
+
+		/*!
+		 * @brief Normalize and concatenate feature sums.
+		 */
+		RankFeatures assembleFeatures(const FeatureAccumulators& acc, double unaryWeight, double pairwiseWeight);
+
+		/*!
+		 * @brief Add the weighted unary term of a node to the unary sums.
+		 */
+		virtual void addUnaryContribution(ImgFeatures& X, ImgLabeling& Y, int node, int nodeLabel, 
+			double weight, VectorXd& unarySums);
+
+		/*!
+		 * @brief Add the weighted pairwise term of an edge to the pairwise sums.
+		 */
+		virtual void addPairwiseContribution(ImgFeatures& X, int node1, int nodeLabel1, int node2, int nodeLabel2, 
+			double weight, VectorXd& pairwiseSums);
 	};
 
 	/**************** Feature Functions ****************/
@@ -47,7 +135,18 @@ namespace HCSearch
 		virtual RankFeatures computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action);
 		virtual int featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action);
 
+		virtual bool computeAccumulators(ImgFeatures& X, ImgLabeling& Y, FeatureAccumulators& acc);
+		virtual bool updateAccumulators(ImgFeatures& X, ImgCandidate& YCandidate, 
+			const FeatureAccumulators& parentAcc, FeatureAccumulators& acc);
+		virtual RankFeatures computeFeatures(ImgFeatures& X, const FeatureAccumulators& acc);
+		using IFeatureFunction::computeFeatures;
+
 	protected:
+		virtual void addUnaryContribution(ImgFeatures& X, ImgLabeling& Y, int node, int nodeLabel, 
+			double weight, VectorXd& unarySums);
+		virtual void addPairwiseContribution(ImgFeatures& X, int node1, int nodeLabel1, int node2, int nodeLabel2, 
+			double weight, VectorXd& pairwiseSums);
+
 		/*!
 		 * @brief Compute unary term.
 		 */
@@ -61,8 +160,13 @@ namespace HCSearch
 		/*!
 		 * @brief Compute pairwise features.
 		 */
-		virtual VectorXd computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
+		virtual VectorXd computePairwiseFeatures(ImgFeatures& X, int node1, int node2, 
 			int nodeLabel1, int nodeLabel2, int& classIndex);
+
+		/*!
+		 * @brief Get the index of an unordered pair of class indices.
+		 */
+		static int pairIndex(int classIndex1, int classIndex2, int numClasses);
 	};
 
 	/*!
@@ -91,20 +195,13 @@ namespace HCSearch
 		/*!
 		 * @brief Compute pairwise features.
 		 */
-		virtual VectorXd computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
+		virtual VectorXd computePairwiseFeatures(ImgFeatures& X, int node1, int node2, 
 			int nodeLabel1, int nodeLabel2, int& classIndex);
 
 		/*!
 		 * @brief Compute context term.
 		 */
 		virtual VectorXd computeContextTerm(ImgFeatures& X, ImgLabeling& Y);
-
-		/*!
-		 * @brief Compute context features.
-		 */
-		VectorXd computeContextFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
-			double nodeLocationX1, double nodeLocationY1, double nodeLocationX2, double nodeLocationY2, 
-			int nodeLabel1, int nodeLabel2, int& classIndex);
 	};
 
 	/*!
@@ -134,7 +231,7 @@ namespace HCSearch
 		/*!
 		 * @brief Compute pairwise features.
 		 */
-		virtual VectorXd computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
+		virtual VectorXd computePairwiseFeatures(ImgFeatures& X, int node1, int node2, 
 			int nodeLabel1, int nodeLabel2, int& classIndex);
 	};
 
@@ -150,7 +247,18 @@ namespace HCSearch
 		virtual RankFeatures computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action);
 		virtual int featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action);
 
+		virtual bool computeAccumulators(ImgFeatures& X, ImgLabeling& Y, FeatureAccumulators& acc);
+		virtual bool updateAccumulators(ImgFeatures& X, ImgCandidate& YCandidate, 
+			const FeatureAccumulators& parentAcc, FeatureAccumulators& acc);
+		virtual RankFeatures computeFeatures(ImgFeatures& X, const FeatureAccumulators& acc);
+		using IFeatureFunction::computeFeatures;
+
 	protected:
+		virtual void addUnaryContribution(ImgFeatures& X, ImgLabeling& Y, int node, int nodeLabel, 
+			double weight, VectorXd& unarySums);
+		virtual void addPairwiseContribution(ImgFeatures& X, int node1, int nodeLabel1, int node2, int nodeLabel2, 
+			double weight, VectorXd& pairwiseSums);
+
 		/*!
 		 * @brief Compute unary term.
 		 */
@@ -164,7 +272,7 @@ namespace HCSearch
 		/*!
 		 * @brief Compute pairwise features.
 		 */
-		virtual VectorXd computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
+		virtual VectorXd computePairwiseFeatures(ImgFeatures& X, int node1, int node2, 
 			int nodeLabel1, int nodeLabel2, int& classIndex);
 	};
 
@@ -179,6 +287,10 @@ namespace HCSearch
 
 		virtual RankFeatures computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action);
 		virtual int featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action);
+
+		virtual bool computeAccumulators(ImgFeatures& X, ImgLabeling& Y, FeatureAccumulators& acc);
+		virtual RankFeatures computeFeatures(ImgFeatures& X, const FeatureAccumulators& acc);
+		using IFeatureFunction::computeFeatures;
 	};
 
 	/*!
@@ -192,6 +304,10 @@ namespace HCSearch
 
 		virtual RankFeatures computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action);
 		virtual int featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action);
+
+		virtual bool computeAccumulators(ImgFeatures& X, ImgLabeling& Y, FeatureAccumulators& acc);
+		virtual RankFeatures computeFeatures(ImgFeatures& X, const FeatureAccumulators& acc);
+		using IFeatureFunction::computeFeatures;
 	};
 
 	/*!
@@ -206,9 +322,15 @@ namespace HCSearch
 		virtual RankFeatures computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action);
 		virtual int featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action);
 
+		virtual bool computeAccumulators(ImgFeatures& X, ImgLabeling& Y, FeatureAccumulators& acc);
+		virtual RankFeatures computeFeatures(ImgFeatures& X, const FeatureAccumulators& acc);
+		using IFeatureFunction::computeFeatures;
+
 	protected:
+		virtual void addPairwiseContribution(ImgFeatures& X, int node1, int nodeLabel1, int node2, int nodeLabel2, 
+			double weight, VectorXd& pairwiseSums);
 		virtual VectorXd computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y);
-		virtual VectorXd computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
+		virtual VectorXd computePairwiseFeatures(ImgFeatures& X, int node1, int node2, 
 			int nodeLabel1, int nodeLabel2, int& classIndex);
 	};
 
@@ -224,19 +346,103 @@ namespace HCSearch
 		virtual RankFeatures computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action);
 		virtual int featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action);
 
+		virtual bool computeAccumulators(ImgFeatures& X, ImgLabeling& Y, FeatureAccumulators& acc);
+		using StandardConfFeatures::computeFeatures;
+
 	protected:
 		virtual VectorXd computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y);
-		virtual VectorXd computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
+		virtual VectorXd computePairwiseFeatures(ImgFeatures& X, int node1, int node2, 
 			int nodeLabel1, int nodeLabel2, int& classIndex);
 	};
 
+	/*!
+	 * @brief Permutohedral lattice for fast high-dimensional Gaussian filtering.
+	 *
+	 * Approximates out_j = sum_i exp(-|p_i-p_j|^2/2) * v_i for all points
+	 * in O(N*d^2) time instead of O(N^2*d) (Adams et al., 2010).
+	 * Positions must be divided by the kernel bandwidths beforehand.
+	 */
+	class PermutohedralLattice
+	{
+		int numPoints; //!< Number of points
+		int dim; //!< Position dimension
+		int numVertices; //!< Number of lattice vertices
+		vector<int> offsets; //!< Enclosing simplex vertices of each point (dim+1 per point)
+		vector<double> barycentrics; //!< Barycentric weights of each point (dim+1 per point)
+		vector<int> blurNeighbors; //!< Neighbors of each vertex along each lattice axis (-1 if none)
+
+	public:
+		/*!
+		 * @brief Build the lattice from point positions.
+		 * @param positions Scaled positions, one row per point
+		 */
+		PermutohedralLattice(const MatrixXd& positions);
+
+		/*!
+		 * @brief Filter values with the Gaussian kernel.
+		 * @param values Values to filter, one row per point
+		 * @return Filtered values, one row per point
+		 */
+		MatrixXd filter(const MatrixXd& values) const;
+
+		/*!
+		 * @brief Get the number of lattice vertices.
+		 */
+		int getNumVertices() const;
+	};
+
+	/*!
+	 * @brief Permutohedral lattices of the dense CRF kernels of an image.
+	 * 
+	 * Both kernels only depend on the node locations and features, 
+	 * so the lattices are built once per image and shared by all labelings.
+	 */
+	class DenseCRFLattices
+	{
+	public:
+		PermutohedralLattice appearance; //!< Lattice of the appearance kernel
+		PermutohedralLattice smoothness; //!< Lattice of the smoothness kernel
+		double appearanceGain; //!< Average response of a node to itself on the appearance lattice
+		double smoothnessGain; //!< Average response of a node to itself on the smoothness lattice
+
+		/*!
+		 * @brief Build the lattices and measure their gains.
+		 * @param appearancePositions Scaled appearance kernel positions, one row per node
+		 * @param smoothnessPositions Scaled smoothness kernel positions, one row per node
+		 * @param numGainSamples Number of nodes used to measure the gains
+		 */
+		DenseCRFLattices(const MatrixXd& appearancePositions, const MatrixXd& smoothnessPositions, int numGainSamples);
+	};
+
 	/*!
 	 * @brief Dense CRF features with unary and pairwise potentials.
+	 * 
+	 * The fully-connected pairwise term is computed exactly in O(N^2) by default. 
+	 * The FILTERED mode approximates it by Gaussian filtering on permutohedral 
+	 * lattices built once per image. The node features are projected onto their 
+	 * top MAX_APPEARANCE_DIM principal components for the appearance lattice, 
+	 * which is exact for features that lie in such a subspace.
 	 */
 	class DenseCRFFeatures : public IFeatureFunction
 	{
+	public:
+		/*!
+		 * @brief Pairwise term computation modes.
+		 */
+		enum PairwiseMode { FILTERED, EXACT };
+
+	protected:
+		static const double THETA_ALPHA; //!< Location bandwidth of the appearance kernel
+		static const double THETA_BETA; //!< Feature bandwidth of the appearance kernel
+		static const double THETA_GAMMA; //!< Location bandwidth of the smoothness kernel
+		static const int MAX_GAIN_SAMPLES; //!< Number of nodes used to measure the lattice gain
+		static const int MAX_APPEARANCE_DIM; //!< Feature dimension of the appearance lattice
+
+		PairwiseMode pairwiseMode;
+
 	public:
 		DenseCRFFeatures();
+		DenseCRFFeatures(PairwiseMode pairwiseMode);
 		~DenseCRFFeatures();
 
 		virtual RankFeatures computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action);
@@ -245,6 +451,9 @@ namespace HCSearch
 	protected:
 		virtual VectorXd computeUnaryTerm(ImgFeatures& X, ImgLabeling& Y);
 		virtual VectorXd computePairwiseTerm(ImgFeatures& X, ImgLabeling& Y);
+		virtual VectorXd computePairwiseTermExact(ImgFeatures& X, ImgLabeling& Y);
+		virtual VectorXd computePairwiseTermFiltered(ImgFeatures& X, ImgLabeling& Y);
+		virtual shared_ptr< const DenseCRFLattices > getLattices(ImgFeatures& X);
 		virtual VectorXd computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
 			double nodeLocationX1, double nodeLocationY1, double nodeLocationX2, double nodeLocationY2, 
 			int nodeLabel1, int nodeLabel2, int& classIndex);
@@ -276,6 +485,11 @@ namespace HCSearch
 	public:
 		virtual RankFeatures computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action)=0;
 
+		/*!
+		 * @brief Global features are not computed incrementally.
+		 */
+		virtual bool computeAccumulators(ImgFeatures& X, ImgLabeling& Y, FeatureAccumulators& acc);
+
 	protected:
 		/*!
 		 * @brief Compute global term.
@@ -355,6 +569,30 @@ namespace HCSearch
 		virtual RankFeatures computeFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action);
 		virtual int featureSize(ImgFeatures& X, ImgLabeling& Y, set<int> action);
 
+		/*!
+		 * @brief Compute per class location sums (count, x, y, x^2, y^2) and extents of a labeling.
+		 */
+		virtual bool computeAccumulators(ImgFeatures& X, ImgLabeling& Y, FeatureAccumulators& acc);
+
+		/*!
+		 * @brief Update the parent location sums and extents with the relabeled nodes.
+		 * 
+		 * Extents of a class only need a pass over the nodes if the last node on one of its boundaries was relabeled.
+		 */
+		virtual bool updateAccumulators(ImgFeatures& X, ImgCandidate& YCandidate, 
+			const FeatureAccumulators& parentAcc, FeatureAccumulators& acc);
+
+		/*!
+		 * @brief Compute features from location sums and extents, with an empty action.
+		 */
+		virtual RankFeatures computeFeatures(ImgFeatures& X, const FeatureAccumulators& acc);
+
+		/*!
+		 * @brief Compute features of a delta candidate in O(|action|) from the parent location sums.
+		 */
+		virtual RankFeatures computeFeatures(ImgFeatures& X, ImgCandidate& YCandidate, const FeatureAccumulators& parentAcc);
+		using IFeatureFunction::computeFeatures;
+
 		void setMutex(map<string, int>& mutex);
 		map<string, int> getMutex();
 
@@ -363,14 +601,22 @@ namespace HCSearch
 		
 		VectorXd computeSpatialEntropyTerm(ImgFeatures& X, ImgLabeling& Y, set<int> action);
 
+		/*!
+		 * @brief Compute the spatial entropy term from per class location sums.
+		 */
+		VectorXd computeSpatialEntropyTerm(const VectorXd& locationSums);
+
+		/*!
+		 * @brief Concatenate the hole, mutex and spatial entropy terms.
+		 */
+		RankFeatures assemblePruneFeatures(const VectorXd& holeTerm, const VectorXd& mutexTerm, const VectorXd& spatialEntropyTerm);
+
 		VectorXd computeMutexTermManually(ImgFeatures& X, ImgLabeling& Y, set<int> action);
 
 		VectorXd computeMutexTerm(ImgFeatures& X, ImgLabeling& Y, set<int> action);
-		VectorXd computeMutexFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
-			double nodeLocationX1, double nodeLocationY1, double nodeLocationX2, double nodeLocationY2, 
-			int nodeLabel1, int nodeLabel2, int& classIndex);
 
 	private:
+		bool isMutexAllowed(int class1, int class2, string config);
 		string mutexStringHelper(int class1, int class2, string config);
 	};
 
@@ -406,7 +652,7 @@ namespace HCSearch
 		/*!
 		 * @brief Compute pairwise features.
 		 */
-		virtual VectorXd computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
+		virtual VectorXd computePairwiseFeatures(ImgFeatures& X, int node1, int node2, 
 			int nodeLabel1, int nodeLabel2);
 	};
 
@@ -442,7 +688,7 @@ namespace HCSearch
 		/*!
 		 * @brief Compute pairwise features.
 		 */
-		virtual VectorXd computePairwiseFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
+		virtual VectorXd computePairwiseFeatures(ImgFeatures& X, int node1, int node2, 
 			int nodeLabel1, int nodeLabel2);
 
 		/*!
@@ -450,13 +696,6 @@ namespace HCSearch
 		 */
 		virtual VectorXd computeContextTerm(ImgFeatures& X, ImgLabeling& Y);
 
-		/*!
-		 * @brief Compute context features.
-		 */
-		VectorXd computeContextFeatures(VectorXd& nodeFeatures1, VectorXd& nodeFeatures2, 
-			double nodeLocationX1, double nodeLocationY1, double nodeLocationX2, double nodeLocationY2, 
-			int nodeLabel1, int nodeLabel2, int& classIndex);
-
 		VectorXd computeMutexTermManually(ImgFeatures& X, ImgLabeling& Y, set<int> action);
 
 		VectorXd computeHoleTerm(ImgFeatures& X, ImgLabeling& Y, set<int> action);
@@ -3,6 +3,10 @@
 #include <cstdlib>
 #include "Globals.hpp"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace HCSearch
 {
 	/**************** Global ****************/
@@ -14,10 +18,115 @@ namespace HCSearch
 
 	namespace Rand
 	{
-		//unsigned long g_init[4] = {(int)time(NULL) % 9999, rand() % 9999, (int)time(NULL) % 8888, rand() % 9999};
-		unsigned long g_init[4] = {1, 2, 3, 4};
-		unsigned long g_length = 4;
-		MTRand_closed unifDist(g_init, g_length);
+		namespace
+		{
+			const unsigned long long GOLDEN_GAMMA = 0x9E3779B97F4A7C15ULL;
+
+			vector<Stream> streams;
+
+			// SplitMix64 finalizer
+			inline unsigned long long mix(unsigned long long z)
+			{
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+				return z ^ (z >> 31);
+			}
+
+			inline unsigned long long combine(unsigned long long h, unsigned long long value)
+			{
+				return mix(h + GOLDEN_GAMMA*(value + 1));
+			}
+
+			// 53 random bits to [0, 1)
+			inline double toUnit(unsigned long long bits)
+			{
+				return static_cast<double>(bits >> 11) * (1.0 / 9007199254740992.0);
+			}
+		}
+
+		Stream::Stream()
+		{
+			this->key = 0;
+			this->counter = 0;
+		}
+
+		Stream::Stream(unsigned long long seed, const string& image, int iteration, int thread)
+		{
+			// FNV-1a hash of the image name
+			unsigned long long imageHash = 0xCBF29CE484222325ULL;
+			for (string::const_iterator it = image.begin(); it != image.end(); ++it)
+			{
+				imageHash ^= static_cast<unsigned char>(*it);
+				imageHash *= 0x100000001B3ULL;
+			}
+
+			this->key = combine(combine(combine(mix(seed), imageHash), iteration), thread);
+			this->counter = 0;
+		}
+
+		double Stream::operator()()
+		{
+			this->counter++;
+			return toUnit(mix(this->key + GOLDEN_GAMMA*this->counter));
+		}
+
+		int Stream::uniformInt(int n)
+		{
+			this->counter++;
+			unsigned long long bits = mix(this->key + GOLDEN_GAMMA*this->counter) >> 32;
+			return static_cast<int>((bits * static_cast<unsigned long long>(n)) >> 32);
+		}
+
+		void Stream::uniforms(double* out, int n)
+		{
+			// no dependency between iterations, so the loop vectorizes
+			const unsigned long long base = this->key + GOLDEN_GAMMA*(this->counter + 1);
+			for (int i = 0; i < n; i++)
+				out[i] = toUnit(mix(base + GOLDEN_GAMMA*static_cast<unsigned long long>(i)));
+			this->counter += n;
+		}
+
+		void beginStreams(const string& image, int iteration)
+		{
+			unsigned long long seed = Global::settings != NULL ? Global::settings->RAND_SEED : 1;
+
+			int numThreads = 1;
+			if (Global::settings != NULL)
+				numThreads = max(numThreads, Global::settings->NUM_THREADS);
+#ifdef _OPENMP
+			numThreads = max(numThreads, omp_get_max_threads());
+#endif
+
+			streams.resize(numThreads);
+			for (int thread = 0; thread < numThreads; thread++)
+				streams[thread] = Stream(seed, image, iteration, thread);
+		}
+
+		Stream& stream()
+		{
+			if (streams.empty())
+			{
+				LOG(ERROR) << "random streams not started, call Rand::beginStreams first";
+				abort();
+			}
+
+			int thread = 0;
+#ifdef _OPENMP
+			thread = omp_get_thread_num();
+#endif
+			if (thread >= static_cast<int>(streams.size()))
+			{
+				LOG(ERROR) << "no random stream for thread " << thread;
+				abort();
+			}
+
+			return streams[thread];
+		}
+
+		double unifDist()
+		{
+			return stream()();
+		}
 	}
 
 	/**************** Abort ****************/
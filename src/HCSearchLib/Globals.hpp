@@ -1,9 +1,10 @@
 #ifndef GLOBALS_HPP
 #define GLOBALS_HPP
 
+#include <string>
+#include <algorithm>
 #include "Settings.hpp"
 #include "MyLogger.hpp"
-#include "mtrand.h"
 
 #ifdef USE_MPI
 #include "EasyMPI.h"
@@ -22,13 +23,84 @@ namespace HCSearch
 	}
 
 	/*!
-	 * @brief Uniform [0, 1] random number generator
+	 * @brief Reproducible random number streams.
+	 * 
+	 * Every (image, iteration, thread) draws from its own stream derived 
+	 * from the run seed, so results do not depend on the order in which 
+	 * images are processed or on how work is split between threads.
 	 */
 	namespace Rand
 	{
-		extern unsigned long g_init[4];
-		extern unsigned long g_length;
-		extern MTRand_closed unifDist;
+		/*!
+		 * @brief Counter-based uniform [0, 1) random number stream.
+		 * 
+		 * The i-th draw is a hash of (key, i), so draws do not depend 
+		 * on each other and can be generated in bulk.
+		 */
+		class Stream
+		{
+			unsigned long long key;
+			unsigned long long counter;
+
+		public:
+			Stream();
+
+			/*!
+			 * @brief Construct the stream of an (image, iteration, thread).
+			 * @param[in] seed Run seed
+			 * @param[in] image Image example name
+			 * @param[in] iteration Stochastic iteration
+			 * @param[in] thread Thread index
+			 */
+			Stream(unsigned long long seed, const string& image, int iteration, int thread);
+
+			/*!
+			 * @brief Draw from Uniform[0, 1).
+			 */
+			double operator()();
+
+			/*!
+			 * @brief Draw an integer uniformly from [0, n).
+			 */
+			int uniformInt(int n);
+
+			/*!
+			 * @brief Draw n values from Uniform[0, 1).
+			 * @param[out] out Array of length n
+			 * @param[in] n Number of draws
+			 */
+			void uniforms(double* out, int n);
+		};
+
+		/*!
+		 * @brief Start the streams of all threads for an image and iteration.
+		 * 
+		 * Call before the parallel regions of a search. 
+		 * The run seed is Global::settings->RAND_SEED.
+		 * @param[in] image Image example name
+		 * @param[in] iteration Stochastic iteration
+		 */
+		void beginStreams(const string& image, int iteration);
+
+		/*!
+		 * @brief Get the stream of the calling thread. Aborts if beginStreams() was not called.
+		 */
+		Stream& stream();
+
+		/*!
+		 * @brief Draw from Uniform[0, 1) using the stream of the calling thread.
+		 */
+		double unifDist();
+
+		/*!
+		 * @brief Shuffle a range using the stream of the calling thread.
+		 */
+		template <class RandomIt> void shuffle(RandomIt first, RandomIt last)
+		{
+			Stream& s = stream();
+			for (int i = static_cast<int>(last - first) - 1; i > 0; i--)
+				swap(first[i], first[s.uniformInt(i+1)]);
+		}
 	}
 
 	/**************** Abort ****************/
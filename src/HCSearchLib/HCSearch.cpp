@@ -255,7 +255,7 @@ namespace HCSearch
 
 		// construct ImgFeatures
 		FeatureGraph featureGraph;
-		featureGraph.adjList = edges;
+		featureGraph.adjList = edges; // also builds the compressed form shared with the labeling
 		featureGraph.nodesData = features;
 		X = new ImgFeatures();
 		X->graph = featureGraph;
@@ -266,10 +266,13 @@ namespace HCSearch
 		X->nodeLocations = nodeLocations;
 		X->edgeWeightsAvailable = Global::settings->USE_EDGE_WEIGHTS;
 		X->edgeWeights = edgeWeights;
+		if (Global::settings->USE_FLOAT_FEATURES)
+			X->computeFloatFeatures();
+		X->computeEdgeKernels();
 
 		// construct ImgLabeling
 		LabelGraph labelGraph;
-		labelGraph.adjList = edges;
+		labelGraph.adjList = featureGraph.adjList; // share graph structure
 		labelGraph.nodesData = labels;
 		Y = new ImgLabeling();
 		Y->graph = labelGraph;
@@ -223,7 +223,7 @@ namespace HCSearch
 						{
 							int nodeIndex = lineIndex-1;
 							int classIndex = Global::settings->CLASSES.getClassIndex(labelOrderFound[columnIndex-1]);
-							Y.confidences(nodeIndex, classIndex) = atof(token.c_str());
+							Y.confidences.mutate()(nodeIndex, classIndex) = atof(token.c_str());
 						}
 						columnIndex++;
 					}
@@ -232,6 +232,10 @@ namespace HCSearch
 				lineIndex++;
 			}
 			fh.close();
+
+			// confidences are fixed from now on, so sort the labels of every node once
+			if (Y.confidencesAvailable)
+				Y.confidences.computeClassOrder();
 		}
 		else
 		{
@@ -243,11 +247,11 @@ namespace HCSearch
 	bool LogRegInit::hasForegroundNeighbors(ImgLabeling& Y, int node)
 	{
 		int nodeLabel = Y.getLabel(node);
-		NeighborSet_t neighbors = Y.graph.adjList[node];
+		NeighborRange neighbors = Y.graph.adjList.neighbors(node);
 
 		bool hasNeighbors = false;
 
-		for (NeighborSet_t::iterator it = neighbors.begin(); it != neighbors.end(); ++it)
+		for (NeighborRange::const_iterator it = neighbors.begin(); it != neighbors.end(); ++it)
 		{
 			int neighborNode = *it;
 			int neighborLabel = Y.getLabel(neighborNode);
@@ -294,6 +298,8 @@ namespace HCSearch
 				satisfied = true;
 				for (int node1 = 0; node1 < numNodes && satisfied; node1++)
 				{
+					vector<int> node1ConfidentLabels = Y.getLabelsByConfidence(node1);
+
 					for (int node2 = 0; node2 < numNodes && satisfied; node2++)
 					{
 						if (node1 == node2)
@@ -310,8 +316,6 @@ namespace HCSearch
 						double nodeLocationY2 = X.getNodeLocationY(node2);
 						int nodeLabel2 = Y.getLabel(node2);
 
-						vector<int> node1ConfidentLabels = Y.getLabelsByConfidence(node1);
-
 						if (nodeLabel1 != nodeLabel2)
 						{
 							if (nodeLocationX1 < nodeLocationX2)
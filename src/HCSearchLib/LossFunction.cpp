@@ -3,6 +3,21 @@
 
 namespace HCSearch
 {
+	/**************** Search Space Function Abstract Definitions ****************/
+
+	double ILossFunction::computeLoss(ImgCandidate& YCandidate, const ImgLabeling& YTruth)
+	{
+		if (!YCandidate.isDelta())
+			return computeLoss(YCandidate.labeling, YTruth);
+
+		ImgLabeling& YPred = *YCandidate.parent;
+		YCandidate.apply(YPred);
+		double loss = computeLoss(YPred, YTruth);
+		YCandidate.revert(YPred);
+
+		return loss;
+	}
+
 	/**************** Loss Functions ****************/
 
 	HammingLoss::HammingLoss()
@@ -19,6 +19,14 @@ namespace HCSearch
 		 * @brief Compute loss.
 		 */
 		virtual double computeLoss(ImgLabeling& YPred, const ImgLabeling& YTruth)=0;
+
+		/*!
+		 * @brief Compute loss of a successor candidate.
+		 * 
+		 * Delta candidates are applied to their parent labeling in place 
+		 * and reverted afterwards, so the labeling is never copied.
+		 */
+		virtual double computeLoss(ImgCandidate& YCandidate, const ImgLabeling& YTruth);
 	};
 
 	/**************** Loss Functions ****************/
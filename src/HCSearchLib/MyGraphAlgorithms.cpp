@@ -62,71 +62,99 @@ namespace MyGraphAlgorithms
 		return r;
 	}
 
-	/**************** Connected Components ****************/
+	/**************** Node Partition ****************/
 
-	ConnectedComponent::ConnectedComponent()
+	NodePartition::NodePartition()
 	{
 	}
 
-	ConnectedComponent::ConnectedComponent(ConnectedComponentSet* ccSet)
+	NodePartition::NodePartition(const vector<int>& nodeKeys, int numKeys)
 	{
-		this->ccSet = ccSet;
+		const int numNodes = nodeKeys.size();
+		this->parts.resize(numNodes);
+
+		// number parts in increasing order of their smallest node
+		vector<int> keyParts(numKeys, -1);
+		int numParts = 0;
+		for (int node = 0; node < numNodes; node++)
+		{
+			if (keyParts[nodeKeys[node]] == -1)
+				keyParts[nodeKeys[node]] = numParts++;
+		}
+
+		// counting sort of the nodes by part
+		this->offsets.assign(numParts+1, 0);
+		for (int node = 0; node < numNodes; node++)
+		{
+			this->parts[node] = keyParts[nodeKeys[node]];
+			this->offsets[this->parts[node]+1]++;
+		}
+		for (int part = 0; part < numParts; part++)
+			this->offsets[part+1] += this->offsets[part];
+
+		this->members.resize(numNodes);
+		vector<int> positions(this->offsets.begin(), this->offsets.end()-1);
+		for (int node = 0; node < numNodes; node++)
+			this->members[positions[this->parts[node]]++] = node;
 	}
 
-	ConnectedComponent::~ConnectedComponent()
+	NodePartition::~NodePartition()
 	{
 	}
 
-	int ConnectedComponent::size()
+	int NodePartition::numParts() const
 	{
-		return this->nodes.size();
+		return this->offsets.empty() ? 0 : this->offsets.size()-1;
 	}
 
-	set<int> ConnectedComponent::getNodes()
+	NodeRange NodePartition::getNodes(int part) const
 	{
-		return this->nodes;
+		const int* first = this->members.empty() ? NULL : &this->members[0];
+		return NodeRange(first + this->offsets[part], first + this->offsets[part+1]);
 	}
 
-	void ConnectedComponent::addNode(int node)
+	/**************** Connected Components ****************/
+
+	ConnectedComponent::ConnectedComponent()
 	{
-		this->nodes.insert(node);
-		this->label = this->ccSet->getOriginalLabeling().getLabel(node);
+		this->arena = NULL;
+		this->index = -1;
 	}
 
-	int ConnectedComponent::getLabel()
+	ConnectedComponent::ConnectedComponent(ComponentArena* arena, int index)
 	{
-		return this->label;
+		this->arena = arena;
+		this->index = index;
 	}
 
-	set<int> ConnectedComponent::getNeighborLabels()
+	ConnectedComponent::~ConnectedComponent()
 	{
-		set<int> labels;
-		labels.insert(this->label);
+	}
 
-		HCSearch::ImgLabeling original = this->ccSet->getOriginalLabeling();
+	int ConnectedComponent::size()
+	{
+		return getNodes().size();
+	}
 
-		// get nodes in connected component
-		for (set<int>::iterator it = nodes.begin(); it != nodes.end(); ++it)
-		{
-			int node1 = *it;
+	NodeRange ConnectedComponent::getNodes()
+	{
+		return this->arena->components.getNodes(this->index);
+	}
 
-			// get neighbors
-			set<int> neighborLabels = original.getNeighborLabels(node1);
-			for (set<int>::iterator it2 = neighborLabels.begin(); 
-				it2 != neighborLabels.end(); ++it2)
-			{
-				labels.insert(*it2);
-			}
-		}
+	int ConnectedComponent::getLabel()
+	{
+		return this->arena->componentLabels[this->index];
+	}
 
-		labels.erase(this->label);
-		return labels;
+	set<int> ConnectedComponent::getNeighborLabels()
+	{
+		return this->arena->getNeighborLabels(this->index);
 	}
 
 	set<int> ConnectedComponent::getTopConfidentLabels(int K)
 	{
 		// check if confidences are available
-		HCSearch::ImgLabeling original = this->ccSet->getOriginalLabeling();
+		HCSearch::ImgLabeling& original = this->arena->original;
 		const int numLabels = original.confidences.cols();
 		if (!original.confidencesAvailable)
 		{
@@ -149,255 +177,193 @@ namespace MyGraphAlgorithms
 			HCSearch::abort();
 		}
 
-		//set<int> labels;
-		//labels.insert(this->label);
-
-		//// get nodes in connected component and recompute label distribution
-		//int numNodes = 0;
-		//VectorXd labelDist = VectorXd::Zero(numLabels);
-		//for (set<int>::iterator it = nodes.begin(); it != nodes.end(); ++it)
-		//{
-		//	int node1 = *it;
-
-		//	labelDist += original.confidences.row(node1);
-		//	numNodes++;
-		//}
-		//if (numNodes == 0)
-		//{
-		//	LOG(ERROR) << "connected component contains no nodes";
-		//	HCSearch::abort();
-		//}
-		//labelDist /= numNodes;
-
-		//// get top K confident labels
-		//HCSearch::LabelConfidencePQ sortedByConfidence;
-		//for (int i = 0; i < numLabels; i++)
-		//{
-		//	int label = HCSearch::Global::settings->CLASSES.getClassLabel(i);
-		//	double confidence = labelDist(i);
-		//	sortedByConfidence.push(MyPrimitives::Pair<int, double>(label, confidence));
-		//}
-		//for (int i = 0; i < K; i++)
-		//{
-		//	MyPrimitives::Pair<int, double> p = sortedByConfidence.top();
-		//	sortedByConfidence.pop();
-		//	labels.insert(p.first);
-		//}
-
-		//labels.erase(this->label);
-		//return labels;
-
 		set<int> labels;
-		labels.insert(this->label);
 
 		// get nodes in connected component
-		for (set<int>::iterator it = nodes.begin(); it != nodes.end(); ++it)
+		NodeRange nodes = getNodes();
+		for (NodeRange::const_iterator it = nodes.begin(); it != nodes.end(); ++it)
 		{
-			int node1 = *it;
-
 			// get top K confident labels
-			HCSearch::LabelConfidencePQ sortedByConfidence;
-			for (int i = 0; i < numLabels; i++)
-			{
-				int label = HCSearch::Global::settings->CLASSES.getClassLabel(i);
-				double confidence = original.confidences(node1, i);
-				sortedByConfidence.push(MyPrimitives::Pair<int, double>(label, confidence));
-			}
-			for (int i = 0; i < K; i++)
-			{
-				MyPrimitives::Pair<int, double> p = sortedByConfidence.top();
-				sortedByConfidence.pop();
-				labels.insert(p.first);
-			}
+			set<int> nodeLabels = original.getTopConfidentLabels(*it, K);
+			labels.insert(nodeLabels.begin(), nodeLabels.end());
 		}
 
-		labels.erase(this->label);
+		labels.erase(getLabel());
 		return labels;
 	}
 
 	bool ConnectedComponent::hasNeighbors()
 	{
-		bool hasNeighbors = false;
-
-		HCSearch::ImgLabeling original = this->ccSet->getOriginalLabeling();
-
-		// get nodes in connected component
-		for (set<int>::iterator it = nodes.begin(); it != nodes.end(); ++it)
-		{
-			int node1 = *it;
-			
-			// get neighbors
-			set<int> neighbors = original.graph.adjList[node1];
-			set<int> uniqueNeighbors;
-
-			// find left overs to see if "outside" neighbors of connected component exist
-			set_difference(neighbors.begin(), neighbors.end(), 
-				nodes.begin(), nodes.end(), 
-				inserter(uniqueNeighbors, uniqueNeighbors.end()));
-
-			if (!uniqueNeighbors.empty())
-			{
-				hasNeighbors = true;
-				break;
-			}
-		}
-
-		return hasNeighbors;
+		return this->arena->componentHasNeighbors[this->index];
 	}
 
-	/**************** Connected Component Set ****************/
-	
-	ConnectedComponentSet::ConnectedComponentSet()
-	{
-	}
+	/**************** Component Arena ****************/
 
-	ConnectedComponentSet::ConnectedComponentSet(HCSearch::ImgLabeling& labeling)
+	ComponentArena::ComponentArena(HCSearch::ImgLabeling& labeling, const vector<int>* nodeSubgraphs)
 	{
-		this->connectedComponents = vector< ConnectedComponent* >();
 		this->original = labeling;
 
 		const int numNodes = this->original.getNumNodes();
 
-		int numForeground = 0;
-		ConnectedComponent* foregroundCC = NULL;
+		// first pass: components of the labeling, kept up to date during search
+		shared_ptr< const HCSearch::LabelComponents > labelComponents = this->original.getLabelComponents();
+		const vector<int>& nodeComponents = labelComponents->nodeComponents;
+		const int numComponentIds = labelComponents->numComponentIds();
 
-		// first pass: union-find
-		DisjointSet ds = DisjointSet(numNodes);
-		for (int node1 = 0; node1 < numNodes; node1++)
+		if (nodeSubgraphs == NULL)
 		{
-			if (!this->original.hasNeighbors(node1))
-				continue;
-
-			// get neighbors (ending nodes) of starting node
-			set<int> neighbors = this->original.getNeighbors(node1);
-			for (set<int>::iterator it2 = neighbors.begin(); it2 != neighbors.end(); ++it2)
+			this->components = NodePartition(nodeComponents, numComponentIds);
+		}
+		else
+		{
+			// components inside one subgraph stay whole
+			vector<int> componentSubgraphs(numComponentIds, -1);
+			vector<bool> splitComponents(numComponentIds, false);
+			for (int node = 0; node < numNodes; node++)
 			{
-				int node2 = *it2;
+				int component = nodeComponents[node];
+				if (componentSubgraphs[component] == -1)
+					componentSubgraphs[component] = (*nodeSubgraphs)[node];
+				else if (componentSubgraphs[component] != (*nodeSubgraphs)[node])
+					splitComponents[component] = true;
+			}
 
-				// get labels
-				int nodeLabel1 = this->original.getLabel(node1);
-				int nodeLabel2 = this->original.getLabel(node2);
+			// second pass: union-find over the edges of split components inside subgraphs
+			DisjointSet ds = DisjointSet(numNodes);
+			for (int node1 = 0; node1 < numNodes; node1++)
+			{
+				int component = nodeComponents[node1];
+				if (!splitComponents[component])
+					continue;
 
-				if (nodeLabel1 == nodeLabel2)
+				HCSearch::NeighborRange neighbors = this->original.graph.adjList.neighbors(node1);
+				for (HCSearch::NeighborRange::const_iterator it = neighbors.begin(); it != neighbors.end(); ++it)
 				{
-					ds.Union(node1, node2);
+					int node2 = *it;
+
+					// same component means same label
+					if (nodeComponents[node2] == component && (*nodeSubgraphs)[node1] == (*nodeSubgraphs)[node2])
+					{
+						ds.Union(node1, node2);
+					}
 				}
 			}
-		}
-
-		// second pass: write to output labeling, record components
-
-		map< int, ConnectedComponent* > ccs; // node index -> cc
 
-		for (int node = 0; node < numNodes; node++)
-		{
-			int index = ds.FindSet(node);
-
-			// record connected components
-			if (ccs.count(index) == 0)
+			vector<int> nodeKeys(numNodes);
+			for (int node = 0; node < numNodes; node++)
 			{
-				ccs[index] = new ConnectedComponent(this);
-
-				if (!HCSearch::Global::settings->CLASSES.classLabelIsBackground(this->original.getLabel(node)))
-				{
-					numForeground++;
-					foregroundCC = ccs[index];
-				}
+				int component = nodeComponents[node];
+				nodeKeys[node] = splitComponents[component] ? numComponentIds + ds.FindSet(node) : component;
 			}
-			ccs[index]->addNode(node);
+			this->components = NodePartition(nodeKeys, numComponentIds + numNodes);
 		}
 
-		// add to list of connected components
-
-		for (map< int, ConnectedComponent* >::iterator it = ccs.begin(); it != ccs.end(); ++it)
+		const int numComponents = this->components.numParts();
+		this->componentLabels.resize(numComponents);
+		this->componentForeground.resize(numComponents);
+		this->componentHasNeighbors.assign(numComponents, false);
+		this->connectedComponents.resize(numComponents);
+		for (int component = 0; component < numComponents; component++)
 		{
-			ConnectedComponent* cc = it->second;
-			this->connectedComponents.push_back(cc);
+			int label = this->original.getLabel(this->components.members[this->components.offsets[component]]);
+			this->componentLabels[component] = label;
+			this->componentForeground[component] = !HCSearch::Global::settings->CLASSES.classLabelIsBackground(label);
+			this->connectedComponents[component] = ConnectedComponent(this, component);
 		}
 
-		if (numForeground == 1)
+		// label bits for the labels present in the labeling
+		int minLabel = 0;
+		int maxLabel = -1;
+		for (int node = 0; node < numNodes; node++)
 		{
-			this->exactlyOnePositiveCC = true;
-			this->foreground = foregroundCC;
+			int label = this->original.getLabel(node);
+			if (node == 0 || label < minLabel)
+				minLabel = label;
+			if (node == 0 || label > maxLabel)
+				maxLabel = label;
 		}
-		else
+
+		vector<int> labelBits(maxLabel-minLabel+1, -1);
+		for (int node = 0; node < numNodes; node++)
+			labelBits[this->original.getLabel(node)-minLabel] = 0;
+		for (int label = minLabel; label <= maxLabel; label++)
 		{
-			this->exactlyOnePositiveCC = false;
-			this->foreground = NULL;
+			if (labelBits[label-minLabel] == 0)
+			{
+				labelBits[label-minLabel] = this->labelValues.size();
+				this->labelValues.push_back(label);
+			}
 		}
-	}
 
-	ConnectedComponentSet::ConnectedComponentSet(Subgraph* subgraph)
-	{
-		this->connectedComponents = vector< ConnectedComponent* >();
-		this->original = subgraph->getOriginalLabeling();
-
-		const int numNodes = this->original.getNumNodes();
-
-		int numForeground = 0;
-		ConnectedComponent* foregroundCC = NULL;
-
-		// first pass: union-find
-		DisjointSet ds = DisjointSet(numNodes);
-		set<int> subNodes = subgraph->getNodes();
-		for (set<int>::iterator it = subNodes.begin(); it != subNodes.end(); ++it)
+		// last pass: neighbor labels
+		const int bitsPerWord = 8*sizeof(unsigned long long);
+		this->labelWords = (this->labelValues.size() + bitsPerWord - 1)/bitsPerWord;
+		this->neighborLabelBits.assign(numComponents*this->labelWords, 0);
+		for (int node1 = 0; node1 < numNodes; node1++)
 		{
-			// only consider nodes in the subgraph
-			int node1 = *it;
-
-			if (!this->original.hasNeighbors(node1))
-				continue;
+			int component1 = this->components.parts[node1];
+			unsigned long long* bits = &this->neighborLabelBits[component1*this->labelWords];
 
-			// get neighbors (ending nodes) of starting node
-			set<int> neighbors = this->original.getNeighbors(node1);
-			for (set<int>::iterator it2 = neighbors.begin(); it2 != neighbors.end(); ++it2)
+			HCSearch::NeighborRange neighbors = this->original.graph.adjList.neighbors(node1);
+			for (HCSearch::NeighborRange::const_iterator it = neighbors.begin(); it != neighbors.end(); ++it)
 			{
-				int node2 = *it2;
-
-				if (subNodes.count(node2) == 0)
-					continue;
-
-				// get labels
-				int nodeLabel1 = this->original.getLabel(node1);
-				int nodeLabel2 = this->original.getLabel(node2);
+				int node2 = *it;
+				int bit = labelBits[this->original.getLabel(node2)-minLabel];
+				bits[bit/bitsPerWord] |= 1ULL << (bit%bitsPerWord);
 
-				if (nodeLabel1 == nodeLabel2)
-				{
-					ds.Union(node1, node2);
-				}
+				if (this->components.parts[node2] != component1)
+					this->componentHasNeighbors[component1] = true;
 			}
 		}
+	}
 
-		// second pass: write to output labeling, record components
+	ComponentArena::~ComponentArena()
+	{
+	}
 
-		map< int, ConnectedComponent* > ccs; // node index -> cc
+	set<int> ComponentArena::getNeighborLabels(int component) const
+	{
+		const int bitsPerWord = 8*sizeof(unsigned long long);
+		const unsigned long long* bits = &this->neighborLabelBits[component*this->labelWords];
 
-		for (set<int>::iterator it = subNodes.begin(); it != subNodes.end(); ++it)
+		set<int> labels;
+		for (int bit = 0; bit < static_cast<int>(this->labelValues.size()); bit++)
 		{
-			// only consider nodes in the subgraph
-			int node = *it;
-			int index = ds.FindSet(node);
+			if (bits[bit/bitsPerWord] & (1ULL << (bit%bitsPerWord)))
+				labels.insert(labels.end(), this->labelValues[bit]);
+		}
 
-			// record connected components
-			if (ccs.count(index) == 0)
-			{
-				ccs[index] = new ConnectedComponent(this);
+		labels.erase(this->componentLabels[component]);
+		return labels;
+	}
 
-				if (!HCSearch::Global::settings->CLASSES.classLabelIsBackground(this->original.getLabel(node)))
-				{
-					numForeground++;
-					foregroundCC = ccs[index];
-				}
-			}
-			ccs[index]->addNode(node);
-		}
+	/**************** Connected Component Set ****************/
+	
+	ConnectedComponentSet::ConnectedComponentSet()
+	{
+		this->arena = NULL;
+		this->exactlyOnePositiveCC = false;
+		this->foreground = NULL;
+	}
 
-		// add to list of connected components
+	ConnectedComponentSet::ConnectedComponentSet(HCSearch::ImgLabeling& labeling)
+	{
+		this->arena = new ComponentArena(labeling, NULL);
+
+		int numForeground = 0;
+		ConnectedComponent* foregroundCC = NULL;
 
-		for (map< int, ConnectedComponent* >::iterator it = ccs.begin(); it != ccs.end(); ++it)
+		// add to list of connected components
+		const int numComponents = this->arena->components.numParts();
+		this->connectedComponents.resize(numComponents);
+		for (int component = 0; component < numComponents; component++)
 		{
-			ConnectedComponent* cc = it->second;
-			this->connectedComponents.push_back(cc);
+			this->connectedComponents[component] = &this->arena->connectedComponents[component];
+			if (this->arena->componentForeground[component])
+			{
+				numForeground++;
+				foregroundCC = this->connectedComponents[component];
+			}
 		}
 
 		if (numForeground == 1)
@@ -414,11 +380,7 @@ namespace MyGraphAlgorithms
 
 	ConnectedComponentSet::~ConnectedComponentSet()
 	{
-		for (vector< ConnectedComponent* >::iterator it = connectedComponents.begin(); it != connectedComponents.end(); ++it)
-		{
-			ConnectedComponent* cc = *it;
-			delete cc;
-		}
+		delete this->arena;
 	}
 
 	int ConnectedComponentSet::size()
@@ -426,9 +388,9 @@ namespace MyGraphAlgorithms
 		return this->connectedComponents.size();
 	}
 
-	HCSearch::ImgLabeling ConnectedComponentSet::getOriginalLabeling()
+	HCSearch::ImgLabeling& ConnectedComponentSet::getOriginalLabeling()
 	{
-		return this->original;
+		return this->arena->original;
 	}
 
 	vector< ConnectedComponent* > ConnectedComponentSet::getConnectedComponents()
@@ -446,70 +408,71 @@ namespace MyGraphAlgorithms
 	Subgraph::Subgraph()
 	{
 		this->subgraphSet = NULL;
+		this->index = -1;
+		this->numForeground = 0;
 	}
 
-	Subgraph::Subgraph(SubgraphSet* subgraphSet)
+	Subgraph::Subgraph(SubgraphSet* subgraphSet, int index)
 	{
 		this->subgraphSet = subgraphSet;
+		this->index = index;
+		this->numForeground = 0;
 	}
 
 	Subgraph::~Subgraph()
 	{
-		delete connectedComponents;
 	}
 
 	int Subgraph::size()
 	{
-		return this->nodes.size();
+		return getNodes().size();
 	}
 
-	set<int> Subgraph::getNodes()
+	NodeRange Subgraph::getNodes()
 	{
-		return this->nodes;
+		return this->subgraphSet->getSubgraphNodes(this->index);
 	}
 
-	void Subgraph::addNode(int node)
+	void Subgraph::addConnectedComponent(ConnectedComponent* cc, bool isForeground)
 	{
-		this->nodes.insert(node);
+		this->connectedComponents.push_back(cc);
+		if (isForeground)
+			this->numForeground++;
 	}
 
-	void Subgraph::processConnectedComponents()
-	{
-		this->connectedComponents = new ConnectedComponentSet(this);
-	}
-
-	HCSearch::ImgLabeling Subgraph::getOriginalLabeling()
+	HCSearch::ImgLabeling& Subgraph::getOriginalLabeling()
 	{
 		return this->subgraphSet->getOriginalLabeling();
 	}
 
 	vector< ConnectedComponent* > Subgraph::getConnectedComponents()
 	{
-		return this->connectedComponents->getConnectedComponents();
+		return this->connectedComponents;
 	}
 
 	bool Subgraph::hasExactlyOnePositiveCC()
 	{
-		return this->connectedComponents->hasExactlyOnePositiveCC();
+		return this->numForeground == 1;
 	}
 
 	/**************** Subgraph Set ****************/
 
 	SubgraphSet::SubgraphSet()
 	{
+		this->arena = NULL;
 	}
 
-	SubgraphSet::SubgraphSet(HCSearch::ImgLabeling& labeling, map< int, set<int> > cuts)
+	SubgraphSet::SubgraphSet(HCSearch::ImgLabeling& labeling, const map< int, set<int> >& cuts)
 	{
 		constructorHelper(labeling, cuts);
 	}
 
-	SubgraphSet::SubgraphSet(HCSearch::ImgLabeling& labeling, map< MyPrimitives::Pair<int, int>, bool > cuts)
+	SubgraphSet::SubgraphSet(HCSearch::ImgLabeling& labeling, const map< MyPrimitives::Pair<int, int>, bool >& cuts)
 	{
 		map< int, set<int> > cutsConverted;
 
 		// convert cuts to format
-		for (map< MyPrimitives::Pair<int, int>, bool >::iterator it = cuts.begin(); it != cuts.end(); ++it)
+		for (map< MyPrimitives::Pair<int, int>, bool >::const_iterator it = cuts.begin(); it != cuts.end(); ++it)
 		{
 			// if not cut
 			if (!it->second)
@@ -518,10 +481,6 @@ namespace MyGraphAlgorithms
 				int node1 = edge.first;
 				int node2 = edge.second;
 
-				if (cutsConverted.count(node1) == 0)
-				{
-					cutsConverted[node1] = set<int>();
-				}
 				cutsConverted[node1].insert(node2);
 			}
 		}
@@ -531,17 +490,12 @@ namespace MyGraphAlgorithms
 
 	SubgraphSet::~SubgraphSet()
 	{
-		for (vector< Subgraph* >::iterator it = subgraphs.begin(); it != subgraphs.end(); ++it)
-		{
-			Subgraph* sub = *it;
-			delete sub;
-		}
+		delete this->arena;
 	}
 
-	void SubgraphSet::constructorHelper(HCSearch::ImgLabeling& labeling, map< int, set<int> > cuts)
+	void SubgraphSet::constructorHelper(HCSearch::ImgLabeling& labeling, const map< int, set<int> >& cuts)
 	{
 		this->cuts = cuts;
-		this->original = labeling;
 
 		// determine subgraphs
 
@@ -549,46 +503,52 @@ namespace MyGraphAlgorithms
 
 		// first pass: union-find
 		DisjointSet ds = DisjointSet(numNodes);
-		for (int node1 = 0; node1 < numNodes; node1++)
+		for (map< int, set<int> >::const_iterator it = cuts.begin(); it != cuts.end(); ++it)
 		{
-			if (cuts.count(node1) == 0)
+			int node1 = it->first;
+			if (node1 < 0 || node1 >= numNodes)
 				continue;
 
 			// get neighbors (ending nodes) of starting node
-			set<int> neighbors = cuts[node1];
-			for (set<int>::iterator it = neighbors.begin(); it != neighbors.end(); ++it)
+			for (set<int>::const_iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2)
 			{
-				int node2 = *it;
+				int node2 = *it2;
 
 				// automatically union-find neighbors
 				ds.Union(node1, node2);
 			}
 		}
 
-		// second pass: write to output labeling, record components
-
-		map< int, Subgraph* > subgraphs; // node index -> subgraph
+		// second pass: record subgraphs and their connected components
 
+		vector<int> nodeRoots(numNodes);
 		for (int node = 0; node < numNodes; node++)
-		{
-			int index = ds.FindSet(node);
+			nodeRoots[node] = ds.FindSet(node);
 
-			// record subgraphs
-			if (subgraphs.count(index) == 0)
-			{
-				subgraphs[index] = new Subgraph(this);
-			}
-			subgraphs[index]->addNode(node);
+		this->subgraphPartition = NodePartition(nodeRoots, numNodes);
+		this->arena = new ComponentArena(labeling, &this->subgraphPartition.parts);
+
+		const int numSubgraphs = this->subgraphPartition.numParts();
+		this->subgraphStore.clear();
+		this->subgraphStore.reserve(numSubgraphs);
+		for (int subgraph = 0; subgraph < numSubgraphs; subgraph++)
+			this->subgraphStore.push_back(Subgraph(this, subgraph));
+
+		const int numComponents = this->arena->components.numParts();
+		for (int component = 0; component < numComponents; component++)
+		{
+			int subgraph = this->subgraphPartition.parts[*this->arena->components.getNodes(component).begin()];
+			this->subgraphStore[subgraph].addConnectedComponent(&this->arena->connectedComponents[component], 
+				this->arena->componentForeground[component]);
 		}
 
 		// add to list of subgraphs
 
-		this->subgraphs = vector< Subgraph* >();
-		for (map< int, Subgraph* >::iterator it = subgraphs.begin(); it != subgraphs.end(); ++it)
+		this->subgraphs.resize(numSubgraphs);
+		for (int subgraph = 0; subgraph < numSubgraphs; subgraph++)
 		{
-			Subgraph* sub = it->second;
-			sub->processConnectedComponents();
-			this->subgraphs.push_back(sub);
+			Subgraph* sub = &this->subgraphStore[subgraph];
+			this->subgraphs[subgraph] = sub;
 
 			if (sub->hasExactlyOnePositiveCC())
 			{
@@ -602,9 +562,14 @@ namespace MyGraphAlgorithms
 		return this->subgraphs.size();
 	}
 
-	HCSearch::ImgLabeling SubgraphSet::getOriginalLabeling()
+	HCSearch::ImgLabeling& SubgraphSet::getOriginalLabeling()
 	{
-		return this->original;
+		return this->arena->original;
+	}
+
+	NodeRange SubgraphSet::getSubgraphNodes(int subgraph)
+	{
+		return this->subgraphPartition.getNodes(subgraph);
 	}
 
 	vector< Subgraph* > SubgraphSet::getSubgraphs()
@@ -612,7 +577,7 @@ namespace MyGraphAlgorithms
 		return this->subgraphs;
 	}
 
-	map< int, set<int> > SubgraphSet::getCuts()
+	HCSearch::SharedAdjList SubgraphSet::getCuts()
 	{
 		return this->cuts;
 	}
@@ -621,4 +586,122 @@ namespace MyGraphAlgorithms
 	{
 		return this->exactlyOnePositiveCCSubgraphs;
 	}
+
+	/**************** Cut Threshold Sweep ****************/
+
+	CutThresholdSweep::CutThresholdSweep(HCSearch::ImgLabeling& labeling)
+	{
+		const int numNodes = labeling.getNumNodes();
+
+		this->foregroundNodes.resize(numNodes);
+		this->sameLabelEdges.resize(numNodes);
+		for (int node1 = 0; node1 < numNodes; node1++)
+		{
+			int nodeLabel1 = labeling.getLabel(node1);
+			this->foregroundNodes[node1] = !HCSearch::Global::settings->CLASSES.classLabelIsBackground(nodeLabel1);
+
+			// same-label edges join connected components once both nodes are in one subgraph
+			HCSearch::NeighborRange neighbors = labeling.graph.adjList.neighbors(node1);
+			for (HCSearch::NeighborRange::const_iterator it = neighbors.begin(); it != neighbors.end(); ++it)
+			{
+				int node2 = *it;
+				if (labeling.getLabel(node2) == nodeLabel1)
+				{
+					this->sameLabelEdges[node1].push_back(node1);
+					this->sameLabelEdges[node1].push_back(node2);
+				}
+			}
+		}
+
+		reset();
+	}
+
+	CutThresholdSweep::~CutThresholdSweep()
+	{
+	}
+
+	void CutThresholdSweep::reset()
+	{
+		const int numNodes = this->foregroundNodes.size();
+
+		this->subgraphSets = DisjointSet(numNodes);
+		this->componentSets = DisjointSet(numNodes);
+		this->pendingEdges = this->sameLabelEdges;
+		this->numForeground.assign(numNodes, 0);
+		this->numGoodSubgraphs = 0;
+
+		// every node starts as its own subgraph and connected component
+		for (int node = 0; node < numNodes; node++)
+		{
+			if (this->foregroundNodes[node])
+			{
+				this->numForeground[node] = 1;
+				this->numGoodSubgraphs++;
+			}
+		}
+	}
+
+	void CutThresholdSweep::keepEdge(int node1, int node2)
+	{
+		int root1 = this->subgraphSets.FindSet(node1);
+		int root2 = this->subgraphSets.FindSet(node2);
+		if (root1 == root2)
+			return;
+
+		if (this->numForeground[root1] == 1)
+			this->numGoodSubgraphs--;
+		if (this->numForeground[root2] == 1)
+			this->numGoodSubgraphs--;
+
+		this->subgraphSets.Union(root1, root2);
+		int root = this->subgraphSets.FindSet(root1);
+		int numForegroundMerged = this->numForeground[root1] + this->numForeground[root2];
+
+		// scan the smaller list of pending edges; the edges between the two subgraphs 
+		// are stored at both ends, so each is found from the smaller side
+		vector<int> smallerPending;
+		vector<int> largerPending;
+		if (this->pendingEdges[root1].size() < this->pendingEdges[root2].size())
+		{
+			smallerPending.swap(this->pendingEdges[root1]);
+			largerPending.swap(this->pendingEdges[root2]);
+		}
+		else
+		{
+			smallerPending.swap(this->pendingEdges[root2]);
+			largerPending.swap(this->pendingEdges[root1]);
+		}
+
+		for (size_t i = 0; i < smallerPending.size(); i += 2)
+		{
+			int nodeA = smallerPending[i];
+			int nodeB = smallerPending[i+1];
+			if (this->subgraphSets.FindSet(nodeB) != root)
+			{
+				largerPending.push_back(nodeA);
+				largerPending.push_back(nodeB);
+				continue;
+			}
+
+			// both nodes are now in the same subgraph: join their connected components
+			int componentA = this->componentSets.FindSet(nodeA);
+			int componentB = this->componentSets.FindSet(nodeB);
+			if (componentA != componentB)
+			{
+				this->componentSets.Union(componentA, componentB);
+				if (this->foregroundNodes[nodeA])
+					numForegroundMerged--;
+			}
+		}
+
+		this->pendingEdges[root].swap(largerPending);
+		this->numForeground[root] = numForegroundMerged;
+		if (numForegroundMerged == 1)
+			this->numGoodSubgraphs++;
+	}
+
+	int CutThresholdSweep::getNumGoodSubgraphs()
+	{
+		return this->numGoodSubgraphs;
+	}
 }
\ No newline at end of file
@@ -14,6 +14,7 @@ using namespace std;
 namespace MyGraphAlgorithms
 {
 	class ConnectedComponent;
+	class ComponentArena;
 	class ConnectedComponentSet;
 	class Subgraph;
 	class SubgraphSet;
@@ -43,21 +44,65 @@ namespace MyGraphAlgorithms
 		int FindSet(int i);
 	};
 
+	/**************** Node Partition ****************/
+
+	/*!
+	 * Contiguous range of nodes in a partition.
+	 */
+	typedef HCSearch::NeighborRange NodeRange;
+
+	/*!
+	 * @brief Flat partition of nodes.
+	 * 
+	 * Parts are numbered in increasing order of their smallest node. 
+	 * The nodes of part p are members[offsets[p]] to members[offsets[p+1]-1], 
+	 * in increasing order.
+	 */
+	class NodePartition
+	{
+	public:
+		vector<int> parts; //!< Node -> part
+		vector<int> offsets; //!< Part -> first position in members
+		vector<int> members; //!< Nodes grouped by part
+
+		NodePartition();
+
+		/*!
+		 * @brief Construct from a key per node in linear time. Nodes with the same key form a part.
+		 * @param[in] nodeKeys Node -> key in [0, numKeys)
+		 * @param[in] numKeys Number of keys
+		 */
+		NodePartition(const vector<int>& nodeKeys, int numKeys);
+
+		~NodePartition();
+
+		/*!
+		 * @brief Get the number of parts.
+		 */
+		int numParts() const;
+
+		/*!
+		 * @brief Get the nodes of a part.
+		 */
+		NodeRange getNodes(int part) const;
+	};
+
 	/**************** Connected Components ****************/
 
 	/*!
 	 * @brief Connected component contains nodes of the same label.
+	 * 
+	 * Refers to a component of a %ComponentArena.
 	 */
 	class ConnectedComponent
 	{
 	private:
-		set<int> nodes;
-		int label;
-		ConnectedComponentSet* ccSet;
+		ComponentArena* arena;
+		int index;
 
 	public:
 		ConnectedComponent();
-		ConnectedComponent(ConnectedComponentSet* ccSet);
+		ConnectedComponent(ComponentArena* arena, int index);
 		~ConnectedComponent();
 
 		/*!
@@ -66,14 +111,9 @@ namespace MyGraphAlgorithms
 		int size();
 
 		/*!
-		 * @brief Get the nodes in the connected component.
-		 */
-		set<int> getNodes();
-
-		/*!
-		 * @brief Add a node into the connected component.
+		 * @brief Get the nodes in the connected component (not copied).
 		 */
-		void addNode(int node);
+		NodeRange getNodes();
 
 		/*!
 		 * @brief Get the label of the connected component.
@@ -96,18 +136,58 @@ namespace MyGraphAlgorithms
 		bool hasNeighbors();
 	};
 
-	/**************** Connected Component Set ****************/
+	/**************** Component Arena ****************/
 
 	/*!
-	 * @brief Connected component set contains a set of connected components.
+	 * @brief Same-label connected components of a labeling in flat arrays.
+	 * 
+	 * Holds the only copy of the labeling. Connected components and subgraphs 
+	 * refer to it and to their nodes without copying. The neighbor labels of 
+	 * each component are a bitset over the labels present in the labeling. 
 	 * 
-	 * Can construct from a labeling or a subgraph.
+	 * Built from the components of the labeling (HCSearch::LabelComponents), 
+	 * so only components split by subgraphs are recomputed.
+	 */
+	class ComponentArena
+	{
+	public:
+		HCSearch::ImgLabeling original; //!< Labeling the components were found in
+		NodePartition components; //!< Node -> component and component -> nodes
+		vector<int> componentLabels; //!< Component -> label
+		vector<bool> componentForeground; //!< Component -> true if foreground
+		vector<bool> componentHasNeighbors; //!< Component -> true if adjacent to a node outside it
+
+		vector<int> labelValues; //!< Label bit -> label, in increasing order
+		int labelWords; //!< Words per neighbor label bitset
+		vector<unsigned long long> neighborLabelBits; //!< Component -> bitset of neighbor labels
+
+		vector<ConnectedComponent> connectedComponents; //!< Component -> connected component
+
+		/*!
+		 * @brief Find the connected components of a labeling.
+		 * @param[in] labeling Labeling
+		 * @param[in] nodeSubgraphs Node -> subgraph to keep components inside subgraphs, or NULL
+		 */
+		ComponentArena(HCSearch::ImgLabeling& labeling, const vector<int>* nodeSubgraphs);
+
+		~ComponentArena();
+
+		/*!
+		 * @brief Get the labels of the neighbors of a component, other than its own label.
+		 */
+		set<int> getNeighborLabels(int component) const;
+	};
+
+	/**************** Connected Component Set ****************/
+
+	/*!
+	 * @brief Connected component set contains the connected components of a labeling.
 	 */
 	class ConnectedComponentSet
 	{
 	private:
+		ComponentArena* arena;
 		vector< ConnectedComponent* > connectedComponents;
-		HCSearch::ImgLabeling original;
 
 		// true if there is only one foreground connected component
 		bool exactlyOnePositiveCC;
@@ -121,11 +201,6 @@ namespace MyGraphAlgorithms
 		 */
 		ConnectedComponentSet(HCSearch::ImgLabeling& labeling);
 		
-		/*!
-		 * @brief Construct a connected component set from a subgraph.
-		 */
-		ConnectedComponentSet(Subgraph* subgraph);
-		
 		~ConnectedComponentSet();
 
 		/*!
@@ -134,9 +209,9 @@ namespace MyGraphAlgorithms
 		int size();
 
 		/*!
-		 * @brief Get the original labeling.
+		 * @brief Get the original labeling (not copied).
 		 */
-		HCSearch::ImgLabeling getOriginalLabeling();
+		HCSearch::ImgLabeling& getOriginalLabeling();
 
 		/*!
 		 * @brief Get connected components.
@@ -153,17 +228,20 @@ namespace MyGraphAlgorithms
 
 	/*!
 	 * @brief %Subgraph contains some nodes with connected components.
+	 * 
+	 * Refers to a part of the subgraph partition of a %SubgraphSet.
 	 */
 	class Subgraph
 	{
 	private:
-		set<int> nodes;
-		ConnectedComponentSet* connectedComponents;
 		SubgraphSet* subgraphSet;
+		int index;
+		vector< ConnectedComponent* > connectedComponents;
+		int numForeground;
 
 	public:
 		Subgraph();
-		Subgraph(SubgraphSet* subgraphSet);
+		Subgraph(SubgraphSet* subgraphSet, int index);
 		~Subgraph();
 
 		/*!
@@ -172,26 +250,19 @@ namespace MyGraphAlgorithms
 		int size();
 
 		/*!
-		 * @brief Get the nodes in the subgraph.
+		 * @brief Get the nodes in the subgraph (not copied).
 		 */
-		set<int> getNodes();
+		NodeRange getNodes();
 
 		/*!
-		 * @brief Add a node into the subgraph.
+		 * @brief Add a connected component of the subgraph.
 		 */
-		void addNode(int node);
+		void addConnectedComponent(ConnectedComponent* cc, bool isForeground);
 
 		/*!
-		 * @brief Find the connected components in the subgraph.
-		 *
-		 * Should only be called when no more nodes are added!
+		 * @brief Get the original labeling (not copied).
 		 */
-		void processConnectedComponents();
-
-		/*!
-		 * @brief Get the original labeling.
-		 */
-		HCSearch::ImgLabeling getOriginalLabeling();
+		HCSearch::ImgLabeling& getOriginalLabeling();
 
 		/*!
 		 * @brief Get the connected components.
@@ -208,23 +279,28 @@ namespace MyGraphAlgorithms
 
 	/*!
 	 * @brief %Subgraph set contains a set of subgraphs, which are partitions of a labeling.
+	 * 
+	 * Subgraphs and their connected components are found with union-find in 
+	 * linear time and stored in flat arrays.
 	 */
 	class SubgraphSet
 	{
 	private:
+		vector< Subgraph > subgraphStore;
 		vector< Subgraph* > subgraphs;
-		map< int, set<int> > cuts;
-		HCSearch::ImgLabeling original;
+		NodePartition subgraphPartition;
+		ComponentArena* arena;
+		HCSearch::SharedAdjList cuts;
 
 		vector< Subgraph* > exactlyOnePositiveCCSubgraphs;
 
 	public:
 		SubgraphSet();
-		SubgraphSet(HCSearch::ImgLabeling& labeling, map< int, set<int> > cuts);
-		SubgraphSet(HCSearch::ImgLabeling& labeling, map< MyPrimitives::Pair<int, int>, bool > cuts);
+		SubgraphSet(HCSearch::ImgLabeling& labeling, const map< int, set<int> >& cuts);
+		SubgraphSet(HCSearch::ImgLabeling& labeling, const map< MyPrimitives::Pair<int, int>, bool >& cuts);
 		~SubgraphSet();
 
-		void constructorHelper(HCSearch::ImgLabeling& labeling, map< int, set<int> > cuts);
+		void constructorHelper(HCSearch::ImgLabeling& labeling, const map< int, set<int> >& cuts);
 
 		/*!
 		 * @brief Get the number of subgraphs.
@@ -232,9 +308,14 @@ namespace MyGraphAlgorithms
 		int size();
 
 		/*!
-		 * @brief Get the original labeling.
+		 * @brief Get the original labeling (not copied).
+		 */
+		HCSearch::ImgLabeling& getOriginalLabeling();
+
+		/*!
+		 * @brief Get the nodes of a subgraph (not copied).
 		 */
-		HCSearch::ImgLabeling getOriginalLabeling();
+		NodeRange getSubgraphNodes(int subgraph);
 
 		/*!
 		 * @brief Get the subgraphs.
@@ -242,15 +323,62 @@ namespace MyGraphAlgorithms
 		vector< Subgraph* > getSubgraphs();
 
 		/*!
-		 * @brief Get the stochastic cuts.
+		 * @brief Get the stochastic cuts (shared, not copied).
 		 */
-		map< int, set<int> > getCuts();
+		HCSearch::SharedAdjList getCuts();
 
 		/*!
 		 * @brief Get the set of subgraphs such that there is exactly one connected component.
 		 */
 		vector< Subgraph* > getExactlyOnePositiveCCSubgraphs();
 	};
+
+	/**************** Cut Threshold Sweep ****************/
+
+	/*!
+	 * @brief Counts the subgraphs of a cut incrementally as uncut edges are kept.
+	 * 
+	 * Keeping edges in decreasing weight order (Kruskal-style) visits the 
+	 * partitions of all cut thresholds from high to low in one pass. 
+	 * Subgraphs and their same-label connected components are tracked with 
+	 * union-find, so the number of subgraphs with exactly one foreground 
+	 * connected component is known without building a SubgraphSet.
+	 */
+	class CutThresholdSweep
+	{
+	private:
+		vector<bool> foregroundNodes;
+		vector< vector<int> > sameLabelEdges; // node -> same-label edges (as node pairs) of the node
+
+		DisjointSet subgraphSets; // node -> subgraph
+		DisjointSet componentSets; // node -> same-label connected component
+
+		vector<int> numForeground; // subgraph root -> num foreground connected components
+		vector< vector<int> > pendingEdges; // subgraph root -> same-label edges (as node pairs) leaving the subgraph
+		int numGoodSubgraphs;
+
+	public:
+		/*!
+		 * @brief Start with every edge of the labeling cut.
+		 */
+		CutThresholdSweep(HCSearch::ImgLabeling& labeling);
+		~CutThresholdSweep();
+
+		/*!
+		 * @brief Cut every edge again.
+		 */
+		void reset();
+
+		/*!
+		 * @brief Keep an edge uncut, merging the subgraphs of its nodes.
+		 */
+		void keepEdge(int node1, int node2);
+
+		/*!
+		 * @brief Get the number of subgraphs with exactly one foreground connected component.
+		 */
+		int getNumGoodSubgraphs();
+	};
 }
 
 #endif
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include <map>
 #include <set>
+#include <memory>
 
 using namespace std;
 
@@ -15,6 +16,7 @@ namespace MyPrimitives
 	template <class T, class U> struct Pair;
 	template <class T, class U, class V> struct Triple;
 	template <class T> class Bimap;
+	template <class T> class CopyOnWrite;
 
 	/*!
 	 * Pair stores a basic 2-tuple
@@ -251,6 +253,75 @@ namespace MyPrimitives
 		this->fowardKeys.clear();
 		this->backwardKeys.clear();
 	}
+
+	/*!
+	 * CopyOnWrite stores a reference-counted value that is shared between copies 
+	 * until one of them requests write access
+	 */
+	template <class T>
+	class CopyOnWrite
+	{
+		shared_ptr<T> data;
+
+	public:
+		CopyOnWrite()
+		{
+			this->data = shared_ptr<T>(new T());
+		}
+		CopyOnWrite(const T& value)
+		{
+			this->data = shared_ptr<T>(new T(value));
+		}
+		~CopyOnWrite() {}
+
+		/*!
+		 * Read access to the shared value
+		 */
+		const T& get() const;
+
+		/*!
+		 * Write access to the value, 
+		 * which first detaches a private copy if the value is shared
+		 */
+		T& mutate();
+
+		/*!
+		 * Checks if the value is shared with other copies
+		 */
+		bool isShared() const;
+
+		/*!
+		 * Checks if the value is shared with the other copy
+		 */
+		bool sharesWith(const CopyOnWrite<T>& other) const;
+	};
+
+	template <class T>
+	const T& CopyOnWrite<T>::get() const
+	{
+		return *this->data;
+	}
+
+	template <class T>
+	T& CopyOnWrite<T>::mutate()
+	{
+		if (isShared())
+			this->data = shared_ptr<T>(new T(*this->data));
+
+		return *this->data;
+	}
+
+	template <class T>
+	bool CopyOnWrite<T>::isShared() const
+	{
+		return this->data.use_count() > 1;
+	}
+
+	template <class T>
+	bool CopyOnWrite<T>::sharesWith(const CopyOnWrite<T>& other) const
+	{
+		return this->data == other.data;
+	}
 }
 
 #endif
\ No newline at end of file
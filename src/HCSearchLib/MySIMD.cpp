@@ -0,0 +1,461 @@
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "MySIMD.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MYSIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace MySIMD
+{
+	/**************** Scalar Kernels ****************/
+
+	namespace
+	{
+		void addScaledScalar(double* dst, const float* src, double weight, int n)
+		{
+			for (int i = 0; i < n; i++)
+				dst[i] += weight * src[i];
+		}
+
+		void contrastKernelScalar(const float* a, const float* b, float* contrast, float* absDiff, int n)
+		{
+			for (int i = 0; i < n; i++)
+			{
+				float diff = a[i] - b[i];
+				absDiff[i] = fabs(diff);
+				contrast[i] = exp(-diff*diff);
+			}
+		}
+
+		double symmetricKLScalar(const float* p, const float* q, int n)
+		{
+			double KL = 0;
+			for (int i = 0; i < n; i++)
+			{
+				if (p[i] != 0 && q[i] != 0)
+					KL += (p[i] - q[i]) * log(p[i] / q[i]);
+			}
+			return KL;
+		}
+	}
+
+#ifdef MYSIMD_X86
+
+	/**************** AVX2 Kernels ****************/
+
+	// exp and log follow the Cephes single-precision polynomials
+
+	namespace
+	{
+		__attribute__((target("avx2,fma")))
+		inline __m256 exp256(__m256 x)
+		{
+			x = _mm256_min_ps(x, _mm256_set1_ps(88.3762626647949f));
+			x = _mm256_max_ps(x, _mm256_set1_ps(-88.3762626647949f));
+
+			// exp(x) = 2^n * exp(g), |g| <= ln(2)/2
+			__m256 fx = _mm256_fmadd_ps(x, _mm256_set1_ps(1.44269504088896341f), _mm256_set1_ps(0.5f));
+			fx = _mm256_floor_ps(fx);
+			x = _mm256_fnmadd_ps(fx, _mm256_set1_ps(0.693359375f), x);
+			x = _mm256_fnmadd_ps(fx, _mm256_set1_ps(-2.12194440e-4f), x);
+
+			__m256 z = _mm256_mul_ps(x, x);
+			__m256 y = _mm256_set1_ps(1.9875691500e-4f);
+			y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.3981999507e-3f));
+			y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(8.3334519073e-3f));
+			y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(4.1665795894e-2f));
+			y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.6666665459e-1f));
+			y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(5.0000001201e-1f));
+			y = _mm256_fmadd_ps(y, z, x);
+			y = _mm256_add_ps(y, _mm256_set1_ps(1.0f));
+
+			__m256i n = _mm256_cvttps_epi32(fx);
+			n = _mm256_slli_epi32(_mm256_add_epi32(n, _mm256_set1_epi32(0x7f)), 23);
+			return _mm256_mul_ps(y, _mm256_castsi256_ps(n));
+		}
+
+		__attribute__((target("avx2,fma")))
+		inline __m256 log256(__m256 x)
+		{
+			// only valid for x > 0
+			x = _mm256_max_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(0x00800000)));
+
+			// x = m * 2^e, 0.5 <= m < 1
+			__m256i e = _mm256_srli_epi32(_mm256_castps_si256(x), 23);
+			x = _mm256_and_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(~0x7f800000)));
+			x = _mm256_or_ps(x, _mm256_set1_ps(0.5f));
+			__m256 fe = _mm256_cvtepi32_ps(_mm256_sub_epi32(e, _mm256_set1_epi32(0x7f)));
+			fe = _mm256_add_ps(fe, _mm256_set1_ps(1.0f));
+
+			// m < sqrt(1/2): use 2m and e-1
+			__m256 mask = _mm256_cmp_ps(x, _mm256_set1_ps(0.707106781186547524f), _CMP_LT_OS);
+			__m256 tmp = _mm256_and_ps(x, mask);
+			x = _mm256_sub_ps(x, _mm256_set1_ps(1.0f));
+			fe = _mm256_sub_ps(fe, _mm256_and_ps(_mm256_set1_ps(1.0f), mask));
+			x = _mm256_add_ps(x, tmp);
+
+			__m256 z = _mm256_mul_ps(x, x);
+			__m256 y = _mm256_set1_ps(7.0376836292e-2f);
+			y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(-1.1514610310e-1f));
+			y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.1676998740e-1f));
+			y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(-1.2420140846e-1f));
+			y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.4249322787e-1f));
+			y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(-1.6668057665e-1f));
+			y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(2.0000714765e-1f));
+			y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(-2.4999993993e-1f));
+			y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(3.3333331174e-1f));
+			y = _mm256_mul_ps(_mm256_mul_ps(y, x), z);
+
+			y = _mm256_fmadd_ps(fe, _mm256_set1_ps(-2.12194440e-4f), y);
+			y = _mm256_fnmadd_ps(z, _mm256_set1_ps(0.5f), y);
+			x = _mm256_add_ps(x, y);
+			return _mm256_fmadd_ps(fe, _mm256_set1_ps(0.693359375f), x);
+		}
+
+		__attribute__((target("avx2,fma")))
+		void addScaledAVX2(double* dst, const float* src, double weight, int n)
+		{
+			const __m256d w = _mm256_set1_pd(weight);
+			int i = 0;
+			for (; i + 4 <= n; i += 4)
+			{
+				__m256d s = _mm256_cvtps_pd(_mm_loadu_ps(src + i));
+				_mm256_storeu_pd(dst + i, _mm256_fmadd_pd(w, s, _mm256_loadu_pd(dst + i)));
+			}
+			addScaledScalar(dst + i, src + i, weight, n - i);
+		}
+
+		__attribute__((target("avx2,fma")))
+		void contrastKernelAVX2(const float* a, const float* b, float* contrast, float* absDiff, int n)
+		{
+			const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+			int i = 0;
+			for (; i + 8 <= n; i += 8)
+			{
+				__m256 diff = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+				_mm256_storeu_ps(absDiff + i, _mm256_and_ps(diff, signMask));
+				_mm256_storeu_ps(contrast + i, exp256(_mm256_mul_ps(_mm256_sub_ps(_mm256_setzero_ps(), diff), diff)));
+			}
+			contrastKernelScalar(a + i, b + i, contrast + i, absDiff + i, n - i);
+		}
+
+		__attribute__((target("avx2,fma")))
+		double symmetricKLAVX2(const float* p, const float* q, int n)
+		{
+			// terms are computed in single precision but summed in double
+			__m256d sum = _mm256_setzero_pd();
+			int i = 0;
+			for (; i + 8 <= n; i += 8)
+			{
+				__m256 pv = _mm256_loadu_ps(p + i);
+				__m256 qv = _mm256_loadu_ps(q + i);
+				__m256 valid = _mm256_and_ps(_mm256_cmp_ps(pv, _mm256_setzero_ps(), _CMP_NEQ_OQ),
+					_mm256_cmp_ps(qv, _mm256_setzero_ps(), _CMP_NEQ_OQ));
+
+				// (p-q) * log(p/q) = p*log(p/q) + q*log(q/p)
+				__m256 term = _mm256_and_ps(_mm256_mul_ps(_mm256_sub_ps(pv, qv), log256(_mm256_div_ps(pv, qv))), valid);
+				sum = _mm256_add_pd(sum, _mm256_cvtps_pd(_mm256_castps256_ps128(term)));
+				sum = _mm256_add_pd(sum, _mm256_cvtps_pd(_mm256_extractf128_ps(term, 1)));
+			}
+
+			double lanes[4];
+			_mm256_storeu_pd(lanes, sum);
+			double KL = 0;
+			for (int k = 0; k < 4; k++)
+				KL += lanes[k];
+
+			return KL + symmetricKLScalar(p + i, q + i, n - i);
+		}
+	}
+
+	/**************** AVX-512 Kernels ****************/
+
+	// GCC's AVX-512 intrinsics initialize their undefined-value operands from themselves
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+	namespace
+	{
+		__attribute__((target("avx512f")))
+		inline __m512 exp512(__m512 x)
+		{
+			x = _mm512_min_ps(x, _mm512_set1_ps(88.3762626647949f));
+			x = _mm512_max_ps(x, _mm512_set1_ps(-88.3762626647949f));
+
+			__m512 fx = _mm512_fmadd_ps(x, _mm512_set1_ps(1.44269504088896341f), _mm512_set1_ps(0.5f));
+			fx = _mm512_roundscale_ps(fx, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+			x = _mm512_fnmadd_ps(fx, _mm512_set1_ps(0.693359375f), x);
+			x = _mm512_fnmadd_ps(fx, _mm512_set1_ps(-2.12194440e-4f), x);
+
+			__m512 z = _mm512_mul_ps(x, x);
+			__m512 y = _mm512_set1_ps(1.9875691500e-4f);
+			y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(1.3981999507e-3f));
+			y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(8.3334519073e-3f));
+			y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(4.1665795894e-2f));
+			y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(1.6666665459e-1f));
+			y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(5.0000001201e-1f));
+			y = _mm512_fmadd_ps(y, z, x);
+			y = _mm512_add_ps(y, _mm512_set1_ps(1.0f));
+
+			__m512i n = _mm512_cvttps_epi32(fx);
+			n = _mm512_slli_epi32(_mm512_add_epi32(n, _mm512_set1_epi32(0x7f)), 23);
+			return _mm512_mul_ps(y, _mm512_castsi512_ps(n));
+		}
+
+		__attribute__((target("avx512f")))
+		inline __m512 log512(__m512 x)
+		{
+			x = _mm512_max_ps(x, _mm512_castsi512_ps(_mm512_set1_epi32(0x00800000)));
+
+			__m512i bits = _mm512_castps_si512(x);
+			__m512i e = _mm512_srli_epi32(bits, 23);
+			bits = _mm512_and_si512(bits, _mm512_set1_epi32(~0x7f800000));
+			bits = _mm512_or_si512(bits, _mm512_castps_si512(_mm512_set1_ps(0.5f)));
+			x = _mm512_castsi512_ps(bits);
+			__m512 fe = _mm512_cvtepi32_ps(_mm512_sub_epi32(e, _mm512_set1_epi32(0x7f)));
+			fe = _mm512_add_ps(fe, _mm512_set1_ps(1.0f));
+
+			__mmask16 mask = _mm512_cmp_ps_mask(x, _mm512_set1_ps(0.707106781186547524f), _CMP_LT_OS);
+			__m512 tmp = _mm512_maskz_mov_ps(mask, x);
+			x = _mm512_sub_ps(x, _mm512_set1_ps(1.0f));
+			fe = _mm512_mask_sub_ps(fe, mask, fe, _mm512_set1_ps(1.0f));
+			x = _mm512_add_ps(x, tmp);
+
+			__m512 z = _mm512_mul_ps(x, x);
+			__m512 y = _mm512_set1_ps(7.0376836292e-2f);
+			y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(-1.1514610310e-1f));
+			y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(1.1676998740e-1f));
+			y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(-1.2420140846e-1f));
+			y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(1.4249322787e-1f));
+			y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(-1.6668057665e-1f));
+			y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(2.0000714765e-1f));
+			y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(-2.4999993993e-1f));
+			y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(3.3333331174e-1f));
+			y = _mm512_mul_ps(_mm512_mul_ps(y, x), z);
+
+			y = _mm512_fmadd_ps(fe, _mm512_set1_ps(-2.12194440e-4f), y);
+			y = _mm512_fnmadd_ps(z, _mm512_set1_ps(0.5f), y);
+			x = _mm512_add_ps(x, y);
+			return _mm512_fmadd_ps(fe, _mm512_set1_ps(0.693359375f), x);
+		}
+
+		__attribute__((target("avx512f")))
+		void addScaledAVX512(double* dst, const float* src, double weight, int n)
+		{
+			const __m512d w = _mm512_set1_pd(weight);
+			int i = 0;
+			for (; i + 8 <= n; i += 8)
+			{
+				__m512d s = _mm512_cvtps_pd(_mm256_loadu_ps(src + i));
+				_mm512_storeu_pd(dst + i, _mm512_fmadd_pd(w, s, _mm512_loadu_pd(dst + i)));
+			}
+			addScaledScalar(dst + i, src + i, weight, n - i);
+		}
+
+		__attribute__((target("avx512f")))
+		void contrastKernelAVX512(const float* a, const float* b, float* contrast, float* absDiff, int n)
+		{
+			for (int i = 0; i < n; i += 16)
+			{
+				__mmask16 tail = (n - i >= 16) ? (__mmask16)0xffff : (__mmask16)((1u << (n - i)) - 1);
+				__m512 diff = _mm512_sub_ps(_mm512_maskz_loadu_ps(tail, a + i), _mm512_maskz_loadu_ps(tail, b + i));
+				_mm512_mask_storeu_ps(absDiff + i, tail, _mm512_abs_ps(diff));
+				_mm512_mask_storeu_ps(contrast + i, tail, exp512(_mm512_mul_ps(_mm512_sub_ps(_mm512_setzero_ps(), diff), diff)));
+			}
+		}
+
+		__attribute__((target("avx512f")))
+		double symmetricKLAVX512(const float* p, const float* q, int n)
+		{
+			// terms are computed in single precision but summed in double
+			__m512d sum = _mm512_setzero_pd();
+			for (int i = 0; i < n; i += 16)
+			{
+				__mmask16 tail = (n - i >= 16) ? (__mmask16)0xffff : (__mmask16)((1u << (n - i)) - 1);
+				__m512 pv = _mm512_maskz_loadu_ps(tail, p + i);
+				__m512 qv = _mm512_maskz_loadu_ps(tail, q + i);
+				__mmask16 valid = _mm512_cmp_ps_mask(pv, _mm512_setzero_ps(), _CMP_NEQ_OQ)
+					& _mm512_cmp_ps_mask(qv, _mm512_setzero_ps(), _CMP_NEQ_OQ);
+
+				__m512 term = _mm512_maskz_mov_ps(valid, _mm512_mul_ps(_mm512_sub_ps(pv, qv), log512(_mm512_div_ps(pv, qv))));
+				sum = _mm512_add_pd(sum, _mm512_cvtps_pd(_mm512_castps512_ps256(term)));
+				sum = _mm512_add_pd(sum, _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(term), 1))));
+			}
+
+			return _mm512_reduce_add_pd(sum);
+		}
+	}
+
+#pragma GCC diagnostic pop
+
+#endif
+
+	/**************** Dispatch ****************/
+
+	namespace
+	{
+		InstructionSet& activeInstructionSet()
+		{
+			static InstructionSet instructionSet = detectInstructionSet();
+			return instructionSet;
+		}
+	}
+
+	InstructionSet detectInstructionSet()
+	{
+#ifdef MYSIMD_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f"))
+			return AVX512;
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+			return AVX2;
+#endif
+		return SCALAR;
+	}
+
+	InstructionSet getInstructionSet()
+	{
+		return activeInstructionSet();
+	}
+
+	void setInstructionSet(InstructionSet instructionSet)
+	{
+		activeInstructionSet() = min(instructionSet, detectInstructionSet());
+	}
+
+	const char* instructionSetName(InstructionSet instructionSet)
+	{
+		switch (instructionSet)
+		{
+		case AVX512:
+			return "AVX-512";
+		case AVX2:
+			return "AVX2";
+		default:
+			return "scalar";
+		}
+	}
+
+	void addScaled(double* dst, const float* src, double weight, int n)
+	{
+#ifdef MYSIMD_X86
+		switch (activeInstructionSet())
+		{
+		case AVX512:
+			addScaledAVX512(dst, src, weight, n);
+			return;
+		case AVX2:
+			addScaledAVX2(dst, src, weight, n);
+			return;
+		default:
+			break;
+		}
+#endif
+		addScaledScalar(dst, src, weight, n);
+	}
+
+	void contrastKernel(const float* a, const float* b, float* contrast, float* absDiff, int n)
+	{
+#ifdef MYSIMD_X86
+		switch (activeInstructionSet())
+		{
+		case AVX512:
+			contrastKernelAVX512(a, b, contrast, absDiff, n);
+			return;
+		case AVX2:
+			contrastKernelAVX2(a, b, contrast, absDiff, n);
+			return;
+		default:
+			break;
+		}
+#endif
+		contrastKernelScalar(a, b, contrast, absDiff, n);
+	}
+
+	double symmetricKL(const float* p, const float* q, int n)
+	{
+#ifdef MYSIMD_X86
+		switch (activeInstructionSet())
+		{
+		case AVX512:
+			return symmetricKLAVX512(p, q, n);
+		case AVX2:
+			return symmetricKLAVX2(p, q, n);
+		default:
+			break;
+		}
+#endif
+		return symmetricKLScalar(p, q, n);
+	}
+
+	/**************** Aligned Float Matrix ****************/
+
+	const int AlignedFloatMatrix::ALIGN_FLOATS;
+
+	AlignedFloatMatrix::AlignedFloatMatrix()
+	{
+		this->alignOffset = 0;
+		this->numRows = 0;
+		this->numCols = 0;
+		this->stride = 0;
+	}
+
+	AlignedFloatMatrix::AlignedFloatMatrix(const AlignedFloatMatrix& other)
+	{
+		*this = other;
+	}
+
+	AlignedFloatMatrix& AlignedFloatMatrix::operator=(const AlignedFloatMatrix& other)
+	{
+		if (this == &other)
+			return *this;
+
+		// the copied buffer may be aligned differently
+		resize(other.numRows, other.numCols);
+		for (int r = 0; r < this->numRows; r++)
+			copy(other.row(r), other.row(r) + this->stride, row(r));
+
+		return *this;
+	}
+
+	void AlignedFloatMatrix::resize(int rows, int cols)
+	{
+		this->numRows = rows;
+		this->numCols = cols;
+		this->stride = ((cols + ALIGN_FLOATS - 1)/ALIGN_FLOATS)*ALIGN_FLOATS;
+		this->buffer.assign(this->numRows*this->stride + ALIGN_FLOATS, 0.0f);
+
+		uintptr_t address = reinterpret_cast<uintptr_t>(&this->buffer[0]);
+		uintptr_t alignBytes = ALIGN_FLOATS*sizeof(float);
+		this->alignOffset = static_cast<int>(((alignBytes - address % alignBytes) % alignBytes)/sizeof(float));
+	}
+
+	int AlignedFloatMatrix::rows() const
+	{
+		return this->numRows;
+	}
+
+	int AlignedFloatMatrix::cols() const
+	{
+		return this->numCols;
+	}
+
+	int AlignedFloatMatrix::getStride() const
+	{
+		return this->stride;
+	}
+
+	float* AlignedFloatMatrix::row(int r)
+	{
+		return &this->buffer[this->alignOffset + r*this->stride];
+	}
+
+	const float* AlignedFloatMatrix::row(int r) const
+	{
+		return &this->buffer[this->alignOffset + r*this->stride];
+	}
+}
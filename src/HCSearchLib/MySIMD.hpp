@@ -0,0 +1,130 @@
+#ifndef MYSIMD_HPP
+#define MYSIMD_HPP
+
+#include <vector>
+
+using namespace std;
+
+//////////////////////////////////////////
+/// My Single-Precision SIMD Kernels
+//////////////////////////////////////////
+
+namespace MySIMD
+{
+	/*!
+	 * @brief Instruction sets of the kernels.
+	 *
+	 * AVX2 and AVX-512 kernels are only compiled in GCC/Clang x86 builds.
+	 * Other builds always use the scalar kernels.
+	 */
+	enum InstructionSet { SCALAR, AVX2, AVX512 };
+
+	/*!
+	 * @brief Get the best instruction set supported by this CPU and build.
+	 */
+	InstructionSet detectInstructionSet();
+
+	/*!
+	 * @brief Get the instruction set used by the kernels.
+	 *
+	 * Defaults to the detected instruction set.
+	 */
+	InstructionSet getInstructionSet();
+
+	/*!
+	 * @brief Set the instruction set used by the kernels.
+	 *
+	 * Requests above the detected instruction set fall back to it.
+	 * Not thread-safe; set it before the search starts.
+	 */
+	void setInstructionSet(InstructionSet instructionSet);
+
+	/*!
+	 * @brief Get the name of an instruction set for logging.
+	 */
+	const char* instructionSetName(InstructionSet instructionSet);
+
+	/*!
+	 * @brief Accumulate dst += weight * src.
+	 * @param[in,out] dst Double-precision accumulator of length n
+	 * @param[in] src Single-precision values of length n
+	 * @param[in] weight Scale of src
+	 * @param[in] n Length
+	 */
+	void addScaled(double* dst, const float* src, double weight, int n);
+
+	/*!
+	 * @brief Compute the pairwise kernels of two feature vectors.
+	 * @param[in] a First feature vector of length n
+	 * @param[in] b Second feature vector of length n
+	 * @param[out] contrast exp(-(a-b)^2) of length n
+	 * @param[out] absDiff |a-b| of length n
+	 * @param[in] n Length
+	 */
+	void contrastKernel(const float* a, const float* b, float* contrast, float* absDiff, int n);
+
+	/*!
+	 * @brief Compute the symmetric KL divergence KL(p||q) + KL(q||p).
+	 *
+	 * Entries where p or q is zero are skipped, as in StochasticSuccessor::computeKL.
+	 * @param[in] p First distribution of length n
+	 * @param[in] q Second distribution of length n
+	 * @param[in] n Length
+	 * @return Returns the symmetric divergence
+	 */
+	double symmetricKL(const float* p, const float* q, int n);
+
+	/**************** Aligned Float Matrix ****************/
+
+	/*!
+	 * @brief Row-major single-precision matrix with 32-byte aligned rows.
+	 *
+	 * Rows are zero-padded to a multiple of 8 floats, so every row
+	 * starts on a 32-byte boundary.
+	 */
+	class AlignedFloatMatrix
+	{
+		static const int ALIGN_FLOATS = 8;
+
+		vector<float> buffer;
+		int alignOffset;
+		int numRows;
+		int numCols;
+		int stride;
+
+	public:
+		AlignedFloatMatrix();
+
+		/*!
+		 * @brief Construct from a double-precision matrix.
+		 */
+		template <class Derived>
+		explicit AlignedFloatMatrix(const Derived& data)
+		{
+			resize(data.rows(), data.cols());
+			for (int r = 0; r < this->numRows; r++)
+			{
+				float* dst = row(r);
+				for (int c = 0; c < this->numCols; c++)
+					dst[c] = static_cast<float>(data(r, c));
+			}
+		}
+
+		AlignedFloatMatrix(const AlignedFloatMatrix& other);
+		AlignedFloatMatrix& operator=(const AlignedFloatMatrix& other);
+
+		/*!
+		 * @brief Resize and zero the matrix.
+		 */
+		void resize(int rows, int cols);
+
+		int rows() const;
+		int cols() const;
+		int getStride() const;
+
+		float* row(int r);
+		const float* row(int r) const;
+	};
+}
+
+#endif
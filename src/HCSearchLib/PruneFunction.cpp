@@ -71,14 +71,22 @@ namespace HCSearch
 	{
 		vector< ImgCandidate > YPrunedCandidates;
 
-		// get pruning features of candidates
+		const int numOriginalCandidates = YCandidates.size();
+
+		// features of delta candidates are updated from the feature sums of the parent
+		FeatureAccumulators parentAcc;
+		this->featureFunction->computeAccumulators(X, Y, parentAcc);
+
+		// get pruning features of candidates (stacked by the ranker unless sparse)
 		vector<RankFeatures> featuresList;
-		for (vector<ImgCandidate>::iterator it = YCandidates.begin(); it != YCandidates.end(); ++it)
+		for (int i = 0; i < numOriginalCandidates; i++)
 		{
-			ImgCandidate YCand = *it;
-			set<int> action = YCand.action;
-			RankFeatures features = this->featureFunction->computeFeatures(X, YCand.labeling, action);
-			featuresList.push_back(features);
+			featuresList.push_back(this->featureFunction->computeFeatures(X, YCandidates[i], parentAcc));
+			if (featuresList[i].size() != featuresList[0].size())
+			{
+				LOG(ERROR) << "pruning features of candidates have different dimensions!";
+				abort();
+			}
 		}
 
 		// run ranker
@@ -86,7 +94,6 @@ namespace HCSearch
 		vector<double> ranks = this->ranker->rank(featuresList);
 
 		// sort by rank
-		const int numOriginalCandidates = YCandidates.size();
 		const int numNewCandidates = static_cast<int>((1-pruneFraction)*numOriginalCandidates);
 
 		LOG() << "adding to running queue..." << endl;
@@ -174,9 +181,8 @@ namespace HCSearch
 		vector<RankFeatures> featuresList;
 		for (vector<ImgCandidate>::iterator it = YCandidates.begin(); it != YCandidates.end(); ++it)
 		{
-			ImgCandidate YCand = *it;
-			set<int> action = YCand.action;
-			RankFeatures features = this->featureFunction->computeFeatures(X, YCand.labeling, action);
+			ImgCandidate& YCand = *it;
+			RankFeatures features = this->featureFunction->computeFeatures(X, YCand);
 			featuresList.push_back(features);
 		}
 
@@ -284,9 +290,9 @@ namespace HCSearch
 		// split into good and bad groups based on loss function
 		for (vector<ImgCandidate>::iterator it = YCandidates.begin(); it != YCandidates.end(); ++it)
 		{
-			ImgCandidate YCand = *it;
+			ImgCandidate& YCand = *it;
 
-			double thisLoss = lossFunc->computeLoss(YCand.labeling, *YTruth);
+			double thisLoss = lossFunc->computeLoss(YCand, *YTruth);
 
 			RankPruneNode rankNode;
 			rankNode.rank = Rand::unifDist();
@@ -394,8 +400,8 @@ namespace HCSearch
 		vector<RankFeatures> featuresList;
 		for (vector<ImgCandidate>::iterator it = YCandidates.begin(); it != YCandidates.end(); ++it)
 		{
-			ImgCandidate YCand = *it;
-			double candLoss = lossFunc->computeLoss(YCand.labeling, *YTruth);
+			ImgCandidate& YCand = *it;
+			double candLoss = lossFunc->computeLoss(YCand, *YTruth);
 			
 			if (candLoss < prevLoss)
 			{
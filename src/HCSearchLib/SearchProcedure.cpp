@@ -1,8 +1,13 @@
 #include <iostream>
 #include <ctime>
+#include <algorithm>
 #include "SearchProcedure.hpp"
 #include "Globals.hpp"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace std;
 
 namespace HCSearch
@@ -238,6 +243,117 @@ namespace HCSearch
 		}
 	}
 
+	/**************** Transposition Table ****************/
+
+	TranspositionTable::TranspositionTable()
+	{
+		reset(0, EVICT_LRU, false);
+	}
+
+	void TranspositionTable::reset(int capacity, EvictionPolicy policy, bool storeFeatures)
+	{
+		this->entries.clear();
+		this->evictionOrder.clear();
+		this->capacity = capacity;
+		this->policy = policy;
+		this->storeFeatures = storeFeatures;
+		this->numLookups = 0;
+		this->numHits = 0;
+		this->numEvictions = 0;
+	}
+
+	bool TranspositionTable::isEnabled() const
+	{
+		return this->capacity > 0;
+	}
+
+	bool TranspositionTable::storesFeatures() const
+	{
+		return this->storeFeatures;
+	}
+
+	const TranspositionTable::Entry* TranspositionTable::find(LabelingHash_t hash, LabelingHash_t check) const
+	{
+		Entries_t::const_iterator it = this->entries.find(hash);
+		if (it == this->entries.end() || it->second.check != check)
+			return NULL;
+
+		return &it->second;
+	}
+
+	void TranspositionTable::recordLookup(LabelingHash_t hash, bool hit)
+	{
+		this->numLookups++;
+		if (!hit)
+			return;
+
+		this->numHits++;
+		if (this->policy == EVICT_LRU)
+		{
+			Entries_t::iterator it = this->entries.find(hash);
+			if (it != this->entries.end())
+				this->evictionOrder.splice(this->evictionOrder.end(), this->evictionOrder, it->second.position);
+		}
+	}
+
+	void TranspositionTable::insert(LabelingHash_t hash, LabelingHash_t check, double heuristic, double cost, 
+		const RankFeatures& heuristicFeatures, const RankFeatures& costFeatures, 
+		const FeatureAccumulators& heuristicAccumulators, const FeatureAccumulators& costAccumulators)
+	{
+		if (!isEnabled() || this->entries.count(hash) > 0)
+			return;
+
+		// evict the oldest (FIFO) or least recently used (LRU) entry
+		while (static_cast<int>(this->entries.size()) >= this->capacity)
+		{
+			this->entries.erase(this->evictionOrder.front());
+			this->evictionOrder.pop_front();
+			this->numEvictions++;
+		}
+
+		Entry& entry = this->entries[hash];
+		entry.heuristic = heuristic;
+		entry.cost = cost;
+		entry.check = check;
+		entry.hasFeatures = this->storeFeatures;
+		if (this->storeFeatures)
+		{
+			entry.heuristicFeatures = heuristicFeatures;
+			entry.costFeatures = costFeatures;
+			entry.heuristicAccumulators = heuristicAccumulators;
+			entry.costAccumulators = costAccumulators;
+		}
+		entry.position = this->evictionOrder.insert(this->evictionOrder.end(), hash);
+	}
+
+	int TranspositionTable::size() const
+	{
+		return this->entries.size();
+	}
+
+	int TranspositionTable::getNumLookups() const
+	{
+		return this->numLookups;
+	}
+
+	int TranspositionTable::getNumHits() const
+	{
+		return this->numHits;
+	}
+
+	int TranspositionTable::getNumEvictions() const
+	{
+		return this->numEvictions;
+	}
+
+	double TranspositionTable::getHitRate() const
+	{
+		if (this->numLookups == 0)
+			return 0;
+
+		return static_cast<double>(this->numHits)/this->numLookups;
+	}
+
 	/**************** Search Procedure ****************/
 
 	ISearchProcedure::SearchNode* ISearchProcedure::createRootNode(SearchType searchType, ImgFeatures& X, ImgLabeling* YTruth, 
@@ -247,28 +363,28 @@ namespace HCSearch
 		switch (searchType)
 		{
 			case LL:
-				root = new SearchNode(&X, YTruth, searchSpace, NULL, NULL, searchType);
+				root = new SearchNode(&X, YTruth, searchSpace, NULL, NULL, searchType, &this->transpositionTable);
 				break;
 			case HL:
-				root = new SearchNode(&X, YTruth, searchSpace, heuristicModel, NULL, searchType);
+				root = new SearchNode(&X, YTruth, searchSpace, heuristicModel, NULL, searchType, &this->transpositionTable);
 				break;
 			case LC:
-				root = new SearchNode(&X, YTruth, searchSpace, NULL, costModel, searchType);
+				root = new SearchNode(&X, YTruth, searchSpace, NULL, costModel, searchType, &this->transpositionTable);
 				break;
 			case HC:
-				root = new SearchNode(&X, NULL, searchSpace, heuristicModel, costModel, searchType);
+				root = new SearchNode(&X, NULL, searchSpace, heuristicModel, costModel, searchType, &this->transpositionTable);
 				break;
 			case LEARN_H:
-				root = new SearchNode(&X, YTruth, searchSpace, NULL, NULL, searchType);
+				root = new SearchNode(&X, YTruth, searchSpace, NULL, NULL, searchType, &this->transpositionTable);
 				break;
 			case LEARN_C:
-				root = new SearchNode(&X, YTruth, searchSpace, heuristicModel, NULL, searchType);
+				root = new SearchNode(&X, YTruth, searchSpace, heuristicModel, NULL, searchType, &this->transpositionTable);
 				break;
 			case LEARN_C_ORACLE_H:
-				root = new SearchNode(&X, YTruth, searchSpace, NULL, NULL, searchType);
+				root = new SearchNode(&X, YTruth, searchSpace, NULL, NULL, searchType, &this->transpositionTable);
 				break;
 			case LEARN_PRUNE:
-				root = new SearchNode(&X, YTruth, searchSpace, NULL, NULL, searchType);
+				root = new SearchNode(&X, YTruth, searchSpace, NULL, NULL, searchType, &this->transpositionTable);
 				break;
 			default:
 				LOG(ERROR) << "searchType constant is invalid.";
@@ -279,6 +395,73 @@ namespace HCSearch
 	ISearchProcedure::SearchMetadata::SearchMetadata()
 	{
 		this->saveAnytimePredictions = false;
+		this->timeBudget = 0;
+	}
+
+	ISearchProcedure::SearchStats::SearchStats()
+	{
+		this->numSteps = 0;
+		this->numNodes = 0;
+		this->elapsedTime = 0;
+		this->budgetExhausted = false;
+		this->numTableLookups = 0;
+		this->numTableHits = 0;
+	}
+
+	ISearchProcedure::SearchStats ISearchProcedure::getLastSearchStats()
+	{
+		return this->lastSearchStats;
+	}
+
+	void ISearchProcedure::startTimeBudget(int timeBudget)
+	{
+		this->searchStartTime = WallClock::now();
+		this->searchTimeBudget = timeBudget;
+		this->lastSearchStats = SearchStats();
+	}
+
+	bool ISearchProcedure::timeBudgetExhausted()
+	{
+		if (this->searchTimeBudget <= 0)
+			return false;
+
+		chrono::milliseconds elapsed = chrono::duration_cast<chrono::milliseconds>(WallClock::now() - this->searchStartTime);
+		if (elapsed.count() < this->searchTimeBudget)
+			return false;
+
+		this->lastSearchStats.budgetExhausted = true;
+		return true;
+	}
+
+	void ISearchProcedure::resetTranspositionTable()
+	{
+		this->transpositionTable.reset(Global::settings->TRANSPOSITION_TABLE_SIZE, 
+			Global::settings->TRANSPOSITION_TABLE_EVICTION, Global::settings->TRANSPOSITION_TABLE_FEATURES);
+	}
+
+	void ISearchProcedure::finishSearchStats(int numSteps, int numNodes)
+	{
+		chrono::duration<double, milli> elapsed = WallClock::now() - this->searchStartTime;
+		this->lastSearchStats.numSteps = numSteps;
+		this->lastSearchStats.numNodes = numNodes;
+		this->lastSearchStats.elapsedTime = elapsed.count();
+
+		LOG() << "completed " << numSteps << " search steps and " << numNodes << " nodes in " 
+			<< this->lastSearchStats.elapsedTime << " ms wall-clock time";
+		if (this->searchTimeBudget > 0)
+			LOG() << " (budget " << this->searchTimeBudget << " ms" 
+				<< (this->lastSearchStats.budgetExhausted ? ", exhausted" : "") << ")";
+		LOG() << endl;
+
+		if (this->transpositionTable.isEnabled())
+		{
+			this->lastSearchStats.numTableLookups = this->transpositionTable.getNumLookups();
+			this->lastSearchStats.numTableHits = this->transpositionTable.getNumHits();
+			LOG() << "transposition table: " << this->transpositionTable.getNumHits() << "/" 
+				<< this->transpositionTable.getNumLookups() << " hits (rate " << this->transpositionTable.getHitRate() 
+				<< "), size " << this->transpositionTable.size() << ", evictions " 
+				<< this->transpositionTable.getNumEvictions() << endl;
+		}
 	}
 
 	void ISearchProcedure::openAnyTimePredictionFiles(int timeBound, SearchMetadata searchMetadata, SearchType searchType)
@@ -460,6 +643,9 @@ namespace HCSearch
 	IRankModel* pruneModel, SearchMetadata searchMetadata)
 	{
 		clock_t tic = clock();
+		startTimeBudget(searchMetadata.timeBudget);
+		Rand::beginStreams(searchMetadata.exampleName, searchMetadata.iter);
+		resetTranspositionTable();
 
 		// set up priority queues
 		// maintain open set for search
@@ -471,14 +657,17 @@ namespace HCSearch
 		SearchNode* root = createRootNode(searchType, X, YTruth, searchSpace, heuristicModel, costModel);
 		openSet.push(root);
 		costSet.push(root);
+		this->visitedIndex.clear();
+		this->visitedIndex.insert(root);
+		this->numGenerated = 1;
 
 		openAnyTimePredictionFiles(timeBound, searchMetadata, searchType);
 		saveAnyTimePrediction(costSet.top()->getY(), costSet.top()->getY(), 0, searchMetadata, searchType);
 
-		// while the open set is not empty and the time step is less than the time bound,
-		// perform search...
+		// while the open set is not empty, the time step is less than the time bound 
+		// and the wall-clock budget is not used up (checked from the second step on), perform search...
 		int timeStep = 0;
-		while (!openSet.empty() && timeStep < timeBound)
+		while (!openSet.empty() && timeStep < timeBound && (timeStep == 0 || !timeBudgetExhausted()))
 		{
 			LOG() << endl << "Running " << SearchTypeStrings[searchType] << " search with time step " << timeStep+1 << "/" << timeBound << "..." << endl;
 			clock_t ticInside = clock();
@@ -489,7 +678,7 @@ namespace HCSearch
 
 			/***** expand these elements *****/
 
-			SearchNodeHeuristicPQ candidateSet = expandElements(subsetOpenSet, openSet, costSet, pruneModel, YTruth, searchType, timeStep, timeBound);
+			SearchNodeHeuristicPQ candidateSet = expandElements(subsetOpenSet, openSet, pruneModel, YTruth, searchType, timeStep, timeBound);
 
 			/***** save current best if anytime prediction enabled *****/
 			saveAnyTimePrediction(candidateSet.top()->getY(), costSet.top()->getY(), timeStep+1, searchMetadata, searchType);
@@ -508,6 +697,10 @@ namespace HCSearch
 			if (searchType == LEARN_H)
 				trainRanker(heuristicModel, bestFeatures, bestLosses, worstFeatures, worstLosses);
 
+			/***** bound memory of the cost set (if enabled) *****/
+
+			boundCostSet(costSet, openSet, searchType, costModel);
+
 			/***** done with this search step *****/
 
 			clock_t tocInside = clock();
@@ -531,7 +724,8 @@ namespace HCSearch
 		SearchNode* lowestCost = costSet.top();
 		ImgLabeling prediction = lowestCost->getY();
 		LOG() << endl << "Finished search. Cost=" << lowestCost->getCost() << endl;
-		LOG() << "Num of outputs generated=" << costSet.size() << endl << endl;
+		LOG() << "Num of outputs generated=" << this->numGenerated << endl << endl;
+		finishSearchStats(timeStep, this->numGenerated);
 
 		// use best/worst cost set candidates as training examples for cost learning (if applicable)
 		if (searchType == LEARN_C || searchType == LEARN_C_ORACLE_H)
@@ -551,6 +745,7 @@ namespace HCSearch
 			//}
 			delete state;
 		}
+		this->visitedIndex.clear();
 		//if (YTruth != NULL)
 		//{
 		//	stringstream ssLosses;
@@ -569,6 +764,77 @@ namespace HCSearch
 		return prediction;
 	}
 
+	bool IBasicSearchProcedure::isDuplicate(SearchNode* state)
+	{
+		return this->visitedIndex.contains(state);
+	}
+
+	void IBasicSearchProcedure::boundCostSet(SearchNodeCostPQ& costSet, SearchNodeHeuristicPQ& openSet, 
+		SearchType searchType, IRankModel* costModel)
+	{
+		const int maxSize = Global::settings->MAX_COST_SET_SIZE;
+		if (maxSize <= 0 || static_cast<int>(costSet.size()) <= 2*maxSize)
+			return;
+
+		// nodes in the open set are still needed for expansion
+		set< SearchNode* > openNodes;
+		SearchNodeHeuristicPQ openSetCopy = openSet;
+		while (!openSetCopy.empty())
+		{
+			openNodes.insert(openSetCopy.top());
+			openSetCopy.pop();
+		}
+
+		// keep the top nodes by cost
+		const double bestCost = costSet.top()->getCost();
+		SearchNodeCostPQ keptSet;
+		vector< SearchNode* > evictedNodes;
+		while (!costSet.empty())
+		{
+			SearchNode* state = costSet.top();
+			costSet.pop();
+
+			if (static_cast<int>(keptSet.size()) < maxSize || state->getCost() <= bestCost || openNodes.count(state) > 0)
+				keptSet.push(state);
+			else
+				evictedNodes.push_back(state);
+		}
+		costSet = keptSet;
+
+		LOG() << "bounded cost set: kept " << costSet.size() << ", evicted " << evictedNodes.size() << endl;
+
+		// stream evicted nodes as worse examples against the current best nodes
+		if ((searchType == LEARN_C || searchType == LEARN_C_ORACLE_H) && !evictedNodes.empty())
+		{
+			vector< RankFeatures > bestFeatures;
+			vector< RankFeatures > worstFeatures;
+			vector< double > bestLosses;
+			vector< double > worstLosses;
+
+			SearchNodeCostPQ bestSet = costSet;
+			while (!bestSet.empty() && bestSet.top()->getCost() <= bestCost)
+			{
+				bestFeatures.push_back(bestSet.top()->getCostFeatures());
+				bestLosses.push_back(bestSet.top()->getCost());
+				bestSet.pop();
+			}
+
+			for (vector< SearchNode* >::iterator it = evictedNodes.begin(); it != evictedNodes.end(); ++it)
+			{
+				worstFeatures.push_back((*it)->getCostFeatures());
+				worstLosses.push_back((*it)->getCost());
+			}
+
+			trainRanker(costModel, bestFeatures, bestLosses, worstFeatures, worstLosses);
+		}
+
+		for (vector< SearchNode* >::iterator it = evictedNodes.begin(); it != evictedNodes.end(); ++it)
+		{
+			this->visitedIndex.retire(*it);
+			delete *it;
+		}
+	}
+
 	/**************** Breadth-First Beam Search Procedure ****************/
 
 	BreadthFirstBeamSearchProcedure::BreadthFirstBeamSearchProcedure()
@@ -608,14 +874,20 @@ namespace HCSearch
 		return subsetOpenSet;
 	}
 
-	ISearchProcedure::SearchNodeHeuristicPQ BreadthFirstBeamSearchProcedure::expandElements(vector< SearchNode* > subsetOpenSet, SearchNodeHeuristicPQ& openSet, SearchNodeCostPQ& costSet,
+	ISearchProcedure::SearchNodeHeuristicPQ BreadthFirstBeamSearchProcedure::expandElements(vector< SearchNode* > subsetOpenSet, SearchNodeHeuristicPQ& openSet,
 		IRankModel* pruneModel, ImgLabeling* YTruth, SearchType searchType, int timeStep, int timeBound)
 	{
 		SearchNodeHeuristicPQ candidateSet;
 		
-		// expand each element
+		// expand each element (at least one, then only while the wall-clock budget lasts)
 		for (vector< SearchNode* >::iterator it = subsetOpenSet.begin(); it != subsetOpenSet.end(); ++it)
 		{
+			if (it != subsetOpenSet.begin() && timeBudgetExhausted())
+			{
+				LOG() << "time budget exhausted, skipping remaining expansions" << endl;
+				break;
+			}
+
 			SearchNode* current = *it;
 			LOG() << "Expansion Node: Heuristic=" << current->getHeuristic() << ", Cost=" << current->getCost() << endl;
 
@@ -631,9 +903,15 @@ namespace HCSearch
 			for (vector< SearchNode* >::iterator it = expansionSet.begin(); it != expansionSet.end(); ++it)
 			{
 				SearchNode* state = *it;
-				if (!Global::settings->CHECK_FOR_DUPLICATES || (!isDuplicate(state, candidateSet) && !isDuplicate(state, costSet)))
+				if (!Global::settings->CHECK_FOR_DUPLICATES || !isDuplicate(state))
 				{
 					candidateSet.push(state);
+					this->visitedIndex.insert(state);
+					this->numGenerated++;
+				}
+				else
+				{
+					delete state;
 				}
 			}
 		}
@@ -738,14 +1016,20 @@ namespace HCSearch
 		return subsetOpenSet;
 	}
 
-	ISearchProcedure::SearchNodeHeuristicPQ BestFirstBeamSearchProcedure::expandElements(vector< SearchNode* > subsetOpenSet, SearchNodeHeuristicPQ& openSet, SearchNodeCostPQ& costSet,
+	ISearchProcedure::SearchNodeHeuristicPQ BestFirstBeamSearchProcedure::expandElements(vector< SearchNode* > subsetOpenSet, SearchNodeHeuristicPQ& openSet,
 		IRankModel* pruneModel, ImgLabeling* YTruth, SearchType searchType, int timeStep, int timeBound)
 	{
 		SearchNodeHeuristicPQ candidateSet;
 		
-		// expand each element
+		// expand each element (at least one, then only while the wall-clock budget lasts)
 		for (vector< SearchNode* >::iterator it = subsetOpenSet.begin(); it != subsetOpenSet.end(); ++it)
 		{
+			if (it != subsetOpenSet.begin() && timeBudgetExhausted())
+			{
+				LOG() << "time budget exhausted, skipping remaining expansions" << endl;
+				break;
+			}
+
 			SearchNode* current = *it;
 			LOG() << "Expansion Node: Heuristic=" << current->getHeuristic() << ", Cost=" << current->getCost() << endl;
 
@@ -761,9 +1045,15 @@ namespace HCSearch
 			for (vector< SearchNode* >::iterator it = expansionSet.begin(); it != expansionSet.end(); ++it)
 			{
 				SearchNode* state = *it;
-				if (!isDuplicate(state, candidateSet) && !isDuplicate(state, costSet))
+				if (!isDuplicate(state))
 				{
 					candidateSet.push(state);
+					this->visitedIndex.insert(state);
+					this->numGenerated++;
+				}
+				else
+				{
+					delete state;
 				}
 			}
 		}
@@ -774,7 +1064,8 @@ namespace HCSearch
 			SearchNode* current = openSet.top();
 			openSet.pop();
 
-			if (!Global::settings->CHECK_FOR_DUPLICATES || (!isDuplicate(current, candidateSet) && !isDuplicate(current, costSet)))
+			// (open set nodes are already indexed; they remain owned by the cost set)
+			if (!Global::settings->CHECK_FOR_DUPLICATES || !isDuplicate(current))
 			{
 				candidateSet.push(current);
 			}
@@ -808,6 +1099,9 @@ namespace HCSearch
 	IRankModel* pruneModel, SearchMetadata searchMetadata)
 	{
 		clock_t tic = clock();
+		startTimeBudget(searchMetadata.timeBudget);
+		Rand::beginStreams(searchMetadata.exampleName, searchMetadata.iter);
+		resetTranspositionTable();
 
 		// set up cost set list to check for duplicates and for learning if necessary
 		// maintain best cost and heuristic node pointers
@@ -820,6 +1114,8 @@ namespace HCSearch
 		bestHeuristicNode = root;
 		bestCostNode = root;
 		costSet.push_back(root);
+		this->costSetIndex.clear();
+		this->costSetIndex.insert(root);
 
 		int numOutputs = 1;
 
@@ -845,10 +1141,10 @@ namespace HCSearch
 		openAnyTimePredictionFiles(timeBound, searchMetadata, searchType);
 		saveAnyTimePrediction(bestHeuristicNode->getY(), bestCostNode->getY(), 0, searchMetadata, searchType);
 
-		// while the open set is not empty and the time step is less than the time bound,
-		// perform search...
+		// while there is a node to expand, the time step is less than the time bound 
+		// and the wall-clock budget is not used up (checked from the second step on), perform search...
 		int timeStep = 0;
-		while (bestHeuristicNode != NULL && timeStep < timeBound)
+		while (bestHeuristicNode != NULL && timeStep < timeBound && (timeStep == 0 || !timeBudgetExhausted()))
 		{
 			LOG() << endl << "Running " << SearchTypeStrings[searchType] << " search with time step " << timeStep+1 << "/" << timeBound << "..." << endl;
 			clock_t ticInside = clock();
@@ -872,6 +1168,10 @@ namespace HCSearch
 				trainRanker(heuristicModel, bestFeatures, bestLosses, worstFeatures, worstLosses);
 			}
 
+			/***** bound memory of the cost set (if enabled) *****/
+
+			boundCostSet(costSet, bestHeuristicNode, searchType, costModel);
+
 			/***** done with this search step *****/
 
 			clock_t tocInside = clock();
@@ -913,6 +1213,7 @@ namespace HCSearch
 		ImgLabeling prediction = lowestCost->getY();
 		LOG() << endl << "Finished search. Cost=" << lowestCost->getCost() << endl;
 		LOG() << "Num of outputs generated=" << numOutputs << endl << endl;
+		finishSearchStats(timeStep, numOutputs);
 
 		// use best/worst cost set candidates as training examples for cost learning (if applicable)
 		if (searchType == LEARN_C || searchType == LEARN_C_ORACLE_H)
@@ -938,6 +1239,7 @@ namespace HCSearch
 			//}
 			delete state;
 		}
+		this->costSetIndex.clear();
 		//if (YTruth != NULL)
 		//{
 		//	stringstream ssLosses;
@@ -979,11 +1281,14 @@ namespace HCSearch
 		for (vector< SearchNode* >::iterator it = expansionSet.begin(); it != expansionSet.end(); ++it)
 		{
 			SearchNode* state = *it;
-			if (!Global::settings->CHECK_FOR_DUPLICATES || !isDuplicate(state, costSet))
+			if (!Global::settings->CHECK_FOR_DUPLICATES || !isDuplicate(state))
 			{
 				// store to cost set in order to check for duplicates
 				if (Global::settings->CHECK_FOR_DUPLICATES || searchType == LEARN_C || searchType == LEARN_C_ORACLE_H)
+				{
 					costSet.push_back(state);
+					this->costSetIndex.insert(state);
+				}
 
 				// only return nodes when learning H
 				if (searchType == LEARN_H)
@@ -999,6 +1304,10 @@ namespace HCSearch
 
 				numOutputs++;
 			}
+			else
+			{
+				delete state;
+			}
 		}
 
 		if (Global::settings->CHECK_FOR_DUPLICATES)
@@ -1087,18 +1396,65 @@ namespace HCSearch
 		}
 	}
 
-	bool GreedySearchProcedure::isDuplicate(SearchNode* state, SearchNodeList& list)
+	bool GreedySearchProcedure::isDuplicate(SearchNode* state)
 	{
-		for (SearchNodeList::iterator it = list.begin(); it != list.end(); ++it)
+		return this->costSetIndex.contains(state);
+	}
+
+	void GreedySearchProcedure::boundCostSet(SearchNodeList& costSet, SearchNode* bestHeuristicNode, 
+		SearchType searchType, IRankModel* costModel)
+	{
+		const int maxSize = Global::settings->MAX_COST_SET_SIZE;
+		if (maxSize <= 0 || static_cast<int>(costSet.size()) <= 2*maxSize)
+			return;
+
+		// keep the top nodes by cost
+		SearchNodeCostPQ sortedSet(costSet.begin(), costSet.end());
+		const double bestCost = sortedSet.top()->getCost();
+		SearchNodeList keptSet;
+		SearchNodeList evictedNodes;
+		while (!sortedSet.empty())
 		{
-			SearchNode* current = *it;
-			if (current->getY().graph.nodesData == state->getY().graph.nodesData)
+			SearchNode* state = sortedSet.top();
+			sortedSet.pop();
+
+			if (static_cast<int>(keptSet.size()) < maxSize || state->getCost() <= bestCost || state == bestHeuristicNode)
+				keptSet.push_back(state);
+			else
+				evictedNodes.push_back(state);
+		}
+		costSet = keptSet;
+
+		LOG() << "bounded cost set: kept " << costSet.size() << ", evicted " << evictedNodes.size() << endl;
+
+		// stream evicted nodes as worse examples against the current best nodes
+		if ((searchType == LEARN_C || searchType == LEARN_C_ORACLE_H) && !evictedNodes.empty())
+		{
+			vector< RankFeatures > bestFeatures;
+			vector< RankFeatures > worstFeatures;
+			vector< double > bestLosses;
+			vector< double > worstLosses;
+
+			for (SearchNodeList::iterator it = costSet.begin(); it != costSet.end() && (*it)->getCost() <= bestCost; ++it)
 			{
-				return true;
+				bestFeatures.push_back((*it)->getCostFeatures());
+				bestLosses.push_back((*it)->getCost());
 			}
+
+			for (SearchNodeList::iterator it = evictedNodes.begin(); it != evictedNodes.end(); ++it)
+			{
+				worstFeatures.push_back((*it)->getCostFeatures());
+				worstLosses.push_back((*it)->getCost());
+			}
+
+			trainRanker(costModel, bestFeatures, bestLosses, worstFeatures, worstLosses);
 		}
 
-		return false;
+		for (SearchNodeList::iterator it = evictedNodes.begin(); it != evictedNodes.end(); ++it)
+		{
+			this->costSetIndex.retire(*it);
+			delete *it;
+		}
 	}
 
 	/**************** Search Node ****************/
@@ -1107,8 +1463,13 @@ namespace HCSearch
 	{
 	}
 
+	ISearchProcedure::SearchNode::~SearchNode()
+	{
+	}
+
 	ISearchProcedure::SearchNode::SearchNode(ImgFeatures* X, ImgLabeling* YTruth, SearchSpace* searchSpace, 
-			IRankModel* heuristicModel, IRankModel* costModel, SearchType searchType)
+			IRankModel* heuristicModel, IRankModel* costModel, SearchType searchType, 
+			TranspositionTable* transpositionTable)
 	{
 		if (X == NULL || searchSpace == NULL)
 		{
@@ -1123,10 +1484,16 @@ namespace HCSearch
 		this->YTruth = YTruth;
 		this->heuristicModel = heuristicModel;
 		this->costModel = costModel;
+		this->transpositionTable = transpositionTable;
+		this->scoredFromTable = false;
 
 		this->YPred = this->searchSpace->getInitialPrediction(*this->X);
+		this->labelingHash = LabelingHash::compute(this->YPred);
+		this->labelingCheck = LabelingHash::compute(this->YPred, LabelingHash::CHECK_SEED);
+		this->depth = 0;
 
 		constructorHelper();
+		compactLabeling();
 	}
 
 	ISearchProcedure::SearchNode::SearchNode(SearchNode* parent, ImgLabeling YPred)
@@ -1144,14 +1511,80 @@ namespace HCSearch
 		this->YTruth = this->parent->YTruth;
 		this->heuristicModel = this->parent->heuristicModel;
 		this->costModel = this->parent->costModel;
+		this->transpositionTable = this->parent->transpositionTable;
+		this->scoredFromTable = false;
 
 		this->YPred = YPred;
+		this->labelingHash = LabelingHash::compute(this->YPred);
+		this->labelingCheck = LabelingHash::compute(this->YPred, LabelingHash::CHECK_SEED);
+		this->depth = this->parent->depth + 1;
 
 		constructorHelper();
+		compactLabeling();
 	}
 
-	void ISearchProcedure::SearchNode::constructorHelper()
+	ISearchProcedure::SearchNode::SearchNode(SearchNode* parent, ImgCandidate& YCandidate, bool deferRanking)
 	{
+		if (parent == NULL)
+		{
+			LOG(ERROR) << "invalid parameters for search node generation.";
+			abort();
+		}
+
+		this->parent = parent;
+		this->searchSpace = this->parent->searchSpace;
+		this->searchType = this->parent->searchType;
+		this->X = this->parent->X;
+		this->YTruth = this->parent->YTruth;
+		this->heuristicModel = this->parent->heuristicModel;
+		this->costModel = this->parent->costModel;
+		this->transpositionTable = this->parent->transpositionTable;
+		this->scoredFromTable = false;
+
+		this->YPred = YCandidate.getLabeling();
+		if (YCandidate.parent == &this->parent->YPred)
+		{
+			// hashes of a delta candidate follow from the parent's and the relabeled nodes
+			this->labelingHash = this->parent->labelingHash;
+			this->labelingCheck = this->parent->labelingCheck;
+			for (map<int, int>::iterator it = YCandidate.newLabels.begin(); it != YCandidate.newLabels.end(); ++it)
+			{
+				const int node = it->first;
+				const int oldLabel = YCandidate.oldLabels[node];
+				this->labelingHash = LabelingHash::update(this->labelingHash, node, oldLabel, it->second);
+				this->labelingCheck = LabelingHash::update(this->labelingCheck, node, oldLabel, it->second, LabelingHash::CHECK_SEED);
+			}
+		}
+		else
+		{
+			this->labelingHash = LabelingHash::compute(this->YPred);
+			this->labelingCheck = LabelingHash::compute(this->YPred, LabelingHash::CHECK_SEED);
+		}
+		this->depth = this->parent->depth + 1;
+
+		// connected components are derived from the parent's around the action when expanded
+		if (YCandidate.parent == &this->parent->YPred && this->parent->YPred.labelComponents)
+		{
+			this->parentLabelComponents = this->parent->YPred.labelComponents;
+			this->parentAction = YCandidate.action;
+		}
+
+		// reuse the scores of a labeling seen before in this search; 
+		// otherwise features can only be updated from the parent if the candidate is a delta against it
+		if (lookupTranspositionTable())
+			this->scoredFromTable = true;
+		else if (YCandidate.parent == &this->parent->YPred)
+			constructorHelper(&YCandidate, deferRanking);
+		else
+			constructorHelper(NULL, deferRanking);
+		compactLabeling();
+	}
+
+	void ISearchProcedure::SearchNode::constructorHelper(ImgCandidate* YCandidate, bool deferRanking)
+	{
+		const FeatureAccumulators* parentHeuristicAcc = this->parent != NULL ? &this->parent->heuristicAccumulators : NULL;
+		const FeatureAccumulators* parentCostAcc = this->parent != NULL ? &this->parent->costAccumulators : NULL;
+
 		double loss;
 		if (this->YTruth != NULL)
 		{
@@ -1168,44 +1601,57 @@ namespace HCSearch
 			}
 			case HL:
 			{
-				this->heuristicFeatures = this->searchSpace->computeHeuristicFeatures(*this->X, this->YPred);
-				this->heuristic = this->heuristicModel->rank(this->heuristicFeatures);
+				this->heuristicFeatures = this->searchSpace->computeHeuristicFeatures(*this->X, this->YPred, 
+					YCandidate, parentHeuristicAcc, this->heuristicAccumulators);
+				if (!deferRanking)
+					this->heuristic = this->heuristicModel->rank(this->heuristicFeatures);
 				this->cost = loss;
 				break;
 			}
 			case LC:
 			{
 				this->heuristic = loss;
-				this->costFeatures = this->searchSpace->computeCostFeatures(*this->X, this->YPred);
-				this->cost = this->costModel->rank(this->costFeatures);
+				this->costFeatures = this->searchSpace->computeCostFeatures(*this->X, this->YPred, 
+					YCandidate, parentCostAcc, this->costAccumulators);
+				if (!deferRanking)
+					this->cost = this->costModel->rank(this->costFeatures);
 				break;
 			}
 			case HC:
 			{
-				this->heuristicFeatures = this->searchSpace->computeHeuristicFeatures(*this->X, this->YPred);
-				this->heuristic = this->heuristicModel->rank(this->heuristicFeatures);
-				this->costFeatures = this->searchSpace->computeCostFeatures(*this->X, this->YPred);
-				this->cost = this->costModel->rank(this->costFeatures);
+				this->heuristicFeatures = this->searchSpace->computeHeuristicFeatures(*this->X, this->YPred, 
+					YCandidate, parentHeuristicAcc, this->heuristicAccumulators);
+				if (!deferRanking)
+					this->heuristic = this->heuristicModel->rank(this->heuristicFeatures);
+				this->costFeatures = this->searchSpace->computeCostFeatures(*this->X, this->YPred, 
+					YCandidate, parentCostAcc, this->costAccumulators);
+				if (!deferRanking)
+					this->cost = this->costModel->rank(this->costFeatures);
 				break;
 			}
 			case LEARN_H:
 			{
-				this->heuristicFeatures = this->searchSpace->computeHeuristicFeatures(*this->X, this->YPred);
+				this->heuristicFeatures = this->searchSpace->computeHeuristicFeatures(*this->X, this->YPred, 
+					YCandidate, parentHeuristicAcc, this->heuristicAccumulators);
 				this->heuristic = loss;
 				this->cost = loss;
 				break;
 			}
 			case LEARN_C:
 			{
-				this->heuristicFeatures = this->searchSpace->computeHeuristicFeatures(*this->X, this->YPred);
-				this->costFeatures = this->searchSpace->computeCostFeatures(*this->X, this->YPred);
-				this->heuristic = this->heuristicModel->rank(this->heuristicFeatures);
+				this->heuristicFeatures = this->searchSpace->computeHeuristicFeatures(*this->X, this->YPred, 
+					YCandidate, parentHeuristicAcc, this->heuristicAccumulators);
+				this->costFeatures = this->searchSpace->computeCostFeatures(*this->X, this->YPred, 
+					YCandidate, parentCostAcc, this->costAccumulators);
+				if (!deferRanking)
+					this->heuristic = this->heuristicModel->rank(this->heuristicFeatures);
 				this->cost = loss;
 				break;
 			}
 			case LEARN_C_ORACLE_H:
 			{
-				this->costFeatures = this->searchSpace->computeCostFeatures(*this->X, this->YPred);
+				this->costFeatures = this->searchSpace->computeCostFeatures(*this->X, this->YPred, 
+					YCandidate, parentCostAcc, this->costAccumulators);
 				this->heuristic = loss;
 				this->cost = loss;
 				break;
@@ -1224,6 +1670,8 @@ namespace HCSearch
 	vector< ISearchProcedure::SearchNode* > ISearchProcedure::SearchNode::generateSuccessorNodes(bool prune, int timeStep, int timeBound, ImgLabeling* YTruth)
 	{
 		vector< SearchNode* > successors;
+		restoreLabeling();
+		updateLabelComponents();
 
 		// generate successors
 		vector< ImgCandidate > YPredSet = this->searchSpace->generateSuccessors(*this->X, this->YPred, timeStep, timeBound);
@@ -1234,19 +1682,153 @@ namespace HCSearch
 			YPredSet = this->searchSpace->pruneSuccessors(*this->X, this->YPred, YPredSet, YTruth, this->searchSpace->getLossFunction());
 		LOG() << "successors pruned." << endl;
 
-		for (vector< ImgCandidate >::iterator it = YPredSet.begin(); it != YPredSet.end(); it++)
+		// only materialize the labelings that survived pruning; 
+		// node construction only reads from this node, so successors can be 
+		// built and scored in parallel, each written to its candidate's slot
+		const int numCandidates = YPredSet.size();
+		successors.resize(numCandidates, NULL);
+
+#ifdef _OPENMP
+		#pragma omp parallel for num_threads(Global::settings->NUM_THREADS) schedule(dynamic) if(Global::settings->NUM_THREADS > 1)
+#endif
+		for (int i = 0; i < numCandidates; i++)
 		{
-			ImgCandidate YCandidate = *it;
-			ImgLabeling YCandPred = YCandidate.labeling;
-			SearchNode* successor = new SearchNode(this, YCandPred);
-			successors.push_back(successor);
+			successors[i] = new SearchNode(this, YPredSet[i], true);
 		}
+
+		// score all successors in one batch per model
+		rankNodes(successors);
+		updateTranspositionTable(successors);
+
+		releaseLabeling();
 		return successors;
 	}
 
+	void ISearchProcedure::SearchNode::rankNodes(vector< SearchNode* >& nodes)
+	{
+		// nodes scored from the transposition table are already ranked
+		vector< SearchNode* > unranked;
+		for (vector< SearchNode* >::iterator it = nodes.begin(); it != nodes.end(); ++it)
+		{
+			if (!(*it)->scoredFromTable)
+				unranked.push_back(*it);
+		}
+
+		if (unranked.empty())
+			return;
+
+		SearchNode* first = unranked.front();
+		switch (first->searchType)
+		{
+			case HL:
+			case LEARN_C:
+				rankNodes(unranked, first->heuristicModel, &SearchNode::heuristicFeatures, &SearchNode::heuristic);
+				break;
+			case LC:
+				rankNodes(unranked, first->costModel, &SearchNode::costFeatures, &SearchNode::cost);
+				break;
+			case HC:
+				rankNodes(unranked, first->heuristicModel, &SearchNode::heuristicFeatures, &SearchNode::heuristic);
+				rankNodes(unranked, first->costModel, &SearchNode::costFeatures, &SearchNode::cost);
+				break;
+			default:
+				break;
+		}
+	}
+
+	bool ISearchProcedure::SearchNode::lookupTranspositionTable()
+	{
+		if (this->transpositionTable == NULL || !this->transpositionTable->isEnabled())
+			return false;
+
+		const TranspositionTable::Entry* entry = this->transpositionTable->find(this->labelingHash, this->labelingCheck);
+		if (entry == NULL)
+			return false;
+
+		// learning needs the features of every node
+		const bool needsFeatures = this->searchType == LEARN_H || this->searchType == LEARN_C 
+			|| this->searchType == LEARN_C_ORACLE_H || this->searchType == LEARN_PRUNE;
+		if (needsFeatures && !entry->hasFeatures)
+			return false;
+
+		this->heuristic = entry->heuristic;
+		this->cost = entry->cost;
+		if (entry->hasFeatures)
+		{
+			this->heuristicFeatures = entry->heuristicFeatures;
+			this->costFeatures = entry->costFeatures;
+			this->heuristicAccumulators = entry->heuristicAccumulators;
+			this->costAccumulators = entry->costAccumulators;
+		}
+		return true;
+	}
+
+	void ISearchProcedure::SearchNode::updateTranspositionTable(vector< SearchNode* >& successors)
+	{
+		for (vector< SearchNode* >::iterator it = successors.begin(); it != successors.end(); ++it)
+		{
+			SearchNode* node = *it;
+			if (node->transpositionTable == NULL || !node->transpositionTable->isEnabled())
+				return;
+
+			node->transpositionTable->recordLookup(node->labelingHash, node->scoredFromTable);
+			if (!node->scoredFromTable)
+				node->transpositionTable->insert(node->labelingHash, node->labelingCheck, node->heuristic, node->cost, 
+					node->heuristicFeatures, node->costFeatures, node->heuristicAccumulators, node->costAccumulators);
+		}
+	}
+
+	void ISearchProcedure::SearchNode::rankNodes(vector< SearchNode* >& nodes, IRankModel* model, 
+		RankFeatures SearchNode::* features, double SearchNode::* value)
+	{
+		const int numNodes = nodes.size();
+		const int featureDim = (nodes.front()->*features).size();
+
+		bool sparse = false;
+		for (int i = 0; i < numNodes; i++)
+		{
+			const RankFeatures& nodeFeatures = nodes[i]->*features;
+			if (nodeFeatures.size() != featureDim)
+			{
+				LOG(ERROR) << "features of search nodes have different dimensions!";
+				abort();
+			}
+			sparse = sparse || nodeFeatures.sparse;
+		}
+
+		// sparse features are ranked one by one in O(nnz) instead of densified
+		if (sparse)
+		{
+			vector<RankFeatures> featuresList;
+			for (int i = 0; i < numNodes; i++)
+				featuresList.push_back(nodes[i]->*features);
+
+			vector<double> ranks = model->rank(featuresList);
+			for (int i = 0; i < numNodes; i++)
+			{
+				nodes[i]->*value = ranks[i];
+			}
+			return;
+		}
+
+		RankFeaturesMatrix featuresMatrix(numNodes, featureDim);
+		for (int i = 0; i < numNodes; i++)
+		{
+			featuresMatrix.row(i) = (nodes[i]->*features).data.transpose();
+		}
+
+		VectorXd ranks = model->rank(featuresMatrix);
+		for (int i = 0; i < numNodes; i++)
+		{
+			nodes[i]->*value = ranks(i);
+		}
+	}
+
 	vector< ISearchProcedure::SearchNode* > ISearchProcedure::SearchNode::generateSuccessorNodesForPruneLearning(IRankModel* learningModel, 
 		ImgLabeling* YTruth, int timeStep, int timeBound)
 	{
+		restoreLabeling();
+		updateLabelComponents();
 		const double pruneFraction = this->searchSpace->getPruneFunction()->getPruneFraction();
 		
 		// setup
@@ -1258,6 +1840,10 @@ namespace HCSearch
 		// generate all successors before pruning
 		vector< ImgCandidate > YPredSet = this->searchSpace->generateSuccessors(*this->X, this->YPred, timeStep, timeBound);
 
+		// prune features of the successors are updated from the sums of the current state
+		FeatureAccumulators pruneAcc;
+		this->searchSpace->computePruneAccumulators(*this->X, this->YPred, pruneAcc);
+
 		// set up pruning priority queue
 		const int numOriginalCandidates = YPredSet.size();
 		const int numNewCandidates = static_cast<int>((1-pruneFraction)*numOriginalCandidates);
@@ -1273,14 +1859,12 @@ namespace HCSearch
 		RankPruneNode bestGoodCandidate;
 		for (vector< ImgCandidate >::iterator it = YPredSet.begin(); it != YPredSet.end(); it++)
 		{
-			ImgCandidate YCandidate = *it;
-			ImgLabeling YCandPred = YCandidate.labeling;
+			ImgCandidate& YCandidate = *it;
 
-			double candLoss = this->searchSpace->computeLoss(YCandPred, *YTruth);
+			double candLoss = this->searchSpace->computeLoss(YCandidate, *YTruth);
 
 			// get rank
-			set<int> action = YCandidate.action;
-			RankFeatures pruneFeatures = this->searchSpace->computePruneFeatures(*this->X, YCandPred, action);
+			RankFeatures pruneFeatures = this->searchSpace->computePruneFeatures(*this->X, YCandidate, pruneAcc);
 			RankerPrune* pruneRanker = dynamic_cast<RankerPrune*>(this->searchSpace->getPruneFunction());
 			if (pruneRanker == NULL)
 			{
@@ -1327,7 +1911,6 @@ namespace HCSearch
 		for (int i = 0; i < topKSize; i++)
 		{
 			RankPruneNode rankNode = topK[i];
-			ImgLabeling YCandPred = rankNode.YCandidate.labeling;
 
 			if (rankNode.good)
 			{
@@ -1349,12 +1932,10 @@ namespace HCSearch
 			vector<double> goodLosses;
 			for (vector<RankPruneNode>::iterator it = goodSet.begin(); it != goodSet.end(); ++it)
 			{
-				RankPruneNode node = *it;
-				ImgLabeling YCandPred = node.YCandidate.labeling;
-				set<int> action = node.YCandidate.action;
+				RankPruneNode& node = *it;
 
-				RankFeatures pruneFeatures = this->searchSpace->computePruneFeatures(*this->X, YCandPred, action);
-				double candLoss = this->searchSpace->computeLoss(YCandPred, *YTruth);
+				RankFeatures pruneFeatures = this->searchSpace->computePruneFeatures(*this->X, node.YCandidate, pruneAcc);
+				double candLoss = this->searchSpace->computeLoss(node.YCandidate, *YTruth);
 
 				goodFeatures.push_back(pruneFeatures);
 				goodLosses.push_back(candLoss);
@@ -1365,15 +1946,12 @@ namespace HCSearch
 			vector<double> badLosses;
 			for (vector<RankPruneNode>::iterator it = topK.begin(); it != topK.end(); ++it)
 			{
-				RankPruneNode node = *it;
+				RankPruneNode& node = *it;
 				if (node.good)
 					continue;
 
-				ImgLabeling YCandPred = node.YCandidate.labeling;
-				set<int> action = node.YCandidate.action;
-
-				RankFeatures pruneFeatures = this->searchSpace->computePruneFeatures(*this->X, YCandPred, action);
-				double candLoss = this->searchSpace->computeLoss(YCandPred, *YTruth);
+				RankFeatures pruneFeatures = this->searchSpace->computePruneFeatures(*this->X, node.YCandidate, pruneAcc);
+				double candLoss = this->searchSpace->computeLoss(node.YCandidate, *YTruth);
 
 				badFeatures.push_back(pruneFeatures);
 				badLosses.push_back(candLoss);
@@ -1407,17 +1985,20 @@ namespace HCSearch
 		// otherwise stop search (no successor)
 		if (goodExists)
 		{
-			ImgLabeling bestCandidate = bestGoodCandidate.YCandidate.labeling;
+			ImgLabeling bestCandidate = bestGoodCandidate.YCandidate.getLabeling();
 			SearchNode* successor = new SearchNode(this, bestCandidate);
 			successors.push_back(successor);
 		}
 
+		releaseLabeling();
 		return successors;
 	}
 
 	vector< ISearchProcedure::SearchNode* > ISearchProcedure::SearchNode::generateSuccessorNodesForPruneLearningOldVersion(IRankModel* learningModel, 
 		ImgLabeling* YTruth, int timeStep, int timeBound)
 	{
+		restoreLabeling();
+		updateLabelComponents();
 		vector< SearchNode* > successors;
 
 		double prevLoss = this->searchSpace->computeLoss(this->YPred, *YTruth);
@@ -1426,16 +2007,18 @@ namespace HCSearch
 		// generate successors
 		vector< ImgCandidate > YPredSet = this->searchSpace->generateSuccessors(*this->X, this->YPred, timeStep, timeBound);
 
+		// prune features of the successors are updated from the sums of the current state
+		FeatureAccumulators pruneAcc;
+		this->searchSpace->computePruneAccumulators(*this->X, this->YPred, pruneAcc);
+
 		// collect training examples
 		for (vector< ImgCandidate >::iterator it = YPredSet.begin(); it != YPredSet.end(); it++)
 		{
-			ImgCandidate YCandidate = *it;
-			ImgLabeling YCandPred = YCandidate.labeling;
+			ImgCandidate& YCandidate = *it;
 			
 			// collect training examples
-			double candLoss = this->searchSpace->computeLoss(YCandPred, *YTruth);
-			set<int> action = YCandidate.action;
-			RankFeatures pruneFeatures = this->searchSpace->computePruneFeatures(*this->X, YCandPred, action);
+			double candLoss = this->searchSpace->computeLoss(YCandidate, *YTruth);
+			RankFeatures pruneFeatures = this->searchSpace->computePruneFeatures(*this->X, YCandidate, pruneAcc);
 
 			if (learningModel->rankerType() == SVM_RANK)
 			{
@@ -1462,9 +2045,10 @@ namespace HCSearch
 			}
 
 			// generate examples
-			SearchNode* successor = new SearchNode(this, YCandPred);
+			SearchNode* successor = new SearchNode(this, YCandidate.getLabeling());
 			successors.push_back(successor);
 		}
+		releaseLabeling();
 		return successors;
 	}
 
@@ -1502,7 +2086,122 @@ namespace HCSearch
 
 	ImgLabeling ISearchProcedure::SearchNode::getY()
 	{
-		return this->YPred;
+		if (!this->compact)
+			return this->YPred;
+
+		ImgLabeling Y = this->YPred;
+		Y.graph.nodesData = getLabels();
+		return Y;
+	}
+
+	LabelingHash_t ISearchProcedure::SearchNode::getLabelingHash()
+	{
+		return this->labelingHash;
+	}
+
+	LabelingHash_t ISearchProcedure::SearchNode::getLabelingCheck()
+	{
+		return this->labelingCheck;
+	}
+
+	bool ISearchProcedure::SearchNode::hasSameLabeling(SearchNode* other)
+	{
+		if (this->labelingHash != other->labelingHash)
+			return false;
+
+		if (!this->compact && !other->compact)
+			return this->YPred.graph.nodesData == other->YPred.graph.nodesData;
+
+		// deltas against the same snapshot only contain labels that differ from it
+		if (this->compact && other->compact && this->snapshotLabels == other->snapshotLabels)
+			return this->snapshotDelta == other->snapshotDelta;
+
+		return getLabels() == other->getLabels();
+	}
+
+	void ISearchProcedure::SearchNode::compactLabeling()
+	{
+		this->compact = false;
+
+		const int interval = Global::settings->SEARCH_NODE_SNAPSHOT_INTERVAL;
+		if (interval <= 0)
+			return;
+
+		const VectorXi& labels = this->YPred.graph.nodesData;
+		const int numNodes = labels.size();
+		this->snapshotDelta.clear();
+
+		bool fullSnapshot = this->parent == NULL || this->depth % interval == 0 || this->parent->snapshotLabels == NULL;
+		if (!fullSnapshot)
+		{
+			// a (node, label) entry takes twice the space of a label in a snapshot
+			const VectorXi& snapshot = *this->parent->snapshotLabels;
+			const int deltaSize = (labels.array() != snapshot.array()).count();
+			fullSnapshot = 2*deltaSize > numNodes;
+
+			if (!fullSnapshot)
+			{
+				this->snapshotLabels = this->parent->snapshotLabels;
+				this->snapshotDelta.reserve(deltaSize);
+				for (int node = 0; node < numNodes; node++)
+				{
+					if (labels(node) != snapshot(node))
+						this->snapshotDelta.push_back(make_pair(node, labels(node)));
+				}
+			}
+		}
+
+		if (fullSnapshot)
+		{
+			// full snapshot, shared with the descendants up to the next snapshot level
+			this->snapshotLabels = make_shared< const VectorXi >(labels);
+		}
+
+		releaseLabeling();
+	}
+
+	void ISearchProcedure::SearchNode::restoreLabeling()
+	{
+		if (!this->compact)
+			return;
+
+		this->YPred.graph.nodesData = getLabels();
+		this->compact = false;
+	}
+
+	void ISearchProcedure::SearchNode::releaseLabeling()
+	{
+		if (this->snapshotLabels == NULL)
+			return;
+
+		this->YPred.graph.nodesData.resize(0);
+		this->YPred.labelComponents.reset();
+		this->compact = true;
+	}
+
+	void ISearchProcedure::SearchNode::updateLabelComponents()
+	{
+		if (this->parentLabelComponents)
+		{
+			this->YPred.labelComponents = shared_ptr< const LabelComponents >(
+				this->parentLabelComponents->update(this->YPred, this->parentAction));
+			this->parentLabelComponents.reset();
+			this->parentAction.clear();
+		}
+
+		// computed from scratch if missing
+		this->YPred.getLabelComponents();
+	}
+
+	VectorXi ISearchProcedure::SearchNode::getLabels()
+	{
+		if (!this->compact)
+			return this->YPred.graph.nodesData;
+
+		VectorXi labels = *this->snapshotLabels;
+		for (vector< pair<int, int> >::iterator it = this->snapshotDelta.begin(); it != this->snapshotDelta.end(); ++it)
+			labels(it->first) = it->second;
+		return labels;
 	}
 
 	SearchType ISearchProcedure::SearchNode::getType()
@@ -1510,6 +2209,100 @@ namespace HCSearch
 		return this->searchType;
 	}
 
+	/**************** Search Node Index ****************/
+
+	ISearchProcedure::SearchNodeIndex::SearchNodeIndex()
+	{
+		this->numNodes = 0;
+		this->numCollisions = 0;
+	}
+
+	ISearchProcedure::SearchNodeIndex::~SearchNodeIndex()
+	{
+	}
+
+	bool ISearchProcedure::SearchNodeIndex::contains(SearchNode* state)
+	{
+		bool hashFound = false;
+
+		// retired nodes: verified with the check hash (labeling was released)
+		pair< Retired_t::iterator, Retired_t::iterator > range = this->retired.equal_range(state->getLabelingHash());
+		for (Retired_t::iterator it = range.first; it != range.second; ++it)
+		{
+			if (it->second == state->getLabelingCheck())
+				return true;
+			hashFound = true;
+		}
+
+		Buckets_t::iterator bucket = this->buckets.find(state->getLabelingHash());
+		if (bucket != this->buckets.end())
+		{
+			// verify exactly: only nodes with the same hash are compared
+			vector< SearchNode* >& nodes = bucket->second;
+			for (vector< SearchNode* >::iterator it = nodes.begin(); it != nodes.end(); ++it)
+			{
+				if ((*it)->hasSameLabeling(state))
+					return true;
+			}
+			hashFound = true;
+		}
+
+		if (hashFound)
+			this->numCollisions++;
+		return false;
+	}
+
+	void ISearchProcedure::SearchNodeIndex::insert(SearchNode* state)
+	{
+		this->buckets[state->getLabelingHash()].push_back(state);
+		this->numNodes++;
+	}
+
+	void ISearchProcedure::SearchNodeIndex::erase(SearchNode* state)
+	{
+		Buckets_t::iterator bucket = this->buckets.find(state->getLabelingHash());
+		if (bucket == this->buckets.end())
+			return;
+
+		vector< SearchNode* >& nodes = bucket->second;
+		vector< SearchNode* >::iterator it = find(nodes.begin(), nodes.end(), state);
+		if (it == nodes.end())
+			return;
+
+		nodes.erase(it);
+		if (nodes.empty())
+			this->buckets.erase(bucket);
+		this->numNodes--;
+	}
+
+	void ISearchProcedure::SearchNodeIndex::retire(SearchNode* state)
+	{
+		erase(state);
+		this->retired.insert(make_pair(state->getLabelingHash(), state->getLabelingCheck()));
+		this->numNodes++;
+	}
+
+	void ISearchProcedure::SearchNodeIndex::clear()
+	{
+		if (this->numCollisions > 0)
+			LOG(DEBUG) << "labeling hash collisions=" << this->numCollisions << endl;
+
+		this->buckets.clear();
+		this->retired.clear();
+		this->numNodes = 0;
+		this->numCollisions = 0;
+	}
+
+	int ISearchProcedure::SearchNodeIndex::size()
+	{
+		return this->numNodes;
+	}
+
+	int ISearchProcedure::SearchNodeIndex::getNumCollisions()
+	{
+		return this->numCollisions;
+	}
+
 	/**************** Compare Search Node ****************/
 
 	bool ISearchProcedure::CompareByHeuristic::operator() (SearchNode*& lhs, SearchNode*& rhs) const
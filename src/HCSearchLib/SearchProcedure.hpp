@@ -2,6 +2,9 @@
 #define SEARCHPROCEDURE_HPP
 
 #include <vector>
+#include <list>
+#include <unordered_map>
+#include <chrono>
 #include "DataStructures.hpp"
 #include "SearchSpace.hpp"
 
@@ -48,6 +51,92 @@ namespace HCSearch
 		static void finishLearning(IRankModel* learningModel, SearchType searchType);
 	};
 
+	/**************** Transposition Table ****************/
+
+	/*!
+	 * @brief Bounded cache of scored labelings, keyed by labeling hash.
+	 * 
+	 * Successors that regenerate a labeling already scored during the same search 
+	 * reuse its heuristic and cost values (and features if stored) instead of 
+	 * recomputing them. find() may be called concurrently; all other methods 
+	 * must be called serially.
+	 */
+	class TranspositionTable
+	{
+	public:
+		struct Entry
+		{
+			double heuristic;
+			double cost;
+			LabelingHash_t check; //!< Independent hash of the labeling to detect collisions
+			bool hasFeatures;
+			RankFeatures heuristicFeatures;
+			RankFeatures costFeatures;
+			FeatureAccumulators heuristicAccumulators;
+			FeatureAccumulators costAccumulators;
+			list< LabelingHash_t >::iterator position; //!< Position in the eviction order
+		};
+
+	protected:
+		typedef unordered_map< LabelingHash_t, Entry > Entries_t;
+
+		Entries_t entries; //!< Labeling hash -> cached scores
+		list< LabelingHash_t > evictionOrder; //!< Front is evicted first
+		int capacity; //!< Maximum number of entries (0 if disabled)
+		EvictionPolicy policy; //!< Eviction policy when full
+		bool storeFeatures; //!< True if feature vectors are cached
+
+		int numLookups; //!< Number of lookups since reset
+		int numHits; //!< Number of hits since reset
+		int numEvictions; //!< Number of evicted entries since reset
+
+	public:
+		TranspositionTable();
+
+		/*!
+		 * Clear the table and reconfigure it.
+		 */
+		void reset(int capacity, EvictionPolicy policy, bool storeFeatures);
+
+		/*!
+		 * True if the table has a nonzero capacity.
+		 */
+		bool isEnabled() const;
+
+		/*!
+		 * True if feature vectors are cached.
+		 */
+		bool storesFeatures() const;
+
+		/*!
+		 * Find the entry of a labeling hash. Returns NULL if not found 
+		 * or if the entry belongs to another labeling with the same hash.
+		 */
+		const Entry* find(LabelingHash_t hash, LabelingHash_t check) const;
+
+		/*!
+		 * Record the result of a lookup (updates hit rates and recency).
+		 */
+		void recordLookup(LabelingHash_t hash, bool hit);
+
+		/*!
+		 * Insert a scored labeling, evicting according to the policy if full.
+		 */
+		void insert(LabelingHash_t hash, LabelingHash_t check, double heuristic, double cost, 
+			const RankFeatures& heuristicFeatures, const RankFeatures& costFeatures, 
+			const FeatureAccumulators& heuristicAccumulators, const FeatureAccumulators& costAccumulators);
+
+		int size() const;
+		int getNumLookups() const;
+		int getNumHits() const;
+		int getNumEvictions() const;
+
+		/*!
+		 * Fraction of lookups that were hits.
+		 */
+		double getHitRate() const;
+	};
+
 	/*!
 	 * @defgroup SearchProcedure Search Procedure
 	 * @brief Provides an interface for setting up a search procedure.
@@ -78,12 +167,41 @@ namespace HCSearch
 			// stochastic iteration
 			int iter;
 
+			// wall-clock time budget in milliseconds (0 for no budget)
+			int timeBudget;
+
 		public:
 			SearchMetadata();
 		};
+
+		// Statistics of the last search
+		struct SearchStats
+		{
+			// number of completed search steps
+			int numSteps;
+
+			// number of search nodes generated (excluding duplicates)
+			int numNodes;
+
+			// elapsed wall-clock time in milliseconds
+			double elapsedTime;
+
+			// true if search stopped because the time budget was exhausted
+			bool budgetExhausted;
+
+			// transposition table lookups and hits
+			int numTableLookups;
+			int numTableHits;
+
+		public:
+			SearchStats();
+		};
 	
 	protected:
+		typedef chrono::steady_clock WallClock;
+
 		class SearchNode;
+		class SearchNodeIndex;
 		class CompareByHeuristic;
 		class CompareByCost;
 
@@ -94,6 +212,11 @@ namespace HCSearch
 		ofstream* anytimeCostNodesFile;
 		bool writingToFile;
 
+		WallClock::time_point searchStartTime; //!< Start time of the current search
+		int searchTimeBudget; //!< Wall-clock time budget of the current search in ms (0 for none)
+		SearchStats lastSearchStats; //!< Statistics of the last search
+		TranspositionTable transpositionTable; //!< Scores of labelings seen during the current search
+
 	public:
 		virtual ~ISearchProcedure() {}
 
@@ -106,7 +229,35 @@ namespace HCSearch
 			int timeBound, SearchSpace* searchSpace, IRankModel* heuristicModel, IRankModel* costModel, 
 			IRankModel* pruneModel, SearchMetadata searchMetadata)=0;
 
+		/*!
+		 * @brief Get the statistics of the last search.
+		 */
+		SearchStats getLastSearchStats();
+
 	protected:
+		/*!
+		 * @brief Start the wall-clock time budget of a search (monotonic clock).
+		 * 
+		 * A budget of 0 means the search is only bounded by time steps. 
+		 * The first search step always runs, so at least one node is expanded.
+		 */
+		void startTimeBudget(int timeBudget);
+
+		/*!
+		 * @brief Check if the wall-clock time budget of the current search is used up.
+		 */
+		bool timeBudgetExhausted();
+
+		/*!
+		 * @brief Clear and configure the transposition table for a new search.
+		 */
+		void resetTranspositionTable();
+
+		/*!
+		 * @brief Record and log the statistics of the finished search.
+		 */
+		void finishSearchStats(int numSteps, int numNodes);
+
 		/*!
 		 * @brief Create the root node of the search tree.
 		 */
@@ -122,12 +273,86 @@ namespace HCSearch
 		void trainCostRanker(IRankModel* ranker, SearchNodeCostPQ& costSet);
 	};
 
+	/**************** Search Node Index ****************/
+
+	/*!
+	 * @brief Hash index of the labelings of visited search nodes.
+	 * 
+	 * Nodes are bucketed by their labeling hash, so a lookup only 
+	 * compares full labelings against nodes with the same hash. 
+	 * Retired nodes (deleted before the end of the search) are only 
+	 * remembered by their labeling hash and check hash.
+	 */
+	class ISearchProcedure::SearchNodeIndex
+	{
+	protected:
+		typedef unordered_map< LabelingHash_t, vector< SearchNode* > > Buckets_t;
+		typedef unordered_multimap< LabelingHash_t, LabelingHash_t > Retired_t;
+
+		Buckets_t buckets; //!< Labeling hash -> nodes with that hash
+		Retired_t retired; //!< Labeling hash -> check hash of retired nodes
+		int numNodes; //!< Number of indexed nodes (including retired)
+		int numCollisions; //!< Number of hash matches with different labelings
+
+	public:
+		SearchNodeIndex();
+		~SearchNodeIndex();
+
+		/*!
+		 * Check if a node with the same labeling is indexed.
+		 */
+		bool contains(SearchNode* state);
+
+		/*!
+		 * Add the node to the index.
+		 */
+		void insert(SearchNode* state);
+
+		/*!
+		 * Remove the node from the index. Does not delete the node.
+		 */
+		void erase(SearchNode* state);
+
+		/*!
+		 * Keep only the hashes of the node in the index, so its labeling 
+		 * is still found after the node is deleted. Does not delete the node.
+		 */
+		void retire(SearchNode* state);
+
+		/*!
+		 * Remove all nodes from the index. Does not delete nodes.
+		 */
+		void clear();
+
+		/*!
+		 * Get the number of indexed nodes.
+		 */
+		int size();
+
+		/*!
+		 * Get the number of hash collisions resolved by exact comparison.
+		 */
+		int getNumCollisions();
+	};
+
 	/*!
 	 * @brief Basic search procedure abstract definition.
 	 * Implements a generic search procedure, where you must define the virtual "stubs."
 	 */
 	class IBasicSearchProcedure : public ISearchProcedure
 	{
+	protected:
+		/*!
+		 * Labelings of all nodes accepted into the candidate or cost sets during the current search.
+		 */
+		SearchNodeIndex visitedIndex;
+
+		/*!
+		 * Number of non-duplicate nodes generated during the current search, 
+		 * including nodes later evicted from the cost set.
+		 */
+		int numGenerated;
+
 	public:
 		virtual ImgLabeling performSearch(SearchType searchType, ImgFeatures& X, ImgLabeling* YTruth, 
 			int timeBound, SearchSpace* searchSpace, IRankModel* heuristicModel, IRankModel* costModel, 
@@ -142,9 +367,9 @@ namespace HCSearch
 		/*!
 		 * @brief Stub for expanding the elements.
 		 * 
-		 * openSet may be modified. costSet is used for duplicate checking.
+		 * openSet may be modified. Duplicates are checked against the visited index.
 		 */
-		virtual SearchNodeHeuristicPQ expandElements(vector< SearchNode* > subsetOpenSet, SearchNodeHeuristicPQ& openSet, SearchNodeCostPQ& costSet,
+		virtual SearchNodeHeuristicPQ expandElements(vector< SearchNode* > subsetOpenSet, SearchNodeHeuristicPQ& openSet,
 			IRankModel* pruneModel, ImgLabeling* YTruth, SearchType searchType, int timeStep, int timeBound)=0;
 
 		/*!
@@ -158,10 +383,22 @@ namespace HCSearch
 			vector< RankFeatures >& bestSet, vector< double >& bestLosses, vector< RankFeatures >& worstSet, vector< double >& worstLosses)=0;
 
 		/*!
-		 * @brief Checks if the state is duplicate among the states in the priority queue.
+		 * @brief Checks if the state is duplicate among the states visited so far.
 		 */
-		template <class T>
-		bool isDuplicate(SearchNode* state, T& pq);
+		bool isDuplicate(SearchNode* state);
+
+		/*!
+		 * @brief Bound the cost set to the lowest-cost nodes.
+		 * 
+		 * When the cost set grows past twice Global::settings->MAX_COST_SET_SIZE, 
+		 * it is trimmed back to the top nodes by cost. Nodes tied with the best cost 
+		 * and nodes still in the open set are always kept. When learning the cost 
+		 * function, the evicted nodes are written to the ranker as worse examples 
+		 * against the current best nodes before they are deleted. Evicted labelings 
+		 * stay retired in the visited index, so they are never accepted again.
+		 */
+		void boundCostSet(SearchNodeCostPQ& costSet, SearchNodeHeuristicPQ& openSet, 
+			SearchType searchType, IRankModel* costModel);
 
 		/*!
 		 * @brief Empty priority queue and delete all elements.
@@ -196,7 +433,7 @@ namespace HCSearch
 		~BreadthFirstBeamSearchProcedure();
 
 		virtual vector< SearchNode* > selectSubsetOpenSet(SearchNodeHeuristicPQ& openSet);
-		virtual SearchNodeHeuristicPQ expandElements(vector< SearchNode* > subsetOpenSet, SearchNodeHeuristicPQ& openSet, SearchNodeCostPQ& costSet,
+		virtual SearchNodeHeuristicPQ expandElements(vector< SearchNode* > subsetOpenSet, SearchNodeHeuristicPQ& openSet,
 			IRankModel* pruneModel, ImgLabeling* YTruth, SearchType searchType, int timeStep, int timeBound);
 		virtual void chooseSuccessors(SearchType searchType, SearchNodeHeuristicPQ& candidateSet, SearchNodeHeuristicPQ& openSet, SearchNodeCostPQ& costSet, 
 			vector< RankFeatures >& bestSet, vector< double >& bestLosses, vector< RankFeatures >& worstSet, vector< double >& worstLosses);
@@ -215,7 +452,7 @@ namespace HCSearch
 		~BestFirstBeamSearchProcedure();
 
 		virtual vector< SearchNode* > selectSubsetOpenSet(SearchNodeHeuristicPQ& openSet);
-		virtual SearchNodeHeuristicPQ expandElements(vector< SearchNode* > subsetOpenSet, SearchNodeHeuristicPQ& openSet, SearchNodeCostPQ& costSet, 
+		virtual SearchNodeHeuristicPQ expandElements(vector< SearchNode* > subsetOpenSet, SearchNodeHeuristicPQ& openSet,
 			IRankModel* pruneModel, ImgLabeling* YTruth, SearchType searchType, int timeStep, int timeBound);
 	};
 
@@ -229,6 +466,12 @@ namespace HCSearch
 	protected:
 		typedef vector< SearchNode* > SearchNodeList;
 
+		/*!
+		 * Labelings of all nodes in the cost set during the current search 
+		 * (evicted nodes are kept as retired).
+		 */
+		SearchNodeIndex costSetIndex;
+
 	public:
 		GreedySearchProcedure();
 		~GreedySearchProcedure();
@@ -257,9 +500,19 @@ namespace HCSearch
 			vector< RankFeatures >& bestSet, vector< double >& bestLosses, vector< RankFeatures >& worstSet, vector< double >& worstLosses);
 
 		/*!
-		 * @brief Checks if the state is duplicate among the states in the priority queue.
+		 * @brief Checks if the state is duplicate among the states in the cost set 
+		 * or evicted from it.
 		 */
-		bool isDuplicate(SearchNode* state, SearchNodeList& list);
+		bool isDuplicate(SearchNode* state);
+
+		/*!
+		 * @brief Bound the cost set to the lowest-cost nodes.
+		 * 
+		 * Same policy as IBasicSearchProcedure::boundCostSet. The node to expand 
+		 * next is always kept.
+		 */
+		void boundCostSet(SearchNodeList& costSet, SearchNode* bestHeuristicNode, 
+			SearchType searchType, IRankModel* costModel);
 	};
 
 	/*! @} */
@@ -280,27 +533,53 @@ namespace HCSearch
 		ImgLabeling* YTruth; //!< Pointer to groundtruth labeling
 
 		RankFeatures heuristicFeatures; //!< Heuristic features
+		FeatureAccumulators heuristicAccumulators; //!< Heuristic feature sums for incremental computation
 		IRankModel* heuristicModel; //!< Heuristic model
 		double heuristic; //!< Heuristic value
 
 		RankFeatures costFeatures; //!< Cost features
+		FeatureAccumulators costAccumulators; //!< Cost feature sums for incremental computation
 		IRankModel* costModel; //!< Cost model
 		double cost; //!< Cost value
 
+		LabelingHash_t labelingHash; //!< Hash of YPred
+		LabelingHash_t labelingCheck; //!< Independent hash of YPred to verify transposition table hits
+
+		int depth; //!< Depth of the node in the search tree
+		bool compact; //!< True if the labels of YPred are released and stored as snapshot + delta
+		shared_ptr< const VectorXi > snapshotLabels; //!< Labels of the nearest snapshot ancestor (or self)
+		vector< pair<int, int> > snapshotDelta; //!< Labels that differ from the snapshot: (node, label) sorted by node
+
+		shared_ptr< const LabelComponents > parentLabelComponents; //!< Connected components of the parent labeling until the node is expanded
+		set<int> parentAction; //!< Nodes relabeled from the parent labeling
+
+		TranspositionTable* transpositionTable; //!< Table of the search (NULL if none)
+		bool scoredFromTable; //!< True if the scores were taken from the transposition table
+
 	public:
 		SearchNode(); // do not use default constructor
+		virtual ~SearchNode();
 
 		/*!
 		 * Node initialization constructor.
 		 */
 		SearchNode(ImgFeatures* X, ImgLabeling* YTruth, SearchSpace* searchSpace, 
-			IRankModel* heuristicModel, IRankModel* costModel, SearchType searchType);
+			IRankModel* heuristicModel, IRankModel* costModel, SearchType searchType, 
+			TranspositionTable* transpositionTable = NULL);
 
 		/*!
 		 * Node generation constructor.
 		 */
 		SearchNode(SearchNode* parent, ImgLabeling YPred);
 
+		/*!
+		 * Node generation constructor from a successor candidate of the parent. 
+		 * Features of delta candidates are computed incrementally from the parent.
+		 * If deferRanking is true, the heuristic/cost models are not applied 
+		 * and the node must be ranked with rankNodes.
+		 */
+		SearchNode(SearchNode* parent, ImgCandidate& YCandidate, bool deferRanking = false);
+
 		/*!
 		 * Generate successor nodes.
 		 */
@@ -337,10 +616,26 @@ namespace HCSearch
 		virtual double getCost();
 
 		/*!
-		 * Get the labeling of the node.
+		 * Get the labeling of the node. 
+		 * Reconstructed from the snapshot if the node is compact.
 		 */
 		ImgLabeling getY();
 
+		/*!
+		 * Get the hash of the labeling of the node.
+		 */
+		LabelingHash_t getLabelingHash();
+
+		/*!
+		 * Get the independent check hash of the labeling of the node.
+		 */
+		LabelingHash_t getLabelingCheck();
+
+		/*!
+		 * Check if the node has exactly the same labeling as another node.
+		 */
+		bool hasSameLabeling(SearchNode* other);
+
 	protected:
 		/*!
 		 * Return type of search node.
@@ -348,7 +643,60 @@ namespace HCSearch
 		SearchType getType();
 
 	private:
-		void constructorHelper();
+		void constructorHelper(ImgCandidate* YCandidate = NULL, bool deferRanking = false);
+
+		/*!
+		 * Take the scores from the transposition table if the labeling was scored before. 
+		 * Returns false if not found or if the cached entry lacks the features needed.
+		 */
+		bool lookupTranspositionTable();
+
+		/*!
+		 * Record the lookups of the successors in the transposition table 
+		 * and add the newly scored ones.
+		 */
+		static void updateTranspositionTable(vector< SearchNode* >& successors);
+
+		/*!
+		 * Store the labels as a delta against the nearest snapshot and release them, 
+		 * if Global::settings->SEARCH_NODE_SNAPSHOT_INTERVAL is set. 
+		 * Every k-th level of the search tree keeps a full (shared) snapshot, 
+		 * as does any node whose delta would be larger than a snapshot.
+		 */
+		void compactLabeling();
+
+		/*!
+		 * Reconstruct the labels of a compact node in YPred (e.g. for expansion).
+		 */
+		void restoreLabeling();
+
+		/*!
+		 * Release the labels of YPred again after restoreLabeling.
+		 */
+		void releaseLabeling();
+
+		/*!
+		 * Make the connected components of YPred available for expansion. 
+		 * Derived locally from the components of the parent if possible.
+		 */
+		void updateLabelComponents();
+
+		/*!
+		 * Get the labels of the node, reconstructing them if the node is compact.
+		 */
+		VectorXi getLabels();
+
+		/*!
+		 * Apply the heuristic/cost models to nodes constructed with deferred ranking. 
+		 * All nodes are ranked in one batch per model.
+		 */
+		static void rankNodes(vector< SearchNode* >& nodes);
+
+		/*!
+		 * Rank one kind of features of the nodes in a batch and store the values.
+		 */
+		static void rankNodes(vector< SearchNode* >& nodes, IRankModel* model, 
+			RankFeatures SearchNode::* features, double SearchNode::* value);
 	};
 
 	/**************** Compare Search Node ****************/
@@ -367,33 +715,6 @@ namespace HCSearch
 
 	/**************** Template definitions ****************/
 
-	template <class T>
-	bool IBasicSearchProcedure::isDuplicate(SearchNode* state, T& pq)
-	{
-		int size = pq.size();
-		bool isDuplicate = false;
-
-		T temp;
-
-		for (int i = 0; i < size; i++)
-		{
-			SearchNode* current = pq.top();
-			pq.pop();
-
-			if (!isDuplicate && current->getY().graph.nodesData == state->getY().graph.nodesData)
-			{
-				isDuplicate = true;
-			}
-
-			temp.push(current);
-		}
-
-		// reset priority queue passed as argument
-		pq = temp;
-
-		return isDuplicate;
-	}
-
 	template <class T>
 	void IBasicSearchProcedure::deleteQueueElements(T& queue)
 	{
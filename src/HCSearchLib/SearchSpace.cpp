@@ -63,6 +63,30 @@ namespace HCSearch
 		return this->costFeatureFunction->computeFeatures(X, Y, action);
 	}
 
+	RankFeatures SearchSpace::computeHeuristicFeatures(ImgFeatures& X, ImgLabeling& Y, 
+		ImgCandidate* YCandidate, const FeatureAccumulators* parentAcc, FeatureAccumulators& acc)
+	{
+		if (this->heuristicFeatureFunction == NULL)
+		{
+			LOG(ERROR) << "heuristic feature function is null";
+			abort();
+		}
+
+		return computeFeaturesIncremental(this->heuristicFeatureFunction, X, Y, YCandidate, parentAcc, acc);
+	}
+
+	RankFeatures SearchSpace::computeCostFeatures(ImgFeatures& X, ImgLabeling& Y, 
+		ImgCandidate* YCandidate, const FeatureAccumulators* parentAcc, FeatureAccumulators& acc)
+	{
+		if (this->costFeatureFunction == NULL)
+		{
+			LOG(ERROR) << "cost feature function is null";
+			abort();
+		}
+
+		return computeFeaturesIncremental(this->costFeatureFunction, X, Y, YCandidate, parentAcc, acc);
+	}
+
 	RankFeatures SearchSpace::computePruneFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action)
 	{
 		if (this->pruneFunction->getFeatureFunction() == NULL)
@@ -74,6 +98,39 @@ namespace HCSearch
 		return this->pruneFunction->getFeatureFunction()->computeFeatures(X, Y, action);
 	}
 
+	RankFeatures SearchSpace::computePruneFeatures(ImgFeatures& X, ImgCandidate& YCandidate)
+	{
+		if (this->pruneFunction->getFeatureFunction() == NULL)
+		{
+			LOG(ERROR) << "prune feature function is null";
+			abort();
+		}
+
+		return this->pruneFunction->getFeatureFunction()->computeFeatures(X, YCandidate);
+	}
+
+	bool SearchSpace::computePruneAccumulators(ImgFeatures& X, ImgLabeling& Y, FeatureAccumulators& acc)
+	{
+		if (this->pruneFunction->getFeatureFunction() == NULL)
+		{
+			LOG(ERROR) << "prune feature function is null";
+			abort();
+		}
+
+		return this->pruneFunction->getFeatureFunction()->computeAccumulators(X, Y, acc);
+	}
+
+	RankFeatures SearchSpace::computePruneFeatures(ImgFeatures& X, ImgCandidate& YCandidate, const FeatureAccumulators& parentAcc)
+	{
+		if (this->pruneFunction->getFeatureFunction() == NULL)
+		{
+			LOG(ERROR) << "prune feature function is null";
+			abort();
+		}
+
+		return this->pruneFunction->getFeatureFunction()->computeFeatures(X, YCandidate, parentAcc);
+	}
+
 	ImgLabeling SearchSpace::getInitialPrediction(ImgFeatures& X)
 	{
 		if (this->initialPredictionFunction == NULL)
@@ -120,6 +177,17 @@ namespace HCSearch
 		return this->lossFunction->computeLoss(YPred, YTruth);
 	}
 
+	double SearchSpace::computeLoss(ImgCandidate& YCandidate, const ImgLabeling& YTruth)
+	{
+		if (this->lossFunction == NULL)
+		{
+			LOG(ERROR) << "loss function is null";
+			abort();
+		}
+
+		return this->lossFunction->computeLoss(YCandidate, YTruth);
+	}
+
 	IPruneFunction* SearchSpace::getPruneFunction()
 	{
 		return this->pruneFunction;
@@ -134,4 +202,22 @@ namespace HCSearch
 	{
 		return this->lossFunction;
 	}
+
+	RankFeatures SearchSpace::computeFeaturesIncremental(IFeatureFunction* featureFunction, ImgFeatures& X, ImgLabeling& Y, 
+		ImgCandidate* YCandidate, const FeatureAccumulators* parentAcc, FeatureAccumulators& acc)
+	{
+		// update parent sums with the changed nodes, otherwise start from scratch
+		bool updated = false;
+		if (YCandidate != NULL && parentAcc != NULL && parentAcc->available)
+			updated = featureFunction->updateAccumulators(X, *YCandidate, *parentAcc, acc);
+		if (!updated)
+			featureFunction->computeAccumulators(X, Y, acc);
+
+		if (acc.available)
+			return featureFunction->computeFeatures(X, acc);
+
+		// feature function does not support incremental computation
+		set<int> action;
+		return featureFunction->computeFeatures(X, Y, action);
+	}
 }
\ No newline at end of file
@@ -101,6 +101,32 @@ namespace HCSearch
 		 */
 		RankFeatures computeCostFeatures(ImgFeatures& X, ImgLabeling& Y);
 
+		/*!
+		 * @brief Compute heuristic features and feature sums of a labeling, 
+		 * incrementally from the parent feature sums if possible.
+		 * @param[in] X Structured image features
+		 * @param[in] Y Structured output labeling
+		 * @param[in] YCandidate Successor candidate Y was materialized from (NULL if none)
+		 * @param[in] parentAcc Heuristic feature sums of the candidate parent (NULL if none)
+		 * @param[out] acc Heuristic feature sums of Y (unavailable if not supported)
+		 * @return Heuristic features for ranking
+		 */
+		RankFeatures computeHeuristicFeatures(ImgFeatures& X, ImgLabeling& Y, 
+			ImgCandidate* YCandidate, const FeatureAccumulators* parentAcc, FeatureAccumulators& acc);
+
+		/*!
+		 * @brief Compute cost features and feature sums of a labeling, 
+		 * incrementally from the parent feature sums if possible.
+		 * @param[in] X Structured image features
+		 * @param[in] Y Structured output labeling
+		 * @param[in] YCandidate Successor candidate Y was materialized from (NULL if none)
+		 * @param[in] parentAcc Cost feature sums of the candidate parent (NULL if none)
+		 * @param[out] acc Cost feature sums of Y (unavailable if not supported)
+		 * @return Cost features for ranking
+		 */
+		RankFeatures computeCostFeatures(ImgFeatures& X, ImgLabeling& Y, 
+			ImgCandidate* YCandidate, const FeatureAccumulators* parentAcc, FeatureAccumulators& acc);
+
 		/*!
 		 * @brief Compute prune features from image features and current labeling.
 		 * @param[in] X Structured image features
@@ -109,6 +135,32 @@ namespace HCSearch
 		 */
 		RankFeatures computePruneFeatures(ImgFeatures& X, ImgLabeling& Y, set<int> action);
 
+		/*!
+		 * @brief Compute prune features from image features and a successor candidate.
+		 * @param[in] X Structured image features
+		 * @param[in] YCandidate Successor candidate (full or delta)
+		 * @return Prune features for classification
+		 */
+		RankFeatures computePruneFeatures(ImgFeatures& X, ImgCandidate& YCandidate);
+
+		/*!
+		 * @brief Compute the prune feature sums of a labeling, shared by its successor candidates.
+		 * @param[in] X Structured image features
+		 * @param[in] Y Structured output labeling (parent of the candidates)
+		 * @param[out] acc Prune feature sums of Y (unavailable if not supported)
+		 * @return Returns false if incremental computation is not supported
+		 */
+		bool computePruneAccumulators(ImgFeatures& X, ImgLabeling& Y, FeatureAccumulators& acc);
+
+		/*!
+		 * @brief Compute prune features of a successor candidate from the prune feature sums of its parent.
+		 * @param[in] X Structured image features
+		 * @param[in] YCandidate Successor candidate (full or delta)
+		 * @param[in] parentAcc Prune feature sums of the candidate parent
+		 * @return Prune features for classification
+		 */
+		RankFeatures computePruneFeatures(ImgFeatures& X, ImgCandidate& YCandidate, const FeatureAccumulators& parentAcc);
+
 		/*!
 		 * @brief Get the initial labeling from image features.
 		 * @param[in] X Structured image features
@@ -140,9 +192,21 @@ namespace HCSearch
 		 */
 		double computeLoss(ImgLabeling& YPred, const ImgLabeling& YTruth);
 
+		/*!
+		 * @brief Compute the loss between a successor candidate and its groundtruth labeling.
+		 * @param[in] YCandidate Successor candidate (full or delta)
+		 * @param[in] YTruth Groundtruth structured output labeling
+		 * @return Loss value
+		 */
+		double computeLoss(ImgCandidate& YCandidate, const ImgLabeling& YTruth);
+
 		IPruneFunction* getPruneFunction();
 		IInitialPredictionFunction* getInitialPredictionFunction();
 		ILossFunction* getLossFunction();
+
+	protected:
+		RankFeatures computeFeaturesIncremental(IFeatureFunction* featureFunction, ImgFeatures& X, ImgLabeling& Y, 
+			ImgCandidate* YCandidate, const FeatureAccumulators* parentAcc, FeatureAccumulators& acc);
 	};
 
 	/*! @} */
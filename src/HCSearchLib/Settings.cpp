@@ -10,6 +10,7 @@ namespace HCSearch
 
 	const string RankerTypeStrings[] = {"svm-rank", "vw"};
 	const bool RankerTypeSaveable[] = {true, true};
+	const string EvictionPolicyStrings[] = {"fifo", "lru"};
 
 	/**************** Class Map ****************/
 
@@ -17,6 +18,7 @@ namespace HCSearch
 	{
 		this->numBackground = 0;
 		this->backgroundExists = false;
+		this->minLabel = 0;
 	}
 
 	ClassMap::~ClassMap()
@@ -35,49 +37,67 @@ namespace HCSearch
 
 	int ClassMap::getClassIndex(int classLabel)
 	{
-		if (!this->allClasses.iexists(classLabel))
+		const unsigned int offset = static_cast<unsigned int>(classLabel - this->minLabel);
+		if (offset >= this->labelIndices.size() || this->labelIndices[offset] < 0)
 		{
 			LOG(ERROR) << "class label does not exist in mapping: " << classLabel;
 			exit(1);
 		}
 
-		return this->allClasses.ilookup(classLabel);
+		return this->labelIndices[offset];
 	}
 
 	int ClassMap::getClassLabel(int classIndex)
 	{
-		if (!this->allClasses.exists(classIndex))
+		// labels may be negative, so check that the label maps back to the index
+		const unsigned int index = static_cast<unsigned int>(classIndex);
+		if (index >= this->indexLabels.size() || !classIndexExists(classIndex))
 		{
 			LOG(ERROR) << "class index does not exist in mapping: " << classIndex;
 			exit(1);
 		}
 
-		return this->allClasses.lookup(classIndex);
+		return this->indexLabels[index];
+	}
+
+	bool ClassMap::classIndexExists(int classIndex)
+	{
+		const unsigned int offset = static_cast<unsigned int>(this->indexLabels[classIndex] - this->minLabel);
+		return offset < this->labelIndices.size() && this->labelIndices[offset] == classIndex;
 	}
 
 	bool ClassMap::classIndexIsBackground(int classIndex)
 	{
-		return this->backgroundClasses[getClassLabel(classIndex)];
+		getClassLabel(classIndex); // reports an unknown index
+		return this->indexBackground[classIndex];
 	}
 
 	bool ClassMap::classLabelIsBackground(int classLabel)
 	{
-		return this->backgroundClasses[classLabel];
+		const unsigned int offset = static_cast<unsigned int>(classLabel - this->minLabel);
+		if (offset >= this->labelIndices.size() || this->labelIndices[offset] < 0)
+			return false;
+
+		return this->indexBackground[this->labelIndices[offset]];
+	}
+
+	const vector<int>& ClassMap::getLabelList()
+	{
+		return this->labelList;
 	}
 
-	set<int> ClassMap::getLabels()
+	const set<int>& ClassMap::getLabels()
 	{
-		return this->allClasses.ikeyset();
+		return this->labelSet;
 	}
 
 	set<int> ClassMap::getBackgroundLabels()
 	{
-		set<int> allLabels = getLabels();
 		set<int> backgrounds;
-		for (set<int>::iterator it = allLabels.begin(); it != allLabels.end(); ++it)
+		for (vector<int>::iterator it = this->labelList.begin(); it != this->labelList.end(); ++it)
 		{
 			int label = *it;
-			if (backgroundClasses[label])
+			if (classLabelIsBackground(label))
 				backgrounds.insert(label);
 		}
 		return backgrounds;
@@ -85,12 +105,11 @@ namespace HCSearch
 
 	set<int> ClassMap::getForegroundLabels()
 	{
-		set<int> allLabels = getLabels();
 		set<int> foregrounds;
-		for (set<int>::iterator it = allLabels.begin(); it != allLabels.end(); ++it)
+		for (vector<int>::iterator it = this->labelList.begin(); it != this->labelList.end(); ++it)
 		{
 			int label = *it;
-			if (!backgroundClasses[label])
+			if (!classLabelIsBackground(label))
 				foregrounds.insert(label);
 		}
 		return foregrounds;
@@ -125,6 +144,7 @@ namespace HCSearch
 			{
 				this->numBackground++;
 			}
+			buildLookupTables();
 		}
 		else
 		{
@@ -138,6 +158,30 @@ namespace HCSearch
 		this->backgroundExists = true;
 	}
 
+	void ClassMap::buildLookupTables()
+	{
+		this->labelSet = this->allClasses.ikeyset();
+		this->labelList.assign(this->labelSet.begin(), this->labelSet.end());
+
+		set<int> indices = this->allClasses.keyset();
+		const int maxIndex = *indices.rbegin();
+		this->indexLabels.assign(maxIndex+1, -1);
+		this->indexBackground.assign(maxIndex+1, false);
+
+		this->minLabel = this->labelList.front();
+		const int maxLabel = this->labelList.back();
+		this->labelIndices.assign(maxLabel - this->minLabel + 1, -1);
+
+		for (vector<int>::iterator it = this->labelList.begin(); it != this->labelList.end(); ++it)
+		{
+			int label = *it;
+			int index = this->allClasses.ilookup(label);
+			this->labelIndices[label - this->minLabel] = index;
+			this->indexLabels[index] = label;
+			this->indexBackground[index] = this->backgroundClasses[label];
+		}
+	}
+
 	/**************** Run-time Statistics ****************/
 
 	RunTimeStats::RunTimeStats()
@@ -415,6 +459,14 @@ namespace HCSearch
 		USE_DAGGER = false;
 		CHECK_FOR_DUPLICATES = false;
 		USE_EDGE_WEIGHTS = false;
+		NUM_THREADS = 1;
+		RAND_SEED = 1;
+		USE_FLOAT_FEATURES = false;
+		MAX_COST_SET_SIZE = 0;
+		SEARCH_NODE_SNAPSHOT_INTERVAL = 0;
+		TRANSPOSITION_TABLE_SIZE = 0;
+		TRANSPOSITION_TABLE_EVICTION = EVICT_LRU;
+		TRANSPOSITION_TABLE_FEATURES = false;
 
 		/**************** Experiment Settings ****************/
 
@@ -2,6 +2,7 @@
 #define SETTINGS_H
 
 #include <string>
+#include <vector>
 
 // Define USE_MPI in Makefile or Visual Studio project
 // It is defined by default in the Visual Studio project
@@ -22,6 +23,9 @@ namespace HCSearch
 	const extern string RankerTypeStrings[];
 	const extern bool RankerTypeSaveable[];
 
+	enum EvictionPolicy { EVICT_FIFO, EVICT_LRU };
+	const extern string EvictionPolicyStrings[];
+
 	/**************** Class Map ****************/
 
 	// Stores class labels
@@ -36,6 +40,14 @@ namespace HCSearch
 		int backgroundLabel; // background label
 		bool backgroundExists; // if background class even exists
 
+		// dense lookup tables, rebuilt whenever a class is added
+		int minLabel; // smallest class label
+		vector<int> labelIndices; // label - minLabel -> class index, -1 if not a class
+		vector<int> indexLabels; // class index -> label
+		vector<bool> indexBackground; // class index -> is background? true/false
+		vector<int> labelList; // sorted class labels
+		set<int> labelSet; // sorted class labels
+
 	public:
 		ClassMap();
 		~ClassMap();
@@ -49,7 +61,15 @@ namespace HCSearch
 		bool classIndexIsBackground(int classIndex);
 		bool classLabelIsBackground(int classLabel);
 
-		set<int> getLabels();
+		/*!
+		 * @brief Get the sorted class labels without copying.
+		 */
+		const vector<int>& getLabelList();
+
+		/*!
+		 * @brief Get the sorted class labels as a set without copying.
+		 */
+		const set<int>& getLabels();
 		set<int> getBackgroundLabels();
 		set<int> getForegroundLabels();
 
@@ -58,6 +78,10 @@ namespace HCSearch
 
 		void addClass(int classIndex, int classLabel, bool isBackground);
 		void setBackgroundLabel(int classLabel);
+
+	protected:
+		void buildLookupTables();
+		bool classIndexExists(int classIndex);
 	};
 
 	/**************** Run-time Statistics ****************/
@@ -248,6 +272,63 @@ namespace HCSearch
 		 */
 		bool USE_EDGE_WEIGHTS;
 
+		/*!
+		 * @brief Number of threads used to construct and score successors.
+		 * 
+		 * Successor nodes are merged back in candidate order, so results 
+		 * do not depend on the number of threads.
+		 */
+		int NUM_THREADS;
+
+		/*!
+		 * @brief Run seed of the random streams.
+		 * 
+		 * Every (image, iteration, thread) derives its own stream from it, 
+		 * so results are reproducible regardless of scheduling.
+		 */
+		unsigned long RAND_SEED;
+
+		/*!
+		 * @brief Keep a single-precision copy of the node features and use the SIMD kernels.
+		 * 
+		 * Speeds up unary sums, edge kernels and KL edge weights for wide features 
+		 * at single-precision accuracy. The double-precision path is used otherwise.
+		 */
+		bool USE_FLOAT_FEATURES;
+
+		/*!
+		 * @brief Maximum number of nodes kept in the cost set of beam and greedy searches (0 for unbounded).
+		 * 
+		 * Evicted nodes are streamed to the cost ranker as training examples.
+		 */
+		int MAX_COST_SET_SIZE;
+
+		/*!
+		 * @brief Keep a full labeling only every k levels of the search tree (0 to keep all).
+		 * 
+		 * Other search nodes store the labels that differ from their nearest snapshot.
+		 */
+		int SEARCH_NODE_SNAPSHOT_INTERVAL;
+
+		/*!
+		 * @brief Capacity of the per-search transposition table (0 to disable).
+		 * 
+		 * Caches heuristic and cost values of scored labelings by labeling hash.
+		 */
+		int TRANSPOSITION_TABLE_SIZE;
+
+		/*!
+		 * @brief Eviction policy of the transposition table when full.
+		 */
+		EvictionPolicy TRANSPOSITION_TABLE_EVICTION;
+
+		/*!
+		 * @brief Also cache feature vectors in the transposition table. 
+		 * 
+		 * Required for the table to be used when learning.
+		 */
+		bool TRANSPOSITION_TABLE_FEATURES;
+
 		/**************** Experiment Settings ****************/
 
 		/*!
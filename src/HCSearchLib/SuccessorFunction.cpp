@@ -29,36 +29,21 @@ namespace HCSearch
 		const int numNodes = YPred.getNumNodes();
 		for (int node = 0; node < numNodes; node++)
 		{
-			// set up candidate label set
-			set<int> candidateLabelsSet;
 			int nodeLabel = YPred.getLabel(node);
-			candidateLabelsSet.insert(nodeLabel);
 
 			// flip to any possible class
-			candidateLabelsSet = Global::settings->CLASSES.getLabels();
-
-			candidateLabelsSet.erase(nodeLabel); // do not flip to same label
+			const vector<int>& candidateLabels = Global::settings->CLASSES.getLabelList();
 
 			// for each candidate label, add to successors list for returning
-			for (set<int>::iterator it2 = candidateLabelsSet.begin(); it2 != candidateLabelsSet.end(); ++it2)
+			for (vector<int>::const_iterator it2 = candidateLabels.begin(); it2 != candidateLabels.end(); ++it2)
 			{
 				int candidateLabel = *it2;
+				if (candidateLabel == nodeLabel)
+					continue; // do not flip to same label
 
 				// form successor object
-				LabelGraph graphNew;
-				graphNew.nodesData = YPred.graph.nodesData;
-				graphNew.nodesData(node) = candidateLabel; // flip bit node
-				graphNew.adjList = YPred.graph.adjList;
-
-				ImgLabeling YNew;
-				YNew.confidences = YPred.confidences;
-				YNew.confidencesAvailable = YPred.confidencesAvailable;
-				YNew.graph = graphNew;
-
-				ImgCandidate YCandidate;
-				YCandidate.labeling = YNew;
-				YCandidate.action = set<int>();
-				YCandidate.action.insert(node);
+				ImgCandidate YCandidate(&YPred);
+				YCandidate.relabel(node, candidateLabel); // flip bit node
 
 				// add candidate to successors
 				successors.push_back(YCandidate);
@@ -97,6 +82,7 @@ namespace HCSearch
 		{
 			// set up candidate label set
 			set<int> candidateLabelsSet;
+			const set<int>* candidateLabels = &candidateLabelsSet;
 			int nodeLabel = YPred.getLabel(node);
 			candidateLabelsSet.insert(nodeLabel);
 
@@ -113,31 +99,19 @@ namespace HCSearch
 			else
 			{
 				// if node is isolated without neighbors, then flip to any possible class
-				candidateLabelsSet = Global::settings->CLASSES.getLabels();
+				candidateLabels = &Global::settings->CLASSES.getLabels();
 			}
 
-			candidateLabelsSet.erase(nodeLabel); // do not flip to same label
-
 			// for each candidate label, add to successors list for returning
-			for (set<int>::iterator it2 = candidateLabelsSet.begin(); it2 != candidateLabelsSet.end(); ++it2)
+			for (set<int>::const_iterator it2 = candidateLabels->begin(); it2 != candidateLabels->end(); ++it2)
 			{
 				int candidateLabel = *it2;
+				if (candidateLabel == nodeLabel)
+					continue; // do not flip to same label
 
 				// form successor object
-				LabelGraph graphNew;
-				graphNew.nodesData = YPred.graph.nodesData;
-				graphNew.nodesData(node) = candidateLabel; // flip bit node
-				graphNew.adjList = YPred.graph.adjList;
-
-				ImgLabeling YNew;
-				YNew.confidences = YPred.confidences;
-				YNew.confidencesAvailable = YPred.confidencesAvailable;
-				YNew.graph = graphNew;
-
-				ImgCandidate YCandidate;
-				YCandidate.labeling = YNew;
-				YCandidate.action = set<int>();
-				YCandidate.action.insert(node);
+				ImgCandidate YCandidate(&YPred);
+				YCandidate.relabel(node, candidateLabel); // flip bit node
 
 				// add candidate to successors
 				successors.push_back(YCandidate);
@@ -176,6 +150,7 @@ namespace HCSearch
 		{
 			// set up candidate label set
 			set<int> candidateLabelsSet;
+			const set<int>* candidateLabels = &candidateLabelsSet;
 			int nodeLabel = YPred.getLabel(node);
 			candidateLabelsSet.insert(nodeLabel);
 
@@ -196,31 +171,19 @@ namespace HCSearch
 			else
 			{
 				// if node is isolated without neighbors, then flip to any possible class
-				candidateLabelsSet = Global::settings->CLASSES.getLabels();
+				candidateLabels = &Global::settings->CLASSES.getLabels();
 			}
 
-			candidateLabelsSet.erase(nodeLabel); // do not flip to same label
-
 			// for each candidate label, add to successors list for returning
-			for (set<int>::iterator it2 = candidateLabelsSet.begin(); it2 != candidateLabelsSet.end(); ++it2)
+			for (set<int>::const_iterator it2 = candidateLabels->begin(); it2 != candidateLabels->end(); ++it2)
 			{
 				int candidateLabel = *it2;
+				if (candidateLabel == nodeLabel)
+					continue; // do not flip to same label
 
 				// form successor object
-				LabelGraph graphNew;
-				graphNew.nodesData = YPred.graph.nodesData;
-				graphNew.nodesData(node) = candidateLabel; // flip bit node
-				graphNew.adjList = YPred.graph.adjList;
-
-				ImgLabeling YNew;
-				YNew.confidences = YPred.confidences;
-				YNew.confidencesAvailable = YPred.confidencesAvailable;
-				YNew.graph = graphNew;
-
-				ImgCandidate YCandidate;
-				YCandidate.labeling = YNew;
-				YCandidate.action = set<int>();
-				YCandidate.action.insert(node);
+				ImgCandidate YCandidate(&YPred);
+				YCandidate.relabel(node, candidateLabel); // flip bit node
 
 				// add candidate to successors
 				successors.push_back(YCandidate);
@@ -237,6 +200,60 @@ namespace HCSearch
 		return successors;
 	}
 
+	/**************** Stochastic Cut Edge Weights ****************/
+
+	namespace
+	{
+		struct EdgeWeightGreater
+		{
+			const vector<double>& weights;
+
+			EdgeWeightGreater(const vector<double>& weights) : weights(weights) {}
+
+			bool operator()(int i, int j) const { return this->weights[i] > this->weights[j]; }
+		};
+
+		/*!
+		 * @brief Get the KL weights of the edges of an image, computing them on first use.
+		 */
+		shared_ptr< const CutEdgeWeights > getCutEdgeWeights(ImgFeatures& X, ImgLabeling& YPred, double T, 
+			double (*computeSymmetricKL)(ImgFeatures&, int, int))
+		{
+			shared_ptr< const CompressedAdjList > edges = YPred.graph.adjList.getCompressed();
+			if (X.cutEdgeWeights && X.cutEdgeWeights->edges == edges && X.cutEdgeWeights->T == T)
+				return X.cutEdgeWeights;
+
+			LOG() << "Computing edge weights from nodes..." << endl;
+
+			CutEdgeWeights* cutEdgeWeights = new CutEdgeWeights();
+			cutEdgeWeights->edges = edges;
+			cutEdgeWeights->T = T;
+			cutEdgeWeights->edgeNodes.reserve(edges->getNumEdges());
+			cutEdgeWeights->weights.reserve(edges->getNumEdges());
+
+			for (int node1 = 0; node1 < edges->getNumNodes(); node1++)
+			{
+				NeighborRange neighbors = edges->getNeighbors(node1);
+				for (NeighborRange::const_iterator it = neighbors.begin(); it != neighbors.end(); ++it)
+				{
+					int node2 = *it;
+					cutEdgeWeights->edgeNodes.push_back(MyPrimitives::Pair<int, int>(node1, node2));
+					cutEdgeWeights->weights.push_back(exp( -computeSymmetricKL(X, node1, node2)*T/2 ));
+				}
+			}
+
+			// edges by decreasing weight for threshold sweeps
+			cutEdgeWeights->order.resize(cutEdgeWeights->weights.size());
+			for (int i = 0; i < static_cast<int>(cutEdgeWeights->order.size()); i++)
+				cutEdgeWeights->order[i] = i;
+			stable_sort(cutEdgeWeights->order.begin(), cutEdgeWeights->order.end(), 
+				EdgeWeightGreater(cutEdgeWeights->weights));
+
+			X.cutEdgeWeights = shared_ptr< const CutEdgeWeights >(cutEdgeWeights);
+			return X.cutEdgeWeights;
+		}
+	}
+
 	/**************** Stochastic Successor Function ****************/
 
 	const double StochasticSuccessor::TOP_CONFIDENCES_PROPORTION = 0.5;
@@ -306,64 +323,42 @@ namespace HCSearch
 
 	MyGraphAlgorithms::SubgraphSet* StochasticSuccessor::cutEdges(ImgFeatures& X, ImgLabeling& YPred, double threshold, double T)
 	{
-		const int numNodes = X.getNumNodes();
-		map< int, set<int> > edges = YPred.graph.adjList;
-
 		// store new cut edges
 		map< int, set<int> > cutEdges;
 
-		// convert to format storing (node1, node2) pairs
-		vector< MyPrimitives::Pair< int, int > > edgeNodes;
-
-		// edge weights using KL divergence measure
-		vector<double> edgeWeights;
-
-		// iterate over all edges to store
+		// (node1, node2) pairs with edge weights
+		shared_ptr< const CutEdgeWeights > cutEdgeWeights;
 		if (X.edgeWeightsAvailable)
 		{
+			CutEdgeWeights* fileEdgeWeights = new CutEdgeWeights();
 			for (map< MyPrimitives::Pair<int, int>, double >::iterator it = X.edgeWeights.begin(); it != X.edgeWeights.end(); ++it)
 			{
-				// get weights
-				double weight = it->second;
-				edgeWeights.push_back(weight);
-
-				// add
-				MyPrimitives::Pair<int, int> key = it->first;
-				edgeNodes.push_back(key);
+				fileEdgeWeights->edgeNodes.push_back(it->first);
+				fileEdgeWeights->weights.push_back(it->second);
 			}
+			cutEdgeWeights = shared_ptr< const CutEdgeWeights >(fileEdgeWeights);
 		}
 		else
 		{
-			LOG() << "Computing edge weights from nodes..." << endl;
-
-			for (map< int, set<int> >::iterator it = edges.begin();
-				it != edges.end(); ++it)
-			{
-				int node1 = it->first;
-				set<int> neighbors = it->second;
-		
-				// loop over neighbors
-				for (set<int>::iterator it2 = neighbors.begin(); it2 != neighbors.end(); ++it2)
-				{
-					int node2 = *it2;
+			// edge weights using KL divergence measure, computed once per image
+			cutEdgeWeights = getCutEdgeWeights(X, YPred, T, &computeSymmetricKL);
+		}
 
-					// get features and labels
-					VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-					VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
+		const vector< MyPrimitives::Pair< int, int > >& edgeNodes = cutEdgeWeights->edgeNodes;
+		const vector<double>& edgeWeights = cutEdgeWeights->weights;
 
-					// compute weights already
-					double weight = exp( -(computeKL(nodeFeatures1, nodeFeatures2) + computeKL(nodeFeatures2, nodeFeatures1))*T/2 );
-					edgeWeights.push_back(weight);
+		// given the edge weights, do the actual cutting!
+		const int numEdges = edgeNodes.size();
 
-					// add
-					MyPrimitives::Pair< int, int> nodePair = MyPrimitives::Pair< int, int >(node1, node2);
-					edgeNodes.push_back(nodePair);
-				}
-			}
+		// one coin per edge, drawn in bulk
+		vector<double> biasedCoins;
+		if (cutEdgesIndependently)
+		{
+			biasedCoins.resize(numEdges);
+			if (numEdges > 0)
+				Rand::stream().uniforms(&biasedCoins[0], numEdges);
 		}
 
-		// given the edge weights, do the actual cutting!
-		const int numEdges = edgeNodes.size();
 		for (int i = 0; i < numEdges; i++)
 		{
 			MyPrimitives::Pair< int, int > nodePair = edgeNodes[i];
@@ -386,7 +381,7 @@ namespace HCSearch
 			else
 			{
 				// bernoulli independent
-				double biasedCoin = Rand::unifDist(); // ~ Uniform(0, 1)
+				double biasedCoin = biasedCoins[i]; // ~ Uniform(0, 1)
 				//decideToCut = biasedCoin <= 1-edgeWeights[i];
 				decideToCut = biasedCoin <= edgeWeights[i];
 			}
@@ -412,6 +407,7 @@ namespace HCSearch
 		Ycopy.confidences = YPred.confidences;
 		Ycopy.confidencesAvailable = YPred.confidencesAvailable;
 		Ycopy.graph = YPred.graph;
+		Ycopy.labelComponents = YPred.labelComponents;
 
 		LOG() << "Getting subgraphs..." << endl;
 
@@ -427,12 +423,15 @@ namespace HCSearch
 		vector< Subgraph* > subgraphset = subgraphs->getSubgraphs();
 
 		// shuffle
-		std::random_shuffle(subgraphset.begin(), subgraphset.end());
+		Rand::shuffle(subgraphset.begin(), subgraphset.end());
 		LOG() << "num subgraphs=" << subgraphset.size() << endl;
 
 		// successors set
 		vector< ImgCandidate > successors;
 
+		// stochastic cuts shared by all candidates
+		SharedAdjList cuts = subgraphs->getCuts();
+
 		// loop over each sub graph
 		int cumSumLabels = 0;
 		int numSumLabels = 0;
@@ -446,7 +445,7 @@ namespace HCSearch
 			vector< ConnectedComponent* > ccset = sub->getConnectedComponents();
 
 			// shuffle
-			std::random_shuffle(ccset.begin(), ccset.end());
+			Rand::shuffle(ccset.begin(), ccset.end());
 			cumSumCC += ccset.size();
 			numSumCC++;
 
@@ -461,41 +460,32 @@ namespace HCSearch
 				int nodeLabel = cc->getLabel();
 				candidateLabelsSet.insert(nodeLabel);
 				
-				// get labels
-				getLabels(candidateLabelsSet, cc);
-				
-				candidateLabelsSet.erase(nodeLabel);
+				// get labels (may be the shared set of all class labels)
+				const set<int>& candidateLabels = getLabels(candidateLabelsSet, cc);
 
-				cumSumLabels += candidateLabelsSet.size();
+				cumSumLabels += candidateLabels.size() - candidateLabels.count(nodeLabel);
 				numSumLabels++;
 
 				// loop over each candidate label
-				for (set<int>::iterator it3 = candidateLabelsSet.begin(); it3 != candidateLabelsSet.end(); ++it3)
+				NodeRange component = cc->getNodes();
+				for (set<int>::const_iterator it3 = candidateLabels.begin(); it3 != candidateLabels.end(); ++it3)
 				{
 					int label = *it3;
+					if (label == nodeLabel)
+						continue; // do not flip to same label
 
 					// form successor object
-					ImgLabeling YNew;
-					YNew.confidences = YPred.confidences;
-					YNew.confidencesAvailable = YPred.confidencesAvailable;
-					YNew.stochasticCuts = subgraphs->getCuts();
-					YNew.stochasticCutsAvailable = true;
-					YNew.graph = YPred.graph;
+					ImgCandidate YCandidate(&YPred);
+					YCandidate.stochasticCuts = cuts;
+					YCandidate.stochasticCutsAvailable = true;
 
 					// make changes
-					set<int> component = cc->getNodes();
-					set<int> action;
-					for (set<int>::iterator it4 = component.begin(); it4 != component.end(); ++it4)
+					for (NodeRange::const_iterator it4 = component.begin(); it4 != component.end(); ++it4)
 					{
 						int node = *it4;
-						YNew.graph.nodesData(node) = label;
-						action.insert(node);
+						YCandidate.relabel(node, label);
 					}
 
-					ImgCandidate YCandidate;
-					YCandidate.labeling = YNew;
-					YCandidate.action = action;
-
 					successors.push_back(YCandidate);
 				}
 			}
@@ -509,33 +499,34 @@ namespace HCSearch
 		return successors;
 	}
 
-	void StochasticSuccessor::getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
+	const set<int>& StochasticSuccessor::getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
 	{
-		getAllLabels(candidateLabelsSet, cc);	
+		return getAllLabels(candidateLabelsSet, cc);	
 	}
 
-	void StochasticSuccessor::getAllLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
+	const set<int>& StochasticSuccessor::getAllLabels(set<int>& /*candidateLabelsSet*/, MyGraphAlgorithms::ConnectedComponent* cc)
 	{
 		// flip to any possible class
-		candidateLabelsSet = Global::settings->CLASSES.getLabels();
+		return Global::settings->CLASSES.getLabels();
 	}
 
-	void StochasticSuccessor::getNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
+	const set<int>& StochasticSuccessor::getNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
 	{
 		if (cc->hasNeighbors())
 		{
 			// add only neighboring labels to candidate label set
 			set<int> neighborSet = cc->getNeighborLabels();
 			candidateLabelsSet.insert(neighborSet.begin(), neighborSet.end());
+			return candidateLabelsSet;
 		}
 		else
 		{
 			// if connected component is isolated without neighboring connected components, then flip to any possible class
-			candidateLabelsSet = Global::settings->CLASSES.getLabels();
+			return Global::settings->CLASSES.getLabels();
 		}
 	}
 
-	void StochasticSuccessor::getConfidencesNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
+	const set<int>& StochasticSuccessor::getConfidencesNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
 	{
 		int topKConfidences = static_cast<int>(ceil(TOP_CONFIDENCES_PROPORTION * Global::settings->CLASSES.numClasses()));
 		candidateLabelsSet = cc->getTopConfidentLabels(topKConfidences);
@@ -545,6 +536,7 @@ namespace HCSearch
 			set<int> neighborSet = cc->getNeighborLabels();
 			candidateLabelsSet.insert(neighborSet.begin(), neighborSet.end());
 		}
+		return candidateLabelsSet;
 	}
 
 	double StochasticSuccessor::computeKL(const VectorXd& p, const VectorXd& q)
@@ -556,9 +548,6 @@ namespace HCSearch
 
 		double KL = 0;
 
-		VectorXd pn = p.normalized();
-		VectorXd qn = q.normalized();
-
 		for (int i = 0; i < p.size(); i++)
 		{
 			if (p(i) != 0)
@@ -577,6 +566,16 @@ namespace HCSearch
 		return KL;
 	}
 
+	double StochasticSuccessor::computeSymmetricKL(ImgFeatures& X, int node1, int node2)
+	{
+		if (X.floatFeaturesAvailable)
+			return MySIMD::symmetricKL(X.floatFeatures->row(node1), X.floatFeatures->row(node2), X.getFeatureDim());
+
+		VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
+		VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
+		return computeKL(nodeFeatures1, nodeFeatures2) + computeKL(nodeFeatures2, nodeFeatures1);
+	}
+
 	/**************** Stochastic Neighbor Successor Function ****************/
 
 	StochasticNeighborSuccessor::StochasticNeighborSuccessor()
@@ -607,9 +606,9 @@ namespace HCSearch
 	{
 	}
 
-	void StochasticNeighborSuccessor::getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
+	const set<int>& StochasticNeighborSuccessor::getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
 	{
-		getNeighborLabels(candidateLabelsSet, cc);	
+		return getNeighborLabels(candidateLabelsSet, cc);	
 	}
 
 	/**************** Stochastic Confidences Neighbor Successor Function ****************/
@@ -642,9 +641,9 @@ namespace HCSearch
 	{
 	}
 
-	void StochasticConfidencesNeighborSuccessor::getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
+	const set<int>& StochasticConfidencesNeighborSuccessor::getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
 	{
-		getConfidencesNeighborLabels(candidateLabelsSet, cc);	
+		return getConfidencesNeighborLabels(candidateLabelsSet, cc);	
 	}
 
 	/**************** Cut Schedule Successor Function ****************/
@@ -697,118 +696,122 @@ namespace HCSearch
 
 	MyGraphAlgorithms::SubgraphSet* CutScheduleSuccessor::cutEdges(ImgFeatures& X, ImgLabeling& YPred, double threshold, double T)
 	{
-		MyGraphAlgorithms::SubgraphSet* subgraphs = NULL;
-
-		const int numNodes = X.getNumNodes();
-		map< int, set<int> > edges = YPred.graph.adjList;
+		// (node1, node2) pairs with edge weights using KL divergence measure, computed once per image
+		shared_ptr< const CutEdgeWeights > cutEdgeWeights = getCutEdgeWeights(X, YPred, T, &computeSymmetricKL);
+		const vector< MyPrimitives::Pair< int, int > >& edgeNodes = cutEdgeWeights->edgeNodes;
+		const vector<double>& edgeWeights = cutEdgeWeights->weights;
+		const vector<int>& edgeOrder = cutEdgeWeights->order;
+		const int numEdges = edgeNodes.size();
 
-		// convert to format storing (node1, node2) pairs
-		vector< MyPrimitives::Pair< int, int > > edgeNodes;
+		// thresholds to attempt in increasing order
+		vector<double> thresholdAttempts;
+		for (double thresholdAttempt = threshold; thresholdAttempt <= 1.0; thresholdAttempt += THRESHOLD_INCREMENT)
+		{
+			thresholdAttempts.push_back(thresholdAttempt);
+			if (thresholdAttempt >= FINAL_THRESHOLD)
+				break;
+		}
+		const int numAttempts = thresholdAttempts.size();
+		if (numAttempts == 0)
+			return NULL;
 
-		// edge weights using KL divergence measure
-		vector<double> edgeWeights;
+		// count good subgraphs of the cuts incrementally instead of building a subgraph set per attempt
+		MyGraphAlgorithms::CutThresholdSweep sweep(YPred);
+		vector<int> numGoodSubgraphs(numAttempts, 0);
+		vector<bool> keepEdges(numEdges, false);
+		int chosenAttempt = numAttempts-1;
 
-		// iterate over all edges to store
-		for (map< int, set<int> >::iterator it = edges.begin();
-			it != edges.end(); ++it)
+		if (!cutEdgesIndependently)
 		{
-			int node1 = it->first;
-			set<int> neighbors = it->second;
-		
-			// loop over neighbors
-			for (set<int>::iterator it2 = neighbors.begin(); it2 != neighbors.end(); ++it2)
+			// uniform state: an edge is kept above the threshold, so sweep thresholds 
+			// from high to low while keeping edges by decreasing weight
+			int numKeptEdges = 0;
+			for (int attempt = numAttempts-1; attempt >= 0; attempt--)
 			{
-				int node2 = *it2;
-
-				// get features and labels
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
-
-				// compute weights already
-				double weight = exp( -(computeKL(nodeFeatures1, nodeFeatures2) + computeKL(nodeFeatures2, nodeFeatures1))*T/2 );
-				edgeWeights.push_back(weight);
-
-				// add
-				MyPrimitives::Pair< int, int> nodePair = MyPrimitives::Pair< int, int >(node1, node2);
-				edgeNodes.push_back(nodePair);
+				for (; numKeptEdges < numEdges && edgeWeights[edgeOrder[numKeptEdges]] > thresholdAttempts[attempt]; numKeptEdges++)
+				{
+					MyPrimitives::Pair< int, int > nodePair = edgeNodes[edgeOrder[numKeptEdges]];
+					sweep.keepEdge(nodePair.first, nodePair.second);
+				}
+				numGoodSubgraphs[attempt] = sweep.getNumGoodSubgraphs();
 			}
-		}
-		
-		// increase threshold until good cuts; also cut by state
-		for (double thresholdAttempt = threshold; thresholdAttempt <= 1.0; thresholdAttempt += THRESHOLD_INCREMENT)
-		{
-			// store new cut edges
-			map< int, set<int> > cutEdges;
 
-			LOG() << "Attempting threshold=" << thresholdAttempt << endl;
-			// given the edge weights, do the actual cutting!
-			const int numEdges = edgeNodes.size();
-			for (int i = 0; i < numEdges; i++)
+			// increase threshold until good cuts
+			for (int attempt = 0; attempt < numAttempts; attempt++)
 			{
-				MyPrimitives::Pair< int, int > nodePair = edgeNodes[i];
-				int node1 = nodePair.first;
-				int node2 = nodePair.second;
-
-				bool decideToCut;
-				if (!cutEdgesIndependently)
+				if (numGoodSubgraphs[attempt] > NUM_GOOD_SUBGRAPHS_THRESHOLD)
 				{
-					// uniform state
-					decideToCut = edgeWeights[i] <= thresholdAttempt;
+					chosenAttempt = attempt;
+					break;
 				}
-				else
+			}
+
+			for (int i = 0; i < numEdges; i++)
+				keepEdges[i] = edgeWeights[i] > thresholdAttempts[chosenAttempt];
+		}
+		else
+		{
+			// bernoulli independent: new coins per attempt, so only the counting is incremental
+			vector<double> biasedCoins(numEdges);
+			for (int attempt = 0; attempt < numAttempts; attempt++)
+			{
+				sweep.reset();
+				if (numEdges > 0)
+					Rand::stream().uniforms(&biasedCoins[0], numEdges);
+				for (int i = 0; i < numEdges; i++)
 				{
-					// bernoulli independent
-					double biasedCoin = Rand::unifDist(); // ~ Uniform(0, 1)
-					decideToCut = biasedCoin <= 1-edgeWeights[i];
+					double biasedCoin = biasedCoins[i]; // ~ Uniform(0, 1)
+					keepEdges[i] = biasedCoin > 1-edgeWeights[i];
+					if (keepEdges[i])
+						sweep.keepEdge(edgeNodes[i].first, edgeNodes[i].second);
 				}
+				numGoodSubgraphs[attempt] = sweep.getNumGoodSubgraphs();
 
-				if (!decideToCut)
+				if (numGoodSubgraphs[attempt] > NUM_GOOD_SUBGRAPHS_THRESHOLD)
 				{
-					// keep these uncut edges
-					if (cutEdges.count(node1) == 0)
-					{
-						cutEdges[node1] = set<int>();
-					}
-					if (cutEdges.count(node2) == 0)
-					{
-						cutEdges[node2] = set<int>();
-					}
-					cutEdges[node1].insert(node2);
-					cutEdges[node2].insert(node1);
+					chosenAttempt = attempt;
+					break;
 				}
 			}
+		}
 
-			// create subgraphs
-			ImgLabeling Ycopy;
-			Ycopy.confidences = YPred.confidences;
-			Ycopy.confidencesAvailable = YPred.confidencesAvailable;
-			Ycopy.graph = YPred.graph;
-
-			MyGraphAlgorithms::SubgraphSet* subgraphsTemp = new MyGraphAlgorithms::SubgraphSet(Ycopy, cutEdges);
-
-			LOG() << "\tnum exactly one positive cc subgraphs=" << subgraphsTemp->getExactlyOnePositiveCCSubgraphs().size() << endl;
-			if (subgraphsTemp->getExactlyOnePositiveCCSubgraphs().size() > NUM_GOOD_SUBGRAPHS_THRESHOLD)
-			{
-				subgraphs = subgraphsTemp;
-				break;
-			}
-
-			if (thresholdAttempt >= FINAL_THRESHOLD)
-			{
-				cout << "reached final threshold" << endl;
-				subgraphs = subgraphsTemp;
-				break;
-			}
+		for (int attempt = 0; attempt <= chosenAttempt; attempt++)
+		{
+			LOG() << "Attempting threshold=" << thresholdAttempts[attempt] << endl;
+			LOG() << "\tnum exactly one positive cc subgraphs=" << numGoodSubgraphs[attempt] << endl;
+		}
+		if (numGoodSubgraphs[chosenAttempt] <= NUM_GOOD_SUBGRAPHS_THRESHOLD)
+		{
+			cout << "reached final threshold" << endl;
+		}
 
-			delete subgraphsTemp;
+		// store new cut edges of the chosen attempt
+		map< int, set<int> > cutEdges;
+		for (int i = 0; i < numEdges; i++)
+		{
+			if (!keepEdges[i])
+				continue;
+
+			// keep these uncut edges
+			int node1 = edgeNodes[i].first;
+			int node2 = edgeNodes[i].second;
+			cutEdges[node1].insert(node2);
+			cutEdges[node2].insert(node1);
 		}
 
-		return subgraphs;
+		// create subgraphs only for the chosen partition
+		ImgLabeling Ycopy;
+		Ycopy.confidences = YPred.confidences;
+		Ycopy.confidencesAvailable = YPred.confidencesAvailable;
+		Ycopy.graph = YPred.graph;
+		Ycopy.labelComponents = YPred.labelComponents;
+
+		return new MyGraphAlgorithms::SubgraphSet(Ycopy, cutEdges);
 	}
 
-	void CutScheduleSuccessor::getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
+	const set<int>& CutScheduleSuccessor::getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
 	{
-		getAllLabels(candidateLabelsSet, cc);	
+		return getAllLabels(candidateLabelsSet, cc);	
 	}
 
 	/**************** Cut Schedule Neighbor Successor Function ****************/
@@ -829,9 +832,9 @@ namespace HCSearch
 	{
 	}
 	
-	void CutScheduleNeighborSuccessor::getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
+	const set<int>& CutScheduleNeighborSuccessor::getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
 	{
-		getNeighborLabels(candidateLabelsSet, cc);	
+		return getNeighborLabels(candidateLabelsSet, cc);	
 	}
 
 	/**************** Cut Schedule Confidences Neighbor Successor Function ****************/
@@ -852,9 +855,9 @@ namespace HCSearch
 	{
 	}
 	
-	void CutScheduleConfidencesNeighborSuccessor::getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
+	const set<int>& CutScheduleConfidencesNeighborSuccessor::getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
 	{
-		getConfidencesNeighborLabels(candidateLabelsSet, cc);	
+		return getConfidencesNeighborLabels(candidateLabelsSet, cc);	
 	}
 
 	/**************** Stochastic Schedule Successor Function ****************/
@@ -933,55 +936,36 @@ namespace HCSearch
 
 	MyGraphAlgorithms::SubgraphSet* StochasticScheduleSuccessor::cutEdges(ImgFeatures& X, ImgLabeling& YPred, double threshold, double T, int timeStep, int timeBound)
 	{
-		const int numNodes = X.getNumNodes();
-		map< int, set<int> > edges = YPred.graph.adjList;
-
 		// store new cut edges
 		map< int, set<int> > cutEdges;
 
-		// convert to format storing (node1, node2) pairs
-		vector< MyPrimitives::Pair< int, int > > edgeNodes;
-
-		// edge weights using KL divergence measure
-		vector<double> edgeWeights;
+		// (node1, node2) pairs with edge weights using KL divergence measure, computed once per image
+		shared_ptr< const CutEdgeWeights > cutEdgeWeights = getCutEdgeWeights(X, YPred, T, &computeSymmetricKL);
+		const vector< MyPrimitives::Pair< int, int > >& edgeNodes = cutEdgeWeights->edgeNodes;
+		const vector<double>& edgeWeights = cutEdgeWeights->weights;
 
 		// keep track of which edges to clamp
-		vector<bool> positiveEdgeClamps;
-		vector<bool> negativeEdgeClamps;
-
-		// iterate over all edges to store
-		for (map< int, set<int> >::iterator it = edges.begin();
-			it != edges.end(); ++it)
-		{
-			int node1 = it->first;
-			set<int> neighbors = it->second;
-		
-			// loop over neighbors
-			for (set<int>::iterator it2 = neighbors.begin(); it2 != neighbors.end(); ++it2)
-			{
-				int node2 = *it2;
-
-				// get features and labels
-				VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
-				VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
+		// for now do not clamp
+		// TODO: read weights and make decision with threshold
+		vector<bool> positiveEdgeClamps(edgeNodes.size(), false);
+		vector<bool> negativeEdgeClamps(edgeNodes.size(), false);
 
-				// compute weights already
-				double weight = exp( -(computeKL(nodeFeatures1, nodeFeatures2) + computeKL(nodeFeatures2, nodeFeatures1))*T/2 );
-				edgeWeights.push_back(weight);
+		// the schedule only depends on the time step, so compute it once per cut
+		double scheduleRatio = 1.0 - 1.0*max(0.0, min(1.0, (1.0*(timeStep+timeBound/4)/timeBound)));
+		double scheduledThreshold = 1 - 1.0*max(0.0, min(1.0, scheduleRatio)) * (1.0 - threshold);
 
-				// for now do not clamp
-				// TODO: read weights and make decision with threshold
-				positiveEdgeClamps.push_back(false);
-				negativeEdgeClamps.push_back(false);
+		// given the edge weights, do the actual cutting!
+		const int numEdges = edgeNodes.size();
 
-				// add
-				MyPrimitives::Pair< int, int> nodePair = MyPrimitives::Pair< int, int >(node1, node2);
-				edgeNodes.push_back(nodePair);
-			}
+		// one threshold per edge, drawn in bulk
+		vector<double> indepThresholds;
+		if (cutEdgesIndependently)
+		{
+			indepThresholds.resize(numEdges);
+			if (numEdges > 0)
+				Rand::stream().uniforms(&indepThresholds[0], numEdges);
 		}
 
-		// given the edge weights, do the actual cutting!
-		const int numEdges = edgeNodes.size();
 		for (int i = 0; i < numEdges; i++)
 		{
 			MyPrimitives::Pair< int, int > nodePair = edgeNodes[i];
@@ -1004,10 +988,6 @@ namespace HCSearch
 			else if (!cutEdgesIndependently)
 			{
 				// uniform state
-				double inverseThreshold = 1.0 - threshold;
-				double scheduleRatio = 1.0 - 1.0*max(0.0, min(1.0, (1.0*(timeStep+timeBound/4)/timeBound)));
-				double scheduledInverseThreshold = 1.0*max(0.0, min(1.0, scheduleRatio)) * inverseThreshold;
-				double scheduledThreshold = 1 - scheduledInverseThreshold;
 				willCut = edgeWeights[i] <= scheduledThreshold;
 
 				//LOG() << "\toriginal threshold=" << threshold << ", scheduled threshold=" << scheduledThreshold << ", will cut=" << willCut << endl;
@@ -1018,14 +998,11 @@ namespace HCSearch
 				//double biasedCoin = Rand::unifDist(); // ~ Uniform(0, 1)
 				//willCut = biasedCoin <= 1-edgeWeights[i];
 
-				double indepThreshold = Rand::unifDist(); // ~ Uniform(0, 1)
-				double inverseThreshold = 1.0 - indepThreshold;
-				double scheduleRatio = 1.0 - 1.0*max(0.0, min(1.0, (1.0*(timeStep+timeBound/4)/timeBound)));
-				double scheduledInverseThreshold = 1.0*max(0.0, min(1.0, scheduleRatio)) * inverseThreshold;
-				double scheduledThreshold = 1 - scheduledInverseThreshold;
-				willCut = edgeWeights[i] <= scheduledThreshold;
+				double indepThreshold = indepThresholds[i]; // ~ Uniform(0, 1)
+				double indepScheduledThreshold = 1 - 1.0*max(0.0, min(1.0, scheduleRatio)) * (1.0 - indepThreshold);
+				willCut = edgeWeights[i] <= indepScheduledThreshold;
 
-				//LOG() << "\toriginal threshold=" << indepThreshold << ", scheduled threshold=" << scheduledThreshold << ", will cut=" << willCut << endl;
+				//LOG() << "\toriginal threshold=" << indepThreshold << ", scheduled threshold=" << indepScheduledThreshold << ", will cut=" << willCut << endl;
 			}
 
 			if (!willCut)
@@ -1049,6 +1026,7 @@ namespace HCSearch
 		Ycopy.confidences = YPred.confidences;
 		Ycopy.confidencesAvailable = YPred.confidencesAvailable;
 		Ycopy.graph = YPred.graph;
+		Ycopy.labelComponents = YPred.labelComponents;
 
 		LOG() << "Getting subgraphs..." << endl;
 
@@ -1092,6 +1070,9 @@ namespace HCSearch
 		// successors set
 		vector< ImgCandidate > successors;
 
+		// stochastic cuts shared by all candidates
+		SharedAdjList cuts = subgraphs->getCuts();
+
 		// loop over each sub graph
 		int cumSumLabels = 0;
 		int numSumLabels = 0;
@@ -1109,44 +1090,35 @@ namespace HCSearch
 				int nodeLabel = cc->getLabel();
 				candidateLabelsSet.insert(nodeLabel);
 				
-				// get labels
-				getLabels(candidateLabelsSet, cc);
-				
-				candidateLabelsSet.erase(nodeLabel);
+				// get labels (may be the shared set of all class labels)
+				const set<int>& candidateLabels = getLabels(candidateLabelsSet, cc);
 
-				cumSumLabels += candidateLabelsSet.size();
+				cumSumLabels += candidateLabels.size() - candidateLabels.count(nodeLabel);
 				numSumLabels++;
 
 				// loop over each candidate label
-				for (set<int>::iterator it3 = candidateLabelsSet.begin(); it3 != candidateLabelsSet.end(); ++it3)
+				NodeRange component = cc->getNodes();
+				for (set<int>::const_iterator it3 = candidateLabels.begin(); it3 != candidateLabels.end(); ++it3)
 				{
 					int label = *it3;
+					if (label == nodeLabel)
+						continue; // do not flip to same label
 
 					// form successor object
-					ImgLabeling YNew;
-					YNew.confidences = YPred.confidences;
-					YNew.confidencesAvailable = YPred.confidencesAvailable;
-					YNew.stochasticCuts = subgraphs->getCuts();
-					YNew.stochasticCutsAvailable = true;
-					YNew.graph = YPred.graph;
+					ImgCandidate YCandidate(&YPred);
+					YCandidate.stochasticCuts = cuts;
+					YCandidate.stochasticCutsAvailable = true;
 
 					// make changes
-					set<int> component = cc->getNodes();
-					set<int> action;
-					for (set<int>::iterator it4 = component.begin(); it4 != component.end(); ++it4)
+					for (NodeRange::const_iterator it4 = component.begin(); it4 != component.end(); ++it4)
 					{
 						int node = *it4;
 						if (this->clampNodes && nodeClampDecisions[node])
-							YNew.graph.nodesData(node) = YPred.getMostConfidentLabel(node);
+							YCandidate.relabel(node, YPred.getMostConfidentLabel(node));
 						else
-							YNew.graph.nodesData(node) = label;
-						action.insert(node);
+							YCandidate.relabel(node, label);
 					}
 
-					ImgCandidate YCandidate;
-					YCandidate.labeling = YNew;
-					YCandidate.action = action;
-
 					successors.push_back(YCandidate);
 				}
 			}
@@ -1160,33 +1132,34 @@ namespace HCSearch
 		return successors;
 	}
 
-	void StochasticScheduleSuccessor::getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
+	const set<int>& StochasticScheduleSuccessor::getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
 	{
-		getAllLabels(candidateLabelsSet, cc);	
+		return getAllLabels(candidateLabelsSet, cc);	
 	}
 
-	void StochasticScheduleSuccessor::getAllLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
+	const set<int>& StochasticScheduleSuccessor::getAllLabels(set<int>& /*candidateLabelsSet*/, MyGraphAlgorithms::ConnectedComponent* cc)
 	{
 		// flip to any possible class
-		candidateLabelsSet = Global::settings->CLASSES.getLabels();
+		return Global::settings->CLASSES.getLabels();
 	}
 
-	void StochasticScheduleSuccessor::getNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
+	const set<int>& StochasticScheduleSuccessor::getNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
 	{
 		if (cc->hasNeighbors())
 		{
 			// add only neighboring labels to candidate label set
 			set<int> neighborSet = cc->getNeighborLabels();
 			candidateLabelsSet.insert(neighborSet.begin(), neighborSet.end());
+			return candidateLabelsSet;
 		}
 		else
 		{
 			// if connected component is isolated without neighboring connected components, then flip to any possible class
-			candidateLabelsSet = Global::settings->CLASSES.getLabels();
+			return Global::settings->CLASSES.getLabels();
 		}
 	}
 
-	void StochasticScheduleSuccessor::getConfidencesNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
+	const set<int>& StochasticScheduleSuccessor::getConfidencesNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
 	{
 		int topKConfidences = static_cast<int>(ceil(TOP_CONFIDENCES_PROPORTION * Global::settings->CLASSES.numClasses()));
 		candidateLabelsSet = cc->getTopConfidentLabels(topKConfidences);
@@ -1196,6 +1169,7 @@ namespace HCSearch
 			set<int> neighborSet = cc->getNeighborLabels();
 			candidateLabelsSet.insert(neighborSet.begin(), neighborSet.end());
 		}
+		return candidateLabelsSet;
 	}
 
 	double StochasticScheduleSuccessor::computeKL(const VectorXd& p, const VectorXd& q)
@@ -1207,9 +1181,6 @@ namespace HCSearch
 
 		double KL = 0;
 
-		VectorXd pn = p.normalized();
-		VectorXd qn = q.normalized();
-
 		for (int i = 0; i < p.size(); i++)
 		{
 			if (p(i) != 0)
@@ -1228,6 +1199,16 @@ namespace HCSearch
 		return KL;
 	}
 
+	double StochasticScheduleSuccessor::computeSymmetricKL(ImgFeatures& X, int node1, int node2)
+	{
+		if (X.floatFeaturesAvailable)
+			return MySIMD::symmetricKL(X.floatFeatures->row(node1), X.floatFeatures->row(node2), X.getFeatureDim());
+
+		VectorXd nodeFeatures1 = X.graph.nodesData.row(node1);
+		VectorXd nodeFeatures2 = X.graph.nodesData.row(node2);
+		return computeKL(nodeFeatures1, nodeFeatures2) + computeKL(nodeFeatures2, nodeFeatures1);
+	}
+
 	/**************** Stochastic Neighbor Successor Function ****************/
 
 	StochasticScheduleNeighborSuccessor::StochasticScheduleNeighborSuccessor()
@@ -1268,9 +1249,9 @@ namespace HCSearch
 	{
 	}
 
-	void StochasticScheduleNeighborSuccessor::getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
+	const set<int>& StochasticScheduleNeighborSuccessor::getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
 	{
-		getNeighborLabels(candidateLabelsSet, cc);	
+		return getNeighborLabels(candidateLabelsSet, cc);	
 	}
 
 	/**************** Stochastic Confidences Neighbor Successor Function ****************/
@@ -1313,9 +1294,9 @@ namespace HCSearch
 	{
 	}
 
-	void StochasticScheduleConfidencesNeighborSuccessor::getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
+	const set<int>& StochasticScheduleConfidencesNeighborSuccessor::getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc)
 	{
-		getConfidencesNeighborLabels(candidateLabelsSet, cc);	
+		return getConfidencesNeighborLabels(candidateLabelsSet, cc);	
 	}
 
 	/**************** Stochastic Constrained Successor Function ****************/
@@ -1452,7 +1433,7 @@ namespace HCSearch
 			if (nodesClamped[node1])
 			{
 				NeighborSet_t neighbors = it->second;
-				for (NeighborSet_t::iterator it2 = neighbors.begin(); it2 != neighbors.end(); ++it2)
+				for (NeighborSet_t::const_iterator it2 = neighbors.begin(); it2 != neighbors.end(); ++it2)
 				{
 					int node2 = *it2;
 					YPredConstrained.graph.nodesData(node2) = YPred.graph.nodesData(node1);
@@ -1460,6 +1441,7 @@ namespace HCSearch
 			}
 			//TODO: what if connected components has multiple clamped nodes with different labels?
 		}
+		YPredConstrained.labelComponents.reset();
 
 		// cut edges without clamping (stochastic cutting)
 		for (map< Pair<int, int>, bool >:: iterator it = edgesClamped.begin(); it != edgesClamped.end(); ++it)
@@ -1493,6 +1475,12 @@ namespace HCSearch
 		// constraint propagation 2: generate successors and propose labels that satisfy must-not-link edges
 		vector< ImgCandidate > successors = createCandidates(YPredConstrained, subgraphs, nodesClamped, edgesClamped, edgesCut);
 
+		// candidates are deltas against the local constrained labeling, so store them in full
+		for (vector< ImgCandidate >::iterator it = successors.begin(); it != successors.end(); ++it)
+		{
+			it->materialize();
+		}
+
 		LOG() << "num successors generated=" << successors.size() << endl;
 
 		Global::settings->stats->addSuccessorCount(successors.size());
@@ -1515,6 +1503,9 @@ namespace HCSearch
 		// successors set
 		vector< ImgCandidate > successors;
 
+		// stochastic cuts shared by all candidates
+		SharedAdjList cuts = subgraphs->getCuts();
+
 		// loop over each sub graph
 		int cumSumLabels = 0;
 		int numSumLabels = 0;
@@ -1546,12 +1537,12 @@ namespace HCSearch
 				candidateLabelsSet.erase(nodeLabel);
 
 				// remove from label set if there is a must-not link edge constraint with clamped neighbor node
-				set<int> component = cc->getNodes();
-				for (set<int>::iterator it4 = component.begin(); it4 != component.end(); ++it4)
+				NodeRange component = cc->getNodes();
+				for (NodeRange::const_iterator it4 = component.begin(); it4 != component.end(); ++it4)
 				{
 					int node1 = *it4;
-					set<int> neighbors = YPred.graph.adjList[node1];
-					for (set<int>::iterator it5 = neighbors.begin(); it5 != neighbors.end(); ++it5)
+					NeighborRange neighbors = YPred.graph.adjList.neighbors(node1);
+					for (NeighborRange::const_iterator it5 = neighbors.begin(); it5 != neighbors.end(); ++it5)
 					{
 						int node2 = *it5;
 						MyPrimitives::Pair<int, int> edge = MyPrimitives::Pair<int, int>(node1, node2);
@@ -1577,31 +1568,21 @@ namespace HCSearch
 					int label = *it3;
 
 					// form successor object
-					ImgLabeling YNew;
-					YNew.confidences = YPred.confidences;
-					YNew.confidencesAvailable = YPred.confidencesAvailable;
-					YNew.stochasticCuts = subgraphs->getCuts();
-					YNew.stochasticCutsAvailable = true;
-					YNew.graph = YPred.graph;
+					ImgCandidate YCandidate(&YPred);
+					YCandidate.stochasticCuts = cuts;
+					YCandidate.stochasticCutsAvailable = true;
 
 					// make changes
-					set<int> component = cc->getNodes();
-					set<int> action;
-					for (set<int>::iterator it4 = component.begin(); it4 != component.end(); ++it4)
+					for (NodeRange::const_iterator it4 = component.begin(); it4 != component.end(); ++it4)
 					{
 						int node = *it4;
 						// clamp node otherwise flip it
 						if (nodesClamped[node])
-							YNew.graph.nodesData(node) = YPred.getLabel(node);
+							YCandidate.relabel(node, YPred.getLabel(node));
 						else
-							YNew.graph.nodesData(node) = label;
-						action.insert(node);
+							YCandidate.relabel(node, label);
 					}
 
-					ImgCandidate YCandidate;
-					YCandidate.labeling = YNew;
-					YCandidate.action = action;
-
 					successors.push_back(YCandidate);
 				}
 			}
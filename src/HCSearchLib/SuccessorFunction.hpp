@@ -100,13 +100,20 @@ namespace HCSearch
 	protected:
 		virtual MyGraphAlgorithms::SubgraphSet* cutEdges(ImgFeatures& X, ImgLabeling& YPred, double threshold, double T);
 		virtual vector< ImgCandidate > createCandidates(ImgLabeling& YPred, MyGraphAlgorithms::SubgraphSet* subgraphs);
-		virtual void getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
+		virtual const set<int>& getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
 
-		void getAllLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
-		void getNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
-		void getConfidencesNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
+		const set<int>& getAllLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
+		const set<int>& getNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
+		const set<int>& getConfidencesNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
 
 		static double computeKL(const VectorXd& p, const VectorXd& q);
+
+		/*!
+		 * @brief Compute KL(f1||f2) + KL(f2||f1) of the features of two nodes.
+		 * 
+		 * Uses the SIMD kernels if single-precision features are available.
+		 */
+		static double computeSymmetricKL(ImgFeatures& X, int node1, int node2);
 	};
 
 	/*!
@@ -124,7 +131,7 @@ namespace HCSearch
 		~StochasticNeighborSuccessor();
 
 	protected:
-		virtual void getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
+		virtual const set<int>& getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
 	};
 
 	/*!
@@ -142,7 +149,7 @@ namespace HCSearch
 		~StochasticConfidencesNeighborSuccessor();
 
 	protected:
-		virtual void getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
+		virtual const set<int>& getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
 	};
 
 	/*!
@@ -167,7 +174,7 @@ namespace HCSearch
 
 	protected:
 		virtual MyGraphAlgorithms::SubgraphSet* cutEdges(ImgFeatures& X, ImgLabeling& YPred, double threshold, double T);
-		virtual void getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
+		virtual const set<int>& getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
 	};
 
 	/*!
@@ -184,7 +191,7 @@ namespace HCSearch
 		~CutScheduleNeighborSuccessor();
 
 	protected:
-		virtual void getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
+		virtual const set<int>& getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
 	};
 
 	/*!
@@ -201,7 +208,7 @@ namespace HCSearch
 		~CutScheduleConfidencesNeighborSuccessor();
 
 	protected:
-		virtual void getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
+		virtual const set<int>& getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
 	};
 
 	/*!
@@ -241,13 +248,20 @@ namespace HCSearch
 	protected:
 		virtual MyGraphAlgorithms::SubgraphSet* cutEdges(ImgFeatures& X, ImgLabeling& YPred, double threshold, double T, int timeStep, int timeBound);
 		virtual vector< ImgCandidate > createCandidates(ImgLabeling& YPred, MyGraphAlgorithms::SubgraphSet* subgraphs);
-		virtual void getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
+		virtual const set<int>& getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
 
-		void getAllLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
-		void getNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
-		void getConfidencesNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
+		const set<int>& getAllLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
+		const set<int>& getNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
+		const set<int>& getConfidencesNeighborLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
 
 		static double computeKL(const VectorXd& p, const VectorXd& q);
+
+		/*!
+		 * @brief Compute KL(f1||f2) + KL(f2||f1) of the features of two nodes.
+		 * 
+		 * Uses the SIMD kernels if single-precision features are available.
+		 */
+		static double computeSymmetricKL(ImgFeatures& X, int node1, int node2);
 	};
 
 	/*!
@@ -266,7 +280,7 @@ namespace HCSearch
 		~StochasticScheduleNeighborSuccessor();
 
 	protected:
-		virtual void getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
+		virtual const set<int>& getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
 	};
 
 	/*!
@@ -285,7 +299,7 @@ namespace HCSearch
 		~StochasticScheduleConfidencesNeighborSuccessor();
 
 	protected:
-		virtual void getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
+		virtual const set<int>& getLabels(set<int>& candidateLabelsSet, MyGraphAlgorithms::ConnectedComponent* cc);
 	};
 
 	/*!
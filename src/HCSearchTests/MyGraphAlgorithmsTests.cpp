@@ -45,6 +45,7 @@ namespace Testing
 			graph.adjList[7].insert(8);
 			graph.adjList[8].insert(5);
 			graph.adjList[8].insert(7);
+			graph.adjList.compress();
 			
 			ImgLabeling Y;
 			Y.graph = graph;
@@ -122,6 +123,67 @@ namespace Testing
 			}
 		}
 
+		TEST_METHOD(ConnectedComponentArenaTest)
+		{
+			MyGraphAlgorithms::ConnectedComponentSet ccset(Y);
+			vector< MyGraphAlgorithms::ConnectedComponent* > ccs = ccset.getConnectedComponents();
+
+			// every node is in exactly one component, in increasing order
+			int numNodes = 0;
+			for (vector< MyGraphAlgorithms::ConnectedComponent* >::iterator it = ccs.begin();
+				it != ccs.end(); ++it)
+			{
+				MyGraphAlgorithms::ConnectedComponent* cc = *it;
+				MyGraphAlgorithms::NodeRange nodes = cc->getNodes();
+				for (MyGraphAlgorithms::NodeRange::const_iterator it2 = nodes.begin(); it2 != nodes.end(); ++it2)
+				{
+					Assert::AreEqual(Y.getLabel(*it2), cc->getLabel());
+					if (it2 != nodes.begin())
+						Assert::IsTrue(*(it2-1) < *it2);
+				}
+				numNodes += cc->size();
+
+				// labels alternate, so the only neighbor label is the other label
+				set<int> neighborLabels = cc->getNeighborLabels();
+				Assert::AreEqual(static_cast<int>(neighborLabels.size()), 1);
+				Assert::AreEqual(*neighborLabels.begin(), 1 - cc->getLabel());
+				Assert::IsTrue(cc->hasNeighbors());
+			}
+			Assert::AreEqual(numNodes, 9);
+
+			// subgraph nodes are covered by their connected components
+			MyGraphAlgorithms::SubgraphSet subgraphset(Y, cuts);
+			vector< MyGraphAlgorithms::Subgraph* > subs = subgraphset.getSubgraphs();
+			for (vector< MyGraphAlgorithms::Subgraph* >::iterator it = subs.begin();
+				it != subs.end(); ++it)
+			{
+				MyGraphAlgorithms::Subgraph* sub = *it;
+				vector< MyGraphAlgorithms::ConnectedComponent* > subccs = sub->getConnectedComponents();
+				int subNodes = 0;
+				for (vector< MyGraphAlgorithms::ConnectedComponent* >::iterator it2 = subccs.begin();
+					it2 != subccs.end(); ++it2)
+					subNodes += (*it2)->size();
+				Assert::AreEqual(subNodes, sub->size());
+			}
+		}
+
+		TEST_METHOD(CutThresholdSweepTest)
+		{
+			// keeping the uncut edges one at a time ends at the same count as the subgraph set
+			MyGraphAlgorithms::CutThresholdSweep sweep(Y);
+			for (map< int, set<int> >::iterator it = cuts.begin(); it != cuts.end(); ++it)
+				for (set<int>::iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2)
+					sweep.keepEdge(it->first, *it2);
+
+			MyGraphAlgorithms::SubgraphSet subgraphset(Y, cuts);
+			Assert::AreEqual(sweep.getNumGoodSubgraphs(), static_cast<int>(subgraphset.getExactlyOnePositiveCCSubgraphs().size()));
+
+			// every node is its own subgraph after a reset
+			sweep.reset();
+			MyGraphAlgorithms::SubgraphSet singletons(Y, map< int, set<int> >());
+			Assert::AreEqual(sweep.getNumGoodSubgraphs(), static_cast<int>(singletons.getExactlyOnePositiveCCSubgraphs().size()));
+		}
+
 		TEST_METHOD(DijsointSetUnionTest)
 		{
 			MyGraphAlgorithms::DisjointSet ds(10);
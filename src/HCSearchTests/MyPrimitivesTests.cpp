@@ -68,5 +68,24 @@ namespace Testing
 			Assert::AreEqual(static_cast<int>(test.count(Pair<int, int>(1, -1))), 1);
 			Assert::AreEqual(static_cast<int>(test.size()), 4);
 		}
+
+		TEST_METHOD(CopyOnWriteDetach)
+		{
+			// construct
+			CopyOnWrite< set<int> > original;
+			original.mutate().insert(1);
+			Assert::IsFalse(original.isShared());
+
+			// copies share the value
+			CopyOnWrite< set<int> > copy = original;
+			Assert::IsTrue(copy.sharesWith(original));
+			Assert::IsTrue(original.isShared());
+
+			// writing to the copy detaches it
+			copy.mutate().insert(2);
+			Assert::IsFalse(copy.sharesWith(original));
+			Assert::AreEqual(static_cast<int>(original.get().size()), 1);
+			Assert::AreEqual(static_cast<int>(copy.get().size()), 2);
+		}
 	};
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "CppUnitTest.h"
 
 #include <iostream>
+#include <thread>
 #include "HCSearch.hpp"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -9,8 +10,348 @@ using namespace HCSearch;
 
 namespace Testing
 {		
+	/**************** Search Test Helpers ****************/
+
+	/*!
+	 * @brief Initial prediction function returning a fixed labeling.
+	 */
+	class FixedInitialPrediction : public IInitialPredictionFunction
+	{
+	private:
+		ImgLabeling Y;
+
+	public:
+		FixedInitialPrediction(ImgLabeling Y)
+		{
+			this->Y = Y;
+		}
+
+		virtual ImgLabeling getInitialPrediction(ImgFeatures& X)
+		{
+			return this->Y;
+		}
+	};
+
+	/*!
+	 * @brief Flipbit successor function that takes at least the given time per call.
+	 */
+	class SlowFlipbitSuccessor : public FlipbitSuccessor
+	{
+	private:
+		int delay; //!< Delay in ms
+
+	public:
+		SlowFlipbitSuccessor(int delay)
+		{
+			this->delay = delay;
+		}
+
+		virtual vector< ImgCandidate > generateSuccessors(ImgFeatures& X, ImgLabeling& YPred, int timeStep, int timeBound)
+		{
+			this_thread::sleep_for(chrono::milliseconds(this->delay));
+			return FlipbitSuccessor::generateSuccessors(X, YPred, timeStep, timeBound);
+		}
+	};
+
+	/*!
+	 * @brief Rank model with fixed weights.
+	 */
+	class FixedRankModel : public IRankModel
+	{
+	private:
+		VectorXd weights;
+
+	public:
+		FixedRankModel(VectorXd weights)
+		{
+			this->weights = weights;
+			this->initialized = true;
+		}
+
+		virtual double rank(const RankFeatures& features)
+		{
+			return rankFeatures(this->weights, features);
+		}
+
+		virtual vector<double> rank(const vector<RankFeatures>& featuresList)
+		{
+			vector<double> ranks;
+			for (vector<RankFeatures>::const_iterator it = featuresList.begin(); it != featuresList.end(); ++it)
+				ranks.push_back(rankFeatures(this->weights, *it));
+			return ranks;
+		}
+
+		virtual VectorXd rank(const RankFeaturesMatrix& featuresMatrix)
+		{
+			return rankMatrix(this->weights, featuresMatrix);
+		}
+
+		virtual RankerType rankerType()
+		{
+			return SVM_RANK;
+		}
+
+		virtual void load(string fileName)
+		{
+		}
+
+		virtual void save(string fileName)
+		{
+		}
+	};
+
+	/*!
+	 * @brief Breadth-first beam search that records the scores of the candidates of every step.
+	 */
+	class SearchTraceProbe : public BreadthFirstBeamSearchProcedure
+	{
+	public:
+		vector< double > heuristics; //!< Heuristic values of the candidates in the order they are chosen
+		vector< double > costs; //!< Cost values of the candidates in the order they are chosen
+
+	public:
+		SearchTraceProbe(int beamSize) : BreadthFirstBeamSearchProcedure(beamSize)
+		{
+		}
+
+		virtual void chooseSuccessors(SearchType searchType, SearchNodeHeuristicPQ& candidateSet, SearchNodeHeuristicPQ& openSet, SearchNodeCostPQ& costSet, 
+			vector< RankFeatures >& bestSet, vector< double >& bestLosses, vector< RankFeatures >& worstSet, vector< double >& worstLosses)
+		{
+			SearchNodeHeuristicPQ candidateSetCopy = candidateSet;
+			while (!candidateSetCopy.empty())
+			{
+				this->heuristics.push_back(candidateSetCopy.top()->getHeuristic());
+				this->costs.push_back(candidateSetCopy.top()->getCost());
+				candidateSetCopy.pop();
+			}
+
+			BreadthFirstBeamSearchProcedure::chooseSuccessors(searchType, candidateSet, openSet, costSet, 
+				bestSet, bestLosses, worstSet, worstLosses);
+		}
+	};
+
+	/*!
+	 * @brief Best-first beam search that records the nodes evicted from the cost set.
+	 * 
+	 * Evictions of a search step are detected at the start of the next step.
+	 */
+	class CostSetEvictionProbe : public BestFirstBeamSearchProcedure
+	{
+	public:
+		int numEvicted; //!< Number of nodes evicted from the cost set
+		int numOpenEvicted; //!< Number of evicted nodes that were still in the open set
+		int numNotWorseEvicted; //!< Number of evicted nodes not worse than the best cost
+		int numEvictedTwice; //!< Number of labelings evicted more than once
+		int numEvictedAccepted; //!< Number of candidates accepted with an evicted labeling
+
+	protected:
+		typedef pair< LabelingHash_t, LabelingHash_t > Labeling_t;
+
+		SearchNodeCostPQ* costSet; //!< Cost set of the running search
+		map< SearchNode*, pair< Labeling_t, double > > costNodes; //!< Cost set after the last step
+		set< Labeling_t > evictedLabelings;
+
+	public:
+		CostSetEvictionProbe(int beamSize) : BestFirstBeamSearchProcedure(beamSize)
+		{
+			this->numEvicted = 0;
+			this->numOpenEvicted = 0;
+			this->numNotWorseEvicted = 0;
+			this->numEvictedTwice = 0;
+			this->numEvictedAccepted = 0;
+			this->costSet = NULL;
+		}
+
+		virtual vector< SearchNode* > selectSubsetOpenSet(SearchNodeHeuristicPQ& openSet)
+		{
+			if (this->costSet != NULL)
+			{
+				set< SearchNode* > liveNodes;
+				SearchNodeCostPQ costSetCopy = *this->costSet;
+				const double bestCost = costSetCopy.top()->getCost();
+				while (!costSetCopy.empty())
+				{
+					liveNodes.insert(costSetCopy.top());
+					costSetCopy.pop();
+				}
+
+				set< SearchNode* > openNodes;
+				SearchNodeHeuristicPQ openSetCopy = openSet;
+				while (!openSetCopy.empty())
+				{
+					openNodes.insert(openSetCopy.top());
+					openSetCopy.pop();
+				}
+
+				// evicted nodes are deleted, so only their pointers and recorded labelings are compared
+				for (map< SearchNode*, pair< Labeling_t, double > >::iterator it = this->costNodes.begin(); it != this->costNodes.end(); ++it)
+				{
+					if (liveNodes.count(it->first) > 0)
+						continue;
+
+					this->numEvicted++;
+					if (openNodes.count(it->first) > 0)
+						this->numOpenEvicted++;
+					if (it->second.second <= bestCost)
+						this->numNotWorseEvicted++;
+					if (!this->evictedLabelings.insert(it->second.first).second)
+						this->numEvictedTwice++;
+				}
+			}
+
+			return BestFirstBeamSearchProcedure::selectSubsetOpenSet(openSet);
+		}
+
+		virtual void chooseSuccessors(SearchType searchType, SearchNodeHeuristicPQ& candidateSet, SearchNodeHeuristicPQ& openSet, SearchNodeCostPQ& costSet, 
+			vector< RankFeatures >& bestSet, vector< double >& bestLosses, vector< RankFeatures >& worstSet, vector< double >& worstLosses)
+		{
+			SearchNodeHeuristicPQ candidateSetCopy = candidateSet;
+			while (!candidateSetCopy.empty())
+			{
+				SearchNode* state = candidateSetCopy.top();
+				candidateSetCopy.pop();
+				if (this->evictedLabelings.count(Labeling_t(state->getLabelingHash(), state->getLabelingCheck())) > 0)
+					this->numEvictedAccepted++;
+			}
+
+			BestFirstBeamSearchProcedure::chooseSuccessors(searchType, candidateSet, openSet, costSet, 
+				bestSet, bestLosses, worstSet, worstLosses);
+
+			this->costSet = &costSet;
+			this->costNodes.clear();
+			SearchNodeCostPQ costSetCopy = costSet;
+			while (!costSetCopy.empty())
+			{
+				SearchNode* state = costSetCopy.top();
+				costSetCopy.pop();
+				this->costNodes[state] = make_pair(Labeling_t(state->getLabelingHash(), state->getLabelingCheck()), state->getCost());
+			}
+		}
+	};
+
+	/*!
+	 * @brief Search procedure to build and inspect search nodes directly.
+	 * 
+	 * Nodes are referred to by the order they were added.
+	 */
+	class SearchNodeProbe : public BreadthFirstBeamSearchProcedure
+	{
+	protected:
+		vector< SearchNode* > nodes;
+
+	public:
+		~SearchNodeProbe()
+		{
+			for (vector< SearchNode* >::iterator it = this->nodes.begin(); it != this->nodes.end(); ++it)
+				delete *it;
+		}
+
+		int addRoot(SearchType searchType, ImgFeatures& X, ImgLabeling* YTruth, 
+			SearchSpace* searchSpace, IRankModel* heuristicModel, IRankModel* costModel)
+		{
+			this->nodes.push_back(createRootNode(searchType, X, YTruth, searchSpace, heuristicModel, costModel));
+			return this->nodes.size() - 1;
+		}
+
+		int addChild(int parent, ImgLabeling Y)
+		{
+			this->nodes.push_back(new SearchNode(this->nodes[parent], Y));
+			return this->nodes.size() - 1;
+		}
+
+		/*!
+		 * Add the (unpruned) successors of a node and return the number of successors.
+		 */
+		int expand(int parent)
+		{
+			vector< SearchNode* > successors = this->nodes[parent]->generateSuccessorNodes(false, 0, 1, NULL);
+			this->nodes.insert(this->nodes.end(), successors.begin(), successors.end());
+			return successors.size();
+		}
+
+		int size()
+		{
+			return this->nodes.size();
+		}
+
+		ImgLabeling getY(int i)
+		{
+			return this->nodes[i]->getY();
+		}
+
+		bool hasSameLabeling(int i, int j)
+		{
+			return this->nodes[i]->hasSameLabeling(this->nodes[j]);
+		}
+
+		double getHeuristic(int i)
+		{
+			return this->nodes[i]->getHeuristic();
+		}
+
+		double getCost(int i)
+		{
+			return this->nodes[i]->getCost();
+		}
+
+		RankFeatures getHeuristicFeatures(int i)
+		{
+			return this->nodes[i]->getHeuristicFeatures();
+		}
+
+		RankFeatures getCostFeatures(int i)
+		{
+			return this->nodes[i]->getCostFeatures();
+		}
+	};
+
 	TEST_CLASS(SearchSpaceTests)
 	{
+	private:
+		/*!
+		 * Set up a 4x3 grid with 3 classes, its groundtruth and an all-zero initial labeling.
+		 */
+		static void setupSearchProblemHelper(ImgFeatures& X, ImgLabeling& YTruth, ImgLabeling& YInit)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 0, false);
+			Global::settings->CLASSES.addClass(1, 1, false);
+			Global::settings->CLASSES.addClass(2, 2, false);
+			Global::settings->CHECK_FOR_DUPLICATES = true;
+
+			const int width = 4;
+			const int height = 3;
+			const int numNodes = width*height;
+
+			AdjList_t edgeNeighbors = AdjList_t();
+			for (int node = 0; node < numNodes; node++)
+			{
+				if (node % width > 0)
+					edgeNeighbors[node].insert(node - 1);
+				if (node % width < width - 1)
+					edgeNeighbors[node].insert(node + 1);
+				if (node >= width)
+					edgeNeighbors[node].insert(node - width);
+				if (node < numNodes - width)
+					edgeNeighbors[node].insert(node + width);
+			}
+
+			X.graph.nodesData = MatrixXd(numNodes, 3);
+			for (int node = 0; node < numNodes; node++)
+				X.graph.nodesData.row(node) << 0.1*(node % 5), 0.2*(node % 3) + 0.1, 1.0 - 0.05*node;
+			X.graph.adjList = edgeNeighbors;
+			X.graph.adjList.compress();
+
+			YTruth.graph.nodesData = VectorXi::Zero(numNodes);
+			YTruth.graph.nodesData << 0, 1, 1, 2,
+					0, 1, 2, 2,
+					1, 1, 0, 2;
+			YTruth.graph.adjList = X.graph.adjList;
+
+			YInit.graph.nodesData = VectorXi::Zero(numNodes);
+			YInit.graph.adjList = X.graph.adjList;
+		}
+
 	public:
 		
 		TEST_METHOD(HammingLossTestZero)
@@ -163,5 +504,1167 @@ namespace Testing
 			bool pairwiseOkay = pairwiseDiff.cwiseAbs().sum() < EPSILON;
 			Assert::AreEqual(pairwiseOkay, true);
 		}
+
+		TEST_METHOD(EdgeKernelCacheTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 1, false);
+			Global::settings->CLASSES.addClass(1, 0, false);
+			Global::settings->CLASSES.addClass(2, -1, true);
+			Global::settings->CLASSES.setBackgroundLabel(-1);
+
+			double EPSILON = 0.0001;
+
+			AdjList_t edgeNeighbors = AdjList_t();
+			NeighborSet_t v0Neighbors = NeighborSet_t();
+			v0Neighbors.insert(3);
+			v0Neighbors.insert(1);
+			NeighborSet_t v1Neighbors = NeighborSet_t();
+			v1Neighbors.insert(0);
+			v1Neighbors.insert(2);
+			NeighborSet_t v2Neighbors = NeighborSet_t();
+			v2Neighbors.insert(1);
+			v2Neighbors.insert(3);
+			NeighborSet_t v3Neighbors = NeighborSet_t();
+			v3Neighbors.insert(2);
+			v3Neighbors.insert(0);
+
+			edgeNeighbors[0] = v0Neighbors;
+			edgeNeighbors[1] = v1Neighbors;
+			edgeNeighbors[2] = v2Neighbors;
+			edgeNeighbors[3] = v3Neighbors;
+
+			LabelGraph graph1;
+			graph1.nodesData = VectorXi::Zero(4);
+			graph1.nodesData << 0, 1, 1, 0;
+			graph1.adjList = edgeNeighbors;
+
+			ImgLabeling YPred;
+			YPred.graph = graph1;
+
+			FeatureGraph graph2;
+			graph2.nodesData = MatrixXd(4, 3);
+			graph2.nodesData << 0.1, 0.2, 0.3,
+					0.2, 0.4, 0.6,
+					1.5, 3.0, 4.5,
+					3.1, 4.5, 9.2;
+			graph2.adjList = edgeNeighbors;
+
+			ImgFeatures X;
+			X.graph = graph2;
+
+			// features without the cache
+			IFeatureFunction* featureFunctionTest = new StandardFeatures();
+			set<int> action;
+			RankFeatures phiDirect = featureFunctionTest->computeFeatures(X, YPred, action);
+
+			// features with the cache
+			X.computeEdgeKernels();
+			Assert::AreEqual(X.edgeKernels.edges->getNumEdges(), 8);
+			Assert::AreEqual(X.edgeKernels.edgeIndex(0, 2), -1);
+			Assert::AreEqual(X.edgeKernels.edgeIndex(1, 2), 3);
+			RankFeatures phiCached = featureFunctionTest->computeFeatures(X, YPred, action);
+
+			Assert::AreEqual(phiCached.data.size(), phiDirect.data.size());
+			bool cacheOkay = (phiCached.data - phiDirect.data).cwiseAbs().sum() < EPSILON;
+			Assert::AreEqual(cacheOkay, true);
+
+			delete featureFunctionTest;
+		}
+
+		TEST_METHOD(DenseCRFFilteredAccuracyTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 1, false);
+			Global::settings->CLASSES.addClass(1, 0, false);
+			Global::settings->CLASSES.addClass(2, -1, true);
+			Global::settings->CLASSES.setBackgroundLabel(-1);
+
+			double EPSILON = 0.0001;
+			double TOLERANCE = 0.001;
+
+			// nodes on a grid with smoothly varying features
+			const int gridSize = 20;
+			const int numNodes = gridSize*gridSize;
+
+			ImgFeatures X;
+			X.graph.nodesData = MatrixXd(numNodes, 3);
+			X.nodeLocations = MatrixXd(numNodes, 2);
+			X.nodeLocationsAvailable = true;
+
+			ImgLabeling Y;
+			Y.graph.nodesData = VectorXi(numNodes);
+
+			for (int node = 0; node < numNodes; node++)
+			{
+				double x = (node % gridSize + 0.5)/gridSize;
+				double y = (node / gridSize + 0.5)/gridSize;
+				X.nodeLocations(node, 0) = x;
+				X.nodeLocations(node, 1) = y;
+				X.graph.nodesData(node, 0) = 0.05*x;
+				X.graph.nodesData(node, 1) = 0.05*y;
+				X.graph.nodesData(node, 2) = 0.02*sin(10*x*y);
+				Y.graph.nodesData(node) = (x < 0.4) ? 0 : ((y < 0.6) ? 1 : -1);
+			}
+			Y.confidences = MatrixXd::Constant(numNodes, 3, 1.0/3);
+			Y.confidencesAvailable = true;
+
+			IFeatureFunction* exactFeatures = new DenseCRFFeatures(DenseCRFFeatures::EXACT);
+			IFeatureFunction* filteredFeatures = new DenseCRFFeatures(DenseCRFFeatures::FILTERED);
+			set<int> action;
+			RankFeatures phiExact = exactFeatures->computeFeatures(X, Y, action);
+			RankFeatures phiFiltered = filteredFeatures->computeFeatures(X, Y, action);
+
+			Assert::AreEqual(phiFiltered.data.size(), phiExact.data.size());
+
+			// unary term does not depend on the mode
+			VectorXd diff = phiFiltered.data - phiExact.data;
+			bool unaryOkay = diff.head(3).cwiseAbs().sum() < EPSILON;
+			Assert::AreEqual(unaryOkay, true);
+
+			// pairwise term is approximated by the lattice
+			VectorXd pairwiseDiff = diff.tail(diff.size()-3);
+			bool pairwiseOkay = pairwiseDiff.cwiseAbs().maxCoeff() < TOLERANCE;
+			Assert::AreEqual(pairwiseOkay, true);
+			bool relativeOkay = pairwiseDiff.norm() < 0.01*phiExact.data.tail(diff.size()-3).norm();
+			Assert::AreEqual(relativeOkay, true);
+
+			delete exactFeatures;
+			delete filteredFeatures;
+		}
+
+		TEST_METHOD(DenseCRFFilteredHighDimTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 1, false);
+			Global::settings->CLASSES.addClass(1, 0, false);
+			Global::settings->CLASSES.addClass(2, -1, true);
+			Global::settings->CLASSES.setBackgroundLabel(-1);
+
+			double EPSILON = 0.0001;
+			double TOLERANCE = 0.001;
+
+			// 64-dim features spanning a 3-dim subspace
+			const int gridSize = 20;
+			const int numNodes = gridSize*gridSize;
+			const int featureDim = 64;
+
+			MatrixXd basis(featureDim, 3);
+			for (int r = 0; r < featureDim; r++)
+				for (int c = 0; c < 3; c++)
+					basis(r, c) = cos(0.7*r*(c+1) + c);
+			HouseholderQR<MatrixXd> qr(basis);
+			MatrixXd orthonormal = qr.householderQ() * MatrixXd::Identity(featureDim, 3);
+
+			ImgFeatures X;
+			X.graph.nodesData = MatrixXd(numNodes, featureDim);
+			X.nodeLocations = MatrixXd(numNodes, 2);
+			X.nodeLocationsAvailable = true;
+
+			ImgLabeling Y;
+			Y.graph.nodesData = VectorXi(numNodes);
+
+			for (int node = 0; node < numNodes; node++)
+			{
+				double x = (node % gridSize + 0.5)/gridSize;
+				double y = (node / gridSize + 0.5)/gridSize;
+				X.nodeLocations(node, 0) = x;
+				X.nodeLocations(node, 1) = y;
+
+				VectorXd latent(3);
+				latent << 0.05*x, 0.05*y, 0.02*sin(10*x*y);
+				X.graph.nodesData.row(node) = (orthonormal*latent).transpose();
+				Y.graph.nodesData(node) = (x < 0.4) ? 0 : ((y < 0.6) ? 1 : -1);
+			}
+			Y.confidences = MatrixXd::Constant(numNodes, 3, 1.0/3);
+			Y.confidencesAvailable = true;
+
+			IFeatureFunction* defaultFeatures = new DenseCRFFeatures();
+			IFeatureFunction* exactFeatures = new DenseCRFFeatures(DenseCRFFeatures::EXACT);
+			IFeatureFunction* filteredFeatures = new DenseCRFFeatures(DenseCRFFeatures::FILTERED);
+			set<int> action;
+			RankFeatures phiDefault = defaultFeatures->computeFeatures(X, Y, action);
+			RankFeatures phiExact = exactFeatures->computeFeatures(X, Y, action);
+			RankFeatures phiFiltered = filteredFeatures->computeFeatures(X, Y, action);
+
+			// exact is the default mode
+			bool defaultOkay = (phiDefault.data - phiExact.data).cwiseAbs().sum() < EPSILON;
+			Assert::AreEqual(defaultOkay, true);
+
+			// projected appearance lattice is built once per image
+			Assert::AreEqual(X.denseCRFLattices != NULL, true);
+			Assert::AreEqual(X.denseCRFLattices->appearance.getNumVertices() > 0, true);
+
+			VectorXd diff = phiFiltered.data - phiExact.data;
+			VectorXd pairwiseDiff = diff.tail(diff.size()-3);
+			bool pairwiseOkay = pairwiseDiff.cwiseAbs().maxCoeff() < TOLERANCE;
+			Assert::AreEqual(pairwiseOkay, true);
+			bool relativeOkay = pairwiseDiff.norm() < 0.01*phiExact.data.tail(diff.size()-3).norm();
+			Assert::AreEqual(relativeOkay, true);
+
+			// cached lattices give the same features
+			RankFeatures phiCached = filteredFeatures->computeFeatures(X, Y, action);
+			bool cachedOkay = (phiCached.data - phiFiltered.data).cwiseAbs().sum() < EPSILON;
+			Assert::AreEqual(cachedOkay, true);
+
+			delete defaultFeatures;
+			delete exactFeatures;
+			delete filteredFeatures;
+		}
+
+		TEST_METHOD(CompressedAdjListTest)
+		{
+			AdjList_t edgeNeighbors = AdjList_t();
+			edgeNeighbors[0].insert(3);
+			edgeNeighbors[0].insert(1);
+			edgeNeighbors[1].insert(0);
+			edgeNeighbors[3].insert(0);
+
+			SharedAdjList adjList = edgeNeighbors;
+			shared_ptr< const CompressedAdjList > compressed = adjList.getCompressed();
+
+			// rows up to the largest node, node 2 has no neighbors
+			Assert::AreEqual(compressed->getNumNodes(), 4);
+			Assert::AreEqual(compressed->getNumEdges(), 4);
+			Assert::AreEqual(adjList.neighbors(2).size(), 0);
+			Assert::AreEqual(adjList.neighbors(7).size(), 0);
+
+			// neighbors are sorted like the neighbor sets
+			NeighborRange neighbors = adjList.neighbors(0);
+			Assert::AreEqual(neighbors.size(), 2);
+			Assert::AreEqual(*neighbors.begin(), 1);
+			Assert::AreEqual(*(neighbors.begin()+1), 3);
+
+			// edge index follows (node1, node2) order
+			Assert::AreEqual(compressed->edgeIndex(0, 1), 0);
+			Assert::AreEqual(compressed->edgeIndex(0, 3), 1);
+			Assert::AreEqual(compressed->edgeIndex(3, 0), 3);
+			Assert::AreEqual(compressed->edgeIndex(1, 3), -1);
+
+			// copies share the compressed form, writes rebuild it
+			SharedAdjList copy = adjList;
+			Assert::AreEqual(copy.getCompressed() == compressed, true);
+			copy[2].insert(3);
+			copy.compress();
+			Assert::AreEqual(copy.neighbors(2).size(), 1);
+			Assert::AreEqual(adjList.neighbors(2).size(), 0);
+		}
+
+		TEST_METHOD(LabelingHashIncrementalTest)
+		{
+			LabelGraph graph1;
+			graph1.nodesData = VectorXi::Zero(4);
+			graph1.nodesData <<	1, 2, 3, 4;
+
+			LabelGraph graph2;
+			graph2.nodesData = VectorXi::Zero(4);
+			graph2.nodesData <<	1, 2, 1, 4;
+
+			ImgLabeling Y1;
+			Y1.graph = graph1;
+			ImgLabeling Y2;
+			Y2.graph = graph2;
+
+			LabelingHash_t hash1 = LabelingHash::compute(Y1);
+			LabelingHash_t hash2 = LabelingHash::compute(Y2);
+
+			// relabeling node 2 from 3 to 1 updates the hash to the recomputed hash
+			Assert::AreEqual(LabelingHash::update(hash1, 2, 3, 1) == hash2, true);
+			Assert::AreEqual(LabelingHash::update(hash2, 2, 1, 3) == hash1, true);
+			Assert::AreEqual(hash1 == hash2, false);
+
+			// the check hash is updated the same way but differs from the primary hash
+			LabelingHash_t check1 = LabelingHash::compute(Y1, LabelingHash::CHECK_SEED);
+			LabelingHash_t check2 = LabelingHash::compute(Y2, LabelingHash::CHECK_SEED);
+			Assert::AreEqual(LabelingHash::update(check1, 2, 3, 1, LabelingHash::CHECK_SEED) == check2, true);
+			Assert::AreEqual(check1 == hash1, false);
+		}
+
+		TEST_METHOD(IncrementalFeaturesTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 1, false);
+			Global::settings->CLASSES.addClass(1, 0, false);
+			Global::settings->CLASSES.addClass(2, -1, true);
+			Global::settings->CLASSES.setBackgroundLabel(-1);
+
+			double EPSILON = 0.0001;
+
+			AdjList_t edgeNeighbors = AdjList_t();
+			edgeNeighbors[0].insert(1);
+			edgeNeighbors[0].insert(3);
+			edgeNeighbors[1].insert(0);
+			edgeNeighbors[1].insert(2);
+			edgeNeighbors[2].insert(1);
+			edgeNeighbors[2].insert(3);
+			edgeNeighbors[3].insert(0);
+			edgeNeighbors[3].insert(2);
+
+			FeatureGraph graph1;
+			graph1.nodesData = MatrixXd(4, 3);
+			graph1.nodesData << 0.1, 0.2, 0.3,
+					0.2, 0.4, 0.6,
+					1.5, 3.0, 4.5,
+					3.1, 4.5, 9.2;
+			graph1.adjList = edgeNeighbors;
+
+			ImgFeatures X;
+			X.graph = graph1;
+
+			ImgLabeling YPred;
+			YPred.graph.nodesData = VectorXi::Zero(4);
+			YPred.graph.nodesData << 0, 1, 1, 0;
+			YPred.graph.adjList = X.graph.adjList;
+
+			// relabel two neighboring nodes
+			ImgCandidate YCandidate(&YPred);
+			YCandidate.relabel(1, -1);
+			YCandidate.relabel(2, 0);
+			ImgLabeling YNew = YCandidate.getLabeling();
+
+			IFeatureFunction* featureFunctionTest = new StandardFeatures();
+			FeatureAccumulators parentAcc;
+			FeatureAccumulators acc;
+			Assert::AreEqual(featureFunctionTest->computeAccumulators(X, YPred, parentAcc), true);
+			Assert::AreEqual(featureFunctionTest->updateAccumulators(X, YCandidate, parentAcc, acc), true);
+
+			// incremental features equal recomputed features
+			set<int> action;
+			RankFeatures phiIncremental = featureFunctionTest->computeFeatures(X, acc);
+			RankFeatures phiFull = featureFunctionTest->computeFeatures(X, YNew, action);
+			bool okay = (phiIncremental.data - phiFull.data).cwiseAbs().sum() < EPSILON;
+			Assert::AreEqual(okay, true);
+
+			delete featureFunctionTest;
+		}
+
+		TEST_METHOD(FloatFeaturesTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 1, false);
+			Global::settings->CLASSES.addClass(1, 0, false);
+			Global::settings->CLASSES.addClass(2, -1, true);
+			Global::settings->CLASSES.setBackgroundLabel(-1);
+
+			double EPSILON = 0.0001;
+
+			// ring of nodes with feature dim not a multiple of the SIMD width
+			const int numNodes = 12;
+			const int featureDim = 11;
+
+			AdjList_t edgeNeighbors = AdjList_t();
+			for (int node = 0; node < numNodes; node++)
+			{
+				edgeNeighbors[node].insert((node+1) % numNodes);
+				edgeNeighbors[(node+1) % numNodes].insert(node);
+			}
+
+			ImgFeatures X;
+			X.graph.nodesData = MatrixXd(numNodes, featureDim);
+			for (int node = 0; node < numNodes; node++)
+				for (int feat = 0; feat < featureDim; feat++)
+					X.graph.nodesData(node, feat) = 0.1*((node*7 + feat*3) % 13);
+			X.graph.adjList = edgeNeighbors;
+
+			ImgLabeling YPred;
+			YPred.graph.nodesData = VectorXi::Zero(numNodes);
+			for (int node = 0; node < numNodes; node++)
+				YPred.graph.nodesData(node) = node % 3 - 1;
+			YPred.graph.adjList = X.graph.adjList;
+
+			IFeatureFunction* featureFunctionTest = new StandardFeatures();
+			set<int> action;
+			RankFeatures phiDouble = featureFunctionTest->computeFeatures(X, YPred, action);
+
+			// long distributions with zero entries for the symmetric KL divergence
+			const int numBins = 1003;
+			vector<float> p(numBins);
+			vector<float> q(numBins);
+			double KLDouble = 0;
+			for (int bin = 0; bin < numBins; bin++)
+			{
+				p[bin] = (bin % 17 == 0) ? 0.0f : 1.0f/(1 + bin % 29);
+				q[bin] = (bin % 23 == 0) ? 0.0f : 1.0f/(1 + (bin*7) % 31);
+				if (p[bin] != 0 && q[bin] != 0)
+					KLDouble += (static_cast<double>(p[bin]) - q[bin]) * log(static_cast<double>(p[bin]) / q[bin]);
+			}
+
+			// single-precision kernels agree with double precision for every instruction set
+			MySIMD::InstructionSet defaultInstructionSet = MySIMD::getInstructionSet();
+			MySIMD::InstructionSet instructionSets[] = { MySIMD::SCALAR, MySIMD::AVX2, MySIMD::AVX512 };
+			for (int i = 0; i < 3; i++)
+			{
+				MySIMD::setInstructionSet(instructionSets[i]);
+
+				ImgFeatures XFloat;
+				XFloat.graph = X.graph;
+				XFloat.computeFloatFeatures();
+				XFloat.computeEdgeKernels();
+
+				RankFeatures phiFloat = featureFunctionTest->computeFeatures(XFloat, YPred, action);
+				bool okay = (phiDouble.data - phiFloat.data).cwiseAbs().maxCoeff() < EPSILON;
+				Assert::AreEqual(okay, true);
+
+				// float terms summed in double stay within float rounding of the double sum
+				double KLFloat = MySIMD::symmetricKL(&p[0], &q[0], numBins);
+				Assert::AreEqual(abs(KLFloat - KLDouble) < 1e-6*KLDouble, true);
+			}
+			MySIMD::setInstructionSet(defaultInstructionSet);
+
+			delete featureFunctionTest;
+		}
+
+		TEST_METHOD(StandardFeaturesInPlaceTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 1, false);
+			Global::settings->CLASSES.addClass(1, 0, false);
+			Global::settings->CLASSES.addClass(2, -1, true);
+			Global::settings->CLASSES.setBackgroundLabel(-1);
+
+			double EPSILON = 0.0001;
+
+			AdjList_t edgeNeighbors = AdjList_t();
+			edgeNeighbors[0].insert(1);
+			edgeNeighbors[0].insert(3);
+			edgeNeighbors[1].insert(0);
+			edgeNeighbors[1].insert(2);
+			edgeNeighbors[2].insert(1);
+			edgeNeighbors[2].insert(3);
+			edgeNeighbors[3].insert(0);
+			edgeNeighbors[3].insert(2);
+
+			FeatureGraph graph1;
+			graph1.nodesData = MatrixXd(4, 3);
+			graph1.nodesData << 0.1, 0.2, 0.3,
+					0.2, 0.4, 0.6,
+					1.5, 3.0, 4.5,
+					3.1, 4.5, 9.2;
+			graph1.adjList = edgeNeighbors;
+
+			ImgFeatures X;
+			X.graph = graph1;
+
+			ImgLabeling YPred;
+			YPred.graph.nodesData = VectorXi::Zero(4);
+			YPred.graph.nodesData << 0, 1, -1, 0;
+			YPred.graph.adjList = X.graph.adjList;
+
+			IFeatureFunction* standardFeatures = new StandardFeatures();
+			IFeatureFunction* countsFeatures = new StandardPairwiseCountsFeatures();
+
+			// in-place accumulated features equal the per-edge features, with and without cached edge kernels
+			set<int> action;
+			for (int cached = 0; cached < 2; cached++)
+			{
+				if (cached)
+					X.computeEdgeKernels();
+
+				FeatureAccumulators acc;
+				Assert::AreEqual(standardFeatures->computeAccumulators(X, YPred, acc), true);
+				RankFeatures phiFull = standardFeatures->computeFeatures(X, YPred, action);
+				RankFeatures phiInPlace = standardFeatures->computeFeatures(X, acc);
+				Assert::AreEqual(phiFull.data.size() == phiInPlace.data.size(), true);
+				Assert::AreEqual((phiFull.data - phiInPlace.data).cwiseAbs().sum() < EPSILON, true);
+
+				FeatureAccumulators countsAcc;
+				Assert::AreEqual(countsFeatures->computeAccumulators(X, YPred, countsAcc), true);
+				RankFeatures phiCountsFull = countsFeatures->computeFeatures(X, YPred, action);
+				RankFeatures phiCountsInPlace = countsFeatures->computeFeatures(X, countsAcc);
+				Assert::AreEqual((phiCountsFull.getDense() - phiCountsInPlace.getDense()).cwiseAbs().sum() < EPSILON, true);
+			}
+
+			delete standardFeatures;
+			delete countsFeatures;
+		}
+
+		TEST_METHOD(SparseRankFeaturesTest)
+		{
+			double EPSILON = 0.0001;
+
+			VectorXd denseData = VectorXd::Zero(12);
+			denseData << 0.5, 0, 0, 1.5, 0, 0, 0, -2.0, 0, 0, 0, 3.0;
+			SparseVector<double> sparseData = denseData.sparseView();
+
+			RankFeatures denseFeatures(denseData);
+			RankFeatures sparseFeatures(sparseData);
+
+			// only the nonzeros are stored
+			Assert::AreEqual(sparseFeatures.sparse, true);
+			Assert::AreEqual(sparseFeatures.size(), denseFeatures.size());
+			Assert::AreEqual(static_cast<int>(sparseFeatures.sparseData.nonZeros()), 4);
+			Assert::AreEqual((sparseFeatures.getDense() - denseData).cwiseAbs().sum() < EPSILON, true);
+
+			// stacked sparse features equal stacked dense features
+			vector<RankFeatures> featuresList;
+			featuresList.push_back(denseFeatures);
+			featuresList.push_back(sparseFeatures);
+			RankFeaturesMatrix featuresMatrix = IRankModel::stackFeatures(featuresList);
+			Assert::AreEqual((featuresMatrix.row(0) - featuresMatrix.row(1)).cwiseAbs().sum() < EPSILON, true);
+		}
+
+		TEST_METHOD(IncrementalPruneFeaturesTest)
+		{
+			Global::settings = new Settings();
+			for (int label = 0; label < 8; label++)
+				Global::settings->CLASSES.addClass(label, label, false);
+
+			double EPSILON = 0.0001;
+
+			// 3x3 grid
+			AdjList_t edgeNeighbors = AdjList_t();
+			for (int node = 0; node < 9; node++)
+			{
+				if (node % 3 < 2)
+				{
+					edgeNeighbors[node].insert(node+1);
+					edgeNeighbors[node+1].insert(node);
+				}
+				if (node < 6)
+				{
+					edgeNeighbors[node].insert(node+3);
+					edgeNeighbors[node+3].insert(node);
+				}
+			}
+
+			ImgFeatures X;
+			X.graph.nodesData = MatrixXd::Zero(9, 3);
+			X.graph.adjList = edgeNeighbors;
+			X.nodeLocations = MatrixXd(9, 2);
+			for (int node = 0; node < 9; node++)
+			{
+				X.nodeLocations(node, 0) = (node % 3)/3.0;
+				X.nodeLocations(node, 1) = (node / 3)/3.0;
+			}
+			X.nodeLocationsAvailable = true;
+
+			ImgLabeling YPred;
+			YPred.graph.nodesData = VectorXi::Zero(9);
+			YPred.graph.nodesData << 1, 1, 3,
+					1, 1, 1,
+					4, 1, 3;
+			YPred.graph.adjList = X.graph.adjList;
+
+			StandardPruneFeatures* featureFunctionTest = new StandardPruneFeatures();
+			FeatureAccumulators parentAcc;
+			Assert::AreEqual(featureFunctionTest->computeAccumulators(X, YPred, parentAcc), true);
+
+			// make a hole in the middle, move a boundary node of label 3, 
+			// then move a boundary node of label 1 that shares its boundary
+			ImgCandidate YHole(&YPred);
+			YHole.relabel(4, 5);
+			ImgCandidate YBoundary(&YPred);
+			YBoundary.relabel(2, 1);
+			ImgCandidate YShared(&YPred);
+			YShared.relabel(0, 2);
+
+			ImgCandidate* candidates[] = {&YHole, &YBoundary, &YShared};
+			for (int i = 0; i < 3; i++)
+			{
+				ImgLabeling YNew = candidates[i]->getLabeling();
+				RankFeatures phiIncremental = featureFunctionTest->computeFeatures(X, *candidates[i], parentAcc);
+				RankFeatures phiFull = featureFunctionTest->computeFeatures(X, YNew, candidates[i]->action);
+				bool okay = (phiIncremental.getDense() - phiFull.getDense()).cwiseAbs().sum() < EPSILON;
+				Assert::AreEqual(okay, true);
+			}
+
+			// chained updates keep the extents of the parent accumulators
+			FeatureAccumulators acc;
+			Assert::AreEqual(featureFunctionTest->updateAccumulators(X, YBoundary, parentAcc, acc), true);
+			ImgLabeling YBoundaryLabeling = YBoundary.getLabeling();
+			ImgCandidate YLast(&YBoundaryLabeling);
+			YLast.relabel(8, 1);
+			FeatureAccumulators lastAcc;
+			Assert::AreEqual(featureFunctionTest->updateAccumulators(X, YLast, acc, lastAcc), true);
+			ImgLabeling YLastLabeling = YLast.getLabeling();
+			FeatureAccumulators fullAcc;
+			featureFunctionTest->computeAccumulators(X, YLastLabeling, fullAcc);
+			Assert::AreEqual(lastAcc.locationExtents == fullAcc.locationExtents, true);
+
+			delete featureFunctionTest;
+		}
+
+		TEST_METHOD(ContextTermsTest)
+		{
+			Global::settings = new Settings();
+			const int numClasses = 8;
+			for (int label = 0; label < numClasses; label++)
+				Global::settings->CLASSES.addClass(label, label, false);
+
+			const int numPairs = (numClasses*(numClasses+1))/2;
+			const int numNodes = 30;
+
+			// 6x5 grid, so many nodes share coordinates
+			ImgFeatures X;
+			X.graph.nodesData = MatrixXd::Zero(numNodes, 2);
+			X.nodeLocations = MatrixXd(numNodes, 2);
+			for (int node = 0; node < numNodes; node++)
+			{
+				X.nodeLocations(node, 0) = (node % 6)/6.0;
+				X.nodeLocations(node, 1) = (node / 6)/5.0;
+			}
+			X.nodeLocationsAvailable = true;
+
+			StandardContextFeatures* contextFeatures = new StandardContextFeatures();
+			StandardPruneFeatures* pruneFeatures = new StandardPruneFeatures();
+
+			srand(14);
+			for (int trial = 0; trial < 100; trial++)
+			{
+				ImgLabeling Y;
+				Y.graph.nodesData = VectorXi(numNodes);
+				for (int node = 0; node < numNodes; node++)
+					Y.graph.nodesData(node) = rand() % (2 + trial % (numClasses-1));
+				if (trial % 2 == 1)
+				{
+					// sparse labels, so labels often share a single row or column
+					for (int node = 0; node < numNodes; node++)
+						if (rand() % 4 != 0)
+							Y.graph.nodesData(node) = 0;
+				}
+				Y.graph.adjList = X.graph.adjList;
+
+				set<int> action;
+				for (int i = 0; i < 1 + trial % 4; i++)
+					action.insert(rand() % numNodes);
+
+				// relative locations over all ordered pairs of differently labeled nodes
+				VectorXd contextExpected = VectorXd::Zero(numPairs*4);
+				for (int node1 = 0; node1 < numNodes; node1++)
+				{
+					for (int node2 = 0; node2 < numNodes; node2++)
+					{
+						int label1 = Y.getLabel(node1);
+						int label2 = Y.getLabel(node2);
+						if (node1 == node2 || label1 == label2)
+							continue;
+
+						int i = min(label1, label2);
+						int j = max(label1, label2);
+						int classIndex = (numClasses*(numClasses+1)-(numClasses-i)*(numClasses-i+1))/2+(numClasses-1-j);
+
+						if (X.getNodeLocationX(node1) < X.getNodeLocationX(node2))
+							contextExpected(classIndex*4 + 0) = 1;
+						else if (X.getNodeLocationX(node1) > X.getNodeLocationX(node2))
+							contextExpected(classIndex*4 + 1) = 1;
+						if (X.getNodeLocationY(node1) < X.getNodeLocationY(node2))
+							contextExpected(classIndex*4 + 2) = 1;
+						else if (X.getNodeLocationY(node1) > X.getNodeLocationY(node2))
+							contextExpected(classIndex*4 + 3) = 1;
+					}
+				}
+
+				// manual mutex constraints of action nodes against all other nodes
+				VectorXd mutexExpected = VectorXd::Zero(8);
+				const int constrainedLabels[] = {3, 4, 5, 7};
+				for (set<int>::iterator it = action.begin(); it != action.end(); ++it)
+				{
+					for (int node2 = 0; node2 < numNodes; node2++)
+					{
+						int node1 = *it;
+						if (node1 == node2)
+							continue;
+
+						for (int k = 0; k < 4; k++)
+						{
+							int label = constrainedLabels[k];
+							if (Y.getLabel(node1) == 1 && Y.getLabel(node2) == label
+								&& X.getNodeLocationY(node1) > X.getNodeLocationY(node2))
+								mutexExpected(2*k) = 1;
+							if (Y.getLabel(node1) == label && Y.getLabel(node2) == 1
+								&& X.getNodeLocationY(node1) < X.getNodeLocationY(node2))
+								mutexExpected(2*k+1) = 1;
+						}
+					}
+				}
+
+				VectorXd contextPhi = contextFeatures->computeFeatures(X, Y, action).getDense();
+				Assert::AreEqual(contextPhi.tail(numPairs*4) == contextExpected, true);
+
+				VectorXd prunePhi = pruneFeatures->computeFeatures(X, Y, action).getDense();
+				Assert::AreEqual(prunePhi.segment(1, 8) == mutexExpected, true);
+			}
+
+			delete contextFeatures;
+			delete pruneFeatures;
+		}
+
+		TEST_METHOD(LabelComponentsUpdateTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 0, true);
+			Global::settings->CLASSES.addClass(1, 1, false);
+			Global::settings->CLASSES.setBackgroundLabel(0);
+
+			// 3x3 grid
+			AdjList_t edgeNeighbors = AdjList_t();
+			for (int node = 0; node < 9; node++)
+			{
+				if (node % 3 < 2)
+				{
+					edgeNeighbors[node].insert(node+1);
+					edgeNeighbors[node+1].insert(node);
+				}
+				if (node < 6)
+				{
+					edgeNeighbors[node].insert(node+3);
+					edgeNeighbors[node+3].insert(node);
+				}
+			}
+
+			ImgLabeling Y;
+			Y.graph.nodesData = VectorXi::Zero(9);
+			Y.graph.nodesData << 1, 0, 1,
+					1, 1, 1,
+					0, 0, 0;
+			Y.graph.adjList = edgeNeighbors;
+
+			LabelComponents parent(Y);
+			Assert::AreEqual(parent.numComponents, 3);
+			Assert::AreEqual(parent.numForeground, 1);
+
+			// cut the foreground component in two and join the background components
+			set<int> action;
+			action.insert(4);
+			ImgLabeling YSplit = Y;
+			YSplit.graph.nodesData(4) = 0;
+
+			LabelComponents* split = parent.update(YSplit, action);
+			LabelComponents splitFull(YSplit);
+			Assert::AreEqual(split->matches(YSplit), true);
+			Assert::AreEqual(split->numComponents, splitFull.numComponents);
+			Assert::AreEqual(split->numComponents, 3);
+			Assert::AreEqual(split->numForeground, 2);
+			Assert::AreEqual(split->nodeComponents[0] == split->nodeComponents[3], true);
+			Assert::AreEqual(split->nodeComponents[0] != split->nodeComponents[2], true);
+			Assert::AreEqual(split->nodeComponents[1] == split->nodeComponents[8], true);
+
+			// join them again
+			LabelComponents* joined = split->update(Y, action);
+			Assert::AreEqual(joined->matches(Y), true);
+			Assert::AreEqual(joined->numComponents, 3);
+			Assert::AreEqual(joined->numForeground, 1);
+			Assert::AreEqual(joined->hasExactlyOnePositiveCC(), true);
+
+			delete split;
+			delete joined;
+		}
+
+		TEST_METHOD(ConfidenceOrderTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 1, false);
+			Global::settings->CLASSES.addClass(1, 0, false);
+			Global::settings->CLASSES.addClass(2, -1, true);
+			Global::settings->CLASSES.setBackgroundLabel(-1);
+
+			ImgLabeling Y;
+			Y.graph.nodesData = VectorXi::Zero(2);
+			MatrixXd confidences(2, 3);
+			confidences << 0.2, 0.5, 0.3,
+					0.6, 0.1, 0.3;
+			Y.confidences = confidences;
+			Y.confidencesAvailable = true;
+			Y.confidences.computeClassOrder();
+
+			// copies share the order
+			ImgLabeling YCopy = Y;
+			Assert::AreEqual(YCopy.confidences.classOrderAvailable(), true);
+
+			vector<int> labels = YCopy.getLabelsByConfidence(0);
+			Assert::AreEqual(labels[0], 0);
+			Assert::AreEqual(labels[1], -1);
+			Assert::AreEqual(labels[2], 1);
+			Assert::AreEqual(YCopy.getMostConfidentLabel(1), 1);
+
+			set<int> topLabels = YCopy.getTopConfidentLabels(1, 2);
+			Assert::AreEqual(static_cast<int>(topLabels.size()), 2);
+			Assert::AreEqual(topLabels.count(1) == 1 && topLabels.count(-1) == 1, true);
+
+			// changing the confidences discards the order
+			Y.confidences.mutate()(0, 0) = 0.9;
+			Assert::AreEqual(Y.confidences.classOrderAvailable(), false);
+			Assert::AreEqual(Y.getMostConfidentLabel(0), 1);
+		}
+
+		TEST_METHOD(CutEdgeWeightsCacheTest)
+		{
+			Global::settings = new Settings();
+			Global::settings->CLASSES.addClass(0, 1, false);
+			Global::settings->CLASSES.addClass(1, 0, false);
+
+			double EPSILON = 0.0001;
+
+			AdjList_t edgeNeighbors = AdjList_t();
+			edgeNeighbors[0].insert(1);
+			edgeNeighbors[1].insert(0);
+			edgeNeighbors[1].insert(2);
+			edgeNeighbors[2].insert(1);
+
+			ImgFeatures X;
+			X.graph.nodesData = MatrixXd(3, 2);
+			X.graph.nodesData << 0.5, 0.5,
+					0.4, 0.6,
+					0.9, 0.1;
+			X.graph.adjList = edgeNeighbors;
+			X.edgeWeightsAvailable = false;
+
+			ImgLabeling YPred;
+			YPred.graph.nodesData = VectorXi::Zero(3);
+			YPred.graph.nodesData << 1, 1, 0;
+			YPred.graph.adjList = X.graph.adjList;
+
+			// weights are computed on the first step and reused afterwards
+			Rand::beginStreams("image", 0);
+			ISuccessorFunction* successorFunction = new StochasticSuccessor(false, 0.5);
+			successorFunction->generateSuccessors(X, YPred, 0, 10);
+			Assert::AreEqual(X.cutEdgeWeights != NULL, true);
+			const CutEdgeWeights* cutEdgeWeights = X.cutEdgeWeights.get();
+			Assert::AreEqual(static_cast<int>(cutEdgeWeights->weights.size()), 4);
+
+			successorFunction->generateSuccessors(X, YPred, 1, 10);
+			Assert::AreEqual(X.cutEdgeWeights.get() == cutEdgeWeights, true);
+
+			// weight of (0, 1) is exp(-KL*T/2)
+			double KL = 0.5*log(0.5/0.4) + 0.5*log(0.5/0.6) + 0.4*log(0.4/0.5) + 0.6*log(0.6/0.5);
+			bool okay = abs(cutEdgeWeights->weights[0] - exp(-KL*0.5/2)) < EPSILON;
+			Assert::AreEqual(okay, true);
+
+			delete successorFunction;
+		}
+
+		TEST_METHOD(TranspositionTableEvictionTest)
+		{
+			RankFeatures noFeatures;
+			FeatureAccumulators noAccumulators;
+
+			// LRU: a hit on the oldest entry protects it from eviction
+			TranspositionTable lruTable;
+			lruTable.reset(2, EVICT_LRU, false);
+			lruTable.insert(1, 1, 0.1, 1.1, noFeatures, noFeatures, noAccumulators, noAccumulators);
+			lruTable.insert(2, 2, 0.2, 1.2, noFeatures, noFeatures, noAccumulators, noAccumulators);
+			lruTable.recordLookup(1, lruTable.find(1, 1) != NULL);
+			lruTable.insert(3, 3, 0.3, 1.3, noFeatures, noFeatures, noAccumulators, noAccumulators);
+
+			Assert::AreEqual(lruTable.find(1, 1) != NULL, true);
+			Assert::AreEqual(lruTable.find(2, 2) == NULL, true);
+			Assert::AreEqual(lruTable.find(3, 3)->cost, 1.3);
+			Assert::AreEqual(lruTable.getNumHits(), 1);
+			Assert::AreEqual(lruTable.getNumEvictions(), 1);
+
+			// FIFO: the oldest entry is evicted regardless of hits
+			TranspositionTable fifoTable;
+			fifoTable.reset(2, EVICT_FIFO, false);
+			fifoTable.insert(1, 1, 0.1, 1.1, noFeatures, noFeatures, noAccumulators, noAccumulators);
+			fifoTable.insert(2, 2, 0.2, 1.2, noFeatures, noFeatures, noAccumulators, noAccumulators);
+			fifoTable.recordLookup(1, fifoTable.find(1, 1) != NULL);
+			fifoTable.insert(3, 3, 0.3, 1.3, noFeatures, noFeatures, noAccumulators, noAccumulators);
+
+			Assert::AreEqual(fifoTable.find(1, 1) == NULL, true);
+			Assert::AreEqual(fifoTable.find(2, 2) != NULL, true);
+			Assert::AreEqual(fifoTable.size(), 2);
+
+			// a labeling with the same hash but another check hash is a miss
+			Assert::AreEqual(fifoTable.find(2, 7) == NULL, true);
+			fifoTable.insert(2, 7, 0.7, 1.7, noFeatures, noFeatures, noAccumulators, noAccumulators);
+			Assert::AreEqual(fifoTable.find(2, 2)->cost, 1.2);
+		}
+
+		TEST_METHOD(BoundedCostSetEvictionTest)
+		{
+			ImgFeatures X;
+			ImgLabeling YTruth;
+			ImgLabeling YInit;
+			setupSearchProblemHelper(X, YTruth, YInit);
+
+			SearchSpace* searchSpace = new SearchSpace(NULL, NULL, new FixedInitialPrediction(YInit), 
+				new FlipbitSuccessor(), new NoPrune(), new HammingLoss());
+			ISearchProcedure::SearchMetadata searchMetadata;
+			searchMetadata.exampleName = "image";
+			searchMetadata.iter = 0;
+
+			// unbounded reference run
+			CostSetEvictionProbe unboundedSearch(3);
+			ImgLabeling YUnbounded = unboundedSearch.performSearch(LL, X, &YTruth, 8, searchSpace, NULL, NULL, NULL, searchMetadata);
+			Assert::AreEqual(unboundedSearch.numEvicted, 0);
+
+			// bounded run follows the same search and returns the same labeling
+			Global::settings->MAX_COST_SET_SIZE = 2;
+			CostSetEvictionProbe boundedSearch(3);
+			ImgLabeling YBounded = boundedSearch.performSearch(LL, X, &YTruth, 8, searchSpace, NULL, NULL, NULL, searchMetadata);
+			Assert::AreEqual(YBounded.graph.nodesData == YUnbounded.graph.nodesData, true);
+			Assert::AreEqual(boundedSearch.getLastSearchStats().numNodes, unboundedSearch.getLastSearchStats().numNodes);
+
+			// only worse nodes outside of the open set are evicted, each labeling once and never accepted again
+			Assert::AreEqual(boundedSearch.numEvicted > 0, true);
+			Assert::AreEqual(boundedSearch.numOpenEvicted, 0);
+			Assert::AreEqual(boundedSearch.numNotWorseEvicted, 0);
+			Assert::AreEqual(boundedSearch.numEvictedTwice, 0);
+			Assert::AreEqual(boundedSearch.numEvictedAccepted, 0);
+
+			delete searchSpace;
+		}
+
+		TEST_METHOD(ThreadCountDeterminismTest)
+		{
+			ImgFeatures X;
+			ImgLabeling YTruth;
+			ImgLabeling YInit;
+			setupSearchProblemHelper(X, YTruth, YInit);
+
+			SearchSpace* searchSpace = new SearchSpace(new StandardFeatures(), new StandardFeatures(), 
+				new FixedInitialPrediction(YInit), new FlipbitSuccessor(), new NoPrune(), new HammingLoss());
+			ISearchProcedure::SearchMetadata searchMetadata;
+			searchMetadata.exampleName = "image";
+			searchMetadata.iter = 0;
+
+			const int featureDim = searchSpace->computeHeuristicFeatures(X, YInit).size();
+			VectorXd heuristicWeights = VectorXd::LinSpaced(featureDim, -1.0, 1.0);
+			VectorXd costWeights = VectorXd::LinSpaced(featureDim, 0.5, -0.5);
+			IRankModel* heuristicModel = new FixedRankModel(heuristicWeights);
+			IRankModel* costModel = new FixedRankModel(costWeights);
+
+			// successors are built and scored in parallel with 4 threads
+			Global::settings->NUM_THREADS = 1;
+			SearchTraceProbe serialSearch(2);
+			ImgLabeling YSerial = serialSearch.performSearch(HC, X, NULL, 5, searchSpace, heuristicModel, costModel, NULL, searchMetadata);
+
+			Global::settings->NUM_THREADS = 4;
+			SearchTraceProbe parallelSearch(2);
+			ImgLabeling YParallel = parallelSearch.performSearch(HC, X, NULL, 5, searchSpace, heuristicModel, costModel, NULL, searchMetadata);
+
+			// same prediction, same candidates in the same order with the same scores
+			Assert::AreEqual(YParallel.graph.nodesData == YSerial.graph.nodesData, true);
+			Assert::AreEqual(serialSearch.heuristics.empty(), false);
+			Assert::AreEqual(parallelSearch.heuristics == serialSearch.heuristics, true);
+			Assert::AreEqual(parallelSearch.costs == serialSearch.costs, true);
+			Assert::AreEqual(parallelSearch.getLastSearchStats().numNodes, serialSearch.getLastSearchStats().numNodes);
+			Assert::AreEqual(parallelSearch.getLastSearchStats().numSteps, serialSearch.getLastSearchStats().numSteps);
+
+			delete heuristicModel;
+			delete costModel;
+			delete searchSpace;
+		}
+
+		TEST_METHOD(CompactNodeReconstructionTest)
+		{
+			ImgFeatures X;
+			ImgLabeling YTruth;
+			ImgLabeling YInit;
+			setupSearchProblemHelper(X, YTruth, YInit);
+
+			SearchSpace* searchSpace = new SearchSpace(NULL, NULL, new FixedInitialPrediction(YInit), 
+				new FlipbitSuccessor(), new NoPrune(), new HammingLoss());
+
+			// labelings of a path: one relabeled node per level, except for level 5 
+			// which differs from its snapshot in more than half of the nodes
+			const int numNodes = YInit.getNumNodes();
+			vector< ImgLabeling > Ys;
+			Ys.push_back(YInit);
+			for (int depth = 1; depth <= 7; depth++)
+			{
+				ImgLabeling Y = Ys.back();
+				if (depth == 5)
+					Y.graph.nodesData = YTruth.graph.nodesData;
+				else
+					Y.graph.nodesData(depth) = (Y.graph.nodesData(depth) + 1) % 3;
+				Ys.push_back(Y);
+			}
+			Assert::AreEqual((Ys[5].graph.nodesData.array() != Ys[3].graph.nodesData.array()).count() > numNodes/2, true);
+
+			// the root has no snapshot; with an interval of 3, level 1 is a snapshot 
+			// since its parent has none, and levels 3 and 6 are snapshots by depth
+			SearchNodeProbe probe;
+			Global::settings->SEARCH_NODE_SNAPSHOT_INTERVAL = 0;
+			int node = probe.addRoot(LL, X, &YTruth, searchSpace, NULL, NULL);
+			Global::settings->SEARCH_NODE_SNAPSHOT_INTERVAL = 3;
+			for (int depth = 1; depth <= 7; depth++)
+				node = probe.addChild(node, Ys[depth]);
+
+			for (int depth = 0; depth <= 7; depth++)
+				Assert::AreEqual(probe.getY(depth).graph.nodesData == Ys[depth].graph.nodesData, true);
+
+			// same labeling as level 4: delta against the level 1 snapshot, 
+			// delta against the level 3 snapshot and not compact
+			int sameOtherSnapshot = probe.addChild(2, Ys[4]);
+			int sameSameSnapshot = probe.addChild(3, Ys[4]);
+			Global::settings->SEARCH_NODE_SNAPSHOT_INTERVAL = 0;
+			int sameNotCompact = probe.addChild(3, Ys[4]);
+
+			Assert::AreEqual(probe.getY(sameOtherSnapshot).graph.nodesData == Ys[4].graph.nodesData, true);
+			Assert::AreEqual(probe.hasSameLabeling(4, sameOtherSnapshot), true);
+			Assert::AreEqual(probe.hasSameLabeling(4, sameSameSnapshot), true);
+			Assert::AreEqual(probe.hasSameLabeling(4, sameNotCompact), true);
+			Assert::AreEqual(probe.hasSameLabeling(sameNotCompact, 4), true);
+			Assert::AreEqual(probe.hasSameLabeling(sameNotCompact, sameOtherSnapshot), true);
+			Assert::AreEqual(probe.hasSameLabeling(3, sameNotCompact), false);
+			Assert::AreEqual(probe.hasSameLabeling(sameNotCompact, 5), false);
+			Assert::AreEqual(probe.hasSameLabeling(sameSameSnapshot, 3), false);
+
+			// successors of a compact node are built from its reconstructed labeling
+			Global::settings->SEARCH_NODE_SNAPSHOT_INTERVAL = 3;
+			const int firstSuccessor = probe.size();
+			const int numSuccessors = probe.expand(4);
+			Assert::AreEqual(numSuccessors, 2*numNodes);
+			for (int i = firstSuccessor; i < firstSuccessor + numSuccessors; i++)
+			{
+				ImgLabeling YSuccessor = probe.getY(i);
+				Assert::AreEqual(static_cast<int>((YSuccessor.graph.nodesData.array() != Ys[4].graph.nodesData.array()).count()), 1);
+				Assert::AreEqual(probe.getCost(i), searchSpace->computeLoss(YSuccessor, YTruth));
+			}
+
+			delete searchSpace;
+		}
+
+		TEST_METHOD(BatchedRankNodesTest)
+		{
+			ImgFeatures X;
+			ImgLabeling YTruth;
+			ImgLabeling YInit;
+			setupSearchProblemHelper(X, YTruth, YInit);
+
+			double EPSILON = 0.0001;
+
+			SearchSpace* searchSpace = new SearchSpace(new StandardFeatures(), new StandardFeatures(), 
+				new FixedInitialPrediction(YInit), new FlipbitSuccessor(), new NoPrune(), new HammingLoss());
+
+			const int featureDim = searchSpace->computeHeuristicFeatures(X, YInit).size();
+			IRankModel* heuristicModel = new FixedRankModel(VectorXd::LinSpaced(featureDim, -1.0, 1.0));
+			IRankModel* costModel = new FixedRankModel(VectorXd::LinSpaced(featureDim, 0.5, -0.5));
+
+			// successors are scored with one matrix-vector product per model
+			SearchNodeProbe probe;
+			int root = probe.addRoot(HC, X, NULL, searchSpace, heuristicModel, costModel);
+			const int numSuccessors = probe.expand(root);
+			Assert::AreEqual(numSuccessors > 1, true);
+			for (int i = root + 1; i <= root + numSuccessors; i++)
+			{
+				Assert::AreEqual(probe.getHeuristicFeatures(i).sparse, false);
+				Assert::AreEqual(abs(probe.getHeuristic(i) - heuristicModel->rank(probe.getHeuristicFeatures(i))) < EPSILON, true);
+				Assert::AreEqual(abs(probe.getCost(i) - costModel->rank(probe.getCostFeatures(i))) < EPSILON, true);
+			}
+
+			delete heuristicModel;
+			delete costModel;
+			delete searchSpace;
+		}
+
+		TEST_METHOD(RankNodesShortWeightsTest)
+		{
+			ImgFeatures X;
+			ImgLabeling YTruth;
+			ImgLabeling YInit;
+			setupSearchProblemHelper(X, YTruth, YInit);
+
+			double EPSILON = 0.0001;
+
+			// dense heuristic features, sparse cost features
+			SearchSpace* searchSpace = new SearchSpace(new StandardFeatures(), new StandardPairwiseCountsFeatures(), 
+				new FixedInitialPrediction(YInit), new FlipbitSuccessor(), new NoPrune(), new HammingLoss());
+
+			// weights shorter than the features (trailing zero weights are not written to model files)
+			const int heuristicDim = searchSpace->computeHeuristicFeatures(X, YInit).size();
+			const int costDim = searchSpace->computeCostFeatures(X, YInit).size();
+			VectorXd heuristicWeights = VectorXd::LinSpaced(heuristicDim - 3, -1.0, 1.0);
+			VectorXd costWeights = VectorXd::LinSpaced(costDim - 3, 0.5, -0.5);
+			IRankModel* heuristicModel = new FixedRankModel(heuristicWeights);
+			IRankModel* costModel = new FixedRankModel(costWeights);
+
+			VectorXd paddedHeuristicWeights = VectorXd::Zero(heuristicDim);
+			paddedHeuristicWeights.head(heuristicDim - 3) = heuristicWeights;
+			VectorXd paddedCostWeights = VectorXd::Zero(costDim);
+			paddedCostWeights.head(costDim - 3) = costWeights;
+			FixedRankModel paddedHeuristicModel(paddedHeuristicWeights);
+			FixedRankModel paddedCostModel(paddedCostWeights);
+
+			// scores equal ranking the features one by one with zero-padded weights
+			SearchNodeProbe probe;
+			int root = probe.addRoot(HC, X, NULL, searchSpace, heuristicModel, costModel);
+			const int numSuccessors = probe.expand(root);
+			Assert::AreEqual(numSuccessors > 1, true);
+			for (int i = root + 1; i <= root + numSuccessors; i++)
+			{
+				Assert::AreEqual(probe.getHeuristicFeatures(i).sparse, false);
+				Assert::AreEqual(probe.getCostFeatures(i).sparse, true);
+				Assert::AreEqual(abs(probe.getHeuristic(i) - paddedHeuristicModel.rank(probe.getHeuristicFeatures(i))) < EPSILON, true);
+				Assert::AreEqual(abs(probe.getCost(i) - paddedCostModel.rank(probe.getCostFeatures(i))) < EPSILON, true);
+			}
+
+			delete heuristicModel;
+			delete costModel;
+			delete searchSpace;
+		}
+
+		TEST_METHOD(GreedyTimeBudgetTest)
+		{
+			ImgFeatures X;
+			ImgLabeling YTruth;
+			ImgLabeling YInit;
+			setupSearchProblemHelper(X, YTruth, YInit);
+
+			// every expansion takes longer than the budget
+			SearchSpace* searchSpace = new SearchSpace(NULL, NULL, new FixedInitialPrediction(YInit), 
+				new SlowFlipbitSuccessor(2), new NoPrune(), new HammingLoss());
+			ISearchProcedure::SearchMetadata searchMetadata;
+			searchMetadata.exampleName = "image";
+			searchMetadata.iter = 0;
+
+			// reference: a single step without a budget
+			GreedySearchProcedure oneStepSearch;
+			ImgLabeling YOneStep = oneStepSearch.performSearch(LL, X, &YTruth, 1, searchSpace, NULL, NULL, NULL, searchMetadata);
+			Assert::AreEqual(oneStepSearch.getLastSearchStats().budgetExhausted, false);
+
+			// the budget stops the search after the first expansion
+			searchMetadata.timeBudget = 1;
+			GreedySearchProcedure budgetSearch;
+			ImgLabeling YBudget = budgetSearch.performSearch(LL, X, &YTruth, 10, searchSpace, NULL, NULL, NULL, searchMetadata);
+			ISearchProcedure::SearchStats stats = budgetSearch.getLastSearchStats();
+			Assert::AreEqual(stats.budgetExhausted, true);
+			Assert::AreEqual(stats.numSteps, 1);
+			Assert::AreEqual(stats.numNodes, oneStepSearch.getLastSearchStats().numNodes);
+			Assert::AreEqual(stats.numNodes, 1 + 2*YInit.getNumNodes());
+
+			// and still returns the lowest cost labeling found
+			Assert::AreEqual(YBudget.graph.nodesData == YOneStep.graph.nodesData, true);
+			Assert::AreEqual(searchSpace->computeLoss(YBudget, YTruth) < searchSpace->computeLoss(YInit, YTruth), true);
+
+			delete searchSpace;
+		}
+
+		TEST_METHOD(BeamTimeBudgetTest)
+		{
+			ImgFeatures X;
+			ImgLabeling YTruth;
+			ImgLabeling YInit;
+			setupSearchProblemHelper(X, YTruth, YInit);
+
+			// every expansion takes longer than the budget
+			SearchSpace* searchSpace = new SearchSpace(NULL, NULL, new FixedInitialPrediction(YInit), 
+				new SlowFlipbitSuccessor(2), new NoPrune(), new HammingLoss());
+			ISearchProcedure::SearchMetadata searchMetadata;
+			searchMetadata.exampleName = "image";
+			searchMetadata.iter = 0;
+
+			// reference: a single step without a budget
+			BreadthFirstBeamSearchProcedure oneStepSearch(3);
+			ImgLabeling YOneStep = oneStepSearch.performSearch(LL, X, &YTruth, 1, searchSpace, NULL, NULL, NULL, searchMetadata);
+			Assert::AreEqual(oneStepSearch.getLastSearchStats().budgetExhausted, false);
+
+			// the budget stops the search after the first expansion
+			searchMetadata.timeBudget = 1;
+			BreadthFirstBeamSearchProcedure budgetSearch(3);
+			ImgLabeling YBudget = budgetSearch.performSearch(LL, X, &YTruth, 10, searchSpace, NULL, NULL, NULL, searchMetadata);
+			ISearchProcedure::SearchStats stats = budgetSearch.getLastSearchStats();
+			Assert::AreEqual(stats.budgetExhausted, true);
+			Assert::AreEqual(stats.numSteps, 1);
+			Assert::AreEqual(stats.numNodes, oneStepSearch.getLastSearchStats().numNodes);
+			Assert::AreEqual(stats.numNodes, 1 + 2*YInit.getNumNodes());
+
+			// and still returns the lowest cost labeling found
+			Assert::AreEqual(YBudget.graph.nodesData == YOneStep.graph.nodesData, true);
+			Assert::AreEqual(searchSpace->computeLoss(YBudget, YTruth) < searchSpace->computeLoss(YInit, YTruth), true);
+
+			delete searchSpace;
+		}
 	};
 }
\ No newline at end of file
@@ -21,5 +21,67 @@ namespace Testing
 			Assert::AreEqual(0, settings->paths->OUTPUT_DIR.compare("output\\"));
 			Assert::AreEqual(0, settings->paths->INPUT_DIR.compare("input\\"));
 		}
+
+		TEST_METHOD(ClassMapLookupTest)
+		{
+			ClassMap classes;
+			classes.addClass(0, 1, false);
+			classes.addClass(1, 0, false);
+			classes.addClass(2, -1, true);
+			classes.setBackgroundLabel(-1);
+
+			// negative labels map through the dense tables
+			Assert::AreEqual(classes.getClassIndex(1), 0);
+			Assert::AreEqual(classes.getClassIndex(0), 1);
+			Assert::AreEqual(classes.getClassIndex(-1), 2);
+			Assert::AreEqual(classes.getClassLabel(2), -1);
+			Assert::AreEqual(classes.classLabelIsBackground(-1), true);
+			Assert::AreEqual(classes.classLabelIsBackground(1), false);
+			Assert::AreEqual(classes.classIndexIsBackground(2), true);
+
+			// cached label list is sorted
+			const vector<int>& labels = classes.getLabelList();
+			Assert::AreEqual(static_cast<int>(labels.size()), 3);
+			Assert::AreEqual(labels[0], -1);
+			Assert::AreEqual(labels[2], 1);
+			Assert::AreEqual(static_cast<int>(classes.getLabels().size()), 3);
+		}
+
+		TEST_METHOD(RandomStreamTest)
+		{
+			// same (image, iteration, thread) gives the same draws
+			Rand::Stream stream1(1, "image1", 0, 0);
+			Rand::Stream stream2(1, "image1", 0, 0);
+			Rand::Stream otherImage(1, "image2", 0, 0);
+			Rand::Stream otherThread(1, "image1", 0, 1);
+
+			double draw1 = stream1();
+			Assert::AreEqual(draw1, stream2());
+			Assert::AreEqual(draw1 != otherImage(), true);
+			Assert::AreEqual(draw1 != otherThread(), true);
+			Assert::AreEqual(draw1 >= 0.0 && draw1 < 1.0, true);
+
+			// bulk draws continue the sequence
+			double bulk[8];
+			stream1.uniforms(bulk, 8);
+			for (int i = 0; i < 8; i++)
+				Assert::AreEqual(bulk[i], stream2());
+
+			// streams restart for each image
+			Global::settings = new Settings();
+			Rand::beginStreams("image1", 3);
+			double first = Rand::unifDist();
+			Rand::beginStreams("image2", 3);
+			Rand::beginStreams("image1", 3);
+			Assert::AreEqual(first, Rand::unifDist());
+
+			// shuffle is a permutation
+			int values[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+			Rand::shuffle(values, values + 10);
+			int sum = 0;
+			for (int i = 0; i < 10; i++)
+				sum += values[i];
+			Assert::AreEqual(sum, 45);
+		}
 	};
 }
\ No newline at end of file